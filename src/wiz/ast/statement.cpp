@@ -205,6 +205,7 @@ namespace wiz {
                 return makeFwdUnique<const Statement>(
                     In(
                         in.pieces,
+                        in.packedPieces,
                         in.dest ? in.dest->clone() : nullptr,
                         in.body ? in.body->clone() : nullptr),
                     location);            
@@ -297,13 +297,17 @@ namespace wiz {
         struct In {
             In(
                 const std::vector<StringView>& pieces,
+                const std::vector<std::vector<StringView>>& packedPieces,
                 FwdUniquePtr<const Expression> dest,
                 FwdUniquePtr<const Statement> body)
             : pieces(pieces),
+            packedPieces(packedPieces),
             dest(std::move(dest)),
             body(std::move(body)) {}
 
             std::vector<StringView> pieces;
+            // Additional banks that the declarations in the body can be packed into.
+            std::vector<std::vector<StringView>> packedPieces;
             FwdUniquePtr<const Expression> dest;
             FwdUniquePtr<const Statement> body;
         };    
@@ -1,3 +1,6 @@
+#include <algorithm>
+#include <cstring>
+
 #include <wiz/compiler/bank.h>
 #include <wiz/compiler/ir_node.h>
 #include <wiz/utility/report.h>
@@ -44,8 +47,9 @@ namespace wiz {
     origin(origin),
     relativePosition(0),
     capacity(capacity),
-    data(isBankKindStored(kind) ? capacity : 0, padValue),
-    ownership(capacity) {}
+    padValue(padValue),
+    dataPages(isBankKindStored(kind) ? (capacity + PageSize - 1) / PageSize : 0),
+    ownershipPages((capacity + PageSize - 1) / PageSize) {}
 
     Bank::~Bank() {}
 
@@ -57,6 +61,10 @@ namespace wiz {
         return kind;
     }
 
+    Optional<std::size_t> Bank::getOrigin() const {
+        return origin;
+    }
+
     std::size_t Bank::getCapacity() const {
         return capacity;
     }
@@ -77,12 +85,22 @@ namespace wiz {
         relativePosition = dest;
     }
 
-    ArrayView<std::uint8_t> Bank::getData() const {
-        return ArrayView<std::uint8_t>(data);
+    std::uint8_t Bank::getPadValue() const {
+        return padValue;
     }
 
-    ArrayView<std::uint8_t> Bank::getUsedData() const {
-        return ArrayView<std::uint8_t>(data.data(), calculateUsedSize());
+    std::size_t Bank::getStoredSize() const {
+        return isBankKindStored(kind) ? capacity : 0;
+    }
+
+    ArrayView<std::uint8_t> Bank::getPageData(std::size_t offset) const {
+        const auto page = offset / PageSize;
+        if (page >= dataPages.size() || dataPages[page] == nullptr) {
+            return ArrayView<std::uint8_t>();
+        }
+
+        const auto pageOffset = offset % PageSize;
+        return ArrayView<std::uint8_t>(dataPages[page].get() + pageOffset, getPageSize(page) - pageOffset);
     }
 
     void Bank::rewind() {
@@ -129,13 +147,13 @@ namespace wiz {
 
         const auto ownerID = match->second;
         for (std::size_t i = 0; i != size; ++i) {
-            if (ownership[relativePosition + i] != ownerID) {
+            if (getOwner(relativePosition + i) != ownerID) {
                 report->error("write conflict encountered at " + getAddressDescription(relativePosition + i)
                     + " while attempting to write byte " + std::to_string(i) + " of " + std::to_string(size)
                     + " byte(s) for " + description.toString(),
                     location, ReportErrorFlags::InternalError | ReportErrorFlags::Continued);
 
-                if (const auto previousID = ownership[relativePosition + i]) {
+                if (const auto previousID = getOwner(relativePosition + i)) {
                     const auto& previous = owners[previousID - 1];
                     report->error("address was supposed to be reserved here, by " + previous.description.toString(), previous.location, ReportErrorFlags::Fatal);
                 } else {
@@ -145,9 +163,13 @@ namespace wiz {
             }
         }
 
-        for (const auto& value : values) {
-            data[relativePosition++] = value;
+        for (std::size_t i = 0; i != size;) {
+            const auto offset = relativePosition + i;
+            const auto length = std::min(size - i, PageSize - offset % PageSize);
+            std::memcpy(getWritableData(offset), values.data() + i, length);
+            i += length;
         }
+        relativePosition += size;
         return true;
     }
 
@@ -173,14 +195,81 @@ namespace wiz {
     }
 
     std::size_t Bank::calculateUsedSize() const {
-        for (std::size_t i = ownership.size() - 1; i < ownership.size(); --i) {
-            if (ownership[i] != 0) {
-                return i + 1;
+        for (std::size_t page = ownershipPages.size() - 1; page < ownershipPages.size(); --page) {
+            if (const auto pageOwners = ownershipPages[page].get()) {
+                const auto pageSize = getPageSize(page);
+                for (std::size_t i = pageSize - 1; i < pageSize; --i) {
+                    if (pageOwners[i] != 0) {
+                        return page * PageSize + i + 1;
+                    }
+                }
             }
         }
         return 0;
     }
 
+    std::size_t Bank::calculateFreeSize() const {
+        std::size_t result = 0;
+        for (std::size_t page = 0; page != ownershipPages.size(); ++page) {
+            const auto pageSize = getPageSize(page);
+            if (const auto pageOwners = ownershipPages[page].get()) {
+                result += static_cast<std::size_t>(std::count(pageOwners, pageOwners + pageSize, 0));
+            } else {
+                result += pageSize;
+            }
+        }
+        return result;
+    }
+
+    std::vector<BankRegion> Bank::calculateRegions() const {
+        std::vector<BankRegion> regions;
+        std::size_t start = 0;
+
+        while (start != capacity) {
+            const auto ownerID = getOwner(start);
+            std::size_t end = start + 1;
+            while (end != capacity && getOwner(end) == ownerID) {
+                ++end;
+            }
+
+            if (ownerID != 0) {
+                regions.push_back(BankRegion(start, end - start, &owners[ownerID - 1]));
+            }
+
+            start = end;
+        }
+
+        return regions;
+    }
+
+    Optional<std::size_t> Bank::findFreeSpace(std::size_t size, std::size_t alignment) const {
+        const auto base = origin.hasValue() ? origin.get() : 0;
+        std::size_t start = 0;
+
+        while (start + size <= capacity) {
+            if (alignment > 1) {
+                const auto alignedStart = (base + start + alignment - 1) / alignment * alignment - base;
+                if (alignedStart != start) {
+                    start = alignedStart;
+                    continue;
+                }
+            }
+
+            std::size_t end = start;
+            while (end != start + size && getOwner(end) == 0) {
+                ++end;
+            }
+
+            if (end == start + size) {
+                return start;
+            }
+
+            start = end + 1;
+        }
+
+        return Optional<std::size_t>();
+    }
+
     std::string Bank::getAddressDescription(std::size_t offset) {
         if (origin.hasValue()) {
             return "absolute address 0x" + Int128(origin.get() + offset).toString(16);
@@ -209,7 +298,7 @@ namespace wiz {
         }
 
         for (std::size_t i = 0; i != size; ++i) {
-            if (const auto previousID = ownership[relativePosition + i]) {
+            if (const auto previousID = getOwner(relativePosition + i)) {
                 const auto& previous = owners[previousID - 1];
                 report->error("overlap conflict encountered at " + getAddressDescription(relativePosition + i)
                     + " while reserving byte " + std::to_string(i) + " of " + std::to_string(size)
@@ -219,10 +308,38 @@ namespace wiz {
                 return false;
             }
 
-            ownership[relativePosition + i] = ownerID;
+            setOwner(relativePosition + i, ownerID);
         }
 
         relativePosition += size;
         return true;
     }
+
+    std::size_t Bank::getPageSize(std::size_t page) const {
+        return std::min<std::size_t>(PageSize, capacity - page * PageSize);
+    }
+
+    std::size_t Bank::getOwner(std::size_t offset) const {
+        const auto pageOwners = ownershipPages[offset / PageSize].get();
+        return pageOwners != nullptr ? pageOwners[offset % PageSize] : 0;
+    }
+
+    void Bank::setOwner(std::size_t offset, std::size_t ownerID) {
+        auto& pageOwners = ownershipPages[offset / PageSize];
+        if (pageOwners == nullptr) {
+            pageOwners = std::make_unique<std::size_t[]>(getPageSize(offset / PageSize));
+        }
+        pageOwners[offset % PageSize] = ownerID;
+    }
+
+    std::uint8_t* Bank::getWritableData(std::size_t offset) {
+        const auto page = offset / PageSize;
+        auto& pageData = dataPages[page];
+        if (pageData == nullptr) {
+            const auto pageSize = getPageSize(page);
+            pageData = std::make_unique<std::uint8_t[]>(pageSize);
+            std::fill(pageData.get(), pageData.get() + pageSize, padValue);
+        }
+        return pageData.get() + offset % PageSize;
+    }
 }
\ No newline at end of file
@@ -37,6 +37,21 @@ namespace wiz {
         SourceLocation location;
     };
 
+    // A run of consecutive bytes in a bank that belong to the same owner.
+    struct BankRegion {
+        BankRegion(
+            std::size_t offset,
+            std::size_t size,
+            const BankRegionOwner* owner)
+        : offset(offset),
+        size(size),
+        owner(owner) {}
+
+        std::size_t offset;
+        std::size_t size;
+        const BankRegionOwner* owner;
+    };
+
     enum class BankKind {
         None,
         UninitializedRam,
@@ -53,6 +68,8 @@ namespace wiz {
         public:
             // Value used to pad unused bank space.
             enum : std::uint8_t { DefaultPadValue = 0xFF };
+            // Bank contents are stored in pages of this many bytes, which are only allocated once something is placed in them.
+            enum : std::size_t { PageSize = 4096 };
         
             Bank(
                 StringView name,
@@ -65,11 +82,16 @@ namespace wiz {
 
             StringView getName() const;
             BankKind getKind() const;
+            Optional<std::size_t> getOrigin() const;
             std::size_t getCapacity() const;
             Address getAddress() const;
             std::size_t getRelativePosition() const;
-            ArrayView<std::uint8_t> getData() const;
-            ArrayView<std::uint8_t> getUsedData() const;
+            std::uint8_t getPadValue() const;
+            // Returns the number of bytes this bank contributes to output: its capacity if stored, and 0 otherwise.
+            std::size_t getStoredSize() const;
+            // Returns the bytes of the page at the given offset, up to the end of that page or the bank.
+            // Returns an empty view if nothing was ever written there, in which case the page holds only the pad value.
+            ArrayView<std::uint8_t> getPageData(std::size_t offset) const;
             void setRelativePosition(std::size_t dest);
 
             void rewind();
@@ -79,18 +101,27 @@ namespace wiz {
             bool absoluteSeek(Report* report, std::size_t dest, const SourceLocation& location);
 
             std::size_t calculateUsedSize() const;
+            std::size_t calculateFreeSize() const;
+            std::vector<BankRegion> calculateRegions() const;
+            Optional<std::size_t> findFreeSpace(std::size_t size, std::size_t alignment) const;
 
         private:
             std::string getAddressDescription(std::size_t offset);
             bool reserve(Report* report, StringView description, const void* node, SourceLocation location, std::size_t size);
+            std::size_t getPageSize(std::size_t page) const;
+            std::size_t getOwner(std::size_t offset) const;
+            void setOwner(std::size_t offset, std::size_t ownerID);
+            std::uint8_t* getWritableData(std::size_t offset);
 
             StringView name;
             BankKind kind;
             Optional<std::size_t> origin;
             std::size_t relativePosition;
             std::size_t capacity;
-            std::vector<std::uint8_t> data;
-            std::vector<std::size_t> ownership;
+            std::uint8_t padValue;
+            // Both are indexed by page, and a null page means every byte in it is unowned, or still the pad value.
+            std::vector<std::unique_ptr<std::uint8_t[]>> dataPages;
+            std::vector<std::unique_ptr<std::size_t[]>> ownershipPages;
 
             std::unordered_map<const void*, std::size_t> nodesToOwners;
             std::vector<BankRegionOwner> owners;
@@ -278,6 +278,27 @@ namespace wiz {
         return nullptr;
     }
 
+    const Instruction* Builtins::addFlagClobberingInstruction(FwdUniquePtr<const Instruction> uniqueInstruction) {
+        auto result = uniqueInstruction.get();
+        instructions.push_back(std::move(uniqueInstruction));
+        flagClobberingInstructionsByInstructionTypes[result->signature.type].push_back(result);
+        return result;
+    }
+
+    const Instruction* Builtins::selectFlagClobberingInstruction(const InstructionType& instructionType, std::uint32_t modeFlags, const std::vector<InstructionOperandRoot>& operandRoots) const {
+        const auto flagClobberingInstructionsIter = flagClobberingInstructionsByInstructionTypes.find(instructionType);
+
+        if (flagClobberingInstructionsIter != flagClobberingInstructionsByInstructionTypes.end()) {
+            for (const auto flagClobberingInstruction : flagClobberingInstructionsIter->second) {
+                if (flagClobberingInstruction->signature.matches(modeFlags, operandRoots)) {
+                    return flagClobberingInstruction;
+                }
+            }
+        }
+
+        return nullptr;
+    }
+
     void Builtins::addRegisterDecomposition(const Definition* reg, std::vector<Definition*> subRegisters) {
         registerDecompositions[reg] = subRegisters;
     }
@@ -296,24 +317,27 @@ namespace wiz {
     }
 
     Builtins::Property Builtins::findPropertyByName(StringView name) const {
-        static std::unordered_map<StringView, Property> props;
-        if (props.empty()) {
+        // Built on first use. Initializing a local static is thread-safe, so compilers running concurrently can share it.
+        static const std::unordered_map<StringView, Property> props = [] {
+            std::unordered_map<StringView, Property> result;
             for (std::size_t i = 0; i != sizeof(propertyNames) / sizeof(*propertyNames); ++i) {
-                props[StringView(propertyNames[i])] = static_cast<Property>(i);
+                result[StringView(propertyNames[i])] = static_cast<Property>(i);
             }
-        }
+            return result;
+        }();
 
         const auto match = props.find(name);
         return match != props.end() ? match->second : Property::None;
     }
 
     Builtins::DeclarationAttribute Builtins::findDeclarationAttributeByName(StringView name) const {
-        static std::unordered_map<StringView, DeclarationAttribute> declarationAttributes;
-        if (declarationAttributes.empty()) {
+        static const std::unordered_map<StringView, DeclarationAttribute> declarationAttributes = [] {
+            std::unordered_map<StringView, DeclarationAttribute> result;
             for (std::size_t i = 0; i != sizeof(declarationAttributeNames) / sizeof(*declarationAttributeNames); ++i) {
-                declarationAttributes[StringView(declarationAttributeNames[i])] = static_cast<DeclarationAttribute>(i);
+                result[StringView(declarationAttributeNames[i])] = static_cast<DeclarationAttribute>(i);
             }
-        }
+            return result;
+        }();
 
         const auto match = declarationAttributes.find(name);
         return match != declarationAttributes.end() ? match->second : DeclarationAttribute::None;
@@ -96,6 +96,11 @@ namespace wiz {
                 return addInstruction(makeFwdUnique<const Instruction>(std::forward<Args>(args)...));
             }
 
+            template <typename... Args>
+            const Instruction* createFlagClobberingInstruction(Args&&... args) {
+                return addFlagClobberingInstruction(makeFwdUnique<const Instruction>(std::forward<Args>(args)...));
+            }
+
             StringPool* getStringPool() const;
             SymbolTable* getBuiltinScope() const;
             const Statement* getBuiltinDeclaration() const;
@@ -117,6 +122,11 @@ namespace wiz {
             std::vector<const Instruction*> findAllSpecializationsByInstruction(const Instruction* instruction) const;
             const Instruction* selectInstruction(const InstructionType& instructionType, std::uint32_t modeFlags, const std::vector<InstructionOperandRoot>& operandRoots) const;
 
+            // Flag-clobbering instructions are shorter alternatives to ordinary instructions, which also overwrite the flags in their affected flags list.
+            // They are never picked by selectInstruction, and are only substituted in after the compiler has proven those flags are dead.
+            const Instruction* addFlagClobberingInstruction(FwdUniquePtr<const Instruction> uniqueInstruction);
+            const Instruction* selectFlagClobberingInstruction(const InstructionType& instructionType, std::uint32_t modeFlags, const std::vector<InstructionOperandRoot>& operandRoots) const;
+
             void addRegisterDecomposition(const Definition* reg, std::vector<Definition*> subRegisters);
             ArrayView<Definition*> findRegisterDecomposition(const Definition* reg) const;
 
@@ -167,6 +177,7 @@ namespace wiz {
             std::vector<FwdUniquePtr<const Instruction>> instructions;
             std::unordered_map<InstructionType, std::vector<const Instruction*>> primaryInstructionsByInstructionTypes;
             std::unordered_map<const Instruction*, std::vector<const Instruction*>> specializationsByInstructions;
+            std::unordered_map<InstructionType, std::vector<const Instruction*>> flagClobberingInstructionsByInstructionTypes;
             std::unordered_map<const Definition*, std::vector<Definition*>> registerDecompositions;
 
             std::vector<std::unique_ptr<BuiltinModeAttribute>> modeAttributes;
@@ -0,0 +1,96 @@
+#include <cstdlib>
+
+#include <wiz/ast/expression.h>
+#include <wiz/compiler/bytecode.h>
+#include <wiz/compiler/operations.h>
+
+namespace wiz {
+    BytecodeProgram::BytecodeProgram()
+    : locals(1) {}
+
+    BytecodeProgram::~BytecodeProgram() {}
+
+    std::size_t BytecodeProgram::addConstant(Int128 value) {
+        constants.push_back(value);
+        return constants.size() - 1;
+    }
+
+    std::size_t BytecodeProgram::addTable(std::vector<Int128> items) {
+        tables.push_back(std::move(items));
+        return tables.size() - 1;
+    }
+
+    std::size_t BytecodeProgram::addLocal() {
+        locals.push_back(Int128());
+        return locals.size() - 1;
+    }
+
+    void BytecodeProgram::emit(BytecodeOpcode opcode, std::size_t operand) {
+        instructions.push_back(BytecodeInstruction(opcode, BinaryOperatorKind::None, operand));
+    }
+
+    void BytecodeProgram::emitBinaryOperator(BinaryOperatorKind op) {
+        instructions.push_back(BytecodeInstruction(BytecodeOpcode::BinaryOperator, op, 0));
+    }
+
+    std::size_t BytecodeProgram::getInstructionCount() const {
+        return instructions.size();
+    }
+
+    Optional<Int128> BytecodeProgram::run(Int128 argument) {
+        locals[0] = argument;
+        stack.clear();
+
+        for (const auto& instruction : instructions) {
+            switch (instruction.opcode) {
+                case BytecodeOpcode::PushConstant: {
+                    stack.push_back(constants[instruction.operand]);
+                    break;
+                }
+                case BytecodeOpcode::PushLocal: {
+                    stack.push_back(locals[instruction.operand]);
+                    break;
+                }
+                case BytecodeOpcode::StoreLocal: {
+                    locals[instruction.operand] = stack.back();
+                    stack.pop_back();
+                    break;
+                }
+                case BytecodeOpcode::BinaryOperator: {
+                    const auto right = stack.back();
+                    stack.pop_back();
+                    const auto result = applyIntegerArithmeticOp(instruction.op, stack.back(), right);
+                    if (result.first != Int128::CheckedArithmeticResult::Success) {
+                        return Optional<Int128>();
+                    }
+                    stack.back() = result.second;
+                    break;
+                }
+                case BytecodeOpcode::SignedNegation: {
+                    const auto result = Int128().checkedSubtract(stack.back());
+                    if (result.first != Int128::CheckedArithmeticResult::Success) {
+                        return Optional<Int128>();
+                    }
+                    stack.back() = result.second;
+                    break;
+                }
+                case BytecodeOpcode::BitwiseNegation: {
+                    stack.back() = ~stack.back();
+                    break;
+                }
+                case BytecodeOpcode::Index: {
+                    const auto& items = tables[instruction.operand];
+                    const auto index = stack.back();
+                    if (index.isNegative() || index >= Int128(items.size())) {
+                        return Optional<Int128>();
+                    }
+                    stack.back() = items[static_cast<std::size_t>(index)];
+                    break;
+                }
+                default: std::abort(); break;
+            }
+        }
+
+        return stack.back();
+    }
+}
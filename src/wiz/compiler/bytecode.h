@@ -0,0 +1,74 @@
+#ifndef WIZ_COMPILER_BYTECODE_H
+#define WIZ_COMPILER_BYTECODE_H
+
+#include <vector>
+#include <cstddef>
+
+#include <wiz/utility/int128.h>
+#include <wiz/utility/optional.h>
+
+namespace wiz {
+    enum class BinaryOperatorKind;
+
+    enum class BytecodeOpcode {
+        // Pushes constants[operand].
+        PushConstant,
+        // Pushes locals[operand].
+        PushLocal,
+        // Pops a value into locals[operand].
+        StoreLocal,
+        // Pops the right and then the left operand, and pushes the result of an arithmetic operator.
+        BinaryOperator,
+        // Pops a value, and pushes its negation.
+        SignedNegation,
+        BitwiseNegation,
+        // Pops an index, and pushes that item of tables[operand].
+        Index,
+    };
+
+    struct BytecodeInstruction {
+        BytecodeInstruction(
+            BytecodeOpcode opcode,
+            BinaryOperatorKind op,
+            std::size_t operand)
+        : opcode(opcode),
+        op(op),
+        operand(operand) {}
+
+        BytecodeOpcode opcode;
+        BinaryOperatorKind op;
+        std::size_t operand;
+    };
+
+    // A compile-time `iexpr` expression, flattened into instructions for a small stack machine.
+    // Reducing an expression tree allocates and clones nodes at every step, which adds up when the same expression
+    // is evaluated once per item of an array comprehension. A program is built once, and then run for each item.
+    class BytecodeProgram {
+        public:
+            BytecodeProgram();
+            ~BytecodeProgram();
+
+            std::size_t addConstant(Int128 value);
+            std::size_t addTable(std::vector<Int128> items);
+            std::size_t addLocal();
+
+            void emit(BytecodeOpcode opcode, std::size_t operand);
+            void emitBinaryOperator(BinaryOperatorKind op);
+
+            std::size_t getInstructionCount() const;
+
+            // Runs the program with the argument in local 0, and returns the value left on the stack.
+            // Returns no value if any operation fails (an overflow, a division by zero, or an index out of bounds).
+            // The caller is expected to evaluate the original expression instead, so that the error is reported in the usual way.
+            Optional<Int128> run(Int128 argument);
+
+        private:
+            std::vector<BytecodeInstruction> instructions;
+            std::vector<Int128> constants;
+            std::vector<std::vector<Int128>> tables;
+            std::vector<Int128> locals;
+            std::vector<Int128> stack;
+    };
+}
+
+#endif
@@ -1,5 +1,7 @@
 #include <cassert>
+#include <iterator>
 #include <algorithm>
+#include <map>
 #include <set>
 
 #include <wiz/compiler/compiler.h>
@@ -8,8 +10,10 @@
 #include <wiz/ast/statement.h>
 #include <wiz/ast/type_expression.h>
 #include <wiz/compiler/bank.h>
+#include <wiz/compiler/bytecode.h>
 #include <wiz/compiler/config.h>
 #include <wiz/compiler/ir_node.h>
+#include <wiz/compiler/profile.h>
 #include <wiz/compiler/builtins.h>
 #include <wiz/compiler/definition.h>
 #include <wiz/compiler/symbol_table.h>
@@ -31,13 +35,31 @@ namespace wiz {
         Config* config,
         ImportManager* importManager,
         Report* report,
+        std::size_t optimizationLevel,
+        const Profile* profile,
         std::unordered_map<StringView, FwdUniquePtr<const Expression>> defines)
-    : program(std::move(program)),
+    : Compiler(program.get(), platform, stringPool, config, importManager, report, optimizationLevel, profile, std::move(defines)) {
+        ownedProgram = std::move(program);
+    }
+
+    Compiler::Compiler(
+        const Statement* program,
+        Platform* platform,
+        StringPool* stringPool,
+        Config* config,
+        ImportManager* importManager,
+        Report* report,
+        std::size_t optimizationLevel,
+        const Profile* profile,
+        std::unordered_map<StringView, FwdUniquePtr<const Expression>> defines)
+    : program(program),
     platform(platform),
     stringPool(stringPool),
     config(config),
     importManager(importManager),
     report(report),
+    optimizationLevel(optimizationLevel),
+    profile(profile),
     builtins(stringPool, platform, std::move(defines)) {
         currentInlineSite = &defaultInlineSite;
     }
@@ -45,19 +67,28 @@ namespace wiz {
     Compiler::~Compiler() {}
 
     bool Compiler::compile() {
-        return reserveDefinitions(program.get())
-        && resolveDefinitionTypes()
-        && reserveStorage(program.get())
-        && emitStatementIr(program.get())
+        return compileLayout()
         && generateCode();
     }
 
+    bool Compiler::compileLayout() {
+        return reserveDefinitions(program)
+        && resolveDefinitionTypes()
+        && reserveStorage(program)
+        && emitStatementIr(program)
+        && resolveOptimizationLevel()
+        && inlineSmallFunctions()
+        && packRelocatableDeclarations()
+        && layoutCode()
+        && assignAddresses();
+    }
+
     Report* Compiler::getReport() const {
         return report;
     }
 
     const Statement* Compiler::getProgram() const {
-        return program.get();
+        return program;
     }
 
     std::vector<const Bank*> Compiler::getRegisteredBanks() const {
@@ -92,6 +123,13 @@ namespace wiz {
                     return true;
                 } else if (a->name != b->name) {
                     return a->name < b->name;
+                } else if (a->declaration != nullptr && b->declaration != nullptr
+                && (a->declaration->location.canonicalPath != b->declaration->location.canonicalPath
+                    || a->declaration->location.line != b->declaration->location.line)) {
+                    // Order by where they were declared rather than where they were allocated, so that the order is the same in every compile.
+                    return a->declaration->location.canonicalPath != b->declaration->location.canonicalPath
+                        ? a->declaration->location.canonicalPath < b->declaration->location.canonicalPath
+                        : a->declaration->location.line < b->declaration->location.line;
                 } else {
                     return a < b;
                 }
@@ -108,6 +146,86 @@ namespace wiz {
         return modeFlags;
     }
 
+    std::vector<std::pair<const Definition*, const Definition*>> Compiler::getVariableAccesses() const {
+        std::vector<std::pair<const Definition*, const Definition*>> results;
+        const Definition* enclosingFunction = nullptr;
+        std::vector<const Definition*> references;
+
+        // Most accesses have had the variable folded into its address by now, so operands are also matched against where each variable lives.
+        std::map<std::size_t, const Definition*> variablesByAddress;
+        for (const auto definition : getRegisteredDefinitions()) {
+            if (definition->kind == DefinitionKind::Var) {
+                const auto& varDefinition = definition->var;
+                if (varDefinition.address.hasValue() && varDefinition.address->absolutePosition.hasValue()
+                && varDefinition.storageSize.hasValue() && varDefinition.storageSize.get() != 0) {
+                    variablesByAddress.emplace(varDefinition.address->absolutePosition.get(), definition);
+                }
+            }
+        }
+
+        const auto findVariableAt = [&](const InstructionOperand* address) -> const Definition* {
+            if (address->kind != InstructionOperandKind::Integer || address->integer.placeholder || address->integer.value.isNegative()) {
+                return nullptr;
+            }
+
+            const auto position = static_cast<std::size_t>(address->integer.value);
+            auto match = variablesByAddress.upper_bound(position);
+            if (match == variablesByAddress.begin()) {
+                return nullptr;
+            }
+            --match;
+            return position - match->first < match->second->var.storageSize.get() ? match->second : nullptr;
+        };
+
+        for (const auto& irNode : irNodes) {
+            if (irNode->kind == IrNodeKind::Label) {
+                const auto definition = irNode->label.definition;
+                if (definition->kind == DefinitionKind::Func && definition->func.body != nullptr) {
+                    enclosingFunction = definition;
+                }
+            } else if (irNode->kind == IrNodeKind::Code && enclosingFunction != nullptr) {
+                references.clear();
+                for (const auto& operandRoot : irNode->code.operandRoots) {
+                    if (operandRoot.expression != nullptr) {
+                        collectReferencedDefinitions(operandRoot.expression, references);
+                    }
+
+                    auto operand = operandRoot.operand.get();
+                    while (operand != nullptr && operand->kind == InstructionOperandKind::BitIndex) {
+                        operand = operand->bitIndex.operand.get();
+                    }
+                    if (operand != nullptr) {
+                        const Definition* variable = nullptr;
+                        if (operand->kind == InstructionOperandKind::Dereference) {
+                            variable = findVariableAt(operand->dereference.operand.get());
+                        } else if (operand->kind == InstructionOperandKind::Index) {
+                            variable = findVariableAt(operand->index.operand.get());
+                        }
+                        if (variable != nullptr) {
+                            references.push_back(variable);
+                        }
+                    }
+                }
+
+                // An instruction that mentions a variable more than once still only accesses it once.
+                std::sort(references.begin(), references.end());
+                references.erase(std::unique(references.begin(), references.end()), references.end());
+
+                for (const auto reference : references) {
+                    if (reference->kind == DefinitionKind::Var) {
+                        results.push_back(std::make_pair(enclosingFunction, reference));
+                    }
+                }
+            }
+        }
+
+        return results;
+    }
+
+    const std::vector<SourceMapEntry>& Compiler::getSourceMap() const {
+        return sourceMap;
+    }
+
     SymbolTable* Compiler::getOrCreateStatementScope(StringView name, const Statement* statement, SymbolTable* parentScope) {
         auto& statementScopes = currentInlineSite->statementScopes;
         const auto match = statementScopes.find(statement);
@@ -184,6 +302,7 @@ namespace wiz {
         }
 
         letExpressionStack.emplace_back(name, location);
+        letExpressionStackPeak = std::max(letExpressionStackPeak, letExpressionStack.size());
         return true;
     }
 
@@ -417,6 +536,274 @@ namespace wiz {
         }
     }
 
+    bool Compiler::isIExprLiteral(const Expression* expression) const {
+        if (expression->kind == ExpressionKind::IntegerLiteral && expression->info.hasValue()) {
+            if (const auto typeDefinition = tryGetResolvedIdentifierTypeDefinition(expression->info->type.get())) {
+                return typeDefinition->kind == DefinitionKind::BuiltinIntegerExpressionType;
+            }
+        }
+        return false;
+    }
+
+    struct Compiler::BytecodeCompileState {
+        BytecodeCompileState(
+            const Definition* itemDefinition) {
+            locals[itemDefinition] = 0;
+        }
+
+        BytecodeProgram program;
+
+        // The local slot of the comprehension's item, and of each parameter of an inlined `let` function.
+        std::unordered_map<const Definition*, std::size_t> locals;
+        // Parameterless `let` expressions, reduced once rather than at every reference.
+        std::unordered_map<const Definition*, std::size_t> constants;
+        std::unordered_map<const Definition*, std::size_t> tables;
+        std::vector<FwdUniquePtr<const Expression>> tableExpressions;
+
+        // Scopes of inlined `let` functions. They outlive compilation so that no other definition can reuse the address of a parameter.
+        std::vector<std::unique_ptr<SymbolTable>> scopes;
+        std::vector<const Definition*> inlinedFunctions;
+
+        // If the result is an item of a table, the program computes its index, and this is the table.
+        // The caller takes the item itself, since each item keeps its own source location.
+        const Expression* rootTable = nullptr;
+        // If the result is cast to a sized integer type, the mask for that type.
+        Optional<Int128> rootMask;
+    };
+
+    // Compiles the subset of expressions where every value is an `iexpr`: integer literals, the comprehension item,
+    // parameterless `let` expressions that reduce to an integer or an array of integers, calls to `let` functions,
+    // arithmetic and negation, indexing into arrays, and an outermost cast to an integer type.
+    // The first item was already reduced the usual way, which checked everything except the values themselves.
+    bool Compiler::compileBytecodeExpression(BytecodeCompileState& state, const Expression* expression, bool root) {
+        auto& program = state.program;
+        if (program.getInstructionCount() > MaxBytecodeInstructions) {
+            return false;
+        }
+
+        switch (expression->kind) {
+            case ExpressionKind::IntegerLiteral: {
+                if (expression->info.hasValue() ? !isIExprLiteral(expression) : expression->integerLiteral.suffix.getLength() > 0) {
+                    return false;
+                }
+
+                program.emit(BytecodeOpcode::PushConstant, program.addConstant(expression->integerLiteral.value));
+                return true;
+            }
+            case ExpressionKind::Identifier: {
+                const auto& pieces = expression->identifier.pieces;
+                const auto resolveResult = resolveIdentifier(pieces, expression->location);
+                const auto definition = resolveResult.first;
+                if (definition == nullptr || resolveResult.second != pieces.size() - 1) {
+                    return false;
+                }
+
+                const auto local = state.locals.find(definition);
+                if (local != state.locals.end()) {
+                    program.emit(BytecodeOpcode::PushLocal, local->second);
+                    return true;
+                }
+
+                const auto constant = state.constants.find(definition);
+                if (constant != state.constants.end()) {
+                    program.emit(BytecodeOpcode::PushConstant, constant->second);
+                    return true;
+                }
+
+                if (const auto letDefinition = definition->tryGet<Definition::Let>()) {
+                    if (letDefinition->parameters.size() == 0) {
+                        const auto value = resolveDefinitionExpression(definition, pieces, expression->location);
+                        if (value != nullptr && isIExprLiteral(value.get())) {
+                            const auto index = program.addConstant(value->integerLiteral.value);
+                            state.constants[definition] = index;
+                            program.emit(BytecodeOpcode::PushConstant, index);
+                            return true;
+                        }
+                    }
+                }
+
+                return false;
+            }
+            case ExpressionKind::UnaryOperator: {
+                const auto& unaryOperator = expression->unaryOperator;
+                switch (unaryOperator.op) {
+                    case UnaryOperatorKind::Grouping: {
+                        return compileBytecodeExpression(state, unaryOperator.operand.get(), root);
+                    }
+                    case UnaryOperatorKind::SignedNegation: {
+                        if (!compileBytecodeExpression(state, unaryOperator.operand.get(), false)) {
+                            return false;
+                        }
+
+                        program.emit(BytecodeOpcode::SignedNegation, 0);
+                        return true;
+                    }
+                    case UnaryOperatorKind::BitwiseNegation: {
+                        if (!compileBytecodeExpression(state, unaryOperator.operand.get(), false)) {
+                            return false;
+                        }
+
+                        program.emit(BytecodeOpcode::BitwiseNegation, 0);
+                        return true;
+                    }
+                    default: return false;
+                }
+            }
+            case ExpressionKind::BinaryOperator: {
+                const auto& binaryOperator = expression->binaryOperator;
+                switch (binaryOperator.op) {
+                    case BinaryOperatorKind::Addition:
+                    case BinaryOperatorKind::BitwiseAnd:
+                    case BinaryOperatorKind::BitwiseOr:
+                    case BinaryOperatorKind::BitwiseXor:
+                    case BinaryOperatorKind::Division:
+                    case BinaryOperatorKind::Modulo:
+                    case BinaryOperatorKind::Multiplication:
+                    case BinaryOperatorKind::LeftShift:
+                    case BinaryOperatorKind::RightShift:
+                    case BinaryOperatorKind::Subtraction:
+                    case BinaryOperatorKind::LogicalLeftShift:
+                    case BinaryOperatorKind::LogicalRightShift: {
+                        if (!compileBytecodeExpression(state, binaryOperator.left.get(), false)
+                        || !compileBytecodeExpression(state, binaryOperator.right.get(), false)) {
+                            return false;
+                        }
+
+                        program.emitBinaryOperator(binaryOperator.op);
+                        return true;
+                    }
+                    case BinaryOperatorKind::Indexing: {
+                        const auto left = binaryOperator.left.get();
+                        if (left->kind != ExpressionKind::Identifier) {
+                            return false;
+                        }
+
+                        const auto& pieces = left->identifier.pieces;
+                        const auto resolveResult = resolveIdentifier(pieces, left->location);
+                        const auto definition = resolveResult.first;
+                        if (definition == nullptr || resolveResult.second != pieces.size() - 1 || state.locals.find(definition) != state.locals.end()) {
+                            return false;
+                        }
+
+                        auto table = state.tables.find(definition);
+                        if (table == state.tables.end()) {
+                            const auto letDefinition = definition->tryGet<Definition::Let>();
+                            if (letDefinition == nullptr || letDefinition->parameters.size() != 0) {
+                                return false;
+                            }
+
+                            auto value = resolveDefinitionExpression(definition, pieces, left->location);
+                            if (value == nullptr || value->kind != ExpressionKind::ArrayLiteral) {
+                                return false;
+                            }
+
+                            const auto& items = value->arrayLiteral.items;
+                            std::vector<Int128> values;
+                            values.reserve(items.size());
+                            for (const auto& item : items) {
+                                if (!isIExprLiteral(item.get())) {
+                                    return false;
+                                }
+                                values.push_back(item->integerLiteral.value);
+                            }
+
+                            table = state.tables.emplace(definition, program.addTable(std::move(values))).first;
+                            state.tableExpressions.push_back(std::move(value));
+                        }
+
+                        if (!compileBytecodeExpression(state, binaryOperator.right.get(), false)) {
+                            return false;
+                        }
+
+                        if (root) {
+                            state.rootTable = state.tableExpressions[table->second].get();
+                        } else {
+                            program.emit(BytecodeOpcode::Index, table->second);
+                        }
+                        return true;
+                    }
+                    default: return false;
+                }
+            }
+            case ExpressionKind::Cast: {
+                if (!root) {
+                    return false;
+                }
+
+                const auto& cast = expression->cast;
+                const auto destType = reduceTypeExpression(cast.type.get());
+                if (destType == nullptr) {
+                    return false;
+                }
+
+                if (const auto destTypeDefinition = tryGetResolvedIdentifierTypeDefinition(destType.get())) {
+                    if (const auto destBuiltinIntegerType = destTypeDefinition->tryGet<Definition::BuiltinIntegerType>()) {
+                        // Wider types are left to the usual path, which computes their mask with an `unsigned` shift.
+                        if (destBuiltinIntegerType->size < sizeof(unsigned int)) {
+                            state.rootMask = Int128((1U << (8U * destBuiltinIntegerType->size)) - 1);
+                            return compileBytecodeExpression(state, cast.operand.get(), false);
+                        }
+                    }
+                }
+
+                return false;
+            }
+            case ExpressionKind::Call: {
+                const auto& call = expression->call;
+                const auto function = call.function.get();
+                if (call.inlined || function->kind != ExpressionKind::Identifier) {
+                    return false;
+                }
+
+                const auto& pieces = function->identifier.pieces;
+                const auto resolveResult = resolveIdentifier(pieces, function->location);
+                const auto definition = resolveResult.first;
+                if (definition == nullptr || resolveResult.second != pieces.size() - 1
+                || definition == builtins.getDefinition(Builtins::DefinitionType::HasDef)
+                || definition == builtins.getDefinition(Builtins::DefinitionType::GetDef)
+                || std::find(state.inlinedFunctions.begin(), state.inlinedFunctions.end(), definition) != state.inlinedFunctions.end()) {
+                    return false;
+                }
+
+                const auto letDefinition = definition->tryGet<Definition::Let>();
+                if (letDefinition == nullptr
+                || letDefinition->parameters.size() == 0
+                || letDefinition->parameters.size() != call.arguments.size()) {
+                    return false;
+                }
+
+                // Arguments are computed in the caller's scope and stored into locals, which the function's parameters are bound to.
+                const auto& parameters = letDefinition->parameters;
+                auto scope = std::make_unique<SymbolTable>(definition->parentScope, StringView());
+
+                for (std::size_t i = 0; i != parameters.size(); ++i) {
+                    if (!compileBytecodeExpression(state, call.arguments[i].get(), false)) {
+                        return false;
+                    }
+
+                    const auto local = program.addLocal();
+                    program.emit(BytecodeOpcode::StoreLocal, local);
+
+                    const auto parameterDefinition = scope->createDefinition(report, Definition::Let({}, nullptr, nullptr), parameters[i], definition->declaration);
+                    if (parameterDefinition == nullptr) {
+                        return false;
+                    }
+                    state.locals[parameterDefinition] = local;
+                }
+
+                state.inlinedFunctions.push_back(definition);
+                enterScope(scope.get());
+                const auto result = compileBytecodeExpression(state, letDefinition->expression, root);
+                exitScope();
+                state.inlinedFunctions.pop_back();
+
+                state.scopes.push_back(std::move(scope));
+                return result;
+            }
+            default: return false;
+        }
+    }
+
     FwdUniquePtr<const Expression> Compiler::reduceExpression(const Expression* expression) {
         switch (expression->kind) {
             case ExpressionKind::ArrayComprehension: {
@@ -442,8 +829,33 @@ namespace wiz {
 
                 const TypeExpression* elementType = nullptr;
 
+                // Once the first item has been reduced the usual way, an `iexpr` body is compiled to bytecode, and run for the remaining items.
+                // Any item that the bytecode can't compute is reduced the usual way instead, which reports the error.
+                std::unique_ptr<BytecodeCompileState> bytecode;
+
                 for (std::size_t i = 0; i != *length; ++i) {
                     auto sourceItem = getSequenceLiteralItem(reducedSequence.get(), i);
+
+                    if (bytecode != nullptr && isIExprLiteral(sourceItem.get())) {
+                        if (const auto value = bytecode->program.run(sourceItem->integerLiteral.value)) {
+                            if (bytecode->rootMask.hasValue()) {
+                                computedItems.push_back(makeFwdUnique<const Expression>(Expression::IntegerLiteral(*value & *bytecode->rootMask), computedItems[0]->location,
+                                    ExpressionInfo(EvaluationContext::CompileTime, elementType->clone(), Qualifiers::None)));
+                                continue;
+                            } else if (bytecode->rootTable == nullptr) {
+                                computedItems.push_back(makeFwdUnique<const Expression>(Expression::IntegerLiteral(*value), computedItems[0]->location,
+                                    ExpressionInfo(EvaluationContext::CompileTime, elementType->clone(), Qualifiers::None)));
+                                continue;
+                            }
+
+                            const auto& tableItems = bytecode->rootTable->arrayLiteral.items;
+                            if (!value->isNegative() && *value < Int128(tableItems.size())) {
+                                computedItems.push_back(tableItems[static_cast<std::size_t>(*value)]->clone());
+                                continue;
+                            }
+                        }
+                    }
+
                     tempLetDefinition.expression = sourceItem.get();
 
                     enterScope(scope.get());
@@ -462,6 +874,20 @@ namespace wiz {
                             computedItem = createConvertedExpression(computedItem.get(), elementType);
                         }
 
+                        if (i == 0 && *length > 1
+                        && isIExprLiteral(sourceItem.get())
+                        && computedItem->kind == ExpressionKind::IntegerLiteral
+                        && computedItem->info->context == EvaluationContext::CompileTime
+                        && computedItem->info->qualifiers == Qualifiers::None) {
+                            bytecode = std::make_unique<BytecodeCompileState>(tempDefinition);
+
+                            enterScope(scope.get());
+                            if (!compileBytecodeExpression(*bytecode, arrayComprehension.expression.get(), true)) {
+                                bytecode = nullptr;
+                            }
+                            exitScope();
+                        }
+
                         computedItems.push_back(std::move(computedItem));
                     } else {
                         return nullptr;
@@ -2260,42 +2686,246 @@ namespace wiz {
                 Qualifiers::None));
     }
 
-    std::string Compiler::getResolvedIdentifierName(Definition* definition, const std::vector<StringView>& pieces) const {
-        if (pieces.size() > 0) {
-            return text::join(pieces.begin(), pieces.end(), ".");
-        } else {
-            return definition->name.toString();
+    Definition* Compiler::findUniqueDefinition(const std::vector<StringView>& pieces) const {
+        std::set<Definition*> previousResults;
+        std::set<Definition*> results;
+
+        for (std::size_t pieceIndex = 0; pieceIndex != pieces.size(); ++pieceIndex) {
+            if (pieceIndex == 0) {
+                currentScope->findUnqualifiedDefinitions(pieces[pieceIndex], results);
+            } else {
+                for (const auto definition : previousResults) {
+                    if (const auto ns = definition->tryGet<Definition::Namespace>()) {
+                        ns->environment->findMemberDefinitions(pieces[pieceIndex], results);
+                    }
+                }
+            }
+
+            if (results.size() != 1) {
+                return nullptr;
+            }
+            if (pieceIndex == pieces.size() - 1) {
+                return *results.begin();
+            }
+
+            std::swap(previousResults, results);
+            results.clear();
         }
+
+        return nullptr;
     }
 
-    FwdUniquePtr<const Expression> Compiler::resolveDefinitionExpression(Definition* definition, const std::vector<StringView>& pieces, SourceLocation location) {
-        if (const auto letDefinition = definition->tryGet<Definition::Let>()) {
-            if (letDefinition->parameters.size() == 0) {
-                FwdUniquePtr<const Expression> result;
+    // Excludes the temporary `let` definitions that bind arguments and loop items, which are given a different expression each time.
+    bool Compiler::isDeclaredLetDefinition(const Definition* definition) const {
+        const auto letDefinition = definition->tryGet<Definition::Let>();
+        return letDefinition != nullptr
+            && definition->declaration != nullptr
+            && definition->declaration->kind == StatementKind::Let
+            && letDefinition->expression == definition->declaration->let.value.get();
+    }
 
-                enterScope(definition->parentScope);
-                if (enterLetExpression(definition->name, location)) {
-                    result = reduceExpression(letDefinition->expression);
+    bool Compiler::isConstantLetDefinition(const Definition* definition, std::vector<const Definition*>& visitedDefinitions) {
+        if (!isDeclaredLetDefinition(definition) || definition->let.parameters.size() != 0) {
+            return false;
+        }
+        const auto letDefinition = &definition->let;
 
-                    if (result != nullptr && result->info->context == EvaluationContext::RunTime) {
-                        report->error("`" +  getResolvedIdentifierName(definition, pieces) + "` is a `let` expression, so it cannot accept a run-time expression", result->location);
-                    }
+        const auto match = reducedLetExpressions.find(definition);
+        if (match != reducedLetExpressions.end()) {
+            return match->second.expression != nullptr;
+        }
+        if (std::find(visitedDefinitions.begin(), visitedDefinitions.end(), definition) != visitedDefinitions.end()) {
+            return false;
+        }
 
-                    exitLetExpression();
-                }
-                exitScope();
+        visitedDefinitions.push_back(definition);
+        enterScope(definition->parentScope);
+        const auto result = isConstantLetExpression(letDefinition->expression, {}, visitedDefinitions);
+        exitScope();
+        visitedDefinitions.pop_back();
+        return result;
+    }
 
-                return result != nullptr
-                    ? result->clone(location, ExpressionInfo(result->info->context, result->info->type->clone(), result->info->qualifiers))
-                    : nullptr;
-            } else {
-                return makeFwdUnique<const Expression>(Expression::ResolvedIdentifier(definition, pieces), location,
-                    ExpressionInfo(EvaluationContext::CompileTime,
-                        makeFwdUnique<const TypeExpression>(TypeExpression::ResolvedIdentifier(builtins.getDefinition(Builtins::DefinitionType::Let)), location),
-                        Qualifiers::None));
+    // Whether an expression only depends on literals, embedded files, and other constant `let` expressions, so that it reduces the same way every time.
+    // Bound names are the parameters and comprehension items in scope, which are replaced by their values when the expression is reduced.
+    bool Compiler::isConstantLetExpression(const Expression* expression, const std::vector<StringView>& boundNames, std::vector<const Definition*>& visitedDefinitions) {
+        switch (expression->kind) {
+            case ExpressionKind::ArrayComprehension: {
+                const auto& arrayComprehension = expression->arrayComprehension;
+                auto itemNames = boundNames;
+                itemNames.push_back(arrayComprehension.name);
+                return isConstantLetExpression(arrayComprehension.sequence.get(), boundNames, visitedDefinitions)
+                    && isConstantLetExpression(arrayComprehension.expression.get(), itemNames, visitedDefinitions);
             }
-        } else if (const auto varDefinition = definition->tryGet<Definition::Var>()) {
-            if (varDefinition->resolvedType == nullptr) {
+            case ExpressionKind::ArrayPadLiteral: {
+                const auto& arrayPadLiteral = expression->arrayPadLiteral;
+                return isConstantLetExpression(arrayPadLiteral.valueExpression.get(), boundNames, visitedDefinitions)
+                    && isConstantLetExpression(arrayPadLiteral.sizeExpression.get(), boundNames, visitedDefinitions);
+            }
+            case ExpressionKind::ArrayLiteral: {
+                for (const auto& item : expression->arrayLiteral.items) {
+                    if (!isConstantLetExpression(item.get(), boundNames, visitedDefinitions)) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+            case ExpressionKind::BinaryOperator: {
+                const auto& binaryOperator = expression->binaryOperator;
+                return isConstantLetExpression(binaryOperator.left.get(), boundNames, visitedDefinitions)
+                    && isConstantLetExpression(binaryOperator.right.get(), boundNames, visitedDefinitions);
+            }
+            case ExpressionKind::BooleanLiteral: return true;
+            case ExpressionKind::Call: {
+                const auto& call = expression->call;
+                const auto function = call.function.get();
+                if (call.inlined || function->kind != ExpressionKind::Identifier) {
+                    return false;
+                }
+
+                for (const auto& argument : call.arguments) {
+                    if (!isConstantLetExpression(argument.get(), boundNames, visitedDefinitions)) {
+                        return false;
+                    }
+                }
+
+                const auto& pieces = function->identifier.pieces;
+                if (pieces.size() == 1 && std::find(boundNames.begin(), boundNames.end(), pieces[0]) != boundNames.end()) {
+                    return false;
+                }
+
+                const auto definition = findUniqueDefinition(pieces);
+                if (definition == nullptr
+                || definition == builtins.getDefinition(Builtins::DefinitionType::HasDef)
+                || definition == builtins.getDefinition(Builtins::DefinitionType::GetDef)
+                || std::find(visitedDefinitions.begin(), visitedDefinitions.end(), definition) != visitedDefinitions.end()) {
+                    return false;
+                }
+
+                const auto letDefinition = definition->tryGet<Definition::Let>();
+                if (letDefinition == nullptr || letDefinition->parameters.size() == 0 || letDefinition->expression == nullptr) {
+                    return false;
+                }
+
+                visitedDefinitions.push_back(definition);
+                enterScope(definition->parentScope);
+                const auto result = isConstantLetExpression(letDefinition->expression, letDefinition->parameters, visitedDefinitions);
+                exitScope();
+                visitedDefinitions.pop_back();
+                return result;
+            }
+            case ExpressionKind::Cast: {
+                const auto& cast = expression->cast;
+                const auto typeKind = cast.type->kind;
+                return (typeKind == TypeExpressionKind::Identifier || typeKind == TypeExpressionKind::ResolvedIdentifier)
+                    && isConstantLetExpression(cast.operand.get(), boundNames, visitedDefinitions);
+            }
+            case ExpressionKind::Embed: return true;
+            case ExpressionKind::Identifier: {
+                const auto& pieces = expression->identifier.pieces;
+                if (pieces.size() == 1 && std::find(boundNames.begin(), boundNames.end(), pieces[0]) != boundNames.end()) {
+                    return true;
+                }
+
+                const auto definition = findUniqueDefinition(pieces);
+                return definition != nullptr && isConstantLetDefinition(definition, visitedDefinitions);
+            }
+            case ExpressionKind::IntegerLiteral: return true;
+            case ExpressionKind::RangeLiteral: {
+                const auto& rangeLiteral = expression->rangeLiteral;
+                return isConstantLetExpression(rangeLiteral.start.get(), boundNames, visitedDefinitions)
+                    && isConstantLetExpression(rangeLiteral.end.get(), boundNames, visitedDefinitions)
+                    && (rangeLiteral.step == nullptr || isConstantLetExpression(rangeLiteral.step.get(), boundNames, visitedDefinitions));
+            }
+            case ExpressionKind::StringLiteral: return true;
+            case ExpressionKind::TupleLiteral: {
+                for (const auto& item : expression->tupleLiteral.items) {
+                    if (!isConstantLetExpression(item.get(), boundNames, visitedDefinitions)) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+            case ExpressionKind::UnaryOperator: {
+                const auto& unaryOperator = expression->unaryOperator;
+                switch (unaryOperator.op) {
+                    case UnaryOperatorKind::Grouping:
+                    case UnaryOperatorKind::SignedNegation:
+                    case UnaryOperatorKind::BitwiseNegation:
+                    case UnaryOperatorKind::LogicalNegation:
+                    case UnaryOperatorKind::LowByte:
+                    case UnaryOperatorKind::HighByte:
+                    case UnaryOperatorKind::BankByte:
+                    case UnaryOperatorKind::LowWord:
+                    case UnaryOperatorKind::MidWord:
+                    case UnaryOperatorKind::HighWord:
+                        return isConstantLetExpression(unaryOperator.operand.get(), boundNames, visitedDefinitions);
+                    default: return false;
+                }
+            }
+            default: return false;
+        }
+    }
+
+    std::string Compiler::getResolvedIdentifierName(Definition* definition, const std::vector<StringView>& pieces) const {
+        if (pieces.size() > 0) {
+            return text::join(pieces.begin(), pieces.end(), ".");
+        } else {
+            return definition->name.toString();
+        }
+    }
+
+    FwdUniquePtr<const Expression> Compiler::resolveDefinitionExpression(Definition* definition, const std::vector<StringView>& pieces, SourceLocation location) {
+        if (const auto letDefinition = definition->tryGet<Definition::Let>()) {
+            if (letDefinition->parameters.size() == 0) {
+                // A constant `let` expression is reduced once, and copied at every other reference.
+                // Tables referenced from `inline for` bodies and array comprehensions would otherwise be rebuilt on every iteration.
+                // The copy is only used where reducing it again would stay within the recursion limit, so that limit is still reported.
+                const auto match = reducedLetExpressions.find(definition);
+                if (match != reducedLetExpressions.end()
+                && match->second.expression != nullptr
+                && letExpressionStack.size() + match->second.depth <= MaxLetRecursionDepth) {
+                    const auto& result = match->second.expression;
+                    letExpressionStackPeak = std::max(letExpressionStackPeak, letExpressionStack.size() + match->second.depth);
+                    return result->clone(location, ExpressionInfo(result->info->context, result->info->type->clone(), result->info->qualifiers));
+                }
+
+                FwdUniquePtr<const Expression> result;
+                const auto previousPeak = letExpressionStackPeak;
+                const auto depth = letExpressionStack.size();
+                letExpressionStackPeak = depth;
+
+                enterScope(definition->parentScope);
+                if (enterLetExpression(definition->name, location)) {
+                    result = reduceExpression(letDefinition->expression);
+
+                    if (result != nullptr && result->info->context == EvaluationContext::RunTime) {
+                        report->error("`" +  getResolvedIdentifierName(definition, pieces) + "` is a `let` expression, so it cannot accept a run-time expression", result->location);
+                    }
+
+                    exitLetExpression();
+                }
+
+                if (result != nullptr && match == reducedLetExpressions.end() && isDeclaredLetDefinition(definition)) {
+                    std::vector<const Definition*> visitedDefinitions;
+                    const auto constant = result->info->context == EvaluationContext::CompileTime && isConstantLetDefinition(definition, visitedDefinitions);
+                    reducedLetExpressions.emplace(definition, ReducedLetExpression(constant ? result->clone() : nullptr, letExpressionStackPeak - depth));
+                }
+                exitScope();
+
+                letExpressionStackPeak = std::max(previousPeak, letExpressionStackPeak);
+
+                return result != nullptr
+                    ? result->clone(location, ExpressionInfo(result->info->context, result->info->type->clone(), result->info->qualifiers))
+                    : nullptr;
+            } else {
+                return makeFwdUnique<const Expression>(Expression::ResolvedIdentifier(definition, pieces), location,
+                    ExpressionInfo(EvaluationContext::CompileTime,
+                        makeFwdUnique<const TypeExpression>(TypeExpression::ResolvedIdentifier(builtins.getDefinition(Builtins::DefinitionType::Let)), location),
+                        Qualifiers::None));
+            }
+        } else if (const auto varDefinition = definition->tryGet<Definition::Var>()) {
+            if (varDefinition->resolvedType == nullptr) {
                 report->error("encountered a reference to `" + std::string(
                     ((varDefinition->qualifiers & Qualifiers::Const) != Qualifiers::None) ? "const"
                     : ((varDefinition->qualifiers & Qualifiers::WriteOnly) != Qualifiers::None) ? "writeonly"
@@ -3891,7 +4521,7 @@ namespace wiz {
             }
             case StatementKind::Block: {
                 const auto& blockStatement = statement->block;
-                enterScope(getOrCreateStatementScope(stringPool->intern(SymbolTable::generateBlockName()), statement, currentScope));
+                enterScope(getOrCreateStatementScope(stringPool->intern(SymbolTable::generateBlockName(blockCount++)), statement, currentScope));
                 for (const auto& item : blockStatement.items) {
                     reserveDefinitions(item.get());
                 }
@@ -4002,7 +4632,7 @@ namespace wiz {
 
                 auto& funcDefinition = definition->func;
 
-                enterScope(getOrCreateStatementScope(stringPool->intern(SymbolTable::generateBlockName()), body, currentScope));
+                enterScope(getOrCreateStatementScope(stringPool->intern(SymbolTable::generateBlockName(blockCount++)), body, currentScope));
                 funcDefinition.environment = currentScope;
                 for (std::size_t i = 0; i != funcDeclaration.parameters.size(); ++i) {
                     const auto& parameter = funcDeclaration.parameters[i];
@@ -4174,7 +4804,7 @@ namespace wiz {
             default: std::abort(); return false;
         }
 
-        return statement == program.get() ? report->validate() : report->alive();
+        return statement == program ? report->validate() : report->alive();
     }
 
     bool Compiler::resolveDefinitionTypes() {
@@ -4454,7 +5084,34 @@ namespace wiz {
 
                 const auto result = handleInStatement(inStatement.pieces, inStatement.dest.get(), statement->location);
                 if (result.first) {
-                    reserveStorage(inStatement.body.get());
+                    if (inStatement.packedPieces.size() != 0 && !isBankKindStored(currentBank->getKind())) {
+                        // Variables can be spread across volatile banks here, since they need no code or data to be emitted.
+                        // Packing into banks with initialized data happens later, once the code has been generated.
+                        std::vector<Bank*> banks;
+                        const auto primaryBank = currentBank;
+                        banks.push_back(primaryBank);
+
+                        for (const auto& packedBankPieces : inStatement.packedPieces) {
+                            if (handleInStatement(packedBankPieces, nullptr, statement->location).first) {
+                                if (isBankKindStored(currentBank->getKind())) {
+                                    report->error(statement->getDescription().toString() + " cannot pack declarations into both volatile and initialized banks, but bank `" + primaryBank->getName().toString() + "` is volatile and bank `" + currentBank->getName().toString() + "` is not", statement->location);
+                                }
+                                banks.push_back(currentBank);
+                            }
+                        }
+
+                        currentBank = primaryBank;
+
+                        if (result.second.hasValue()) {
+                            report->error(statement->getDescription().toString() + " with more than one bank cannot have an explicit address", statement->location);
+                        }
+
+                        if (report->alive()) {
+                            reservePackedVariableStorage(inStatement.body.get(), banks);
+                        }
+                    } else {
+                        reserveStorage(inStatement.body.get());
+                    }
                 }
 
                 currentBank = bankStack.back();
@@ -4509,7 +5166,7 @@ namespace wiz {
             default: std::abort(); return false;
         }
 
-        return statement == program.get() ? report->validate() : report->alive();
+        return statement == program ? report->validate() : report->alive();
     }
 
     bool Compiler::resolveVariableInitializer(Definition* definition, const Expression* initializer, StringView description, SourceLocation location) {
@@ -4621,6 +5278,87 @@ namespace wiz {
         return true;
     }
 
+    bool Compiler::reservePackedVariableStorage(const Statement* statement, const std::vector<Bank*>& banks) {
+        struct PackedVariable {
+            Definition* definition;
+            const Statement* statement;
+        };
+
+        enterScope(getOrCreateStatementScope(StringView(), statement, currentScope));
+        const auto onExit = makeScopeGuard([&]() {
+            exitScope();
+        });
+
+        // Anything other than a plain variable declaration is reserved in the first listed bank, like a single-bank `in`.
+        std::vector<PackedVariable> variables;
+        for (const auto& item : statement->block.items) {
+            if (item->kind == StatementKind::Var && item->var.value == nullptr) {
+                for (const auto& name : item->var.names) {
+                    variables.push_back(PackedVariable {currentScope->findLocalMemberDefinition(name), item.get()});
+                }
+            } else {
+                currentBank = banks[0];
+                if (!reserveStorage(item.get())) {
+                    return false;
+                }
+            }
+        }
+
+        // The banks are filled in the order they are listed, so the most used variables get the first (fastest) bank.
+        if (profile != nullptr) {
+            std::stable_sort(variables.begin(), variables.end(), [&](const PackedVariable& a, const PackedVariable& b) {
+                return profile->getVariableWeight(a.definition) > profile->getVariableWeight(b.definition);
+            });
+        }
+
+        for (const auto& variable : variables) {
+            const auto definition = variable.definition;
+            const auto& varDefinition = definition->var;
+            const auto description = variable.statement->getDescription();
+            const auto location = variable.statement->location;
+
+            currentBank = banks[0];
+
+            if (varDefinition.resolvedType != nullptr
+            && varDefinition.resolvedType->kind != TypeExpressionKind::DesignatedStorage
+            && varDefinition.addressExpression == nullptr
+            && (varDefinition.qualifiers & Qualifiers::Extern) == Qualifiers::None
+            && varDefinition.enclosingFunction == nullptr) {
+                const auto storageSize = calculateStorageSize(varDefinition.resolvedType, description);
+                if (!storageSize.hasValue()) {
+                    return false;
+                }
+
+                const auto alignment = varDefinition.alignment != 0 ? varDefinition.alignment : 1;
+                const auto match = std::find_if(banks.begin(), banks.end(), [&](const Bank* bank) {
+                    std::size_t padding = 0;
+                    if (alignment > 1) {
+                        const auto unalignedAddress = bank->getAddress().absolutePosition.get();
+                        padding = (unalignedAddress + alignment - 1) / alignment * alignment - unalignedAddress;
+                    }
+                    return bank->getRelativePosition() + padding + storageSize.get() <= bank->getCapacity();
+                });
+
+                if (match == banks.end()) {
+                    std::string bankNames;
+                    for (const auto bank : banks) {
+                        bankNames += (bankNames.empty() ? "`" : ", `") + bank->getName().toString() + "`";
+                    }
+                    report->error(description.toString() + " of `" + definition->name.toString() + "` needs " + std::to_string(storageSize.get()) + " byte(s), which do not fit in the remaining space of any of the banks " + bankNames, location);
+                    return false;
+                }
+
+                currentBank = *match;
+            }
+
+            if (!reserveVariableStorage(definition, description, location)) {
+                return false;
+            }
+        }
+
+        return report->alive();
+    }
+
     FwdUniquePtr<InstructionOperand> Compiler::createPlaceholderFromResolvedTypeDefinition(const Definition* resolvedTypeDefinition) const {
         if (const auto builtinIntegerType = resolvedTypeDefinition->tryGet<Definition::BuiltinIntegerType>()) {
             const auto placeholder = platform->getPlaceholderValue();
@@ -4987,6 +5725,87 @@ namespace wiz {
         }
     }
 
+    bool Compiler::collectReferencedDefinitions(const Expression* expression, std::vector<const Definition*>& results) const {
+        switch (expression->kind) {
+            case ExpressionKind::ArrayComprehension: {
+                const auto& arrayComprehension = expression->arrayComprehension;
+                return collectReferencedDefinitions(arrayComprehension.expression.get(), results)
+                    && collectReferencedDefinitions(arrayComprehension.sequence.get(), results);
+            }
+            case ExpressionKind::ArrayPadLiteral: {
+                const auto& arrayPadLiteral = expression->arrayPadLiteral;
+                return collectReferencedDefinitions(arrayPadLiteral.valueExpression.get(), results)
+                    && collectReferencedDefinitions(arrayPadLiteral.sizeExpression.get(), results);
+            }
+            case ExpressionKind::ArrayLiteral: {
+                for (const auto& item : expression->arrayLiteral.items) {
+                    if (!collectReferencedDefinitions(item.get(), results)) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+            case ExpressionKind::BinaryOperator: {
+                const auto& binaryOperator = expression->binaryOperator;
+                return collectReferencedDefinitions(binaryOperator.left.get(), results)
+                    && collectReferencedDefinitions(binaryOperator.right.get(), results);
+            }
+            case ExpressionKind::BooleanLiteral: return true;
+            case ExpressionKind::Call: {
+                const auto& call = expression->call;
+                if (!collectReferencedDefinitions(call.function.get(), results)) {
+                    return false;
+                }
+                for (const auto& argument : call.arguments) {
+                    if (!collectReferencedDefinitions(argument.get(), results)) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+            case ExpressionKind::Cast: return collectReferencedDefinitions(expression->cast.operand.get(), results);
+            case ExpressionKind::Embed: return true;
+            case ExpressionKind::FieldAccess: return collectReferencedDefinitions(expression->fieldAccess.operand.get(), results);
+            // Unresolved names could refer to anything.
+            case ExpressionKind::Identifier: return false;
+            case ExpressionKind::IntegerLiteral: return true;
+            case ExpressionKind::OffsetOf: return true;
+            case ExpressionKind::RangeLiteral: {
+                const auto& rangeLiteral = expression->rangeLiteral;
+                return collectReferencedDefinitions(rangeLiteral.start.get(), results)
+                    && collectReferencedDefinitions(rangeLiteral.end.get(), results)
+                    && (rangeLiteral.step == nullptr || collectReferencedDefinitions(rangeLiteral.step.get(), results));
+            }
+            case ExpressionKind::ResolvedIdentifier: {
+                results.push_back(expression->resolvedIdentifier.definition);
+                return true;
+            }
+            // The statement part of a side-effect isn't inspected.
+            case ExpressionKind::SideEffect: return false;
+            case ExpressionKind::StringLiteral: return true;
+            case ExpressionKind::StructLiteral: {
+                for (const auto& item : expression->structLiteral.items) {
+                    if (!collectReferencedDefinitions(item.second->value.get(), results)) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+            case ExpressionKind::TupleLiteral: {
+                for (const auto& item : expression->tupleLiteral.items) {
+                    if (!collectReferencedDefinitions(item.get(), results)) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+            case ExpressionKind::TypeOf: return true;
+            case ExpressionKind::TypeQuery: return true;
+            case ExpressionKind::UnaryOperator: return collectReferencedDefinitions(expression->unaryOperator.operand.get(), results);
+            default: std::abort(); return false;
+        }
+    }
+
     bool Compiler::emitNestedAssignmentIr(const Expression* expression, bool pre, bool post) {
         if (expression->info->context == EvaluationContext::RunTime) {
             switch (expression->kind){
@@ -5304,7 +6123,7 @@ namespace wiz {
                     enterInlineSite(registeredInlineSites.addNew());
 
                     const auto funcDeclaration = definition->declaration;
-                    enterScope(getOrCreateStatementScope(stringPool->intern(SymbolTable::generateBlockName()), funcDeclaration->func.body.get(), funcDefinition->enclosingScope));
+                    enterScope(getOrCreateStatementScope(stringPool->intern(SymbolTable::generateBlockName(blockCount++)), funcDeclaration->func.body.get(), funcDefinition->enclosingScope));
 
                     for (std::size_t i = 0; i != funcDefinition->parameters.size(); i++) {
                         auto& parameter = funcDefinition->parameters[i];
@@ -6451,6 +7270,33 @@ namespace wiz {
         }
     }
 
+    bool Compiler::isDeclarationFree(const Statement* statement) const {
+        switch (statement->kind) {
+            case StatementKind::Attribution: return isDeclarationFree(statement->attribution.body.get());
+            case StatementKind::Block: {
+                for (const auto& item : statement->block.items) {
+                    if (!isDeclarationFree(item.get())) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+            case StatementKind::Branch: return true;
+            case StatementKind::DoWhile: return isDeclarationFree(statement->doWhile.body.get());
+            case StatementKind::ExpressionStatement: return true;
+            case StatementKind::For: return isDeclarationFree(statement->for_.body.get());
+            case StatementKind::If: {
+                const auto& if_ = statement->if_;
+                return isDeclarationFree(if_.body.get())
+                && (if_.alternative == nullptr || isDeclarationFree(if_.alternative.get()));
+            }
+            // Nested inline for bodies are analyzed when they are emitted.
+            case StatementKind::InlineFor: return true;
+            case StatementKind::While: return isDeclarationFree(statement->while_.body.get());
+            default: return false;
+        }
+    }
+
     bool Compiler::emitFunctionIr(Definition* definition, SourceLocation location) {
         auto& funcDefinition = definition->func;
 
@@ -6729,7 +7575,36 @@ namespace wiz {
                     break;
                 }               
 
-                // TODO: decrement-and-branch optimization if the instruction exists.
+                // Counting down to 1 can use a decrement-and-branch instruction (eg. `djnz`), if the platform has a short one for the counter.
+                if (forStatement.distanceHint == 0 && rangeStep->value == Int128(-1) && rangeEnd->value == Int128(1)) {
+                    auto comparisonValue = makeFwdUnique<Expression>(
+                        Expression::IntegerLiteral(Int128(0)),
+                        reducedSequence->location,
+                        ExpressionInfo(EvaluationContext::CompileTime,
+                            makeFwdUnique<const TypeExpression>(TypeExpression::ResolvedIdentifier(builtins.getDefinition(Builtins::DefinitionType::IExpr)), reducedSequence->location),
+                            Qualifiers::None));
+                    auto decrement = makeFwdUnique<Expression>(Expression::UnaryOperator(UnaryOperatorKind::PreDecrement, reducedCounter->clone()), reducedCounter->location, Optional<ExpressionInfo>());
+                    auto condition = makeFwdUnique<Expression>(Expression::BinaryOperator(BinaryOperatorKind::NotEqual, std::move(decrement), std::move(comparisonValue)), reducedCounter->location, Optional<ExpressionInfo>());
+
+                    if (auto reducedDecrementCondition = reduceExpression(condition.get())) {
+                        if (const auto binaryOperator = reducedDecrementCondition->tryGet<Expression::BinaryOperator>()) {
+                            const auto testAndBranch = getTestAndBranch(binaryOperator->op, binaryOperator->left.get(), binaryOperator->right.get(), forStatement.distanceHint);
+                            if (testAndBranch != nullptr && testAndBranch->branches.size() == 0) {
+                                std::vector<InstructionOperandRoot> operandRoots;
+                                for (const auto testOperand : testAndBranch->testOperands) {
+                                    operandRoots.push_back(InstructionOperandRoot(testOperand, createOperandFromExpression(testOperand, true)));
+                                }
+                                operandRoots.push_back(InstructionOperandRoot(beginLabelReferenceExpression, createOperandFromExpression(beginLabelReferenceExpression, true)));
+
+                                if (builtins.selectInstruction(testAndBranch->testInstructionType, modeFlags, operandRoots) != nullptr) {
+                                    reducedCondition = expressionPool.add(std::move(reducedDecrementCondition));
+                                    conditionNegated = false;
+                                    incrementInstruction = nullptr;
+                                }
+                            }
+                        }
+                    }
+                }
 
                 if (!emitExpressionStatementIr(reducedInitAssignment, reducedInitAssignment->location)) {
                     report->error("could not generate initial assignment instruction for " + statement->getDescription().toString(), statement->location);
@@ -6738,7 +7613,9 @@ namespace wiz {
                 irNodes.addNew(IrNode::Label(beginLabelDefinition), statement->location);
                 emitStatementIr(forStatement.body.get());
                 irNodes.addNew(IrNode::Label(continueLabelDefinition), reducedCondition->location);
-                irNodes.addNew(IrNode::Code(incrementInstruction, std::move(incrementOperandRoots)), reducedCondition->location);
+                if (incrementInstruction != nullptr) {
+                    irNodes.addNew(IrNode::Code(incrementInstruction, std::move(incrementOperandRoots)), reducedCondition->location);
+                }
                 if (!emitBranchIr(forStatement.distanceHint, BranchKind::Goto, beginLabelReferenceExpression, nullptr, conditionNegated, reducedCondition, reducedCondition->location)) {
                     report->error("could not generate branch instruction for " + statement->getDescription().toString(), statement->location);
                     break;
@@ -6754,6 +7631,10 @@ namespace wiz {
                 if (funcDefinition.inlined) {
                     //report->error("TODO: `inline func`", statement->location);
                     break;
+                } else if (packedBanks.size() != 0 && currentFunction == nullptr) {
+                    irNodes.addNew(IrNode::PushRelocation(currentBank, Optional<std::size_t>(), packedBanks), statement->location);
+                    emitFunctionIr(definition, statement->location);
+                    irNodes.addNew(IrNode::PopRelocation(), statement->location);
                 } else {
                     emitFunctionIr(definition, statement->location);
                 }
@@ -6811,8 +7692,38 @@ namespace wiz {
                 const auto& inStatement = statement->in;
                 bankStack.push_back(currentBank);
 
+                const auto oldPackedBanks = packedBanks;
+                const auto onExit = makeScopeGuard([&]() {
+                    packedBanks = oldPackedBanks;
+                });
+
+                packedBanks.clear();
+
                 const auto result = handleInStatement(inStatement.pieces, inStatement.dest.get(), statement->location);
                 if (result.first) {
+                    // Packing into volatile banks was already done when storage was reserved.
+                    if (inStatement.packedPieces.size() != 0 && isBankKindStored(currentBank->getKind())) {
+                        const auto primaryBank = currentBank;
+                        packedBanks.push_back(primaryBank);
+
+                        for (const auto& packedBankPieces : inStatement.packedPieces) {
+                            if (handleInStatement(packedBankPieces, nullptr, statement->location).first) {
+                                packedBanks.push_back(currentBank);
+                            }
+                        }
+
+                        currentBank = primaryBank;
+
+                        if (result.second.hasValue()) {
+                            report->error(statement->getDescription().toString() + " with more than one bank cannot have an explicit address", statement->location);
+                        }
+                        for (const auto packedBank : packedBanks) {
+                            if (!isBankKindStored(packedBank->getKind())) {
+                                report->error(statement->getDescription().toString() + " can only pack declarations into banks with initialized data, but bank `" + packedBank->getName().toString() + "` is volatile", statement->location);
+                            }
+                        }
+                    }
+
                     irNodes.addNew(IrNode::PushRelocation(currentBank, result.second), statement->location);
                     emitStatementIr(inStatement.body.get());
                     irNodes.addNew(IrNode::PopRelocation(), statement->location);
@@ -6847,7 +7758,7 @@ namespace wiz {
                     break;
                 }
 
-                enterScope(getOrCreateStatementScope(stringPool->intern(SymbolTable::generateBlockName()), statement, currentScope));
+                enterScope(getOrCreateStatementScope(stringPool->intern(SymbolTable::generateBlockName(blockCount++)), statement, currentScope));
                 
                 const auto beginLabelDefinition = createAnonymousLabelDefinition("$loop"_sv);
                 const auto endLabelDefinition = createAnonymousLabelDefinition("$endloop"_sv);
@@ -6856,16 +7767,32 @@ namespace wiz {
 
                 irNodes.addNew(IrNode::Label(beginLabelDefinition), statement->location);
 
+                // A body without declarations analyzes the same way on every iteration,
+                // so the first iteration serves as a template for the rest.
+                // Only the loop variable and the per-iteration labels are bound again.
+                // The block names the analysis would have generated are still counted, so later names don't change.
+                const auto body = inlineForStatement.body.get();
+                const bool reuseAnalysis = isDeclarationFree(body);
+                Optional<std::size_t> analyzedBlockCount;
+
                 for (std::size_t i = 0; i != *length; ++i) {
                     enterInlineSite(registeredInlineSites.addNew());
-                    enterScope(getOrCreateStatementScope(stringPool->intern(SymbolTable::generateBlockName()), statement, currentScope));
+                    enterScope(getOrCreateStatementScope(stringPool->intern(SymbolTable::generateBlockName(blockCount++)), statement, currentScope));
 
                     const auto continueLabelDefinition = createAnonymousLabelDefinition("$continue"_sv);
 
                     continueLabel = continueLabelDefinition;
-                    const auto body = inlineForStatement.body.get();
 
-                    bool valid = reserveDefinitions(body) && resolveDefinitionTypes() && reserveStorage(body);
+                    bool valid = true;
+                    if (analyzedBlockCount.hasValue()) {
+                        blockCount += *analyzedBlockCount;
+                    } else {
+                        const auto oldBlockCount = blockCount;
+                        valid = reserveDefinitions(body) && resolveDefinitionTypes() && reserveStorage(body);
+                        if (valid && reuseAnalysis) {
+                            analyzedBlockCount = blockCount - oldBlockCount;
+                        }
+                    }
 
                     if (valid) {
                         auto tempDeclaration = statementPool.addNew(Statement::InternalDeclaration(), statement->location);
@@ -6968,11 +7895,20 @@ namespace wiz {
                                 const auto destExpression = expressionPool.add(resolveDefinitionExpression(definition, {}, statement->location));
                                 emitAssignmentExpressionIr(destExpression, varDefinition.initializerExpression.get(), statement->location);
                             } else if (varDefinition.enclosingFunction == nullptr) {
+                                const auto packed = packedBanks.size() != 0 && varDefinition.addressExpression == nullptr;
+                                if (packed) {
+                                    irNodes.addNew(IrNode::PushRelocation(currentBank, Optional<std::size_t>(), packedBanks), statement->location);
+                                }
+
                                 irNodes.addNew(IrNode::Var(definition), statement->location);
 
                                 for (auto& nestedConstant : varDefinition.nestedConstants) {
                                     irNodes.addNew(IrNode::Var(nestedConstant), statement->location);
                                 }
+
+                                if (packed) {
+                                    irNodes.addNew(IrNode::PopRelocation(), statement->location);
+                                }
                             }
                         }
                     }
@@ -7021,24 +7957,1246 @@ namespace wiz {
             default: std::abort(); return false;
         }
 
-        return statement == program.get() ? report->validate() : report->alive();
+        return statement == program ? report->validate() : report->alive();
     }
 
-    bool Compiler::generateCode() {
-        for (auto& bank : registeredBanks) {
-            bank->rewind();
+    bool Compiler::resolveOptimizationLevel() {
+        // An `optimize` config directive in the program takes priority over the level given on the command line.
+        if (const auto optimize = config->checkInteger(report, "optimize"_sv, false)) {
+            if (optimize->second < Int128(0)) {
+                report->error("`optimize` must be a non-negative integer", optimize->first->location);
+                return false;
+            }
+            optimizationLevel = static_cast<std::size_t>(optimize->second);
         }
-        
-        std::vector<std::vector<const InstructionOperand*>> captureLists;
-        std::set<std::size_t> irNodeIndexesToRemove;
+        return true;
+    }
 
-        // First pass: calculate data/instruction sizes, assign labels.
-        for (std::size_t i = 0; i != irNodes.size(); ++i) {
+    bool Compiler::inlineSmallFunctions() {
+        if (optimizationLevel == 0) {
+            return true;
+        }
+
+        std::vector<std::string> keptMessages;
+        while (inlineSmallFunctionCalls(keptMessages, false)) {}
+
+        // Hot functions are considered once the size-driven inlining has settled,
+        // so that their callers are already in the shape that the profiled build had.
+        if (profile != nullptr) {
+            while (inlineSmallFunctionCalls(keptMessages, true)) {}
+        }
+
+        for (const auto& message : keptMessages) {
+            report->log(message);
+        }
+
+        return report->validate();
+    }
+
+    bool Compiler::inlineSmallFunctionCalls(std::vector<std::string>& keptMessages, bool useProfile) {
+        keptMessages.clear();
+
+        // Single-call functions with larger bodies than this stay out of line, since they grow the caller.
+        const std::size_t inlineBudget = 64;
+
+        const auto none = SIZE_MAX;
+        const auto irNodeCount = irNodes.size();
+        std::vector<std::vector<const InstructionOperand*>> captureLists;
+
+        const auto measure = [&](const Instruction* instruction, const std::vector<InstructionOperandRoot>& operandRoots) -> std::size_t {
+            return instruction->signature.extract(operandRoots, captureLists)
+                ? instruction->encoding->calculateSize(instruction->options, captureLists)
+                : 0;
+        };
+        const auto isFunctionLabel = [](const Definition* definition) {
+            return definition->func.body != nullptr && !definition->func.inlined;
+        };
+        const auto getDirectReference = [](const InstructionOperandRoot& operandRoot) -> Definition* {
+            const auto resolvedIdentifier = operandRoot.expression != nullptr ? operandRoot.expression->tryGet<Expression::ResolvedIdentifier>() : nullptr;
+            return resolvedIdentifier != nullptr && resolvedIdentifier->definition->kind == DefinitionKind::Func ? resolvedIdentifier->definition : nullptr;
+        };
+
+        // Turns a `return` inside an inlined body into a jump to the end of the inlined code.
+        const auto selectReturnJump = [&](const IrNode::Code& code, const Expression* endLabelExpression, std::vector<InstructionOperandRoot>& operandRoots) -> const Instruction* {
+            operandRoots.clear();
+            operandRoots.push_back(InstructionOperandRoot(nullptr, makeFwdUnique<InstructionOperand>(InstructionOperand::Integer(Int128(0)))));
+            operandRoots.push_back(InstructionOperandRoot(endLabelExpression, createOperandFromExpression(endLabelExpression, true)));
+            for (std::size_t k = 1; k < code.operandRoots.size(); ++k) {
+                operandRoots.push_back(InstructionOperandRoot(code.operandRoots[k].expression, code.operandRoots[k].operand->clone()));
+            }
+            return builtins.selectInstruction(InstructionType(BranchKind::Goto), code.instruction->signature.requiredModeFlags, operandRoots);
+        };
+
+        std::unordered_map<const Definition*, std::size_t> labelIndexes;
+        std::unordered_map<const Definition*, std::size_t> referenceCounts;
+        std::unordered_map<const Definition*, std::vector<std::size_t>> callSites;
+        std::vector<std::pair<std::size_t, std::size_t>> functionRanges;
+        std::vector<std::pair<std::size_t, const Definition*>> shortBranches;
+        std::vector<const Definition*> references;
+        bool referencesKnown = true;
+
+        const auto closeFunctionRange = [&](std::size_t end) {
+            if (functionRanges.size() != 0 && functionRanges.back().second == none) {
+                functionRanges.back().second = end;
+            }
+        };
+        const auto collectReferences = [&](const Expression* expression) {
+            references.clear();
+            if (!collectReferencedDefinitions(expression, references)) {
+                referencesKnown = false;
+            }
+            for (const auto definition : references) {
+                ++referenceCounts[definition];
+            }
+        };
+
+        for (std::size_t i = 0; i != irNodeCount; ++i) {
+            const auto& irNode = irNodes[i];
+            switch (irNode->kind) {
+                case IrNodeKind::Label: {
+                    const auto definition = irNode->label.definition;
+                    labelIndexes[definition] = i;
+                    if (isFunctionLabel(definition)) {
+                        closeFunctionRange(i);
+                        functionRanges.push_back(std::make_pair(i, none));
+                    }
+                    break;
+                }
+                case IrNodeKind::Code: {
+                    const auto& code = irNode->code;
+                    for (const auto& operandRoot : code.operandRoots) {
+                        if (operandRoot.expression != nullptr) {
+                            collectReferences(operandRoot.expression);
+                        }
+                    }
+
+                    const auto branchKind = code.instruction->signature.type.tryGet<BranchKind>();
+                    if (branchKind != nullptr && *branchKind == BranchKind::Call && code.operandRoots.size() == 2) {
+                        const auto destination = getDirectReference(code.operandRoots[1]);
+                        if (destination != nullptr && isFunctionLabel(destination)) {
+                            callSites[destination].push_back(i);
+                        }
+                    }
+
+                    // Test-and-branch instructions have no far form, so treat them as short.
+                    for (const auto& operandRoot : code.operandRoots) {
+                        if (const auto destination = getDirectReference(operandRoot)) {
+                            if (branchKind == nullptr || isRangeLimitedBranch(irNode.get())) {
+                                shortBranches.push_back(std::make_pair(i, destination));
+                            }
+                            break;
+                        }
+                    }
+                    break;
+                }
+                case IrNodeKind::Var: {
+                    const auto& varDefinition = irNode->var.definition->var;
+                    if (varDefinition.initializerExpression != nullptr) {
+                        collectReferences(varDefinition.initializerExpression.get());
+                    }
+                    if (varDefinition.addressExpression != nullptr) {
+                        collectReferences(varDefinition.addressExpression);
+                    }
+                    closeFunctionRange(i);
+                    break;
+                }
+                default: {
+                    closeFunctionRange(i);
+                    break;
+                }
+            }
+        }
+        closeFunctionRange(irNodeCount);
+
+        // Profile-guided copies only go into callers that are hot themselves.
+        const auto isHotSite = [&](std::size_t site) {
+            const auto range = std::upper_bound(functionRanges.begin(), functionRanges.end(), site,
+                [](std::size_t index, const std::pair<std::size_t, std::size_t>& functionRange) { return index < functionRange.first; });
+            if (range == functionRanges.begin()) {
+                return false;
+            }
+            const auto& enclosingRange = *std::prev(range);
+            return site < enclosingRange.second && profile->isHot(irNodes[enclosingRange.first]->label.definition);
+        };
+
+        struct InlineCandidate {
+            const Definition* definition;
+            std::size_t start;
+            std::size_t end;
+            std::size_t bodySize;
+            std::size_t overheadSize;
+            bool removable;
+            bool profileGuided;
+        };
+
+        std::vector<InlineCandidate> candidates;
+        std::unordered_map<const Definition*, std::size_t> candidateIndexes;
+        const auto placeholderLabelExpression = expressionPool.add(resolveDefinitionExpression(createAnonymousLabelDefinition("$inline"_sv), {}, SourceLocation()));
+        std::vector<InstructionOperandRoot> tempOperandRoots;
+
+        for (const auto& functionRange : functionRanges) {
+            const auto start = functionRange.first;
+            const auto end = functionRange.second;
+            const auto definition = irNodes[start]->label.definition;
+            const auto& funcDefinition = definition->func;
+            const auto callSiteIter = callSites.find(definition);
+            if (callSiteIter == callSites.end()) {
+                continue;
+            }
+
+            const auto& sites = callSiteIter->second;
+            const auto name = "`" + definition->name.toString() + "`";
+            const auto keep = [&](const std::string& reason) {
+                keptMessages.push_back("kept " + name + " out of line: " + reason);
+            };
+
+            if (funcDefinition.far || funcDefinition.fallthrough || funcDefinition.returnKind != BranchKind::Return) {
+                keep("it does not use a plain near `return`");
+                continue;
+            }
+            if (end - start < 2 || !isUnconditionalTransfer(irNodes[end - 1].get())
+            || *irNodes[end - 1]->code.instruction->signature.type.tryGet<BranchKind>() != BranchKind::Return) {
+                keep("it does not end in a `return`");
+                continue;
+            }
+
+            std::string reason;
+            std::size_t bodySize = 0;
+            int stackDepth = 0;
+            std::unordered_map<const Definition*, std::size_t> localReferenceCounts;
+
+            for (auto j = start + 1; j != end - 1 && reason.size() == 0; ++j) {
+                const auto& irNode = irNodes[j];
+                if (irNode->kind != IrNodeKind::Code) {
+                    continue;
+                }
+
+                const auto& code = irNode->code;
+                if (code.instruction->signature.requiredModeFlags != 0) {
+                    reason = "it depends on processor mode flags";
+                    break;
+                }
+
+                // The callee's frame lies under its return address, which an inlined copy no longer has.
+                const auto& instructionType = code.instruction->signature.type;
+                if (const auto voidIntrinsic = instructionType.tryGet<InstructionType::VoidIntrinsic>()) {
+                    stackDepth += platform->getStackEffect(voidIntrinsic->definition);
+                } else if (const auto loadIntrinsic = instructionType.tryGet<InstructionType::LoadIntrinsic>()) {
+                    stackDepth += platform->getStackEffect(loadIntrinsic->definition);
+                }
+                if (stackDepth < 0) {
+                    reason = "it pushes and pops the stack unevenly";
+                    break;
+                }
+
+                for (const auto& operandRoot : code.operandRoots) {
+                    if (operandRoot.expression == nullptr) {
+                        continue;
+                    }
+
+                    const auto directReference = getDirectReference(operandRoot);
+                    references.clear();
+                    collectReferencedDefinitions(operandRoot.expression, references);
+                    for (const auto reference : references) {
+                        const auto labelIndexIter = labelIndexes.find(reference);
+                        const auto isLocalLabel = labelIndexIter != labelIndexes.end() && labelIndexIter->second > start && labelIndexIter->second < end;
+                        if (reference == definition) {
+                            reason = "it is recursive";
+                        } else if (platform->isStackPointer(reference)) {
+                            reason = "it depends on the stack pointer";
+                        } else if (isLocalLabel && reference != directReference) {
+                            reason = "it takes the address of one of its own labels";
+                        } else if (isLocalLabel && labelIndexIter->second < j) {
+                            reason = "it contains a loop";
+                        } else if (isLocalLabel) {
+                            ++localReferenceCounts[reference];
+                        }
+                    }
+                }
+
+                const auto branchKind = code.instruction->signature.type.tryGet<BranchKind>();
+                if (branchKind == nullptr || *branchKind == BranchKind::Call) {
+                    bodySize += measure(code.instruction, code.operandRoots);
+                } else if (*branchKind == BranchKind::Return) {
+                    if (const auto instruction = selectReturnJump(code, placeholderLabelExpression, tempOperandRoots)) {
+                        bodySize += measure(instruction, tempOperandRoots);
+                    } else if (reason.size() == 0) {
+                        reason = "one of its conditional returns has no matching jump";
+                    }
+                } else if (*branchKind == BranchKind::Goto) {
+                    const auto destination = code.operandRoots.size() >= 2 ? getDirectReference(code.operandRoots[1]) : nullptr;
+                    if (destination == nullptr || localReferenceCounts.find(destination) == localReferenceCounts.end()) {
+                        if (reason.size() == 0) {
+                            reason = "it jumps outside of its own body";
+                        }
+                    }
+                    bodySize += measure(code.instruction, code.operandRoots);
+                } else if (reason.size() == 0) {
+                    reason = "it uses a far or interrupt branch";
+                }
+            }
+
+            if (reason.size() == 0 && stackDepth != 0) {
+                reason = "it pushes and pops the stack unevenly";
+            }
+
+            // Local labels must only be used by the function itself, so the copies can be relabelled.
+            for (auto j = start + 1; j != end - 1 && reason.size() == 0; ++j) {
+                if (const auto label = irNodes[j]->tryGet<IrNode::Label>()) {
+                    const auto localCount = localReferenceCounts.find(label->definition);
+                    if (!referencesKnown || referenceCounts[label->definition] != (localCount != localReferenceCounts.end() ? localCount->second : 0)) {
+                        reason = "one of its labels is used from outside";
+                    }
+                }
+            }
+
+            if (reason.size() != 0) {
+                keep(reason);
+                continue;
+            }
+
+            const auto& callCode = irNodes[sites[0]]->code;
+            const auto& returnCode = irNodes[end - 1]->code;
+            const auto overheadSize = measure(callCode.instruction, callCode.operandRoots) + measure(returnCode.instruction, returnCode.operandRoots);
+
+            // Removing the out-of-line copy needs every use of the function to be an inlined call,
+            // and nothing else falling into it or expecting it at a fixed address.
+            const auto previousIrNode = start != 0 ? irNodes[start - 1].get() : nullptr;
+            const auto removable = referencesKnown
+                && referenceCounts[definition] == sites.size()
+                && (previousIrNode == nullptr
+                    || (previousIrNode->kind == IrNodeKind::Code && isUnconditionalTransfer(previousIrNode))
+                    || (previousIrNode->kind == IrNodeKind::PushRelocation && !previousIrNode->pushRelocation.address.hasValue())
+                    || previousIrNode->kind == IrNodeKind::PopRelocation
+                    || previousIrNode->kind == IrNodeKind::Var);
+
+            // A profile can justify copying a hot function into its hot callers, even though that grows the program.
+            const auto profileGuided = useProfile && profile->isHot(definition)
+                && bodySize >= overheadSize && bodySize <= inlineBudget
+                && (sites.size() != 1 || !removable);
+
+            if (profileGuided && std::none_of(sites.begin(), sites.end(), isHotSite)) {
+                keep("none of its call sites are in hot functions");
+                continue;
+            }
+
+            if (bodySize >= overheadSize && !profileGuided) {
+                if (sites.size() != 1 || !removable) {
+                    keep("its body of " + std::to_string(bodySize) + " byte(s) is not smaller than its " + std::to_string(overheadSize) + " byte(s) of call overhead"
+                        + (sites.size() != 1 ? ", and it has " + std::to_string(sites.size()) + " call sites" : ", and it is used by more than calls"));
+                    continue;
+                }
+                if (bodySize > inlineBudget) {
+                    keep("its body of " + std::to_string(bodySize) + " byte(s) is over the inline budget of " + std::to_string(inlineBudget) + " byte(s)");
+                    continue;
+                }
+            }
+
+            candidateIndexes[definition] = candidates.size();
+            candidates.push_back(InlineCandidate {definition, start, end, bodySize, overheadSize, removable, profileGuided});
+        }
+
+        // Functions which call other candidates wait for the next round, so their copies include the inlined code.
+        std::vector<bool> deferred(candidates.size(), false);
+        for (std::size_t c = 0; c != candidates.size(); ++c) {
+            const auto& candidate = candidates[c];
+            for (auto j = candidate.start + 1; j != candidate.end; ++j) {
+                const auto& irNode = irNodes[j];
+                if (irNode->kind == IrNodeKind::Code && irNode->code.operandRoots.size() == 2) {
+                    const auto destination = getDirectReference(irNode->code.operandRoots[1]);
+                    if (destination != nullptr && destination != candidate.definition && candidateIndexes.find(destination) != candidateIndexes.end()) {
+                        deferred[c] = true;
+                        break;
+                    }
+                }
+            }
+        }
+
+        std::vector<const InlineCandidate*> inlinedSites(irNodeCount, nullptr);
+        std::vector<bool> removed(irNodeCount, false);
+        bool changed = false;
+
+        for (std::size_t c = 0; c != candidates.size(); ++c) {
+            if (deferred[c]) {
+                continue;
+            }
+
+            const auto& candidate = candidates[c];
+            const auto& sites = callSites[candidate.definition];
+            const auto callSize = measure(irNodes[sites[0]]->code.instruction, irNodes[sites[0]]->code.operandRoots);
+
+            // Growing the caller could push a short branch over the call site out of range.
+            std::size_t inlinedCount = 0;
+            for (const auto site : sites) {
+                if (candidate.profileGuided && !isHotSite(site)) {
+                    continue;
+                }
+
+                bool spanned = false;
+                if (candidate.bodySize > callSize) {
+                    for (const auto& shortBranch : shortBranches) {
+                        const auto labelIndex = labelIndexes.find(shortBranch.second);
+                        if (labelIndex != labelIndexes.end()
+                        && std::min(shortBranch.first, labelIndex->second) < site
+                        && site < std::max(shortBranch.first, labelIndex->second)) {
+                            spanned = true;
+                            break;
+                        }
+                    }
+                }
+
+                if (!spanned) {
+                    inlinedSites[site] = &candidate;
+                    ++inlinedCount;
+                }
+            }
+
+            const auto name = "`" + candidate.definition->name.toString() + "`";
+            if (inlinedCount == 0) {
+                keptMessages.push_back("kept " + name + " out of line: a short branch spans each of its call sites");
+                continue;
+            }
+
+            const auto removeCopy = candidate.removable && inlinedCount == sites.size();
+            if (removeCopy) {
+                auto start = candidate.start;
+                auto end = candidate.end;
+                if (start != 0 && end != irNodeCount
+                && irNodes[start - 1]->kind == IrNodeKind::PushRelocation && irNodes[start - 1]->pushRelocation.packedBanks.size() != 0
+                && irNodes[end]->kind == IrNodeKind::PopRelocation) {
+                    --start;
+                    ++end;
+                }
+                for (auto j = start; j != end; ++j) {
+                    removed[j] = true;
+                }
+            }
+
+            report->log("inlined " + name + " at " + std::to_string(inlinedCount) + " of " + std::to_string(sites.size()) + " call site(s)"
+                + " (body of " + std::to_string(candidate.bodySize) + " byte(s), call overhead of " + std::to_string(candidate.overheadSize) + " byte(s))"
+                + (removeCopy ? ", and removed its out-of-line copy" : "")
+                + (candidate.profileGuided ? ", guided by the profile" : ""));
+            changed = true;
+        }
+
+        if (!changed) {
+            return false;
+        }
+
+        // Bodies are copied through raw pointers, since kept nodes are moved into the new list as it is built.
+        std::vector<const IrNode*> bodyIrNodes;
+        bodyIrNodes.reserve(irNodeCount);
+        for (const auto& irNode : irNodes) {
+            bodyIrNodes.push_back(irNode.get());
+        }
+
+        auto oldIrNodes = irNodes.release();
+        std::unordered_map<const Definition*, Definition*> labelCopies;
+
+        for (std::size_t i = 0; i != irNodeCount; ++i) {
+            const auto candidate = inlinedSites[i];
+            if (candidate == nullptr) {
+                if (!removed[i]) {
+                    irNodes.add(std::move(oldIrNodes[i]));
+                }
+                continue;
+            }
+
+            const auto location = oldIrNodes[i]->location;
+            const auto endLabelDefinition = createAnonymousLabelDefinition("$inline"_sv);
+            const auto endLabelExpression = expressionPool.add(resolveDefinitionExpression(endLabelDefinition, {}, location));
+
+            labelCopies.clear();
+            for (auto j = candidate->start + 1; j != candidate->end - 1; ++j) {
+                if (const auto label = bodyIrNodes[j]->tryGet<IrNode::Label>()) {
+                    labelCopies[label->definition] = createAnonymousLabelDefinition("$inline"_sv);
+                }
+            }
+
+            for (auto j = candidate->start + 1; j != candidate->end - 1; ++j) {
+                const auto irNode = bodyIrNodes[j];
+                if (const auto label = irNode->tryGet<IrNode::Label>()) {
+                    irNodes.addNew(IrNode::Label(labelCopies[label->definition]), irNode->location);
+                    continue;
+                }
+
+                const auto& code = irNode->code;
+                const auto branchKind = code.instruction->signature.type.tryGet<BranchKind>();
+                std::vector<InstructionOperandRoot> operandRoots;
+                const Instruction* instruction = code.instruction;
+
+                if (branchKind != nullptr && *branchKind == BranchKind::Return) {
+                    instruction = selectReturnJump(code, endLabelExpression, operandRoots);
+                } else {
+                    operandRoots.reserve(code.operandRoots.size());
+                    for (const auto& operandRoot : code.operandRoots) {
+                        const auto labelCopy = labelCopies.find(getDirectReference(operandRoot));
+                        if (labelCopy != labelCopies.end()) {
+                            const auto expression = expressionPool.add(resolveDefinitionExpression(labelCopy->second, {}, irNode->location));
+                            operandRoots.push_back(InstructionOperandRoot(expression, createOperandFromExpression(expression, true)));
+                        } else {
+                            operandRoots.push_back(InstructionOperandRoot(operandRoot.expression, operandRoot.operand->clone()));
+                        }
+                    }
+                }
+
+                irNodes.addNew(IrNode::Code(instruction, std::move(operandRoots)), irNode->location);
+            }
+
+            irNodes.addNew(IrNode::Label(endLabelDefinition), location);
+        }
+
+        return true;
+    }
+
+    bool Compiler::packRelocatableDeclarations() {
+        std::vector<std::vector<const InstructionOperand*>> captureLists;
+        std::vector<std::pair<std::size_t, std::size_t>> itemRanges;
+        std::unordered_map<const Definition*, const IrNode*> itemsByLabel;
+        std::vector<std::pair<const Definition*, const Definition*>> references;
+        const Definition* enclosingFunction = nullptr;
+
+        for (std::size_t i = 0; i != irNodes.size(); ++i) {
+            const auto& irNode = irNodes[i];
+            switch (irNode->kind) {
+                case IrNodeKind::PushRelocation: {
+                    if (irNode->pushRelocation.packedBanks.size() == 0) {
+                        break;
+                    }
+
+                    // Measure everything up to the matching pop.
+                    auto& item = relocatableItems[irNode.get()];
+                    std::size_t depth = 0;
+                    std::size_t end = i + 1;
+                    for (; end != irNodes.size(); ++end) {
+                        const auto& nestedIrNode = irNodes[end];
+                        if (nestedIrNode->kind == IrNodeKind::PushRelocation) {
+                            ++depth;
+                        } else if (nestedIrNode->kind == IrNodeKind::PopRelocation) {
+                            if (depth == 0) {
+                                break;
+                            }
+                            --depth;
+                        } else if (depth == 0) {
+                            if (const auto label = nestedIrNode->tryGet<IrNode::Label>()) {
+                                itemsByLabel[label->definition] = irNode.get();
+                                packedDefinitions.insert(label->definition);
+                            } else if (const auto code = nestedIrNode->tryGet<IrNode::Code>()) {
+                                if (code->instruction->signature.extract(code->operandRoots, captureLists)) {
+                                    item.size += code->instruction->encoding->calculateSize(code->instruction->options, captureLists);
+                                }
+                            } else if (const auto var = nestedIrNode->tryGet<IrNode::Var>()) {
+                                const auto& varDefinition = var->definition->var;
+                                const auto alignment = varDefinition.alignment != 0 ? varDefinition.alignment : 1;
+                                if (item.size == 0) {
+                                    item.alignment = alignment;
+                                } else {
+                                    item.size += alignment - 1;
+                                }
+                                item.size += varDefinition.storageSize.hasValue() ? varDefinition.storageSize.get() : 0;
+                                itemsByLabel[var->definition] = irNode.get();
+                                packedDefinitions.insert(var->definition);
+                            }
+                        }
+                    }
+
+                    if (end == irNodes.size()) {
+                        report->error("relocatable declaration has no matching end of relocation", irNode->location, ReportErrorFlags::InternalError);
+                        return false;
+                    }
+
+                    itemRanges.push_back(std::make_pair(i, end + 1));
+                    break;
+                }
+                case IrNodeKind::Label: {
+                    const auto definition = irNode->label.definition;
+                    if (definition->func.body != nullptr) {
+                        enclosingFunction = definition;
+                    }
+                    break;
+                }
+                case IrNodeKind::Code: {
+                    const auto& code = irNode->code;
+                    if (enclosingFunction != nullptr && code.instruction->signature.type.tryGet<BranchKind>() != nullptr && code.operandRoots.size() >= 2) {
+                        const auto destination = code.operandRoots[1].expression;
+                        const auto resolvedIdentifier = destination != nullptr ? destination->tryGet<Expression::ResolvedIdentifier>() : nullptr;
+                        if (resolvedIdentifier != nullptr && resolvedIdentifier->definition->kind == DefinitionKind::Func) {
+                            references.push_back(std::make_pair(enclosingFunction, resolvedIdentifier->definition));
+                        }
+                    }
+                    break;
+                }
+                default: break;
+            }
+        }
+
+        if (itemRanges.size() == 0) {
+            return true;
+        }
+
+        // Calls between declarations pull them toward the same bank.
+        for (const auto& reference : references) {
+            const auto sourceItem = itemsByLabel.find(reference.first);
+            const auto targetItem = itemsByLabel.find(reference.second);
+            const auto sourceNode = sourceItem != itemsByLabel.end() ? sourceItem->second : nullptr;
+            const auto targetNode = targetItem != itemsByLabel.end() ? targetItem->second : nullptr;
+
+            if (sourceNode != targetNode) {
+                if (sourceNode != nullptr) {
+                    relocatableItems[sourceNode].neighbors.push_back(reference.second);
+                }
+                if (targetNode != nullptr) {
+                    relocatableItems[targetNode].neighbors.push_back(reference.first);
+                }
+            }
+        }
+
+        // Move the relocatable declarations after everything else, largest first, so they get placed
+        // after all fixed content is known, and big items get first pick of the free space.
+        std::stable_sort(itemRanges.begin(), itemRanges.end(),
+            [&](const std::pair<std::size_t, std::size_t>& a, const std::pair<std::size_t, std::size_t>& b) {
+                return relocatableItems[irNodes[a.first].get()].size > relocatableItems[irNodes[b.first].get()].size;
+            });
+
+        std::vector<bool> moved(irNodes.size(), false);
+        for (const auto& itemRange : itemRanges) {
+            for (auto i = itemRange.first; i != itemRange.second; ++i) {
+                moved[i] = true;
+            }
+        }
+
+        auto oldIrNodes = irNodes.release();
+        for (std::size_t i = 0; i != oldIrNodes.size(); ++i) {
+            if (!moved[i]) {
+                irNodes.add(std::move(oldIrNodes[i]));
+            }
+        }
+        for (const auto& itemRange : itemRanges) {
+            for (auto i = itemRange.first; i != itemRange.second; ++i) {
+                irNodes.add(std::move(oldIrNodes[i]));
+            }
+        }
+
+        return true;
+    }
+
+    bool Compiler::placeRelocatableDeclaration(IrNode* irNode) {
+        auto& pushRelocation = irNode->pushRelocation;
+        auto& item = relocatableItems[irNode];
+
+        Bank* bestBank = nullptr;
+        std::size_t bestPosition = 0;
+        std::size_t bestAffinity = 0;
+
+        for (const auto bank : pushRelocation.packedBanks) {
+            const auto position = bank->findFreeSpace(item.size, item.alignment);
+            if (!position.hasValue()) {
+                continue;
+            }
+
+            std::size_t affinity = 0;
+            for (const auto neighbor : item.neighbors) {
+                const auto& address = neighbor->func.address;
+                if (address.hasValue() && address.get().bank == bank) {
+                    ++affinity;
+                }
+            }
+
+            if (bestBank == nullptr || affinity > bestAffinity) {
+                bestBank = bank;
+                bestPosition = position.get();
+                bestAffinity = affinity;
+            }
+        }
+
+        if (bestBank == nullptr) {
+            std::string bankNames;
+            for (const auto bank : pushRelocation.packedBanks) {
+                bankNames += (bankNames.size() != 0 ? ", `" : "`") + bank->getName().toString() + "`";
+            }
+
+            report->error("declaration needs " + std::to_string(item.size) + " byte(s), which do not fit in the remaining space of any of the banks " + bankNames, irNode->location);
+            return false;
+        }
+
+        pushRelocation.bank = bestBank;
+        item.position = bestPosition;
+        return true;
+    }
+
+    void Compiler::checkPackedReferences() {
+        // Call graph affinity is only a preference, so packing can still split a near reference across two banks
+        // that are mapped into the same addresses. Only one of them can be visible at a time, so the reference is wrong.
+        const auto getReferencedDefinition = [](const Expression* expression) -> const Definition* {
+            if (expression != nullptr) {
+                if (const auto binaryOperator = expression->tryGet<Expression::BinaryOperator>()) {
+                    if (binaryOperator->op == BinaryOperatorKind::Indexing) {
+                        expression = binaryOperator->left.get();
+                    }
+                }
+                if (const auto resolvedIdentifier = expression->tryGet<Expression::ResolvedIdentifier>()) {
+                    const auto definition = resolvedIdentifier->definition;
+                    if (definition->kind == DefinitionKind::Func || definition->kind == DefinitionKind::Var) {
+                        return definition;
+                    }
+                }
+            }
+            return nullptr;
+        };
+
+        const auto sharesAddresses = [](const Bank* a, const Bank* b) {
+            const auto originA = a->getOrigin();
+            const auto originB = b->getOrigin();
+            return originA.hasValue() && originB.hasValue()
+                && originA.get() < originB.get() + b->getCapacity()
+                && originB.get() < originA.get() + a->getCapacity();
+        };
+
+        std::vector<std::pair<const Bank*, bool>> relocationStack;
+        const Bank* sourceBank = nullptr;
+        bool sourcePacked = false;
+
+        for (const auto& irNode : irNodes) {
+            switch (irNode->kind) {
+                case IrNodeKind::PushRelocation: {
+                    relocationStack.push_back(std::make_pair(sourceBank, sourcePacked));
+                    sourceBank = irNode->pushRelocation.bank;
+                    sourcePacked = sourcePacked || irNode->pushRelocation.packedBanks.size() != 0;
+                    break;
+                }
+                case IrNodeKind::PopRelocation: {
+                    sourceBank = relocationStack.back().first;
+                    sourcePacked = relocationStack.back().second;
+                    relocationStack.pop_back();
+                    break;
+                }
+                case IrNodeKind::Code: {
+                    const auto& code = irNode->code;
+                    if (const auto branchKind = code.instruction->signature.type.tryGet<BranchKind>()) {
+                        if (*branchKind == BranchKind::FarCall || *branchKind == BranchKind::FarGoto || *branchKind == BranchKind::FarReturn) {
+                            break;
+                        }
+                    }
+
+                    for (const auto& operandRoot : code.operandRoots) {
+                        const auto definition = getReferencedDefinition(operandRoot.expression);
+                        if (definition == nullptr || sourceBank == nullptr
+                        || (!sourcePacked && packedDefinitions.find(definition) == packedDefinitions.end())) {
+                            continue;
+                        }
+
+                        const auto& address = definition->kind == DefinitionKind::Func ? definition->func.address : definition->var.address;
+                        const auto targetBank = address.hasValue() ? address.get().bank : nullptr;
+                        if (targetBank == nullptr || targetBank == sourceBank || !sharesAddresses(sourceBank, targetBank)) {
+                            continue;
+                        }
+
+                        report->error("`" + definition->name.toString() + "` was placed in bank `" + targetBank->getName().toString()
+                            + "`, but is referenced from bank `" + sourceBank->getName().toString()
+                            + "`, which is mapped at the same addresses (use a far call, or keep both in one bank)", irNode->location);
+                    }
+                    break;
+                }
+                default: break;
+            }
+        }
+    }
+
+    bool Compiler::isUnconditionalTransfer(const IrNode* irNode) const {
+        if (const auto code = irNode->tryGet<IrNode::Code>()) {
+            if (const auto branchKind = code->instruction->signature.type.tryGet<BranchKind>()) {
+                switch (*branchKind) {
+                    case BranchKind::Goto:
+                    case BranchKind::FarGoto:
+                    case BranchKind::Return:
+                    case BranchKind::FarReturn:
+                    case BranchKind::IrqReturn:
+                    case BranchKind::NmiReturn: {
+                        // Conditional branches always end with the boolean flag test operand.
+                        const auto& operandRoots = code->operandRoots;
+                        return operandRoots.size() > 0
+                            && operandRoots.back().operand->kind != InstructionOperandKind::Boolean;
+                    }
+                    default: return false;
+                }
+            }
+        }
+        return false;
+    }
+
+    bool Compiler::isRangeLimitedBranch(const IrNode* irNode) const {
+        const auto& code = irNode->code;
+        const auto& operandRoots = code.operandRoots;
+        if (operandRoots.size() == 0) {
+            return false;
+        }
+        const auto distanceHint = operandRoots[0].operand->tryGet<InstructionOperand::Integer>();
+        if (distanceHint == nullptr || distanceHint->value != Int128(0)) {
+            return false;
+        }
+
+        // If asking for a far branch picks a different encoding, the near one has a limited reach.
+        std::vector<InstructionOperandRoot> farOperandRoots;
+        farOperandRoots.reserve(operandRoots.size());
+        farOperandRoots.push_back(InstructionOperandRoot(nullptr, makeFwdUnique<InstructionOperand>(InstructionOperand::Integer(Int128(1)))));
+        for (std::size_t i = 1; i < operandRoots.size(); ++i) {
+            farOperandRoots.push_back(InstructionOperandRoot(operandRoots[i].expression, operandRoots[i].operand->clone()));
+        }
+
+        const auto farInstruction = builtins.selectInstruction(code.instruction->signature.type, code.instruction->signature.requiredModeFlags, farOperandRoots);
+        return farInstruction == nullptr || farInstruction->encoding != code.instruction->encoding;
+    }
+
+    bool Compiler::layoutCode() {
+        foldBranchesOverJumps();
+        // Moving functions changes where they are placed, which programs might rely on, so only do it when asked to optimize.
+        if (optimizationLevel != 0) {
+            orderFunctionsForFallthrough();
+        }
+        selectFlagClobberingInstructions();
+        return report->validate();
+    }
+
+    void Compiler::foldBranchesOverJumps() {
+        std::vector<std::vector<const InstructionOperand*>> captureLists;
+        std::set<std::size_t> irNodeIndexesToRemove;
+
+        // Rewrite `goto $skip if cond; goto dest; $skip:` into `goto dest if !cond; $skip:`.
+        // The jump can be any unconditional branch kind that has a conditional form (eg. `return`, `call`).
+        for (std::size_t i = 0; i + 1 < irNodes.size(); ++i) {
+            const auto& irNode = irNodes[i];
+            const auto& nextIrNode = irNodes[i + 1];
+            if (irNode->kind != IrNodeKind::Code || nextIrNode->kind != IrNodeKind::Code) {
+                continue;
+            }
+
+            auto& branch = irNode->code;
+            const auto& jump = nextIrNode->code;
+            const auto branchKind = branch.instruction->signature.type.tryGet<BranchKind>();
+            const auto jumpKind = jump.instruction->signature.type.tryGet<BranchKind>();
+            if (branchKind == nullptr || *branchKind != BranchKind::Goto || jumpKind == nullptr
+            || branch.operandRoots.size() != 4 || jump.operandRoots.size() == 0 || jump.operandRoots.size() > 2
+            || jump.operandRoots.back().operand->kind == InstructionOperandKind::Boolean) {
+                continue;
+            }
+
+            const auto condition = branch.operandRoots[3].operand->tryGet<InstructionOperand::Boolean>();
+            const auto skipExpression = branch.operandRoots[1].expression;
+            const auto skipIdentifier = skipExpression != nullptr ? skipExpression->tryGet<Expression::ResolvedIdentifier>() : nullptr;
+            if (condition == nullptr || skipIdentifier == nullptr) {
+                continue;
+            }
+
+            bool skipsJump = false;
+            for (std::size_t labelIndex = i + 2; labelIndex < irNodes.size(); ++labelIndex) {
+                if (const auto label = irNodes[labelIndex]->tryGet<IrNode::Label>()) {
+                    if (label->definition == skipIdentifier->definition) {
+                        skipsJump = true;
+                        break;
+                    }
+                } else {
+                    break;
+                }
+            }
+            if (!skipsJump) {
+                continue;
+            }
+
+            std::vector<InstructionOperandRoot> operandRoots;
+            operandRoots.reserve(jump.operandRoots.size() + 2);
+            for (const auto& operandRoot : jump.operandRoots) {
+                operandRoots.push_back(InstructionOperandRoot(operandRoot.expression, operandRoot.operand->clone()));
+            }
+            operandRoots.push_back(InstructionOperandRoot(branch.operandRoots[2].expression, branch.operandRoots[2].operand->clone()));
+            operandRoots.push_back(InstructionOperandRoot(nullptr, makeFwdUnique<InstructionOperand>(InstructionOperand::Boolean(!condition->value))));
+
+            // Only accept the same encoding as the original jump, so the folded branch has the same reach.
+            const auto modeFlags = branch.instruction->signature.requiredModeFlags | jump.instruction->signature.requiredModeFlags;
+            const auto instruction = builtins.selectInstruction(jump.instruction->signature.type, modeFlags, operandRoots);
+            if (instruction == nullptr || instruction->encoding != jump.instruction->encoding) {
+                continue;
+            }
+
+            if (!branch.instruction->signature.extract(branch.operandRoots, captureLists)) {
+                continue;
+            }
+            const auto branchSize = branch.instruction->encoding->calculateSize(branch.instruction->options, captureLists);
+            if (!jump.instruction->signature.extract(jump.operandRoots, captureLists)) {
+                continue;
+            }
+            const auto jumpSize = jump.instruction->encoding->calculateSize(jump.instruction->options, captureLists);
+            if (!instruction->signature.extract(operandRoots, captureLists)) {
+                continue;
+            }
+            const auto foldedSize = instruction->encoding->calculateSize(instruction->options, captureLists);
+
+            if (foldedSize < branchSize + jumpSize) {
+                branch.instruction = instruction;
+                branch.operandRoots = std::move(operandRoots);
+                irNodeIndexesToRemove.insert(i + 1);
+                ++i;
+            }
+        }
+
+        irNodes.remove(irNodeIndexesToRemove);
+    }
+
+    void Compiler::orderFunctionsForFallthrough() {
+        const auto none = SIZE_MAX;
+        const auto irNodeCount = irNodes.size();
+
+        // A chunk is a function label and the code that follows it.
+        // Consecutive chunks form a movable segment, ended by relocations or data.
+        std::vector<std::size_t> chunkOf(irNodeCount, none);
+        std::vector<std::size_t> segmentOf(irNodeCount, none);
+        std::vector<std::size_t> chunkStarts;
+        std::vector<std::size_t> chunkSegments;
+        std::vector<std::pair<std::size_t, std::size_t>> segmentChunkRanges;
+        std::vector<std::size_t> segmentEnds;
+        std::unordered_map<const Definition*, std::size_t> labelIndexes;
+
+        for (std::size_t i = 0; i != irNodeCount; ++i) {
+            const auto& irNode = irNodes[i];
+            switch (irNode->kind) {
+                case IrNodeKind::Label: {
+                    const auto definition = irNode->label.definition;
+                    labelIndexes[definition] = i;
+
+                    if (definition->func.body != nullptr && !definition->func.inlined) {
+                        if (segmentChunkRanges.size() == 0 || segmentChunkRanges.back().second != none) {
+                            segmentChunkRanges.push_back(std::make_pair(chunkStarts.size(), none));
+                        }
+                        chunkStarts.push_back(i);
+                        chunkSegments.push_back(segmentChunkRanges.size() - 1);
+                    }
+                    break;
+                }
+                case IrNodeKind::Code: break;
+                default: {
+                    if (segmentChunkRanges.size() != 0 && segmentChunkRanges.back().second == none) {
+                        segmentChunkRanges.back().second = chunkStarts.size();
+                        segmentEnds.push_back(i);
+                    }
+                    break;
+                }
+            }
+
+            if (segmentChunkRanges.size() != 0 && segmentChunkRanges.back().second == none) {
+                chunkOf[i] = chunkStarts.size() - 1;
+                segmentOf[i] = segmentChunkRanges.size() - 1;
+            }
+        }
+
+        if (segmentChunkRanges.size() != 0 && segmentChunkRanges.back().second == none) {
+            segmentChunkRanges.back().second = chunkStarts.size();
+            segmentEnds.push_back(irNodeCount);
+        }
+
+        const auto chunkCount = chunkStarts.size();
+        const auto getChunkEnd = [&](std::size_t chunk) {
+            return chunk + 1 < chunkCount && chunkSegments[chunk + 1] == chunkSegments[chunk]
+                ? chunkStarts[chunk + 1]
+                : segmentEnds[chunkSegments[chunk]];
+        };
+
+        std::vector<std::size_t> chainHeads(chunkCount, none);
+        std::vector<std::size_t> chainSuccessors(chunkCount, none);
+        std::vector<std::size_t> chainPredecessors(chunkCount, none);
+        std::unordered_map<const Definition*, std::size_t> chainsByHeadLabel;
+        std::set<std::size_t> linkedTailCalls;
+
+        for (std::size_t segment = 0; segment != segmentChunkRanges.size(); ++segment) {
+            const auto firstChunk = segmentChunkRanges[segment].first;
+            const auto lastChunk = segmentChunkRanges[segment].second;
+
+            // Chunks that don't end in an unconditional transfer fall into the next one, so they must stay glued together.
+            for (std::size_t chunk = firstChunk; chunk != lastChunk; ++chunk) {
+                if (chunk != firstChunk && !isUnconditionalTransfer(irNodes[chunkStarts[chunk] - 1].get())) {
+                    chainHeads[chunk] = chainHeads[chunk - 1];
+                } else {
+                    chainHeads[chunk] = chunk;
+                    chainsByHeadLabel[irNodes[chunkStarts[chunk]]->label.definition] = chunk;
+                }
+            }
+
+            // Link each chain that ends in a tail call to the chain it calls, so the jump becomes a fallthrough.
+            std::vector<std::pair<std::size_t, std::size_t>> tailCalls;
+            for (std::size_t chunk = firstChunk; chunk != lastChunk; ++chunk) {
+                const auto chunkEnd = getChunkEnd(chunk);
+                const auto& lastIrNode = irNodes[chunkEnd - 1];
+                if (chunk + 1 != lastChunk && chainHeads[chunk + 1] == chainHeads[chunk]) {
+                    continue;
+                }
+                if (!isUnconditionalTransfer(lastIrNode.get())) {
+                    continue;
+                }
+
+                const auto& code = lastIrNode->code;
+                if (*code.instruction->signature.type.tryGet<BranchKind>() != BranchKind::Goto || code.operandRoots.size() != 2) {
+                    continue;
+                }
+
+                const auto destination = code.operandRoots[1].expression;
+                const auto resolvedIdentifier = destination != nullptr ? destination->tryGet<Expression::ResolvedIdentifier>() : nullptr;
+                if (resolvedIdentifier == nullptr) {
+                    continue;
+                }
+
+                const auto chainIter = chainsByHeadLabel.find(resolvedIdentifier->definition);
+                if (chainIter != chainsByHeadLabel.end()) {
+                    tailCalls.push_back(std::make_pair(chunk, chainIter->second));
+                }
+            }
+
+            // A chain can only be fallen into from one place, so with a profile, the most executed tail calls get first pick.
+            if (profile != nullptr) {
+                std::stable_sort(tailCalls.begin(), tailCalls.end(),
+                    [&](const std::pair<std::size_t, std::size_t>& a, const std::pair<std::size_t, std::size_t>& b) {
+                        return profile->getFunctionWeight(irNodes[chunkStarts[a.first]]->label.definition)
+                            > profile->getFunctionWeight(irNodes[chunkStarts[b.first]]->label.definition);
+                    });
+            }
+
+            for (const auto& tailCall : tailCalls) {
+                const auto chunk = tailCall.first;
+                const auto source = chainHeads[chunk];
+                const auto target = tailCall.second;
+                if (target == firstChunk || chunkSegments[target] != segment || target == source
+                || chainPredecessors[target] != none || chainSuccessors[source] != none) {
+                    continue;
+                }
+
+                bool cyclic = false;
+                for (auto next = target; next != none; next = chainSuccessors[next]) {
+                    if (next == source) {
+                        cyclic = true;
+                        break;
+                    }
+                }
+                if (cyclic) {
+                    continue;
+                }
+
+                chainSuccessors[source] = target;
+                chainPredecessors[target] = source;
+                linkedTailCalls.insert(getChunkEnd(chunk) - 1);
+            }
+        }
+
+        // Short branches between chunks could end up out of range after reordering, so leave those segments alone.
+        std::vector<bool> segmentPinned(segmentChunkRanges.size(), false);
+        for (std::size_t i = 0; i != irNodeCount; ++i) {
+            const auto& irNode = irNodes[i];
+            if (irNode->kind != IrNodeKind::Code || linkedTailCalls.find(i) != linkedTailCalls.end()) {
+                continue;
+            }
+
+            const auto& code = irNode->code;
+            if (code.instruction->signature.type.tryGet<BranchKind>() == nullptr || code.operandRoots.size() < 2) {
+                continue;
+            }
+
+            const auto destination = code.operandRoots[1].expression;
+            const auto resolvedIdentifier = destination != nullptr ? destination->tryGet<Expression::ResolvedIdentifier>() : nullptr;
+            if (resolvedIdentifier == nullptr) {
+                continue;
+            }
+
+            const auto labelIndexIter = labelIndexes.find(resolvedIdentifier->definition);
+            if (labelIndexIter == labelIndexes.end()) {
+                continue;
+            }
+
+            const auto labelIndex = labelIndexIter->second;
+            if (chunkOf[i] != chunkOf[labelIndex] && isRangeLimitedBranch(irNode.get())) {
+                if (segmentOf[i] != none) {
+                    segmentPinned[segmentOf[i]] = true;
+                }
+                if (segmentOf[labelIndex] != none) {
+                    segmentPinned[segmentOf[labelIndex]] = true;
+                }
+            }
+        }
+
+        bool changed = false;
+        for (std::size_t chunk = 0; chunk != chunkCount; ++chunk) {
+            if (segmentPinned[chunkSegments[chunk]]) {
+                chainSuccessors[chunk] = none;
+                chainPredecessors[chunk] = none;
+            } else if (chainSuccessors[chunk] != none) {
+                changed = true;
+            }
+        }
+
+        if (!changed) {
+            return;
+        }
+
+        auto oldIrNodes = irNodes.release();
+        std::size_t i = 0;
+        while (i != irNodeCount) {
+            if (segmentOf[i] == none) {
+                irNodes.add(std::move(oldIrNodes[i]));
+                ++i;
+                continue;
+            }
+
+            const auto segment = segmentOf[i];
+            const auto firstChunk = segmentChunkRanges[segment].first;
+            const auto lastChunk = segmentChunkRanges[segment].second;
+
+            for (std::size_t chunk = firstChunk; chunk != lastChunk; ++chunk) {
+                if (chainHeads[chunk] != chunk || chainPredecessors[chunk] != none) {
+                    continue;
+                }
+
+                for (auto chain = chunk; chain != none; chain = chainSuccessors[chain]) {
+                    for (auto member = chain; member != lastChunk && chainHeads[member] == chain; ++member) {
+                        const auto memberEnd = getChunkEnd(member);
+                        for (auto j = chunkStarts[member]; j != memberEnd; ++j) {
+                            irNodes.add(std::move(oldIrNodes[j]));
+                        }
+                    }
+                }
+            }
+
+            i = segmentEnds[segment];
+        }
+    }
+
+    void Compiler::selectFlagClobberingInstructions() {
+        std::vector<std::vector<const InstructionOperand*>> captureLists;
+        std::unordered_map<const Definition*, std::size_t> labelIndexes;
+
+        const auto measure = [&](const Instruction* instruction, const std::vector<InstructionOperandRoot>& operandRoots) -> std::size_t {
+            return instruction->signature.extract(operandRoots, captureLists)
+                ? instruction->encoding->calculateSize(instruction->options, captureLists)
+                : SIZE_MAX;
+        };
+
+        for (std::size_t i = 0; i != irNodes.size(); ++i) {
+            if (const auto label = irNodes[i]->tryGet<IrNode::Label>()) {
+                labelIndexes[label->definition] = i;
+            }
+        }
+
+        // Layout is final at this point, so the code that follows an instruction in the IR is the code that runs after it.
+        for (std::size_t i = 0; i != irNodes.size(); ++i) {
+            auto& irNode = irNodes[i];
+            if (irNode->kind != IrNodeKind::Code) {
+                continue;
+            }
+
+            auto& code = irNode->code;
+            const auto instruction = builtins.selectFlagClobberingInstruction(code.instruction->signature.type, code.instruction->signature.requiredModeFlags, code.operandRoots);
+            if (instruction == nullptr || instruction == code.instruction
+            || measure(instruction, code.operandRoots) >= measure(code.instruction, code.operandRoots)) {
+                continue;
+            }
+
+            bool clobbersLiveFlag = false;
+            for (const auto flag : instruction->options.affectedFlags) {
+                if (isFlagLiveAfter(i, flag, labelIndexes)) {
+                    clobbersLiveFlag = true;
+                    break;
+                }
+            }
+
+            if (!clobbersLiveFlag) {
+                code.instruction = instruction;
+            }
+        }
+    }
+
+    bool Compiler::isFlagLiveAfter(std::size_t irNodeIndex, const Definition* flag, const std::unordered_map<const Definition*, std::size_t>& labelIndexes) const {
+        // Give up on long paths rather than following the whole program.
+        const std::size_t scanLimit = 64;
+
+        std::vector<std::size_t> pendingIndexes {irNodeIndex + 1};
+        std::set<std::size_t> visitedIndexes;
+        std::size_t scanCount = 0;
+
+        // Follow every path out of the instruction until each one overwrites the flag.
+        // Anything the scan can't see past (calls, returns, indirect jumps, data, relocations) might read the flag.
+        while (pendingIndexes.size() != 0) {
+            auto index = pendingIndexes.back();
+            pendingIndexes.pop_back();
+
+            if (!visitedIndexes.insert(index).second) {
+                continue;
+            }
+
+            for (; ; ++index) {
+                if (index >= irNodes.size() || ++scanCount > scanLimit) {
+                    return true;
+                }
+
+                const auto& irNode = irNodes[index];
+                if (irNode->kind == IrNodeKind::Label) {
+                    continue;
+                }
+                if (irNode->kind != IrNodeKind::Code) {
+                    return true;
+                }
+
+                const auto& code = irNode->code;
+                const auto usage = platform->getFlagUsage(code.instruction, code.operandRoots, flag);
+                if (usage == PlatformFlagUsage::Read || usage == PlatformFlagUsage::Unknown) {
+                    return true;
+                }
+                if (usage == PlatformFlagUsage::Write) {
+                    break;
+                }
+
+                if (const auto branchKind = code.instruction->signature.type.tryGet<BranchKind>()) {
+                    if (*branchKind != BranchKind::Goto || code.operandRoots.size() < 2) {
+                        return true;
+                    }
+
+                    const auto destination = code.operandRoots[1].expression;
+                    const auto resolvedIdentifier = destination != nullptr ? destination->tryGet<Expression::ResolvedIdentifier>() : nullptr;
+                    const auto labelIndexIter = resolvedIdentifier != nullptr ? labelIndexes.find(resolvedIdentifier->definition) : labelIndexes.end();
+                    if (labelIndexIter == labelIndexes.end()) {
+                        return true;
+                    }
+
+                    pendingIndexes.push_back(labelIndexIter->second);
+                    if (isUnconditionalTransfer(irNode.get())) {
+                        break;
+                    }
+                }
+            }
+        }
+
+        return false;
+    }
+
+    bool Compiler::assignAddresses() {
+        for (auto& bank : registeredBanks) {
+            bank->rewind();
+        }
+        
+        std::vector<std::vector<const InstructionOperand*>> captureLists;
+        std::set<std::size_t> irNodeIndexesToRemove;
+
+        // First pass: calculate data/instruction sizes, assign labels.
+        for (std::size_t i = 0; i != irNodes.size(); ++i) {
             const auto& irNode = irNodes[i];
             switch (irNode->kind) {
                 case IrNodeKind::PushRelocation: {
                     const auto& pushRelocation = irNode->pushRelocation;
                     bankStack.push_back(currentBank);
+
+                    if (pushRelocation.packedBanks.size() != 0) {
+                        if (!placeRelocatableDeclaration(irNode.get())) {
+                            return false;
+                        }
+
+                        currentBank = pushRelocation.bank;
+                        currentBank->setRelativePosition(relocatableItems[irNode.get()].position);
+                        break;
+                    }
+
                     currentBank = pushRelocation.bank;
 
                     if (const auto address = pushRelocation.address.tryGet()) {
@@ -7145,9 +9303,7 @@ namespace wiz {
             }
         }
 
-        for (auto it = irNodeIndexesToRemove.rbegin(); it != irNodeIndexesToRemove.rend(); ++it) {
-            irNodes.remove(*it);
-        }
+        irNodes.remove(irNodeIndexesToRemove);
 
         irNodeIndexesToRemove.clear();
 
@@ -7155,6 +9311,31 @@ namespace wiz {
             return false;
         }
 
+        if (relocatableItems.size() != 0) {
+            checkPackedReferences();
+            if (!report->validate()) {
+                return false;
+            }
+
+            std::set<const Bank*> targetBanks;
+            for (const auto& irNode : irNodes) {
+                if (irNode->kind == IrNodeKind::PushRelocation) {
+                    targetBanks.insert(irNode->pushRelocation.packedBanks.begin(), irNode->pushRelocation.packedBanks.end());
+                }
+            }
+
+            report->log("packed " + std::to_string(relocatableItems.size()) + " relocatable declaration(s) into " + std::to_string(targetBanks.size()) + " bank(s):");
+            for (const auto& bank : registeredBanks) {
+                if (targetBanks.find(bank.get()) != targetBanks.end()) {
+                    report->log("  bank `" + bank->getName().toString() + "`: " + std::to_string(bank->calculateFreeSize()) + " of " + std::to_string(bank->getCapacity()) + " byte(s) free");
+                }
+            }
+        }
+
+        return true;
+    }
+
+    bool Compiler::generateCode() {
         for (auto& bank : registeredBanks) {
             bank->rewind();
         }
@@ -7162,6 +9343,10 @@ namespace wiz {
         std::vector<std::uint8_t> tempBuffer;
         std::vector<FwdUniquePtr<const Expression>> tempExpressions;
         std::vector<InstructionOperandRoot> tempOperandRoots;
+        std::vector<std::vector<const InstructionOperand*>> captureLists;
+
+        sourceMap.clear();
+        sourceMap.reserve(irNodes.size());
 
         // Second pass: resolve all link-time expressions, write the instructions into the correct banks.
         for (const auto& irNode : irNodes) {
@@ -7171,7 +9356,9 @@ namespace wiz {
                     bankStack.push_back(currentBank);
                     currentBank = pushRelocation.bank;
 
-                    if (const auto address = pushRelocation.address.tryGet()) {
+                    if (pushRelocation.packedBanks.size() != 0) {
+                        currentBank->setRelativePosition(relocatableItems[irNode.get()].position);
+                    } else if (const auto address = pushRelocation.address.tryGet()) {
                         currentBank->absoluteSeek(report, *address, irNode->location);
                     }
                     break;
@@ -7221,7 +9408,11 @@ namespace wiz {
 
                     for (std::size_t i = 0; i != code.operandRoots.size() && !failed; ++i) {
                         const auto& operandRoot = code.operandRoots[i];
-                        if (const auto expression = operandRoot.expression) {
+                        if (operandRoot.expression != nullptr && !operandRoot.operand->hasPlaceholder()) {
+                            // Everything this operand depends on was already known when the instruction was selected,
+                            // so reducing the expression again would produce the same operand.
+                            tempOperandRoots.push_back(InstructionOperandRoot(operandRoot.expression, operandRoot.operand->clone()));
+                        } else if (const auto expression = operandRoot.expression) {
                             if (auto reducedExpression = reduceExpression(expression)) {
                                 if (auto operand = createOperandFromExpression(reducedExpression.get(), true)) {
                                     tempOperandRoots.push_back(InstructionOperandRoot(reducedExpression.get(), std::move(operand)));
@@ -7245,11 +9436,16 @@ namespace wiz {
                     }
 
                     if (instruction->signature.extract(tempOperandRoots, captureLists)) {
+                        const auto address = currentBank->getAddress();
+
                         tempBuffer.clear();
                         instruction->encoding->write(report, currentBank, tempBuffer, instruction->options, captureLists, irNode->location);
                         if (!currentBank->write(report, "code"_sv, irNode.get(), irNode->location, tempBuffer)) {
                             break;
                         }
+
+                        // Record which source line produced each instruction, so debug formats can map addresses back to lines.
+                        sourceMap.push_back(SourceMapEntry(address, irNode->location));
                     } else {
                         report->error("failed to extract instruction capture list during generation pass", irNode->location, ReportErrorFlags::InternalError);
                     }
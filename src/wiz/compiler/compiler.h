@@ -11,6 +11,7 @@
 
 #include <wiz/compiler/instruction.h>
 #include <wiz/compiler/builtins.h>
+#include <wiz/compiler/source_map.h>
 #include <wiz/utility/string_pool.h>
 #include <wiz/utility/fwd_unique_ptr.h>
 #include <wiz/utility/int128.h>
@@ -28,6 +29,7 @@ namespace wiz {
     class Bank;
     class Config;
     class Report;
+    class Profile;
     class Platform;
     class SymbolTable;
     class ImportManager;
@@ -49,15 +51,34 @@ namespace wiz {
                 Config* config,
                 ImportManager* importManager,
                 Report* report,
+                std::size_t optimizationLevel,
+                const Profile* profile,
+                std::unordered_map<StringView, FwdUniquePtr<const Expression>> defines);
+            // Compiles a program that is owned by the caller, and must outlive the compiler.
+            // The program is only read, so several compilers can share one parsed program, even concurrently.
+            Compiler(
+                const Statement* program,
+                Platform* platform,
+                StringPool* stringPool,
+                Config* config,
+                ImportManager* importManager,
+                Report* report,
+                std::size_t optimizationLevel,
+                const Profile* profile,
                 std::unordered_map<StringView, FwdUniquePtr<const Expression>> defines);
             ~Compiler();
 
             bool compile();
+            // Runs every stage up to assigning addresses to definitions, without generating any code.
+            bool compileLayout();
 
             Report* getReport() const;
             const Statement* getProgram() const;
             std::vector<const Bank*> getRegisteredBanks() const;
             std::vector<const Definition*> getRegisteredDefinitions() const;
+            // Returns a (function, variable) pair for every instruction that refers to a variable, once the layout is known.
+            std::vector<std::pair<const Definition*, const Definition*>> getVariableAccesses() const;
+            const std::vector<SourceMapEntry>& getSourceMap() const;
             const Builtins& getBuiltins() const;
             std::uint32_t getModeFlags() const;
 
@@ -87,12 +108,19 @@ namespace wiz {
             std::pair<Definition*, std::size_t> resolveIdentifier(const std::vector<StringView>& pieces, SourceLocation location);
             FwdUniquePtr<const TypeExpression> reduceTypeExpression(const TypeExpression* typeExpression);
             FwdUniquePtr<const Expression> reduceExpression(const Expression* expression);
+            bool isIExprLiteral(const Expression* expression) const;
+            struct BytecodeCompileState;
+            bool compileBytecodeExpression(BytecodeCompileState& state, const Expression* expression, bool root);
             Optional<std::size_t> tryGetSequenceLiteralLength(const Expression* expression) const;
             FwdUniquePtr<const Expression> getSequenceLiteralItem(const Expression* expression, std::size_t index) const;
             FwdUniquePtr<const Expression> createStringLiteralExpression(StringView data, SourceLocation location) const;
             FwdUniquePtr<const Expression> createArrayLiteralExpression(std::vector<FwdUniquePtr<const Expression>> items, const TypeExpression* elementType, SourceLocation location) const;
             std::string getResolvedIdentifierName(Definition* definition, const std::vector<StringView>& pieces) const;
             FwdUniquePtr<const Expression> resolveDefinitionExpression(Definition* definition, const std::vector<StringView>& pieces, SourceLocation location);
+            Definition* findUniqueDefinition(const std::vector<StringView>& pieces) const;
+            bool isDeclaredLetDefinition(const Definition* definition) const;
+            bool isConstantLetDefinition(const Definition* definition, std::vector<const Definition*>& visitedDefinitions);
+            bool isConstantLetExpression(const Expression* expression, const std::vector<StringView>& boundNames, std::vector<const Definition*>& visitedDefinitions);
             FwdUniquePtr<const Expression> resolveTypeMemberExpression(const TypeExpression* typeExpression, StringView name);
             FwdUniquePtr<const Expression> resolveValueMemberExpression(const Expression* expression, StringView name);
             FwdUniquePtr<const Expression> simplifyIndirectionOffsetExpression(FwdUniquePtr<const TypeExpression> resultType, const Expression* expression, EvaluationContext context, Optional<Int128> absolutePosition, Int128 offset);
@@ -137,6 +165,7 @@ namespace wiz {
             bool reserveStorage(const Statement* statement);
             bool resolveVariableInitializer(Definition* definition, const Expression* initializer, StringView description, SourceLocation location);
             bool reserveVariableStorage(Definition* definition, StringView description, SourceLocation location);
+            bool reservePackedVariableStorage(const Statement* statement, const std::vector<Bank*>& banks);
 
             FwdUniquePtr<InstructionOperand> createPlaceholderFromResolvedTypeDefinition(const Definition* resolvedTypeDefinition) const;
             FwdUniquePtr<InstructionOperand> createPlaceholderFromTypeExpression(const TypeExpression* typeExpression) const;
@@ -145,6 +174,7 @@ namespace wiz {
             FwdUniquePtr<InstructionOperand> createOperandFromRunTimeExpression(const Expression* expression, bool quiet) const;
             bool isLeafExpression(const Expression* expression) const;
             bool hasNestedAssignment(const Expression* expression) const;
+            bool collectReferencedDefinitions(const Expression* expression, std::vector<const Definition*>& results) const;
             bool emitNestedAssignmentIr(const Expression* expression, bool pre, bool post);
             FwdUniquePtr<const Expression> stripNestedAssignment(const Expression* expression) const;
 
@@ -167,16 +197,34 @@ namespace wiz {
             std::unique_ptr<PlatformTestAndBranch> getTestAndBranch(BinaryOperatorKind op, const Expression* left, const Expression* right, std::size_t distanceHint) const;
             bool emitBranchIr(std::size_t distanceHint, BranchKind kind, const Expression* destination, const Expression* returnValue, bool negated, const Expression* condition, SourceLocation location);
             bool hasUnconditionalReturn(const Statement* statement) const;
+            bool isDeclarationFree(const Statement* statement) const;
             bool emitFunctionIr(Definition* definition, SourceLocation location);
             bool emitStatementIr(const Statement* statement);
+            bool resolveOptimizationLevel();
+            bool inlineSmallFunctions();
+            bool inlineSmallFunctionCalls(std::vector<std::string>& keptMessages, bool useProfile);
+            bool packRelocatableDeclarations();
+            bool placeRelocatableDeclaration(IrNode* irNode);
+            void checkPackedReferences();
+            bool isUnconditionalTransfer(const IrNode* irNode) const;
+            bool isRangeLimitedBranch(const IrNode* irNode) const;
+            bool layoutCode();
+            void foldBranchesOverJumps();
+            void orderFunctionsForFallthrough();
+            void selectFlagClobberingInstructions();
+            bool isFlagLiveAfter(std::size_t irNodeIndex, const Definition* flag, const std::unordered_map<const Definition*, std::size_t>& labelIndexes) const;
+            bool assignAddresses();
             bool generateCode();
 
-            FwdUniquePtr<const Statement> program;
+            FwdUniquePtr<const Statement> ownedProgram;
+            const Statement* program = nullptr;
             Platform* platform = nullptr;
             StringPool* stringPool = nullptr;
             Config* config = nullptr;
             ImportManager* importManager = nullptr;
             Report* report = nullptr;
+            std::size_t optimizationLevel = 0;
+            const Profile* profile = nullptr;
             Builtins builtins;
 
             std::unordered_map<StringView, SymbolTable*> moduleScopes;
@@ -184,6 +232,7 @@ namespace wiz {
             PtrPool<SymbolTable> registeredScopes;
             SymbolTable* currentScope = nullptr;
             std::vector<SymbolTable*> scopeStack;
+            std::size_t blockCount = 0;
 
             struct ResolveIdentifierState {
                 std::set<Definition*> previousResults;
@@ -205,6 +254,7 @@ namespace wiz {
             std::vector<Definition*> definitionsToResolve;
 
             static const std::size_t MaxLetRecursionDepth = 128;
+            static const std::size_t MaxBytecodeInstructions = 4096;
 
             struct LetExpressionStackItem {
                 LetExpressionStackItem(
@@ -217,6 +267,21 @@ namespace wiz {
             };
 
             std::vector<LetExpressionStackItem> letExpressionStack;
+            std::size_t letExpressionStackPeak = 0;
+
+            struct ReducedLetExpression {
+                ReducedLetExpression(
+                    FwdUniquePtr<const Expression> expression,
+                    std::size_t depth)
+                : expression(std::move(expression)), depth(depth) {}
+
+                // Null if the `let` expression might not reduce the same way every time.
+                FwdUniquePtr<const Expression> expression;
+                // How deep the `let` expression stack got while reducing it.
+                std::size_t depth;
+            };
+
+            std::unordered_map<const Definition*, ReducedLetExpression> reducedLetExpressions;
 
             bool allowReservedConstants = false;
             std::vector<Definition*> reservedConstants;
@@ -252,6 +317,17 @@ namespace wiz {
             Bank* currentBank = nullptr;
             std::vector<Bank*> bankStack;
             PtrPool<Bank> registeredBanks;
+            std::vector<Bank*> packedBanks;
+
+            struct RelocatableItem {
+                std::size_t size = 0;
+                std::size_t alignment = 1;
+                std::size_t position = 0;
+                std::vector<const Definition*> neighbors;
+            };
+
+            std::unordered_map<const IrNode*, RelocatableItem> relocatableItems;
+            std::set<const Definition*> packedDefinitions;
 
             Definition* currentFunction = nullptr;
             Definition* breakLabel = nullptr;
@@ -264,6 +340,7 @@ namespace wiz {
             FwdPtrPool<const Statement> statementPool;
             FwdPtrPool<const Expression> expressionPool;
             FwdPtrPool<IrNode> irNodes;
+            std::vector<SourceMapEntry> sourceMap;
             std::unordered_map<StringView, std::size_t> labelSuffixes;
     };
 }
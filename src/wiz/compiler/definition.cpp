@@ -1,5 +1,6 @@
 #include <wiz/utility/fwd_unique_ptr.h>
 #include <wiz/compiler/definition.h>
+#include <wiz/compiler/symbol_table.h>
 
 namespace wiz {
     template <>
@@ -40,4 +41,17 @@ namespace wiz {
             default: return Optional<Address>();
         }
     }
+
+    std::string Definition::getQualifiedName() const {
+        std::string result;
+        // Anonymous labels start with `$`, and are left unqualified.
+        if ((name.getLength() == 0 || name[0] != '$') && parentScope != nullptr) {
+            result = parentScope->getFullName();
+            if (!result.empty()) {
+                result += '.';
+            }
+        }
+        result += name.toString();
+        return result;
+    }
 }
\ No newline at end of file
@@ -3,6 +3,7 @@
 
 #include <type_traits>
 #include <memory>
+#include <string>
 #include <cstddef>
 #include <cstdint>
 
@@ -456,6 +457,8 @@ namespace wiz {
         template <typename T> const T* tryGet() const;
 
         Optional<Address> getAddress() const;
+        // The name qualified by every enclosing named scope (eg. `player.update`), as used in symbol files and reports.
+        std::string getQualifiedName() const;
 
         DefinitionKind kind;
         union {
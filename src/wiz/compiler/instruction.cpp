@@ -214,6 +214,20 @@ namespace wiz {
         }
     }
 
+    bool InstructionOperand::hasPlaceholder() const {
+        switch (kind) {
+            case InstructionOperandKind::BitIndex: return bitIndex.operand->hasPlaceholder() || bitIndex.subscript->hasPlaceholder();
+            case InstructionOperandKind::Binary: return binary.left->hasPlaceholder() || binary.right->hasPlaceholder();
+            case InstructionOperandKind::Boolean: return boolean.placeholder;
+            case InstructionOperandKind::Dereference: return dereference.operand->hasPlaceholder();
+            case InstructionOperandKind::Index: return index.operand->hasPlaceholder() || index.subscript->hasPlaceholder();
+            case InstructionOperandKind::Integer: return integer.placeholder;
+            case InstructionOperandKind::Register: return false;
+            case InstructionOperandKind::Unary: return unary.operand->hasPlaceholder();
+            default: std::abort(); return false;
+        }
+    }
+
 
 
 
@@ -195,6 +195,9 @@ namespace wiz {
         int compare(const InstructionOperand& other) const;
         std::string toString() const;
 
+        // Returns true if any part of this operand stands in for a value that isn't known yet (eg. a label address).
+        bool hasPlaceholder() const;
+
         bool operator ==(const InstructionOperand& other) const {
             return compare(other) == 0;
         }
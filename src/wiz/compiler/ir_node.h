@@ -31,8 +31,18 @@ namespace wiz {
             : bank(bank),
             address(address) {}
 
+            PushRelocation(
+                Bank* bank,
+                Optional<std::size_t> address,
+                const std::vector<Bank*>& packedBanks)
+            : bank(bank),
+            address(address),
+            packedBanks(packedBanks) {}
+
             Bank* bank;
             Optional<std::size_t> address;
+            // If non-empty, the bank is picked from these during code generation.
+            std::vector<Bank*> packedBanks;
         };
 
         struct PopRelocation {};
@@ -0,0 +1,212 @@
+#include <map>
+#include <algorithm>
+
+#include <wiz/compiler/bank.h>
+#include <wiz/compiler/profile.h>
+#include <wiz/compiler/definition.h>
+#include <wiz/utility/text.h>
+#include <wiz/utility/report.h>
+#include <wiz/utility/source_location.h>
+
+namespace wiz {
+    namespace {
+        // Functions with at least 1/32 of the total weight are treated as hot.
+        const std::uint64_t hotWeightShift = 5;
+
+        bool parseNumber(StringView text, std::size_t radix, std::uint64_t& result) {
+            if (text.getLength() == 0) {
+                return false;
+            }
+
+            result = 0;
+            for (std::size_t i = 0; i != text.getLength(); ++i) {
+                const auto c = static_cast<unsigned char>(text[i]);
+                std::uint64_t digit = 0;
+                if (c >= '0' && c <= '9') {
+                    digit = c - '0';
+                } else if (radix == 16 && c >= 'a' && c <= 'f') {
+                    digit = c - 'a' + 10;
+                } else if (radix == 16 && c >= 'A' && c <= 'F') {
+                    digit = c - 'A' + 10;
+                } else {
+                    return false;
+                }
+
+                if (result > (UINT64_MAX - digit) / radix) {
+                    return false;
+                }
+                result = result * radix + digit;
+            }
+            return true;
+        }
+
+        bool parseAddress(StringView text, std::uint64_t& result) {
+            if (text.getLength() > 0 && text[0] == '$') {
+                text = text.sub(1);
+            } else if (text.getLength() > 1 && text[0] == '0' && (text[1] == 'x' || text[1] == 'X')) {
+                text = text.sub(2);
+            }
+            return parseNumber(text, 16, result);
+        }
+    }
+
+    Profile::Profile() {}
+    Profile::~Profile() {}
+
+    bool Profile::parse(Report* report, StringView path, const std::string& text) {
+        std::size_t lineNumber = 0;
+        bool seenRow = false;
+
+        for (const auto& rawLine : text::split(StringView(text), "\n"_sv)) {
+            ++lineNumber;
+
+            auto line = rawLine;
+            const auto commentStart = line.findFirstOf("#"_sv);
+            if (commentStart < line.getLength()) {
+                line = line.sub(0, commentStart);
+            }
+            line = text::trim(line);
+            if (line.getLength() == 0) {
+                continue;
+            }
+
+            const auto columns = text::split(line, ",;\t"_sv);
+            std::uint64_t address = 0;
+            std::uint64_t count = 0;
+            if (columns.size() < 2 || !parseAddress(text::trim(columns[0]), address) || !parseNumber(text::trim(columns[1]), 10, count)) {
+                // Emulators usually export a row of column names first.
+                if (!seenRow) {
+                    seenRow = true;
+                    continue;
+                }
+
+                report->error("profile row must be of the form `address,count`", SourceLocation(path, lineNumber));
+                return false;
+            }
+
+            seenRow = true;
+            samples.push_back(std::make_pair(static_cast<std::size_t>(address), count));
+        }
+
+        // Keep samples sorted by address, so each function's share can be found with a binary search.
+        std::stable_sort(samples.begin(), samples.end(), [](const std::pair<std::size_t, std::uint64_t>& a, const std::pair<std::size_t, std::uint64_t>& b) {
+            return a.first < b.first;
+        });
+
+        return report->validate();
+    }
+
+    void Profile::attribute(const std::vector<const Definition*>& definitions) {
+        struct Extent {
+            std::size_t start;
+            const Definition* function;
+        };
+
+        // Gather where every function and piece of data starts, so that each function extends up to whatever follows it in its bank.
+        std::map<const Bank*, std::vector<Extent>> extentsByBank;
+        for (const auto definition : definitions) {
+            const auto address = definition->getAddress();
+            if (!address.hasValue() || !address->absolutePosition.hasValue() || address->bank == nullptr) {
+                continue;
+            }
+
+            if (definition->kind == DefinitionKind::Func) {
+                if (definition->func.body != nullptr && !definition->func.inlined) {
+                    extentsByBank[address->bank].push_back(Extent {address->absolutePosition.get(), definition});
+                }
+            } else {
+                extentsByBank[address->bank].push_back(Extent {address->absolutePosition.get(), nullptr});
+            }
+        }
+
+        functionWeights.clear();
+        totalWeight = 0;
+
+        for (auto& item : extentsByBank) {
+            const auto bank = item.first;
+            auto& extents = item.second;
+            std::stable_sort(extents.begin(), extents.end(), [](const Extent& a, const Extent& b) { return a.start < b.start; });
+
+            const auto bankAddress = bank->getAddress();
+            if (!bankAddress.absolutePosition.hasValue()) {
+                continue;
+            }
+            const auto bankEnd = bankAddress.absolutePosition.get() - bankAddress.relativePosition.get() + bank->getCapacity();
+
+            for (std::size_t i = 0; i != extents.size(); ++i) {
+                const auto function = extents[i].function;
+                if (function == nullptr) {
+                    continue;
+                }
+
+                const auto start = extents[i].start;
+                auto end = bankEnd;
+                for (auto j = i + 1; j != extents.size(); ++j) {
+                    if (extents[j].start > start) {
+                        end = extents[j].start;
+                        break;
+                    }
+                }
+
+                // Banks that share an address range (eg. switchable banks) each get the samples, since the trace can't tell them apart.
+                std::uint64_t weight = 0;
+                const auto compareAddress = [](const std::pair<std::size_t, std::uint64_t>& sample, std::size_t address) { return sample.first < address; };
+                const auto first = std::lower_bound(samples.begin(), samples.end(), start, compareAddress);
+                const auto last = std::lower_bound(first, samples.end(), end, compareAddress);
+                for (auto sample = first; sample != last; ++sample) {
+                    weight += sample->second;
+                }
+
+                if (weight != 0) {
+                    functionWeights[function->getQualifiedName()] += weight;
+                    totalWeight += weight;
+                }
+            }
+        }
+    }
+
+    void Profile::attributeVariableAccesses(const std::vector<std::pair<const Definition*, const Definition*>>& accesses) {
+        variableWeights.clear();
+
+        for (const auto& access : accesses) {
+            const auto weight = getFunctionWeight(access.first);
+            if (weight != 0) {
+                variableWeights[access.second->getQualifiedName()] += weight;
+            }
+        }
+    }
+
+    std::size_t Profile::getSampleCount() const {
+        return samples.size();
+    }
+
+    std::uint64_t Profile::getTotalWeight() const {
+        return totalWeight;
+    }
+
+    std::uint64_t Profile::getFunctionWeight(const Definition* definition) const {
+        const auto match = functionWeights.find(definition->getQualifiedName());
+        return match != functionWeights.end() ? match->second : 0;
+    }
+
+    std::uint64_t Profile::getVariableWeight(const Definition* definition) const {
+        const auto match = variableWeights.find(definition->getQualifiedName());
+        return match != variableWeights.end() ? match->second : 0;
+    }
+
+    bool Profile::isHot(const Definition* definition) const {
+        const auto weight = getFunctionWeight(definition);
+        return weight != 0 && weight >= (totalWeight >> hotWeightShift);
+    }
+
+    std::vector<std::pair<std::string, std::uint64_t>> Profile::getHottestFunctions(std::size_t count) const {
+        std::vector<std::pair<std::string, std::uint64_t>> results(functionWeights.begin(), functionWeights.end());
+        std::sort(results.begin(), results.end(), [](const std::pair<std::string, std::uint64_t>& a, const std::pair<std::string, std::uint64_t>& b) {
+            return a.second != b.second ? a.second > b.second : a.first < b.first;
+        });
+        if (results.size() > count) {
+            results.resize(count);
+        }
+        return results;
+    }
+}
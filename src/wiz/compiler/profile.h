@@ -0,0 +1,56 @@
+#ifndef WIZ_COMPILER_PROFILE_H
+#define WIZ_COMPILER_PROFILE_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <unordered_map>
+
+#include <wiz/utility/string_view.h>
+
+namespace wiz {
+    class Report;
+    struct Definition;
+
+    // Execution counts (or cycle totals) per address, exported from an emulator running a previous build of the program.
+    class Profile {
+        public:
+            Profile();
+            ~Profile();
+
+            // Reads `address,count` rows.
+            // Addresses are hexadecimal (optionally prefixed by `$` or `0x`) and counts are decimal.
+            // Blank lines, `#` comments, extra columns and a leading header row are ignored.
+            bool parse(Report* report, StringView path, const std::string& text);
+
+            // Attributes each sampled address to the function whose code contains it.
+            // The definitions must come from a build with the same layout as the one that was profiled.
+            void attribute(const std::vector<const Definition*>& definitions);
+
+            // Credits each variable with the weight of every function that accesses it, once per accessing instruction.
+            // The (function, variable) pairs must come from the same build as the definitions passed to attribute().
+            void attributeVariableAccesses(const std::vector<std::pair<const Definition*, const Definition*>>& accesses);
+
+            std::size_t getSampleCount() const;
+            std::uint64_t getTotalWeight() const;
+            std::uint64_t getFunctionWeight(const Definition* definition) const;
+            std::uint64_t getVariableWeight(const Definition* definition) const;
+
+            // A function is hot if it accounts for a significant share of the attributed weight.
+            bool isHot(const Definition* definition) const;
+
+            // Returns up to `count` functions with the most weight, heaviest first.
+            std::vector<std::pair<std::string, std::uint64_t>> getHottestFunctions(std::size_t count) const;
+
+        private:
+            std::vector<std::pair<std::size_t, std::uint64_t>> samples;
+            // Keyed by qualified name, since the profiled build and the current build have separate definitions.
+            std::unordered_map<std::string, std::uint64_t> functionWeights;
+            std::unordered_map<std::string, std::uint64_t> variableWeights;
+            std::uint64_t totalWeight = 0;
+    };
+}
+
+#endif
@@ -0,0 +1,252 @@
+#include <chrono>
+#include <cstdio>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <wiz/compiler/result_cache.h>
+#include <wiz/utility/path.h>
+#include <wiz/utility/text.h>
+#include <wiz/utility/reader.h>
+#include <wiz/utility/writer.h>
+#include <wiz/utility/checksum.h>
+#include <wiz/utility/resource_manager.h>
+
+namespace wiz {
+    namespace {
+        const char* const ManifestHeader = "wiz-cache-manifest 1";
+        const char* const ResultHeader = "wiz-cache-result 1";
+        const std::size_t HashLength = 64;
+
+        std::string hashText(StringView text) {
+            return checksum::sha256(reinterpret_cast<const std::uint8_t*>(text.getData()), text.getLength());
+        }
+
+        struct ManifestEntry {
+            std::string resultHash;
+            // The filename of every input, and the hash of its contents, or an empty hash if it couldn't be opened.
+            std::vector<std::pair<std::string, std::string>> inputs;
+        };
+
+        // Manifests are text, with one `result <hash>` line starting each entry,
+        // followed by a `file <hash> <filename>` or `missing <filename>` line for each of its inputs.
+        std::vector<ManifestEntry> parseManifest(const std::string& text) {
+            std::vector<ManifestEntry> entries;
+            const auto lines = text::split(StringView(text), "\n"_sv);
+            if (lines.size() == 0 || lines[0] != StringView(ManifestHeader)) {
+                return {};
+            }
+
+            for (std::size_t i = 1; i != lines.size(); ++i) {
+                const auto line = lines[i];
+                if (line.startsWith("result "_sv)) {
+                    entries.push_back(ManifestEntry());
+                    entries.back().resultHash = line.sub(7).toString();
+                } else if (line.startsWith("file "_sv) && entries.size() != 0 && line.getLength() > 5 + HashLength + 1) {
+                    entries.back().inputs.emplace_back(line.sub(5 + HashLength + 1).toString(), line.sub(5, HashLength).toString());
+                } else if (line.startsWith("missing "_sv) && entries.size() != 0) {
+                    entries.back().inputs.emplace_back(line.sub(8).toString(), std::string());
+                } else if (line.getLength() != 0) {
+                    // Not written by this version, so don't trust any of it.
+                    return {};
+                }
+            }
+
+            return entries;
+        }
+
+        std::string formatManifest(const std::vector<ManifestEntry>& entries) {
+            std::string result = std::string(ManifestHeader) + "\n";
+            for (const auto& entry : entries) {
+                result += "result " + entry.resultHash + "\n";
+                for (const auto& input : entry.inputs) {
+                    result += input.second.size() != 0
+                        ? "file " + input.second + " " + input.first + "\n"
+                        : "missing " + input.first + "\n";
+                }
+            }
+            return result;
+        }
+
+        bool parseSize(StringView text, std::size_t& result) {
+            if (text.getLength() == 0) {
+                return false;
+            }
+
+            result = 0;
+            for (const auto c : text) {
+                if (c < '0' || c > '9') {
+                    return false;
+                }
+                result = result * 10 + static_cast<std::size_t>(c - '0');
+            }
+            return true;
+        }
+
+        // Results hold every file a compile wrote, each as a `<name length> <data length>` line followed by the name and the data.
+        bool parseResult(const std::string& text, std::vector<ResultCache::File>& files) {
+            const auto header = std::string(ResultHeader) + "\n";
+            if (text.compare(0, header.size(), header) != 0) {
+                return false;
+            }
+
+            files.clear();
+            std::size_t offset = header.size();
+            while (offset != text.size()) {
+                const auto lineEnd = text.find('\n', offset);
+                if (lineEnd == std::string::npos) {
+                    return false;
+                }
+
+                const auto line = StringView(text).sub(offset, lineEnd - offset);
+                const auto separator = line.find(" "_sv);
+                std::size_t nameLength = 0;
+                std::size_t dataLength = 0;
+                if (separator == SIZE_MAX
+                || !parseSize(line.sub(0, separator), nameLength)
+                || !parseSize(line.sub(separator + 1), dataLength)
+                || text.size() - (lineEnd + 1) < nameLength
+                || text.size() - (lineEnd + 1) - nameLength < dataLength) {
+                    return false;
+                }
+
+                const auto nameOffset = lineEnd + 1;
+                const auto dataOffset = nameOffset + nameLength;
+                files.emplace_back(text.substr(nameOffset, nameLength),
+                    std::vector<std::uint8_t>(text.begin() + dataOffset, text.begin() + dataOffset + dataLength));
+                offset = dataOffset + dataLength;
+            }
+
+            return true;
+        }
+
+        bool readFile(const std::string& path, std::string& result) {
+            FileReader reader {StringView(path)};
+            if (!reader.isOpen()) {
+                return false;
+            }
+            result = reader.readFully();
+            return true;
+        }
+
+        // Readers either see the old file or the new one, never a partly written one.
+        bool writeFileAtomically(const std::string& path, StringView data) {
+            // Named uniquely enough that builds writing the same entry at the same time don't write into each other's file.
+            const auto temporaryPath = path + ".tmp" + std::to_string(std::chrono::high_resolution_clock::now().time_since_epoch().count());
+            {
+                FileWriter writer {StringView(temporaryPath)};
+                if (!writer.isOpen() || !writer.write(data)) {
+                    std::remove(temporaryPath.c_str());
+                    return false;
+                }
+            }
+
+            if (std::rename(temporaryPath.c_str(), path.c_str()) != 0) {
+                // Windows won't rename over an existing file.
+                std::remove(path.c_str());
+                if (std::rename(temporaryPath.c_str(), path.c_str()) != 0) {
+                    std::remove(temporaryPath.c_str());
+                    return false;
+                }
+            }
+            return true;
+        }
+    }
+
+    ResultCache::ResultCache(StringView directory, StringView key)
+    : directory(directory.toString()),
+    keyHash(hashText(key)) {}
+
+    ResultCache::~ResultCache() {}
+
+    bool ResultCache::lookup(ResourceManager* resourceManager, std::vector<File>& files) const {
+        std::string manifestText;
+        if (!readFile(getPath(StringView(keyHash), ".manifest"_sv), manifestText)) {
+            return false;
+        }
+
+        // Entries usually share most of their inputs, so each file is only read once.
+        std::unordered_map<std::string, std::string> currentHashes;
+
+        for (const auto& entry : parseManifest(manifestText)) {
+            bool match = true;
+            for (const auto& input : entry.inputs) {
+                auto current = currentHashes.find(input.first);
+                if (current == currentHashes.end()) {
+                    std::string hash;
+                    auto reader = resourceManager->openReader(StringView(input.first), false);
+                    if (reader && reader->isOpen()) {
+                        const auto contents = reader->readFully();
+                        hash = hashText(StringView(contents));
+                    }
+                    current = currentHashes.emplace(input.first, hash).first;
+                }
+
+                if (current->second != input.second) {
+                    match = false;
+                    break;
+                }
+            }
+
+            std::string resultText;
+            if (match
+            && readFile(getPath(StringView(entry.resultHash), ".result"_sv), resultText)
+            && parseResult(resultText, files)) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    bool ResultCache::store(const RecordingResourceManager& recording) const {
+        ManifestEntry entry;
+        std::unordered_set<std::string> seen;
+        std::string resultKey = keyHash + "\n";
+
+        for (const auto& read : recording.getReads()) {
+            if (!seen.insert(read.filename).second) {
+                continue;
+            }
+            if (read.filename.find('\n') != std::string::npos) {
+                return false;
+            }
+
+            const auto hash = read.found ? hashText(StringView(read.contents)) : std::string();
+            entry.inputs.emplace_back(read.filename, hash);
+            resultKey += (read.found ? hash : "-") + " " + read.filename + "\n";
+        }
+        entry.resultHash = hashText(StringView(resultKey));
+
+        std::string resultText = std::string(ResultHeader) + "\n";
+        for (const auto& write : recording.getWrites()) {
+            resultText += std::to_string(write.filename.size()) + " " + std::to_string(write.contents.size()) + "\n";
+            resultText += write.filename;
+            resultText.append(write.contents.begin(), write.contents.end());
+        }
+
+        if (!path::createDirectory(StringView(directory))
+        || !writeFileAtomically(getPath(StringView(entry.resultHash), ".result"_sv), StringView(resultText))) {
+            return false;
+        }
+
+        // The newest entry goes first, since the last build is the likeliest to be repeated.
+        std::vector<ManifestEntry> entries {entry};
+        std::string manifestText;
+        if (readFile(getPath(StringView(keyHash), ".manifest"_sv), manifestText)) {
+            for (auto& previous : parseManifest(manifestText)) {
+                if (entries.size() == MaxManifestEntries) {
+                    break;
+                }
+                if (previous.resultHash != entry.resultHash) {
+                    entries.push_back(std::move(previous));
+                }
+            }
+        }
+
+        return writeFileAtomically(getPath(StringView(keyHash), ".manifest"_sv), StringView(formatManifest(entries)));
+    }
+
+    std::string ResultCache::getPath(StringView name, StringView extension) const {
+        return directory + "/" + name.toString() + extension.toString();
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef WIZ_COMPILER_RESULT_CACHE_H
+#define WIZ_COMPILER_RESULT_CACHE_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include <wiz/utility/string_view.h>
+
+namespace wiz {
+    class ResourceManager;
+    class RecordingResourceManager;
+
+    // A directory of files written by earlier compiles, so that a compile whose inputs haven't changed can restore its outputs instead.
+    //
+    // Which files a compile reads isn't known until it has parsed every import and evaluated every embed, so lookups take two steps.
+    // The key covers everything known beforehand (the compiler version and build, the arguments and the working directory), and names a manifest.
+    // The manifest lists the files that earlier compiles with the same key read, with a hash of each one's contents.
+    // If every file in one of its entries still has the same contents (or is still missing), that entry's outputs are restored.
+    class ResultCache {
+        public:
+            struct File {
+                File(
+                    std::string filename,
+                    std::vector<std::uint8_t> contents)
+                : filename(std::move(filename)),
+                contents(std::move(contents)) {}
+
+                std::string filename;
+                std::vector<std::uint8_t> contents;
+            };
+
+            // Older entries are dropped from a manifest once it has this many.
+            static const std::size_t MaxManifestEntries = 16;
+
+            ResultCache(StringView directory, StringView key);
+            ~ResultCache();
+
+            // Returns true, and the files to restore, if an earlier compile read the same files as they are now.
+            bool lookup(ResourceManager* resourceManager, std::vector<File>& files) const;
+
+            // Saves the files that a successful compile wrote, under the files it read.
+            // Every cache file is written under a temporary name and then renamed, so builds sharing the cache never see a partial entry.
+            bool store(const RecordingResourceManager& recording) const;
+
+        private:
+            std::string getPath(StringView name, StringView extension) const;
+
+            std::string directory;
+            std::string keyHash;
+    };
+}
+
+#endif
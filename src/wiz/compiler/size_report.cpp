@@ -0,0 +1,465 @@
+#include <map>
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <iterator>
+#include <algorithm>
+
+#include <wiz/compiler/bank.h>
+#include <wiz/compiler/definition.h>
+#include <wiz/compiler/size_report.h>
+#include <wiz/utility/report.h>
+#include <wiz/utility/source_location.h>
+
+namespace wiz {
+    namespace {
+        StringView getBankKindName(BankKind kind) {
+            switch (kind) {
+                case BankKind::None: return "none"_sv;
+                case BankKind::UninitializedRam: return "vardata"_sv;
+                case BankKind::InitializedRam: return "varinitdata"_sv;
+                case BankKind::ProgramRom: return "prgdata"_sv;
+                case BankKind::DataRom: return "constdata"_sv;
+                case BankKind::CharacterRom: return "chrdata"_sv;
+                default: std::abort(); return StringView();
+            }
+        }
+
+        std::string quote(const std::string& text) {
+            static const char hexDigits[] = "0123456789abcdef";
+
+            std::string result = "\"";
+            for (const auto c : text) {
+                if (c == '\"' || c == '\\') {
+                    result += '\\';
+                    result += c;
+                } else if (static_cast<unsigned char>(c) < 32) {
+                    result += "\\u00";
+                    result += hexDigits[(c >> 4) & 0x0F];
+                    result += hexDigits[c & 0x0F];
+                } else {
+                    result += c;
+                }
+            }
+            result += '\"';
+            return result;
+        }
+
+        std::string formatDelta(std::size_t current, std::size_t previous) {
+            return current >= previous
+                ? "+" + std::to_string(current - previous)
+                : "-" + std::to_string(previous - current);
+        }
+
+        // Just enough of a JSON reader to load the reports written by `SizeReport::toJson`.
+        class JsonReader {
+            public:
+                explicit JsonReader(const std::string& text)
+                : text(text) {}
+
+                std::size_t getLine() const {
+                    return static_cast<std::size_t>(std::count(text.begin(), text.begin() + position, '\n')) + 1;
+                }
+
+                bool consume(char c) {
+                    skipSpace();
+                    if (position < text.size() && text[position] == c) {
+                        ++position;
+                        return true;
+                    }
+                    return false;
+                }
+
+                bool atEnd() {
+                    skipSpace();
+                    return position == text.size();
+                }
+
+                bool readString(std::string& result) {
+                    if (!consume('\"')) {
+                        return false;
+                    }
+
+                    result.clear();
+                    while (position < text.size()) {
+                        const auto c = text[position++];
+                        if (c == '\"') {
+                            return true;
+                        } else if (c == '\\') {
+                            if (position >= text.size()) {
+                                return false;
+                            }
+
+                            const auto escape = text[position++];
+                            switch (escape) {
+                                case 'n': result += '\n'; break;
+                                case 'r': result += '\r'; break;
+                                case 't': result += '\t'; break;
+                                case 'b': result += '\b'; break;
+                                case 'f': result += '\f'; break;
+                                case 'u': {
+                                    if (position + 4 > text.size()) {
+                                        return false;
+                                    }
+                                    unsigned int code = 0;
+                                    for (std::size_t i = 0; i != 4; ++i) {
+                                        const auto digit = static_cast<unsigned char>(text[position++]);
+                                        if (!std::isxdigit(digit)) {
+                                            return false;
+                                        }
+                                        code = code * 16 + static_cast<unsigned int>(std::isdigit(digit) ? digit - '0' : std::tolower(digit) - 'a' + 10);
+                                    }
+                                    result += static_cast<char>(code < 0x80 ? code : '?');
+                                    break;
+                                }
+                                default: result += escape; break;
+                            }
+                        } else {
+                            result += c;
+                        }
+                    }
+                    return false;
+                }
+
+                bool readNumber(std::size_t& result) {
+                    skipSpace();
+                    const auto start = position;
+                    result = 0;
+                    while (position < text.size() && text[position] >= '0' && text[position] <= '9') {
+                        const auto digit = static_cast<std::size_t>(text[position] - '0');
+                        // A size that doesn't fit is not one this compiler wrote, so the baseline is rejected as malformed.
+                        if (result > (SIZE_MAX - digit) / 10) {
+                            return false;
+                        }
+                        result = result * 10 + digit;
+                        ++position;
+                    }
+                    return position != start;
+                }
+
+                bool skipValue() {
+                    skipSpace();
+                    if (position >= text.size()) {
+                        return false;
+                    }
+
+                    const auto c = text[position];
+                    if (c == '\"') {
+                        std::string ignored;
+                        return readString(ignored);
+                    } else if (c == '{' || c == '[') {
+                        const auto close = c == '{' ? '}' : ']';
+                        ++position;
+                        if (consume(close)) {
+                            return true;
+                        }
+                        do {
+                            if (c == '{') {
+                                std::string ignored;
+                                if (!readString(ignored) || !consume(':')) {
+                                    return false;
+                                }
+                            }
+                            if (!skipValue()) {
+                                return false;
+                            }
+                        } while (consume(','));
+                        return consume(close);
+                    } else {
+                        const auto start = position;
+                        while (position < text.size() && (std::isalnum(static_cast<unsigned char>(text[position])) || text[position] == '-' || text[position] == '+' || text[position] == '.')) {
+                            ++position;
+                        }
+                        return position != start;
+                    }
+                }
+
+                // Reads each `"key": value` pair of an object, passing the key to `readMember`, which must consume the value.
+                template <typename F>
+                bool readObject(F readMember) {
+                    if (!consume('{')) {
+                        return false;
+                    }
+                    if (consume('}')) {
+                        return true;
+                    }
+                    do {
+                        std::string key;
+                        if (!readString(key) || !consume(':') || !readMember(key)) {
+                            return false;
+                        }
+                    } while (consume(','));
+                    return consume('}');
+                }
+
+                template <typename F>
+                bool readArray(F readElement) {
+                    if (!consume('[')) {
+                        return false;
+                    }
+                    if (consume(']')) {
+                        return true;
+                    }
+                    do {
+                        if (!readElement()) {
+                            return false;
+                        }
+                    } while (consume(','));
+                    return consume(']');
+                }
+
+            private:
+                void skipSpace() {
+                    while (position < text.size() && std::isspace(static_cast<unsigned char>(text[position]))) {
+                        ++position;
+                    }
+                }
+
+                const std::string& text;
+                std::size_t position = 0;
+        };
+    }
+
+    SizeReport::SizeReport() {}
+
+    SizeReport::~SizeReport() {}
+
+    void SizeReport::collect(const std::vector<const Bank*>& banks, const std::vector<const Definition*>& definitions) {
+        struct Extent {
+            std::size_t start;
+            std::size_t end;
+            const Definition* definition;
+        };
+
+        // Functions extend up to whatever follows them in their bank. Variables and constants cover their storage.
+        std::map<const Bank*, std::vector<Extent>> extentsByBank;
+        for (const auto definition : definitions) {
+            const auto address = definition->getAddress();
+            if (!address.hasValue() || !address->relativePosition.hasValue() || address->bank == nullptr) {
+                continue;
+            }
+
+            const auto start = address->relativePosition.get();
+            if (definition->kind == DefinitionKind::Func) {
+                if (definition->func.body != nullptr && !definition->func.inlined) {
+                    extentsByBank[address->bank].push_back(Extent {start, SIZE_MAX, definition});
+                }
+            } else if (definition->kind == DefinitionKind::Var && definition->var.storageSize.hasValue()) {
+                extentsByBank[address->bank].push_back(Extent {start, start + definition->var.storageSize.get(), definition});
+            }
+        }
+
+        this->banks.clear();
+
+        for (const auto bank : banks) {
+            auto& extents = extentsByBank[bank];
+            std::stable_sort(extents.begin(), extents.end(), [](const Extent& a, const Extent& b) { return a.start < b.start; });
+            for (std::size_t i = 0; i != extents.size(); ++i) {
+                if (extents[i].end == SIZE_MAX) {
+                    extents[i].end = bank->getCapacity();
+                    for (auto j = i + 1; j != extents.size(); ++j) {
+                        if (extents[j].start > extents[i].start) {
+                            extents[i].end = extents[j].start;
+                            break;
+                        }
+                    }
+                }
+            }
+
+            BankUsage usage(bank->getName().toString(), getBankKindName(bank->getKind()).toString(), bank->getCapacity(), bank->getCapacity() - bank->calculateFreeSize());
+
+            std::map<std::string, std::size_t> itemIndexes;
+            const auto addBytes = [&](std::string name, StringView kind, std::size_t size) {
+                const auto match = itemIndexes.find(name);
+                if (match != itemIndexes.end()) {
+                    usage.items[match->second].size += size;
+                } else {
+                    itemIndexes[name] = usage.items.size();
+                    usage.items.push_back(Item(std::move(name), kind.toString(), size));
+                }
+            };
+
+            for (const auto& region : bank->calculateRegions()) {
+                auto offset = region.offset;
+                const auto regionEnd = region.offset + region.size;
+
+                while (offset != regionEnd) {
+                    // Find the last definition starting at or before this offset.
+                    auto match = std::upper_bound(extents.begin(), extents.end(), offset, [](std::size_t value, const Extent& extent) { return value < extent.start; });
+                    const Extent* extent = nullptr;
+                    if (match != extents.begin() && std::prev(match)->end > offset) {
+                        extent = &*std::prev(match);
+                    }
+
+                    if (extent != nullptr) {
+                        const auto end = std::min(regionEnd, extent->end);
+                        const auto definition = extent->definition;
+                        addBytes(definition->getQualifiedName(), definition->kind == DefinitionKind::Func ? "function"_sv : (definition->var.qualifiers & Qualifiers::Const) != Qualifiers::None ? "constant"_sv : "variable"_sv, end - offset);
+                        offset = end;
+                    } else {
+                        const auto end = match != extents.end() ? std::min(regionEnd, match->start) : regionEnd;
+                        addBytes("(" + region.owner->description.toString() + ")", "other"_sv, end - offset);
+                        offset = end;
+                    }
+                }
+            }
+
+            std::stable_sort(usage.items.begin(), usage.items.end(), [](const Item& a, const Item& b) {
+                return a.size != b.size ? a.size > b.size : a.name < b.name;
+            });
+
+            this->banks.push_back(std::move(usage));
+        }
+    }
+
+    bool SizeReport::parseJson(Report* report, StringView path, const std::string& text) {
+        JsonReader reader(text);
+        banks.clear();
+
+        const auto readItem = [&](BankUsage& bank) {
+            Item item("", "", 0);
+            const auto result = reader.readObject([&](const std::string& key) {
+                if (key == "name") {
+                    return reader.readString(item.name);
+                } else if (key == "kind") {
+                    return reader.readString(item.kind);
+                } else if (key == "size") {
+                    return reader.readNumber(item.size);
+                } else {
+                    return reader.skipValue();
+                }
+            });
+            bank.items.push_back(std::move(item));
+            return result;
+        };
+
+        const auto readBank = [&]() {
+            BankUsage bank("", "", 0, 0);
+            const auto result = reader.readObject([&](const std::string& key) {
+                if (key == "name") {
+                    return reader.readString(bank.name);
+                } else if (key == "kind") {
+                    return reader.readString(bank.kind);
+                } else if (key == "capacity") {
+                    return reader.readNumber(bank.capacity);
+                } else if (key == "used") {
+                    return reader.readNumber(bank.used);
+                } else if (key == "items") {
+                    return reader.readArray([&]() { return readItem(bank); });
+                } else {
+                    return reader.skipValue();
+                }
+            });
+            banks.push_back(std::move(bank));
+            return result;
+        };
+
+        const auto result = reader.readObject([&](const std::string& key) {
+            if (key == "banks") {
+                return reader.readArray(readBank);
+            } else {
+                return reader.skipValue();
+            }
+        });
+
+        if (!result || !reader.atEnd()) {
+            report->error("size report is not in the format written by `--size-report=json`", SourceLocation(path, reader.getLine()));
+            return false;
+        }
+
+        return true;
+    }
+
+    std::string SizeReport::toJson() const {
+        std::string result = "{\n    \"banks\": [";
+
+        for (std::size_t i = 0; i != banks.size(); ++i) {
+            const auto& bank = banks[i];
+            result += i != 0 ? ",\n" : "\n";
+            result += "        {\n";
+            result += "            \"name\": " + quote(bank.name) + ",\n";
+            result += "            \"kind\": " + quote(bank.kind) + ",\n";
+            result += "            \"capacity\": " + std::to_string(bank.capacity) + ",\n";
+            result += "            \"used\": " + std::to_string(bank.used) + ",\n";
+            result += "            \"free\": " + std::to_string(bank.capacity - bank.used) + ",\n";
+            result += "            \"items\": [";
+
+            for (std::size_t j = 0; j != bank.items.size(); ++j) {
+                const auto& item = bank.items[j];
+                result += j != 0 ? ",\n" : "\n";
+                result += "                {\"name\": " + quote(item.name) + ", \"kind\": " + quote(item.kind) + ", \"size\": " + std::to_string(item.size) + "}";
+            }
+
+            result += bank.items.size() != 0 ? "\n            ]\n" : "]\n";
+            result += "        }";
+        }
+
+        result += banks.size() != 0 ? "\n    ]\n}\n" : "]\n}\n";
+        return result;
+    }
+
+    void SizeReport::log(Report* report) const {
+        report->log("size report:");
+        for (const auto& bank : banks) {
+            report->log("  bank `" + bank.name + "` (" + bank.kind + "): " + std::to_string(bank.used) + " of " + std::to_string(bank.capacity) + " byte(s) used, " + std::to_string(bank.capacity - bank.used) + " free");
+            for (const auto& item : bank.items) {
+                report->log("    `" + item.name + "` (" + item.kind + "): " + std::to_string(item.size) + " byte(s)");
+            }
+        }
+    }
+
+    void SizeReport::logChanges(Report* report, const SizeReport& baseline) const {
+        report->log("size changes against baseline:");
+
+        bool changed = false;
+        const auto logBank = [&](const std::string& name, std::size_t used, std::size_t previousUsed, bool isNew, bool isRemoved) {
+            changed = true;
+            report->log("  bank `" + name + "`: " + formatDelta(used, previousUsed) + " byte(s) used"
+                + (isNew ? " (new)" : isRemoved ? " (removed)" : " (" + std::to_string(used) + ", was " + std::to_string(previousUsed) + ")"));
+        };
+
+        for (const auto& bank : banks) {
+            const auto previousBank = std::find_if(baseline.banks.begin(), baseline.banks.end(), [&](const BankUsage& other) { return other.name == bank.name; });
+            if (previousBank == baseline.banks.end()) {
+                logBank(bank.name, bank.used, 0, true, false);
+                continue;
+            }
+
+            std::vector<std::string> lines;
+            for (const auto& item : bank.items) {
+                const auto previousItem = std::find_if(previousBank->items.begin(), previousBank->items.end(), [&](const Item& other) { return other.name == item.name; });
+                if (previousItem == previousBank->items.end()) {
+                    lines.push_back("    `" + item.name + "`: +" + std::to_string(item.size) + " byte(s) (new)");
+                } else if (previousItem->size != item.size) {
+                    lines.push_back("    `" + item.name + "`: " + formatDelta(item.size, previousItem->size) + " byte(s) (" + std::to_string(item.size) + ", was " + std::to_string(previousItem->size) + ")");
+                }
+            }
+            for (const auto& previousItem : previousBank->items) {
+                if (std::none_of(bank.items.begin(), bank.items.end(), [&](const Item& item) { return item.name == previousItem.name; })) {
+                    lines.push_back("    `" + previousItem.name + "`: -" + std::to_string(previousItem.size) + " byte(s) (removed)");
+                }
+            }
+
+            if (bank.used != previousBank->used || lines.size() != 0) {
+                logBank(bank.name, bank.used, previousBank->used, false, false);
+                for (const auto& line : lines) {
+                    report->log(line);
+                }
+            }
+        }
+
+        for (const auto& previousBank : baseline.banks) {
+            if (std::none_of(banks.begin(), banks.end(), [&](const BankUsage& bank) { return bank.name == previousBank.name; })) {
+                logBank(previousBank.name, 0, previousBank.used, false, true);
+            }
+        }
+
+        if (!changed) {
+            report->log("  no changes.");
+        }
+    }
+
+    const std::vector<SizeReport::BankUsage>& SizeReport::getBanks() const {
+        return banks;
+    }
+}
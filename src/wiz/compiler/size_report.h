@@ -0,0 +1,72 @@
+#ifndef WIZ_COMPILER_SIZE_REPORT_H
+#define WIZ_COMPILER_SIZE_REPORT_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+#include <wiz/utility/string_view.h>
+
+namespace wiz {
+    class Bank;
+    class Report;
+    struct Definition;
+
+    // Bytes used by every function, constant and variable, and the free space left in each bank.
+    class SizeReport {
+        public:
+            struct Item {
+                Item(
+                    std::string name,
+                    std::string kind,
+                    std::size_t size)
+                : name(std::move(name)),
+                kind(std::move(kind)),
+                size(size) {}
+
+                std::string name;
+                std::string kind;
+                std::size_t size;
+            };
+
+            struct BankUsage {
+                BankUsage(
+                    std::string name,
+                    std::string kind,
+                    std::size_t capacity,
+                    std::size_t used)
+                : name(std::move(name)),
+                kind(std::move(kind)),
+                capacity(capacity),
+                used(used) {}
+
+                std::string name;
+                std::string kind;
+                std::size_t capacity;
+                std::size_t used;
+                std::vector<Item> items;
+            };
+
+            SizeReport();
+            ~SizeReport();
+
+            // Attributes the owned regions of every bank to the definition that contains them.
+            // Bytes that lie outside any function or variable are listed under their owner's description, in parentheses.
+            void collect(const std::vector<const Bank*>& banks, const std::vector<const Definition*>& definitions);
+
+            // Reads a report previously written by `toJson`.
+            bool parseJson(Report* report, StringView path, const std::string& text);
+
+            std::string toJson() const;
+            void log(Report* report) const;
+            // Logs the banks and items whose size changed since the baseline.
+            void logChanges(Report* report, const SizeReport& baseline) const;
+
+            const std::vector<BankUsage>& getBanks() const;
+
+        private:
+            std::vector<BankUsage> banks;
+    };
+}
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef WIZ_COMPILER_SOURCE_MAP_H
+#define WIZ_COMPILER_SOURCE_MAP_H
+
+#include <wiz/compiler/address.h>
+#include <wiz/utility/source_location.h>
+
+namespace wiz {
+    // The start of a run of generated code, and the source line that produced it.
+    struct SourceMapEntry {
+        SourceMapEntry(
+            Address address,
+            SourceLocation location)
+        : address(address),
+        location(location) {}
+
+        Address address;
+        SourceLocation location;
+    };
+}
+
+#endif
@@ -1,5 +1,3 @@
-#include <cstdio>
-#include <limits>
 #include <algorithm>
 #include <wiz/ast/statement.h>
 #include <wiz/utility/report.h>
@@ -7,11 +5,8 @@
 #include <wiz/compiler/symbol_table.h>
 
 namespace wiz {
-    std::string SymbolTable::generateBlockName() {
-        static unsigned int blockIndex = 0;
-        char buffer[std::numeric_limits<unsigned int>::digits10 + 5] = {0};
-        std::sprintf(buffer, "%%blk%u", blockIndex++);
-        return std::string(buffer);
+    std::string SymbolTable::generateBlockName(std::size_t index) {
+        return "%blk" + std::to_string(index);
     }
 
     SymbolTable::SymbolTable()
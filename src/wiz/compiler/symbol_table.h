@@ -15,7 +15,7 @@ namespace wiz {
 
     class SymbolTable {
         public:
-            static std::string generateBlockName();
+            static std::string generateBlockName(std::size_t index);
 
             SymbolTable();
             SymbolTable(SymbolTable* parent, StringView namespaceName);
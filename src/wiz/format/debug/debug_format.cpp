@@ -1,9 +1,58 @@
+#include <iterator>
+
+#include <wiz/compiler/definition.h>
 #include <wiz/format/debug/debug_format.h>
 #include <wiz/format/debug/mlb_debug_format.h>
 #include <wiz/format/debug/rgbds_sym_debug_format.h>
 #include <wiz/format/debug/wla_sym_debug_format.h>
 
 namespace wiz {
+    bool DebugAddressOwnership::claim(std::size_t start, std::size_t end, const Definition* definition) {
+        const auto overlap = findFirstOverlap(start, end);
+        if (overlap != ranges.end()) {
+            if (overlap->first > start) {
+                ranges[start] = std::make_pair(overlap->first - 1, definition);
+            }
+            return false;
+        }
+
+        ranges[start] = std::make_pair(end, definition);
+        return true;
+    }
+
+    std::map<std::size_t, std::pair<std::size_t, const Definition*>>::const_iterator DebugAddressOwnership::findFirstOverlap(std::size_t start, std::size_t end) const {
+        // Ranges are disjoint, so only the last range starting at or before `start` can contain it.
+        auto match = ranges.upper_bound(start);
+        if (match != ranges.begin()) {
+            const auto previous = std::prev(match);
+            if (previous->second.first >= start) {
+                return previous;
+            }
+        }
+
+        // Otherwise, the first range starting after `start` is the earliest one that might begin inside [start, end].
+        if (match != ranges.end() && match->first <= end) {
+            return match;
+        }
+
+        return ranges.end();
+    }
+
+    std::vector<DebugSymbol> collectDebugSymbols(const std::vector<const Definition*>& definitions) {
+        std::vector<DebugSymbol> symbols;
+
+        for (const auto& definition : definitions) {
+            const auto address = definition->getAddress();
+            if (!address.hasValue() || !address->absolutePosition.hasValue()) {
+                continue;
+            }
+
+            symbols.emplace_back(definition, address.get(), definition->getQualifiedName());
+        }
+
+        return symbols;
+    }
+
     DebugFormatCollection::DebugFormatCollection() {
         add("mlb"_sv, std::make_unique<MlbDebugFormat>());
         add("rgbds"_sv, std::make_unique<RgbdsSymDebugFormat>());
@@ -1,10 +1,15 @@
 #ifndef WIZ_FORMAT_DEBUG_DEBUG_FORMAT_H
 #define WIZ_FORMAT_DEBUG_DEBUG_FORMAT_H
 
+#include <map>
+#include <cstdint>
 #include <memory>
 #include <vector>
+#include <utility>
+#include <string>
 #include <unordered_map>
 
+#include <wiz/compiler/address.h>
 #include <wiz/utility/string_view.h>
 
 namespace wiz {
@@ -13,8 +18,47 @@ namespace wiz {
     class Report;
     class StringPool;
     class ResourceManager;
+    class Writer;
     struct Definition;
     struct OutputFormatContext;
+    struct SourceMapEntry;
+
+    // Tracks which definition has claimed each address range, so that aliased definitions are only written once.
+    // Ranges are stored as disjoint intervals sorted by start address, so claims cost O(log n) in the number of
+    // claimed ranges rather than O(n) in the number of bytes they cover.
+    class DebugAddressOwnership {
+        public:
+            // Claims the inclusive range [start, end] for the definition.
+            // If part of the range is already owned, the claim fails, but any unowned bytes before the first owned
+            // address are still claimed (matching the byte-by-byte claiming this replaced).
+            bool claim(std::size_t start, std::size_t end, const Definition* definition);
+
+        private:
+            // Maps the start of each claimed range to its inclusive end and owner.
+            std::map<std::size_t, std::pair<std::size_t, const Definition*>> ranges;
+
+            std::map<std::size_t, std::pair<std::size_t, const Definition*>>::const_iterator findFirstOverlap(std::size_t start, std::size_t end) const;
+    };
+
+    // A definition with a known absolute address, along with the parts of its symbol that every debug format needs.
+    struct DebugSymbol {
+        DebugSymbol(
+            const Definition* definition,
+            Address address,
+            std::string fullName)
+        : definition(definition),
+        address(address),
+        fullName(std::move(fullName)) {}
+
+        const Definition* definition;
+        Address address;
+        // The scope-qualified name of the definition, before any format-specific mangling.
+        std::string fullName;
+    };
+
+    // Collects the definitions that can appear in a symbol file, in registration order.
+    // This is done once per build, so that each debug format doesn't have to re-walk the scopes of every definition.
+    std::vector<DebugSymbol> collectDebugSymbols(const std::vector<const Definition*>& definitions);
 
     struct DebugFormatContext {
         DebugFormatContext(
@@ -25,7 +69,9 @@ namespace wiz {
             StringView formatName,
             StringView outputName,
             const OutputFormatContext* outputContext,
-            std::vector<const Definition*> definitions)
+            const std::vector<DebugSymbol>* symbols,
+            const std::vector<SourceMapEntry>* sourceMap,
+            const std::unordered_map<StringView, std::uint32_t>* sourceChecksums)
         : resourceManager(resourceManager),
         report(report),
         stringPool(stringPool),
@@ -33,7 +79,9 @@ namespace wiz {
         formatName(formatName),
         outputName(outputName),
         outputContext(outputContext),
-        definitions(definitions) {}
+        symbols(symbols),
+        sourceMap(sourceMap),
+        sourceChecksums(sourceChecksums) {}
 
         ResourceManager* resourceManager;
         Report* report;
@@ -42,16 +90,25 @@ namespace wiz {
         StringView formatName;
         StringView outputName;
         const OutputFormatContext* outputContext;
-        std::vector<const Definition*> definitions;
+        const std::vector<DebugSymbol>* symbols;
+        // The address and source line of every generated instruction, in the order they were generated.
+        const std::vector<SourceMapEntry>* sourceMap;
+        // The CRC-32 of each source file as it was scanned, keyed by canonical path.
+        const std::unordered_map<StringView, std::uint32_t>* sourceChecksums;
 
-        std::unordered_map<std::size_t, const Definition*> addressOwnership;
+        DebugAddressOwnership addressOwnership;
     };    
 
     class DebugFormat {
         public:
             virtual ~DebugFormat() {}
 
-            virtual bool generate(DebugFormatContext& context) = 0;
+            // The file extension used for symbol files of this format, which are written alongside the output file.
+            virtual StringView getExtension() const = 0;
+
+            // Writes the symbol file to the writer.
+            // Several formats may be generated concurrently, so this must not modify anything shared between contexts.
+            virtual bool generate(DebugFormatContext& context, Writer* writer) = 0;
     };
 
     class DebugFormatCollection {
@@ -5,10 +5,8 @@
 #include <wiz/format/output/output_format.h>
 #include <wiz/format/debug/mlb_debug_format.h>
 #include <wiz/utility/misc.h>
-#include <wiz/utility/path.h>
 #include <wiz/utility/text.h>
 #include <wiz/utility/writer.h>
-#include <wiz/utility/resource_manager.h>
 
 namespace wiz {
     namespace {
@@ -68,79 +66,60 @@ namespace wiz {
             return ""_sv;
         }
 
-        void dumpAddress(Writer* writer, const Definition* definition, DebugFormatContext& context) {
+        void dumpAddress(Writer* writer, const DebugSymbol& symbol, DebugFormatContext& context) {
             const auto outputContext = context.outputContext;
-            const auto address = definition->getAddress();
-
-            if (address.hasValue()) {
-                if (address->absolutePosition.hasValue()) {
-                    // Ignore hardware registers / 'extern'.
-                    // If these are mapper-related, definitions for different mappers might alias each other.
-                    // Also, mapper-related registers might alias code/data in the ROM area of address space.
-                    const auto labelTypes = getLabelTypes(definition);
-                    if (labelTypes == "G"_sv) {
-                        return;
-                    }
+            const auto definition = symbol.definition;
+            const auto& address = symbol.address;
+
+            // Ignore hardware registers / 'extern'.
+            // If these are mapper-related, definitions for different mappers might alias each other.
+            // Also, mapper-related registers might alias code/data in the ROM area of address space.
+            const auto labelTypes = getLabelTypes(definition);
+            if (labelTypes == "G"_sv) {
+                return;
+            }
 
-                    const auto outputRelative = isLabelOutputRelative(definition);
+            const auto outputRelative = isLabelOutputRelative(definition);
 
-                    Optional<std::size_t> maybeStartValue;
-                    if (outputRelative) {
-                        const auto offset = outputContext->getOutputOffset(address.get());
-                        if (offset.hasValue()) {
-                            maybeStartValue = std::max<std::size_t>(offset.get() - outputContext->fileHeaderPrefixSize, 0);
-                        }
-                    } else {
-                        maybeStartValue = address->absolutePosition.get();
-                    }
+            Optional<std::size_t> maybeStartValue;
+            if (outputRelative) {
+                const auto offset = outputContext->getOutputOffset(address);
+                if (offset.hasValue()) {
+                    maybeStartValue = std::max<std::size_t>(offset.get() - outputContext->fileHeaderPrefixSize, 0);
+                }
+            } else {
+                maybeStartValue = address.absolutePosition.get();
+            }
 
-                    if (!maybeStartValue.hasValue()) {
-                        return;
-                    }
+            if (!maybeStartValue.hasValue()) {
+                return;
+            }
 
-                    const auto startValue = maybeStartValue.get();
-                    const auto endValue = definition->kind == DefinitionKind::Var
-                        ? startValue + std::max<std::size_t>(definition->var.storageSize.get() - 1, 0)
-                        : startValue;
-
-                    for (std::size_t i = startValue; i <= endValue; i++) {
-                        const auto match = context.addressOwnership.find(i);
-                        if (match != context.addressOwnership.end()) {
-                            return;
-                        } else {
-                            context.addressOwnership[i] = definition;
-                        }
-                    }
+            const auto startValue = maybeStartValue.get();
+            const auto endValue = definition->kind == DefinitionKind::Var
+                ? startValue + std::max<std::size_t>(definition->var.storageSize.get() - 1, 0)
+                : startValue;
 
-                    auto addressString = toHexString(startValue);
-                    if (endValue != startValue) {
-                        addressString += '-';
-                        addressString += toHexString(endValue);
-                    }
+            if (!context.addressOwnership.claim(startValue, endValue, definition)) {
+                return;
+            }
 
-                    std::string fullName;
-                    if ((definition->name.getLength() == 0 || definition->name[0] != '$')
-                    && definition->parentScope != nullptr) {
-                        const auto prefix = definition->parentScope->getFullName();
-                        if (!prefix.empty()) {
-                            fullName = prefix;
-                            fullName += '.';
-                        }
-                    }
-                    fullName += definition->name.toString();
-                    
-                    fullName = text::replaceAll(fullName, ".", "_");
-                    fullName = text::replaceAll(fullName, "$", "__");
-                    fullName = text::replaceAll(fullName, "%", "__");
-
-                    for (const auto& labelType : labelTypes) {
-                        writer->write(StringView(&labelType, 1));
-                        writer->write(":"_sv);
-                        writer->write(StringView(addressString));
-                        writer->write(":"_sv);
-                        writer->writeLine(StringView(fullName));
-                    }
-                }
+            auto addressString = toHexString(startValue);
+            if (endValue != startValue) {
+                addressString += '-';
+                addressString += toHexString(endValue);
+            }
+
+            auto fullName = text::replaceAll(symbol.fullName, ".", "_");
+            fullName = text::replaceAll(fullName, "$", "__");
+            fullName = text::replaceAll(fullName, "%", "__");
+
+            for (const auto& labelType : labelTypes) {
+                writer->write(StringView(&labelType, 1));
+                writer->write(":"_sv);
+                writer->write(StringView(addressString));
+                writer->write(":"_sv);
+                writer->writeLine(StringView(fullName));
             }
         }
     }
@@ -148,14 +127,14 @@ namespace wiz {
     MlbDebugFormat::MlbDebugFormat() {}
     MlbDebugFormat::~MlbDebugFormat() {}
 
-    bool MlbDebugFormat::generate(DebugFormatContext& context) {
-        const auto debugName = path::stripExtension(context.outputName).toString() + ".mlb";
+    StringView MlbDebugFormat::getExtension() const {
+        return "mlb"_sv;
+    }
 
-        if (auto writer = context.resourceManager->openWriter(StringView(debugName))) {
-            for (const auto& definition : context.definitions) {
-                dumpAddress(writer.get(), definition, context);
-            }
-        }       
+    bool MlbDebugFormat::generate(DebugFormatContext& context, Writer* writer) {
+        for (const auto& symbol : *context.symbols) {
+            dumpAddress(writer, symbol, context);
+        }
 
         return true;
     }
@@ -5,10 +5,8 @@
 #include <wiz/format/output/output_format.h>
 #include <wiz/format/debug/rgbds_sym_debug_format.h>
 #include <wiz/utility/misc.h>
-#include <wiz/utility/path.h>
 #include <wiz/utility/text.h>
 #include <wiz/utility/writer.h>
-#include <wiz/utility/resource_manager.h>
 
 namespace wiz {
     namespace {
@@ -34,87 +32,70 @@ namespace wiz {
             return false;
         }
 
-        void dumpAddress(Writer* writer, const Definition* definition, DebugFormatContext& context) {
+        void dumpAddress(Writer* writer, const DebugSymbol& symbol, DebugFormatContext& context) {
             const auto outputContext = context.outputContext;
-            const auto address = definition->getAddress();
-
-            if (address.hasValue()) {
-                if (address->absolutePosition.hasValue()) {
-                    const auto outputRelative = isDebugLabelOutputRelative(definition);
-
-                    // Ignore hardware registers / 'extern'.
-                    // If these are mapper-related, definitions for different mappers might alias each other.
-                    // Also, mapper-related registers might alias code/data in the ROM area of address space.
-                    if ((definition->var.qualifiers & Qualifiers::Extern) != Qualifiers::None
-                    || !address->relativePosition.hasValue()) {
-                        return;
-                    }
+            const auto definition = symbol.definition;
+            const auto& address = symbol.address;
 
-                    Optional<std::size_t> maybeValue;
-                    if (outputRelative) {
-                        const auto offset = outputContext->getOutputOffset(address.get());
-                        if (offset.hasValue()) {
-                            maybeValue = std::max<std::size_t>(offset.get() - outputContext->fileHeaderPrefixSize, 0);
-                        }
-                    } else {
-                        maybeValue = address->absolutePosition.get();
-                    }
-
-                    if (!maybeValue.hasValue()) {
-                        return;
-                    }
+            const auto outputRelative = isDebugLabelOutputRelative(definition);
 
-                    const auto value = maybeValue.get();
-                    const auto match = context.addressOwnership.find(value);
-                    if (match != context.addressOwnership.end()) {
-                        return;
-                    } else {
-                        context.addressOwnership[value] = definition;
-                    }
+            // Ignore hardware registers / 'extern'.
+            // If these are mapper-related, definitions for different mappers might alias each other.
+            // Also, mapper-related registers might alias code/data in the ROM area of address space.
+            if ((definition->var.qualifiers & Qualifiers::Extern) != Qualifiers::None
+            || !address.relativePosition.hasValue()) {
+                return;
+            }
 
-                    // Bank index comes from:
-                    // - the output-relative offset divided by debugBankSize (for output-relative definitions)
-                    // - upper 8-bits of the absolute absolute (for absolute definitions).
-                    // Meanwhile, the lower 16-bit part of the address comes from source-provided absolute address, so that
-                    // 00:0000, 01:1000, 02:1000, etc give expected results on GB.
-                    const auto bankIndex = outputRelative ? value / outputContext->debugBankSize : value >> 16U;
-                    auto addressString = text::padLeft(toHexString(bankIndex & 0xFF), '0', 2);
-                    addressString += ':';
-                    addressString += text::padLeft(toHexString(address->absolutePosition.get() & 0xFFFF), '0', 4);
-
-                    std::string fullName;
-                    if ((definition->name.getLength() == 0 || definition->name[0] != '$')
-                    && definition->parentScope != nullptr) {
-                        const auto prefix = definition->parentScope->getFullName();
-                        if (!prefix.empty()) {
-                            fullName = prefix;
-                            fullName += '.';
-                        }
-                    }
-                    fullName += definition->name.toString();
-                    
-                    fullName = text::replaceAll(fullName, "$", "__");
-                    fullName = text::replaceAll(fullName, "%", "__");
-
-                    writer->write(StringView(addressString));
-                    writer->write(" "_sv);
-                    writer->writeLine(StringView(fullName));
+            Optional<std::size_t> maybeValue;
+            if (outputRelative) {
+                const auto offset = outputContext->getOutputOffset(address);
+                if (offset.hasValue()) {
+                    maybeValue = std::max<std::size_t>(offset.get() - outputContext->fileHeaderPrefixSize, 0);
                 }
+            } else {
+                maybeValue = address.absolutePosition.get();
             }
+
+            if (!maybeValue.hasValue()) {
+                return;
+            }
+
+            const auto value = maybeValue.get();
+            if (!context.addressOwnership.claim(value, value, definition)) {
+                return;
+            }
+
+            // Bank index comes from:
+            // - the output-relative offset divided by debugBankSize (for output-relative definitions)
+            // - upper 8-bits of the absolute absolute (for absolute definitions).
+            // Meanwhile, the lower 16-bit part of the address comes from source-provided absolute address, so that
+            // 00:0000, 01:1000, 02:1000, etc give expected results on GB.
+            const auto bankIndex = outputRelative ? value / outputContext->debugBankSize : value >> 16U;
+            auto addressString = text::padLeft(toHexString(bankIndex & 0xFF), '0', 2);
+            addressString += ':';
+            addressString += text::padLeft(toHexString(address.absolutePosition.get() & 0xFFFF), '0', 4);
+
+            auto fullName = text::replaceAll(symbol.fullName, "$", "__");
+            fullName = text::replaceAll(fullName, "%", "__");
+
+            writer->write(StringView(addressString));
+            writer->write(" "_sv);
+            writer->writeLine(StringView(fullName));
         }
     }
 
     RgbdsSymDebugFormat::RgbdsSymDebugFormat() {}
     RgbdsSymDebugFormat::~RgbdsSymDebugFormat() {}
 
-    bool RgbdsSymDebugFormat::generate(DebugFormatContext& context) {
-        const auto debugName = path::stripExtension(context.outputName).toString() + ".sym";
+    StringView RgbdsSymDebugFormat::getExtension() const {
+        return "sym"_sv;
+    }
 
-        if (auto writer = context.resourceManager->openWriter(StringView(debugName))) {
-            for (const auto& definition : context.definitions) {
-                dumpAddress(writer.get(), definition, context);
-            }
-        }       
+    bool RgbdsSymDebugFormat::generate(DebugFormatContext& context, Writer* writer) {
+        for (const auto& symbol : *context.symbols) {
+            dumpAddress(writer, symbol, context);
+        }
 
         return true;
     }
@@ -9,7 +9,8 @@ namespace wiz {
             RgbdsSymDebugFormat();
             ~RgbdsSymDebugFormat() override;
 
-            bool generate(DebugFormatContext& context) override;
+            StringView getExtension() const override;
+            bool generate(DebugFormatContext& context, Writer* writer) override;
     };
 }
 
@@ -1,17 +1,18 @@
+#include <string>
+#include <vector>
 #include <algorithm>
+#include <unordered_map>
 
 #include <wiz/compiler/definition.h>
 #include <wiz/compiler/symbol_table.h>
 #include <wiz/format/output/output_format.h>
 #include <wiz/format/debug/wla_sym_debug_format.h>
+#include <wiz/compiler/source_map.h>
 #include <wiz/utility/misc.h>
-#include <wiz/utility/path.h>
 #include <wiz/utility/text.h>
 #include <wiz/utility/writer.h>
-#include <wiz/utility/resource_manager.h>
 
 // See: https://wla-dx.readthedocs.io/en/latest/symbols.html
-// TODO: support [source files] and [addr-to-line mapping] functionality.
 namespace wiz {
     namespace {
         bool isDebugLabelOutputRelative(const Definition* definition) {
@@ -36,78 +37,134 @@ namespace wiz {
             return false;
         }
 
-        bool isSnesRelatedFormat(DebugFormatContext& context) {
+        bool isSnesRelatedFormat(const DebugFormatContext& context) {
             return context.outputContext->formatName == "sfc"_sv
                 || context.outputContext->formatName == "smc"_sv;
         }
 
-        void dumpAddress(Writer* writer, const Definition* definition, DebugFormatContext& context) {
+        // Returns the value used to identify the address in the symbol file.
+        // This is an offset into the output file for output-relative addresses, and the absolute address otherwise.
+        Optional<std::size_t> getDebugValue(const DebugFormatContext& context, const Address& address, bool outputRelative) {
             const auto outputContext = context.outputContext;
-            const auto address = definition->getAddress();
-
-            if (address.hasValue()) {
-                if (address->absolutePosition.hasValue()) {
-                    const auto snes = isSnesRelatedFormat(context);
-                    const auto outputRelative = !snes && isDebugLabelOutputRelative(definition);
-
-                    // Ignore hardware registers / 'extern'.
-                    // If these are mapper-related, definitions for different mappers might alias each other.
-                    // Also, mapper-related registers might alias code/data in the ROM area of address space.
-                    if ((definition->var.qualifiers & Qualifiers::Extern) != Qualifiers::None
-                    || !address->relativePosition.hasValue()) {
-                        return;
-                    }
 
-                    Optional<std::size_t> maybeValue;
-                    if (outputRelative) {
-                        const auto offset = outputContext->getOutputOffset(address.get());
-                        if (offset.hasValue()) {
-                            maybeValue = std::max<std::size_t>(offset.get() - outputContext->fileHeaderPrefixSize, 0);
-                        }
-                    } else {
-                        maybeValue = address->absolutePosition.get();
-                    }
+            if (outputRelative) {
+                const auto offset = outputContext->getOutputOffset(address);
+                if (offset.hasValue()) {
+                    return std::max<std::size_t>(offset.get() - outputContext->fileHeaderPrefixSize, 0);
+                }
+                return Optional<std::size_t>();
+            } else {
+                return address.absolutePosition.get();
+            }
+        }
 
-                    if (!maybeValue.hasValue()) {
-                        return;
-                    }
+        std::string getAddressString(const DebugFormatContext& context, const Address& address, std::size_t value, bool outputRelative) {
+            // Bank index comes from:
+            // - the output-relative offset divided by debugBankSize (for output-relative definitions)
+            // - upper 8-bits of the absolute absolute (for absolute definitions).
+            // Meanwhile, the lower 16-bit part of the address comes from source-provided absolute address, so that
+            // 00:0000, 01:1000, 02:1000, etc give expected results on GB.
+            const auto bankIndex = outputRelative ? value / context.outputContext->debugBankSize : value >> 16U;
+            auto addressString = text::padLeft(toHexString(bankIndex & 0xFF), '0', 2);
+            addressString += ':';
+            addressString += text::padLeft(toHexString(address.absolutePosition.get() & 0xFFFF), '0', 4);
+            return addressString;
+        }
 
-                    const auto value = maybeValue.get();
-                    const auto match = context.addressOwnership.find(value);
-                    if (match != context.addressOwnership.end()) {
-                        return;
-                    } else {
-                        context.addressOwnership[value] = definition;
-                    }
+        void dumpAddress(Writer* writer, const DebugSymbol& symbol, DebugFormatContext& context) {
+            const auto definition = symbol.definition;
+            const auto& address = symbol.address;
 
-                    // Bank index comes from:
-                    // - the output-relative offset divided by debugBankSize (for output-relative definitions)
-                    // - upper 8-bits of the absolute absolute (for absolute definitions).
-                    // Meanwhile, the lower 16-bit part of the address comes from source-provided absolute address, so that
-                    // 00:0000, 01:1000, 02:1000, etc give expected results on GB.
-                    const auto bankIndex = outputRelative ? value / outputContext->debugBankSize : value >> 16U;
-                    auto addressString = text::padLeft(toHexString(bankIndex & 0xFF), '0', 2);
-                    addressString += ':';
-                    addressString += text::padLeft(toHexString(address->absolutePosition.get() & 0xFFFF), '0', 4);
-
-                    std::string fullName;
-                    if ((definition->name.getLength() == 0 || definition->name[0] != '$')
-                    && definition->parentScope != nullptr) {
-                        const auto prefix = definition->parentScope->getFullName();
-                        if (!prefix.empty()) {
-                            fullName = prefix;
-                            fullName += '.';
-                        }
-                    }
-                    fullName += definition->name.toString();
-                    
-                    fullName = text::replaceAll(fullName, "$", "__");
-                    fullName = text::replaceAll(fullName, "%", "__");
-
-                    writer->write(StringView(addressString));
-                    writer->write(" "_sv);
-                    writer->writeLine(StringView(fullName));
+            const auto snes = isSnesRelatedFormat(context);
+            const auto outputRelative = !snes && isDebugLabelOutputRelative(definition);
+
+            // Ignore hardware registers / 'extern'.
+            // If these are mapper-related, definitions for different mappers might alias each other.
+            // Also, mapper-related registers might alias code/data in the ROM area of address space.
+            if ((definition->var.qualifiers & Qualifiers::Extern) != Qualifiers::None
+            || !address.relativePosition.hasValue()) {
+                return;
+            }
+
+            const auto maybeValue = getDebugValue(context, address, outputRelative);
+            if (!maybeValue.hasValue()) {
+                return;
+            }
+
+            const auto value = maybeValue.get();
+            if (!context.addressOwnership.claim(value, value, definition)) {
+                return;
+            }
+
+            const auto addressString = getAddressString(context, address, value, outputRelative);
+
+            auto fullName = text::replaceAll(symbol.fullName, "$", "__");
+            fullName = text::replaceAll(fullName, "%", "__");
+
+            writer->write(StringView(addressString));
+            writer->write(" "_sv);
+            writer->writeLine(StringView(fullName));
+        }
+
+        void dumpSourceMap(Writer* writer, DebugFormatContext& context) {
+            // Code is addressed the same way as function labels.
+            const auto outputRelative = !isSnesRelatedFormat(context);
+
+            std::vector<const SourceLocation*> sourceFiles;
+            std::unordered_map<StringView, std::size_t> sourceFileIndexes;
+            std::vector<std::string> mappingLines;
+
+            for (const auto& entry : *context.sourceMap) {
+                const auto& location = entry.location;
+                if (location.line == 0 || location.canonicalPath.getLength() == 0
+                || !entry.address.absolutePosition.hasValue()) {
+                    continue;
+                }
+
+                const auto maybeValue = getDebugValue(context, entry.address, outputRelative);
+                if (!maybeValue.hasValue()) {
+                    continue;
                 }
+
+                std::size_t fileIndex = sourceFiles.size();
+                const auto match = sourceFileIndexes.find(location.canonicalPath);
+                if (match != sourceFileIndexes.end()) {
+                    fileIndex = match->second;
+                } else {
+                    sourceFileIndexes[location.canonicalPath] = fileIndex;
+                    sourceFiles.push_back(&location);
+                }
+
+                auto line = getAddressString(context, entry.address, maybeValue.get(), outputRelative);
+                line += ' ';
+                line += text::padLeft(toHexString(fileIndex), '0', 4);
+                line += ':';
+                line += text::padLeft(toHexString(location.line), '0', 8);
+                mappingLines.push_back(std::move(line));
+            }
+
+            if (mappingLines.size() == 0) {
+                return;
+            }
+
+            writer->writeLine("[source files]"_sv);
+            for (std::size_t i = 0; i != sourceFiles.size(); ++i) {
+                const auto location = sourceFiles[i];
+
+                // Debuggers use the checksum to tell whether the source file has changed since the build.
+                const auto match = context.sourceChecksums->find(location->canonicalPath);
+                const auto crc = match != context.sourceChecksums->end() ? match->second : 0;
+
+                writer->write(StringView(text::padLeft(toHexString(i), '0', 4)));
+                writer->write(" "_sv);
+                writer->write(StringView(text::padLeft(toHexString(crc), '0', 8)));
+                writer->write(" "_sv);
+                writer->writeLine(location->displayPath);
+            }
+
+            writer->writeLine("[addr-to-line mapping]"_sv);
+            for (const auto& line : mappingLines) {
+                writer->writeLine(StringView(line));
             }
         }
     }
@@ -115,15 +172,17 @@ namespace wiz {
     WlaSymDebugFormat::WlaSymDebugFormat() {}
     WlaSymDebugFormat::~WlaSymDebugFormat() {}
 
-    bool WlaSymDebugFormat::generate(DebugFormatContext& context) {
-        const auto debugName = path::stripExtension(context.outputName).toString() + ".sym";
+    StringView WlaSymDebugFormat::getExtension() const {
+        return "sym"_sv;
+    }
 
-        if (auto writer = context.resourceManager->openWriter(StringView(debugName))) {
-            writer->writeLine("[labels]"_sv);
-            for (const auto& definition : context.definitions) {
-                dumpAddress(writer.get(), definition, context);
-            }
-        }       
+    bool WlaSymDebugFormat::generate(DebugFormatContext& context, Writer* writer) {
+        writer->writeLine("[labels]"_sv);
+        for (const auto& symbol : *context.symbols) {
+            dumpAddress(writer, symbol, context);
+        }
+
+        dumpSourceMap(writer, context);
 
         return true;
     }
@@ -27,11 +27,8 @@ namespace wiz {
 
         for (std::size_t i = 0; i != banks.size(); ++i) {
             const auto& bank = banks[i];            
-            const auto bankData = trimmedBankIndex == i ? bank->getUsedData() : bank->getData();
-
             context.bankOffsets[bank] = data.size();
-            data.reserve(data.size() + bankData.size());
-            data.insert(data.end(), bankData.begin(), bankData.end());
+            data.appendBank(bank, trimmedBankIndex == i ? bank->calculateUsedSize() : bank->getStoredSize());
         }
 
         return true;
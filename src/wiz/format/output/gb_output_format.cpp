@@ -65,11 +65,8 @@ namespace wiz {
         auto& data = context.data;
 
         for (const auto& bank : banks) {
-            const auto bankData = bank->getData();
-
             context.bankOffsets[bank] = data.size();
-            data.reserve(data.size() + bankData.size());
-            data.insert(data.end(), bankData.begin(), bankData.end());
+            data.appendBank(bank, bank->getStoredSize());
         }
 
         if (data.size() < RomBankSize) {
@@ -78,22 +75,22 @@ namespace wiz {
 
         context.debugBankSize = 16384;
 
-        memset(&data[0x134], 0, 0x14D - 0x134);
-        memcpy(&data[0x104], LogoBitmap, sizeof(LogoBitmap));
+        data.fill(0x134, 0, 0x14D - 0x134);
+        data.write(0x104, LogoBitmap, sizeof(LogoBitmap));
         data[0x14B] = 0x33;
 
         std::size_t titleMaxLength = config->has("manufacturer"_sv) ? 11 : 15;
 
         if (const auto title = config->checkFixedString(report, "title"_sv, titleMaxLength, false)) {
-            memcpy(&data[0x134], title->second.getData(), title->second.getLength());
+            data.write(0x134, title->second.getData(), title->second.getLength());
         } else {
             auto truncatedOutputName = path::stripExtension(context.outputName).sub(0, titleMaxLength).toString();
             std::transform(truncatedOutputName.begin(), truncatedOutputName.end(), truncatedOutputName.begin(), [](unsigned char c) { return std::toupper(c); });
-            memcpy(&data[0x134], truncatedOutputName.data(), truncatedOutputName.length());
+            data.write(0x134, truncatedOutputName.data(), truncatedOutputName.length());
         }
 
         if (const auto manufacturer = config->checkFixedString(report, "manufacturer"_sv, 4, false)) {
-            memcpy(&data[0x13F], manufacturer->second.getData(), manufacturer->second.getLength());
+            data.write(0x13F, manufacturer->second.getData(), manufacturer->second.getLength());
         }
         if (const auto gbcCompatible = config->checkBoolean(report, "gbc_compatible"_sv, false)) {
             if (gbcCompatible->second) {
@@ -106,7 +103,7 @@ namespace wiz {
             }
         }
         if (const auto licensee = config->checkFixedString(report, "licensee"_sv, 2, false)) {
-            memcpy(&data[0x144], licensee->second.getData(), licensee->second.getLength());
+            data.write(0x144, licensee->second.getData(), licensee->second.getLength());
         }
         if (const auto sgbCompatible = config->checkBoolean(report, "sgb_compatible"_sv, false)) {
             if (sgbCompatible->second) {
@@ -173,16 +170,12 @@ namespace wiz {
 
         std::uint8_t headerChecksum = 0;
         for(std::size_t i = 0x134; i != 0x14D; ++i) {
-            headerChecksum = (headerChecksum - data[i] - 1) & 0xFF;
+            headerChecksum = (headerChecksum - data.get(i) - 1) & 0xFF;
         }
         data[0x14D] = headerChecksum;
 
-        std::uint16_t globalChecksum = 0;
-        for (std::size_t i = 0, size = data.size(); i != size; ++i) {
-            if (i != 0x14E && i != 0x14F) {
-                globalChecksum += data[i];
-            }
-        }
+        // The checksum covers the whole ROM except itself.
+        const auto globalChecksum = static_cast<std::uint16_t>(data.sum(0, 0x14E) + data.sum(0x150, data.size()));
         data[0x14E] = (globalChecksum >> 8) & 0xFF;
         data[0x14F] = globalChecksum & 0xFF;
 
@@ -84,17 +84,14 @@ namespace wiz {
         const auto& banks = context.banks;
         auto& data = context.data;
 
-        data.insert(data.end(), HeaderSize, 0);
+        data.appendFill(HeaderSize, 0);
 
         context.fileHeaderPrefixSize = HeaderSize;
 
         for (const auto& bank : banks) {
             if (isBankKindStored(bank->getKind()) && bank->getKind() != BankKind::CharacterRom) {
-                const auto bankData = bank->getData();
-
                 context.bankOffsets[bank] = data.size();
-                data.reserve(data.size() + bankData.size());
-                data.insert(data.end(), bankData.begin(), bankData.end());
+                data.appendBank(bank, bank->getStoredSize());
             }
         }
 
@@ -108,11 +105,8 @@ namespace wiz {
 
         for (const auto& bank : banks) {
             if (isBankKindStored(bank->getKind()) && bank->getKind() == BankKind::CharacterRom) {
-                const auto bankData = bank->getData();
-
                 context.bankOffsets[bank] = data.size();
-                data.reserve(data.size() + bankData.size());
-                data.insert(data.end(), bankData.begin(), bankData.end());
+                data.appendBank(bank, bank->getStoredSize());
             }
         }
 
@@ -124,7 +118,7 @@ namespace wiz {
             chrSize = paddedChrSize;
         }
 
-        memcpy(&data[0], HeaderSignature.getData(), HeaderSignature.getLength());
+        data.write(0, HeaderSignature.getData(), HeaderSignature.getLength());
         data[4] = static_cast<std::uint8_t>(prgSize / PrgRomBankSize);
         data[5] = static_cast<std::uint8_t>(chrSize / ChrRomBankSize);
 
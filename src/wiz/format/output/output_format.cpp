@@ -1,11 +1,228 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+
+#include <wiz/compiler/bank.h>
 #include <wiz/format/output/output_format.h>
 #include <wiz/format/output/binary_output_format.h>
 #include <wiz/format/output/gb_output_format.h>
 #include <wiz/format/output/nes_output_format.h>
 #include <wiz/format/output/sms_output_format.h>
 #include <wiz/format/output/snes_output_format.h>
+#include <wiz/utility/checksum.h>
 
 namespace wiz {
+    namespace {
+        // Patches are applied to a copy of the surrounding page, so that neighbouring header writes share one buffer.
+        const std::size_t PatchPageSize = 256;
+        // Fill chunks are written as repeated views of a block this size.
+        const std::size_t FillBlockSize = 64 * 1024;
+    }
+
+    std::uint8_t OutputData::Chunk::get(std::size_t index) const {
+        switch (kind) {
+            case ChunkKind::View: return view[index];
+            case ChunkKind::Fill: return value;
+            case ChunkKind::Buffer: return buffer[index];
+            default: std::abort(); return 0;
+        }
+    }
+
+    OutputData::Chunk OutputData::Chunk::slice(std::size_t begin, std::size_t end) const {
+        switch (kind) {
+            case ChunkKind::View: return Chunk(offset + begin, view.sub(begin, end - begin));
+            case ChunkKind::Fill: return Chunk(offset + begin, end - begin, value);
+            case ChunkKind::Buffer: return Chunk(offset + begin, std::vector<std::uint8_t>(buffer.begin() + begin, buffer.begin() + end));
+            default: std::abort(); return Chunk(0, 0, 0);
+        }
+    }
+
+    OutputData::OutputData() {}
+    OutputData::~OutputData() {}
+
+    std::size_t OutputData::size() const {
+        return totalSize;
+    }
+
+    void OutputData::append(ArrayView<std::uint8_t> view) {
+        if (view.size() == 0) {
+            return;
+        }
+
+        chunks.push_back(Chunk(totalSize, view));
+        totalSize += view.size();
+    }
+
+    void OutputData::appendBank(const Bank* bank, std::size_t size) {
+        for (std::size_t offset = 0; offset < size; offset += Bank::PageSize) {
+            const auto length = std::min<std::size_t>(Bank::PageSize, size - offset);
+            const auto page = bank->getPageData(offset);
+            if (page.size() != 0) {
+                append(page.sub(0, length));
+            } else {
+                appendFill(length, bank->getPadValue());
+            }
+        }
+    }
+
+    void OutputData::appendFill(std::size_t count, std::uint8_t value) {
+        if (count == 0) {
+            return;
+        }
+
+        if (chunks.size() != 0 && chunks.back().kind == ChunkKind::Fill && chunks.back().value == value) {
+            chunks.back().size += count;
+        } else {
+            chunks.push_back(Chunk(totalSize, count, value));
+        }
+        totalSize += count;
+    }
+
+    void OutputData::resize(std::size_t newSize, std::uint8_t value) {
+        if (newSize > totalSize) {
+            appendFill(newSize - totalSize, value);
+        }
+    }
+
+    std::uint8_t OutputData::get(std::size_t offset) const {
+        const auto& chunk = chunks[findChunkIndex(offset)];
+        return chunk.get(offset - chunk.offset);
+    }
+
+    std::uint8_t& OutputData::operator [](std::size_t offset) {
+        return *getWritableData(offset, 1);
+    }
+
+    void OutputData::write(std::size_t offset, const void* source, std::size_t length) {
+        if (length != 0) {
+            memcpy(getWritableData(offset, length), source, length);
+        }
+    }
+
+    void OutputData::fill(std::size_t offset, std::uint8_t value, std::size_t length) {
+        if (length != 0) {
+            memset(getWritableData(offset, length), value, length);
+        }
+    }
+
+    std::uint64_t OutputData::sum(std::size_t begin, std::size_t end) const {
+        std::uint64_t result = 0;
+        if (begin >= end) {
+            return result;
+        }
+
+        for (auto i = findChunkIndex(begin); i != chunks.size() && chunks[i].offset < end; ++i) {
+            const auto& chunk = chunks[i];
+            const auto from = std::max(begin, chunk.offset) - chunk.offset;
+            const auto to = std::min(end, chunk.offset + chunk.size) - chunk.offset;
+
+            switch (chunk.kind) {
+                case ChunkKind::View: {
+                    result += checksum::sumBytes(chunk.view.getData() + from, to - from);
+                    break;
+                }
+                case ChunkKind::Fill: {
+                    result += static_cast<std::uint64_t>(chunk.value) * (to - from);
+                    break;
+                }
+                case ChunkKind::Buffer: {
+                    result += checksum::sumBytes(chunk.buffer.data() + from, to - from);
+                    break;
+                }
+                default: std::abort(); break;
+            }
+        }
+
+        return result;
+    }
+
+    std::vector<ArrayView<std::uint8_t>> OutputData::getSpans() const {
+        std::vector<ArrayView<std::uint8_t>> spans;
+        spans.reserve(chunks.size());
+
+        for (const auto& chunk : chunks) {
+            switch (chunk.kind) {
+                case ChunkKind::View: {
+                    spans.push_back(chunk.view);
+                    break;
+                }
+                case ChunkKind::Fill: {
+                    auto& fillBlock = fillBlocks[chunk.value];
+                    if (fillBlock == nullptr) {
+                        fillBlock = std::make_unique<std::vector<std::uint8_t>>(FillBlockSize, chunk.value);
+                    }
+
+                    for (std::size_t remaining = chunk.size; remaining != 0;) {
+                        const auto length = std::min(remaining, FillBlockSize);
+                        spans.push_back(ArrayView<std::uint8_t>(fillBlock->data(), length));
+                        remaining -= length;
+                    }
+                    break;
+                }
+                case ChunkKind::Buffer: {
+                    spans.push_back(ArrayView<std::uint8_t>(chunk.buffer));
+                    break;
+                }
+                default: std::abort(); break;
+            }
+        }
+
+        return spans;
+    }
+
+    std::size_t OutputData::findChunkIndex(std::size_t offset) const {
+        const auto match = std::upper_bound(chunks.begin(), chunks.end(), offset, [](std::size_t offset, const Chunk& chunk) {
+            return offset < chunk.offset;
+        });
+        return static_cast<std::size_t>(match - chunks.begin()) - 1;
+    }
+
+    std::uint8_t* OutputData::getWritableData(std::size_t offset, std::size_t length) {
+        {
+            auto& chunk = chunks[findChunkIndex(offset)];
+            if (chunk.kind == ChunkKind::Buffer && offset + length <= chunk.offset + chunk.size) {
+                return &chunk.buffer[offset - chunk.offset];
+            }
+        }
+
+        // Replace the chunks under the surrounding pages with a single buffer that holds a copy of their bytes.
+        const auto begin = offset / PatchPageSize * PatchPageSize;
+        const auto end = std::min((offset + length + PatchPageSize - 1) / PatchPageSize * PatchPageSize, totalSize);
+        const auto firstIndex = findChunkIndex(begin);
+        const auto lastIndex = findChunkIndex(end - 1);
+
+        std::vector<std::uint8_t> buffer;
+        buffer.reserve(end - begin);
+        for (auto i = firstIndex; i <= lastIndex; ++i) {
+            const auto& chunk = chunks[i];
+            const auto from = std::max(begin, chunk.offset);
+            const auto to = std::min(end, chunk.offset + chunk.size);
+            for (auto j = from; j != to; ++j) {
+                buffer.push_back(chunk.get(j - chunk.offset));
+            }
+        }
+
+        std::vector<Chunk> replacements;
+        const auto& firstChunk = chunks[firstIndex];
+        const auto& lastChunk = chunks[lastIndex];
+        if (firstChunk.offset < begin) {
+            replacements.push_back(firstChunk.slice(0, begin - firstChunk.offset));
+        }
+        const auto bufferIndex = firstIndex + replacements.size();
+        replacements.push_back(Chunk(begin, std::move(buffer)));
+        if (lastChunk.offset + lastChunk.size > end) {
+            replacements.push_back(lastChunk.slice(end - lastChunk.offset, lastChunk.size));
+        }
+
+        chunks.erase(chunks.begin() + firstIndex, chunks.begin() + lastIndex + 1);
+        chunks.insert(chunks.begin() + firstIndex, std::make_move_iterator(replacements.begin()), std::make_move_iterator(replacements.end()));
+
+        return &chunks[bufferIndex].buffer[offset - begin];
+    }
+
+
+
     Optional<std::size_t> OutputFormatContext::getOutputOffset(Address address) const {
         const auto bankOffset = bankOffsets.find(address.bank);
         return bankOffset != bankOffsets.end() && address.relativePosition.hasValue()
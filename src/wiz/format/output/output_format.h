@@ -2,7 +2,9 @@
 #define WIZ_FORMAT_OUTPUT_OUTPUT_FORMAT_H
 
 #include <cstdint>
+#include <memory>
 #include <unordered_map>
+#include <vector>
 
 #include <wiz/compiler/address.h>
 #include <wiz/utility/string_view.h>
@@ -15,6 +17,73 @@ namespace wiz {
     class Report;
     class StringPool;
 
+    // The bytes of an output file, as a list of chunks that are written in order, rather than one contiguous buffer.
+    // Bank data is referenced in place, padding is stored as a fill value, and only the small regions that a format patches (eg. headers) are copied.
+    class OutputData {
+        public:
+            OutputData();
+            ~OutputData();
+
+            std::size_t size() const;
+
+            // Appends a view of bytes owned elsewhere, which must outlive this OutputData.
+            void append(ArrayView<std::uint8_t> view);
+            // Appends the first `size` bytes of a bank, viewing its pages in place, and using fill for pages it never wrote.
+            void appendBank(const Bank* bank, std::size_t size);
+            void appendFill(std::size_t count, std::uint8_t value);
+            // Grows to the given size by appending fill, or does nothing if already that big.
+            void resize(std::size_t newSize, std::uint8_t value);
+
+            std::uint8_t get(std::size_t offset) const;
+            std::uint8_t& operator [](std::size_t offset);
+            void write(std::size_t offset, const void* source, std::size_t length);
+            void fill(std::size_t offset, std::uint8_t value, std::size_t length);
+
+            // Returns the byte sum of the range [begin, end), without visiting fill chunks byte by byte.
+            std::uint64_t sum(std::size_t begin, std::size_t end) const;
+
+            // Returns the spans of memory that make up the file, in order, suitable for vectored writes.
+            std::vector<ArrayView<std::uint8_t>> getSpans() const;
+
+        private:
+            enum class ChunkKind {
+                View,
+                Fill,
+                Buffer,
+            };
+
+            struct Chunk {
+                Chunk(std::size_t offset, ArrayView<std::uint8_t> view)
+                : kind(ChunkKind::View), offset(offset), size(view.size()), view(view), value(0) {}
+
+                Chunk(std::size_t offset, std::size_t size, std::uint8_t value)
+                : kind(ChunkKind::Fill), offset(offset), size(size), view(), value(value) {}
+
+                Chunk(std::size_t offset, std::vector<std::uint8_t> buffer)
+                : kind(ChunkKind::Buffer), offset(offset), size(buffer.size()), view(), value(0), buffer(std::move(buffer)) {}
+
+                ChunkKind kind;
+                std::size_t offset;
+                std::size_t size;
+                ArrayView<std::uint8_t> view;
+                std::uint8_t value;
+                std::vector<std::uint8_t> buffer;
+
+                std::uint8_t get(std::size_t index) const;
+                Chunk slice(std::size_t begin, std::size_t end) const;
+            };
+
+            OutputData(const OutputData&) = delete;
+            OutputData& operator=(const OutputData&) = delete;
+
+            std::size_t findChunkIndex(std::size_t offset) const;
+            std::uint8_t* getWritableData(std::size_t offset, std::size_t length);
+
+            std::vector<Chunk> chunks;
+            std::size_t totalSize = 0;
+            mutable std::unordered_map<std::uint8_t, std::unique_ptr<std::vector<std::uint8_t>>> fillBlocks;
+    };
+
     struct OutputFormatContext {
         OutputFormatContext(Report* report,
             StringPool* stringPool,
@@ -47,7 +116,7 @@ namespace wiz {
         std::size_t debugBankSize = 65536;
 
         std::unordered_map<const Bank*, std::size_t> bankOffsets;
-        std::vector<std::uint8_t> data;
+        OutputData data;
     };
 
     class OutputFormat {
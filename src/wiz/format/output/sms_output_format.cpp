@@ -22,11 +22,8 @@ namespace wiz {
         auto& data = context.data;
         
         for (const auto& bank : banks) {
-            const auto bankData = bank->getData();
-
             context.bankOffsets[bank] = data.size();
-            data.reserve(data.size() + bankData.size());
-            data.insert(data.end(), bankData.begin(), bankData.end());
+            data.appendBank(bank, bank->getStoredSize());
         }
 
         std::size_t headerAddress = 0x1FF0;
@@ -48,8 +45,8 @@ namespace wiz {
             }
         }
 
-        memset(&data[headerAddress], 0, 0x10);
-        memcpy(&data[headerAddress], HeaderSignature.getData(), HeaderSignature.getLength());
+        data.fill(headerAddress, 0, 0x10);
+        data.write(headerAddress, HeaderSignature.getData(), HeaderSignature.getLength());
 
         if (const auto productCode = config->checkInteger(report, "product_code"_sv, false)) {
             if (Int128(0) <= productCode->second && productCode->second <= Int128(159999)) {
@@ -95,12 +92,8 @@ namespace wiz {
             data[headerAddress + 0xF] |= setting << 4;
         }
 
-        std::uint16_t checksum = 0;
-        for (std::size_t i = 0, size = data.size(); i != size; ++i) {
-            if (i < headerAddress || i >= headerAddress + HeaderSize) {
-                checksum += data[i];
-            }
-        }
+        // The checksum covers the whole ROM except the header.
+        const auto checksum = static_cast<std::uint16_t>(data.sum(0, headerAddress) + data.sum(headerAddress + HeaderSize, data.size()));
         data[headerAddress + 0xA] = (checksum >> 8) & 0xFF;
         data[headerAddress + 0xB] = checksum & 0xFF;
 
@@ -1,3 +1,4 @@
+#include <array>
 #include <algorithm>
 #include <stdexcept>
 #include <utility>
@@ -17,6 +18,23 @@
 #include <wiz/utility/source_location.h>
 
 namespace wiz {
+    namespace {
+        struct BinaryOperatorInfo {
+            BinaryOperatorInfo()
+            : precedence(BinaryPrecedence::None),
+            op(BinaryOperatorKind::None) {}
+
+            BinaryOperatorInfo(
+                BinaryPrecedence precedence,
+                BinaryOperatorKind op)
+            : precedence(precedence),
+            op(op) {}
+
+            BinaryPrecedence precedence;
+            BinaryOperatorKind op;
+        };
+    }
+
     Parser::Parser(
         StringPool* stringPool,
         ImportManager* importManager,
@@ -160,6 +178,9 @@ namespace wiz {
     }
 
     void Parser::popScanner() {
+        // The scanner has read the whole file by now, so its checksum matches the source that was compiled.
+        importManager->setSourceChecksum(scanner->getLocation().canonicalPath, scanner->getChecksum());
+
         if (scannerStack.size() > 1) {
             // Pop previous scanner off stack.
             scanner = std::move(scannerStack.back());
@@ -468,7 +489,7 @@ namespace wiz {
     }
 
     FwdUniquePtr<const Statement> Parser::parseInStatement() {
-        // relocation = `in` (IDENTIFIER (`.` IDENTIFIER)*) (`,` expression)? block
+        // relocation = `in` (IDENTIFIER (`.` IDENTIFIER)*) (`,` IDENTIFIER (`.` IDENTIFIER)*)* (`@` expression)? block
         const auto location = scanner->getLocation();
         FwdUniquePtr<const Expression> dest;
         
@@ -494,6 +515,18 @@ namespace wiz {
             }                
         }
 
+        // (`,` identifier)*
+        std::vector<std::vector<StringView>> packedPieces;
+        while (token.type == TokenType::Comma) {
+            nextToken(); // `,`
+
+            auto packedBankPieces = parseQualifiedIdentifier();
+            if (packedBankPieces.size() == 0) {
+                return nullptr;
+            }
+            packedPieces.push_back(std::move(packedBankPieces));
+        }
+
         // (@ expr)?
         if (token.type == TokenType::At) {
             nextToken(); // @
@@ -501,7 +534,7 @@ namespace wiz {
         }
         
         auto block = parseBlockStatement(); // block
-        return makeFwdUnique<const Statement>(Statement::In(pieces, std::move(dest), std::move(block)), location);
+        return makeFwdUnique<const Statement>(Statement::In(pieces, packedPieces, std::move(dest), std::move(block)), location);
     }
 
     FwdUniquePtr<const Statement> Parser::parseBlockStatement() {
@@ -1405,237 +1438,86 @@ namespace wiz {
 
     FwdUniquePtr<const Expression> Parser::parseLogicalOr(ExpressionParseOptions options) {
         // logical_or = logical_and (`||` logical_and)*
-        FwdUniquePtr<const Expression> left;
-
-        left = parseLogicalAnd(options); // logical_and
-        while (report->alive()) {
-            if (token.type == TokenType::DoubleBar) {
-                const auto location = scanner->getLocation();
-                nextToken(); // operator token
-                auto right = parseLogicalAnd(options); // logical_and
-                left = makeFwdUnique<const Expression>(Expression::BinaryOperator(
-                    BinaryOperatorKind::LogicalOr, std::move(left), std::move(right)), location, Optional<ExpressionInfo>());
-            } else {
-                return left;
-            }
-        }
-        return nullptr;
-    }
-
-    FwdUniquePtr<const Expression> Parser::parseLogicalAnd(ExpressionParseOptions options) {
-        // logical_conjunction = comparison (`&&` comparison)*
-        FwdUniquePtr<const Expression> left;
-
-        left = parseComparison(options); // comparison
-        while (report->alive()) {
-            if (token.type == TokenType::DoubleAmpersand) {
-                const auto location = scanner->getLocation();
-                nextToken(); // operator token
-                auto right = parseComparison(options); // comparison
-                left = makeFwdUnique<const Expression>(Expression::BinaryOperator(
-                    BinaryOperatorKind::LogicalAnd, std::move(left), std::move(right)), location, Optional<ExpressionInfo>());
-            } else {
-                return left;
-            }
-        }
-        return nullptr;
+        return parseBinaryOperators(options, BinaryPrecedence::LogicalOr);
     }
 
-    FwdUniquePtr<const Expression> Parser::parseComparison(ExpressionParseOptions options) {
+    FwdUniquePtr<const Expression> Parser::parseBinaryOperators(ExpressionParseOptions options, BinaryPrecedence minimumPrecedence) {
+        // Every binary operator level, parsed by precedence climbing, rather than one nested call per level for every operand.
+        // logical_or = logical_and (`||` logical_and)*
+        // logical_and = comparison (`&&` comparison)*
         // comparison = range (cmp_op range)*
-        FwdUniquePtr<const Expression> left;
-
-        left = parseRange(options); // range
-        while (report->alive()) {
-            BinaryOperatorKind op = BinaryOperatorKind::None;
-            switch (token.type) {
-                case TokenType::ExclamationEquals: op = BinaryOperatorKind::NotEqual; break;
-                case TokenType::DoubleEquals: op = BinaryOperatorKind::Equal; break;
-                case TokenType::LessThan: op = BinaryOperatorKind::LessThan; break;
-                case TokenType::GreaterThan: op = BinaryOperatorKind::GreaterThan; break;
-                case TokenType::LessThanEquals: op = BinaryOperatorKind::LessThanOrEqual; break;
-                case TokenType::GreaterThanEquals: op = BinaryOperatorKind::GreaterThanOrEqual; break;
-                default: op = BinaryOperatorKind::None; break;
-            }
-            if (op != BinaryOperatorKind::None) {
-                const auto location = scanner->getLocation();
-                nextToken(); // operator token
-                auto right = parseRange(options); // range
-                left = makeFwdUnique<const Expression>(Expression::BinaryOperator(
-                    op, std::move(left), std::move(right)), location, Optional<ExpressionInfo>());
-            } else {
-                return left;
-            }
-        }
-        return nullptr;
-    }
-
-    FwdUniquePtr<const Expression> Parser::parseRange(ExpressionParseOptions options) {
         // range = bitwise_or ((`...` | `..<` | `>..`) bitwise_or (`by` bitwise_or)?)?
-        FwdUniquePtr<const Expression> left;
-
-        left = parseBitwiseOr(options); // bitwise_or
-        if (report->alive()) {
-            if (token.type == TokenType::DotDot) {
-                const auto location = scanner->getLocation();
-
-                nextToken(); // operator token
-                auto right = parseBitwiseOr(options); // bitwise_or
-
-                FwdUniquePtr<const Expression> step;
-                if (token.type == TokenType::Identifier && token.keyword == Keyword::By) {
-                    nextToken(); // IDENTIFIER (keyword `by`)
-                    step = parseBitwiseOr(options); // bitwise_or
-                }
-
-                return makeFwdUnique<const Expression>(Expression::RangeLiteral(std::move(left), std::move(right), std::move(step)), location, Optional<ExpressionInfo>());
-            } else {
-                return left;
-            }
-        }
-        return nullptr;
-    }
-
-    FwdUniquePtr<const Expression> Parser::parseBitwiseOr(ExpressionParseOptions options) {
         // bitwise_or = bitwise_xor (`|` bitwise_xor)*
-        FwdUniquePtr<const Expression> left;
-
-        left = parseBitwiseXor(options); // bitwise_xor
-        while (report->alive()) {
-            if (token.type == TokenType::Bar) {
-                const auto location = scanner->getLocation();
-                nextToken(); // operator token
-                auto right = parseBitwiseXor(options); // bitwise_xor
-                left = makeFwdUnique<const Expression>(Expression::BinaryOperator(
-                    BinaryOperatorKind::BitwiseOr, std::move(left), std::move(right)), location, Optional<ExpressionInfo>());
-            } else {
-                return left;
-            }
-        }
-        return nullptr;
-    }
-
-    FwdUniquePtr<const Expression> Parser::parseBitwiseXor(ExpressionParseOptions options) {
         // bitwise_xor = bitwise_and (`^` bitwise_and)*
-        FwdUniquePtr<const Expression> left;
-
-        left = parseBitwiseAnd(options); // bitwise_and
-        while (report->alive()) {
-            if (token.type == TokenType::Caret) {
-                const auto location = scanner->getLocation();
-                nextToken(); // operator token
-                auto right = parseBitwiseAnd(options); // bitwise_and
-                left = makeFwdUnique<const Expression>(Expression::BinaryOperator(
-                    BinaryOperatorKind::BitwiseXor, std::move(left), std::move(right)), location, Optional<ExpressionInfo>());
-            } else {
-                return left;
-            }
-        }
-        return nullptr;
-    }
-
-    FwdUniquePtr<const Expression> Parser::parseBitwiseAnd(ExpressionParseOptions options) {
         // bitwise_and = shift (`&` shift)*
-        FwdUniquePtr<const Expression> left;
-
-        left = parseShift(options); // shift
-        while (report->alive()) {
-            if (token.type == TokenType::Ampersand) {
-                const auto location = scanner->getLocation();
-                nextToken(); // operator token
-                auto right = parseShift(options); // shift
-                left = makeFwdUnique<const Expression>(Expression::BinaryOperator(
-                    BinaryOperatorKind::BitwiseAnd, std::move(left), std::move(right)), location, Optional<ExpressionInfo>());
-            } else {
-                return left;
-            }
-        }
-        return nullptr;
-    }
-
-    FwdUniquePtr<const Expression> Parser::parseShift(ExpressionParseOptions options) {
         // shift = addition (shift_op addition)*
-        FwdUniquePtr<const Expression> left;
-
-        left = parseAddition(options); // addition
-        while (report->alive()) {
-            BinaryOperatorKind op = BinaryOperatorKind::None;
-            switch (token.type) {
-                case TokenType::DoubleLessThan: op = BinaryOperatorKind::LeftShift; break;
-                case TokenType::DoubleGreaterThan: op = BinaryOperatorKind::RightShift; break;
-                case TokenType::TripleLessThan: op = BinaryOperatorKind::LogicalLeftShift; break;
-                case TokenType::TripleGreaterThan: op = BinaryOperatorKind::LogicalRightShift; break;
-                case TokenType::QuadrupleLessThan: op = BinaryOperatorKind::LeftRotate; break;
-                case TokenType::QuadrupleGreaterThan: op = BinaryOperatorKind::RightRotate; break;
-                case TokenType::QuadrupleLessThanHash: op = BinaryOperatorKind::LeftRotateWithCarry; break;
-                case TokenType::QuadrupleGreaterThanHash: op = BinaryOperatorKind::RightRotateWithCarry; break;
-                default: op = BinaryOperatorKind::None; break;
-            }
-
-            if (op != BinaryOperatorKind::None) {
-                const auto location = scanner->getLocation();
-                nextToken(); // operator token
-                auto right = parseAddition(options); // addition
-                left = makeFwdUnique<const Expression>(Expression::BinaryOperator(
-                    op, std::move(left), std::move(right)), location, Optional<ExpressionInfo>());
-            } else {
-                return left;
-            }
-        }
-        return nullptr;
-    }
-
-
-    FwdUniquePtr<const Expression> Parser::parseAddition(ExpressionParseOptions options) {
         // addition = multiplication (add_op multiplication)*
-        FwdUniquePtr<const Expression> left;
+        // multiplication = cast (mul_op cast)*
+        static const auto operators = [] {
+            std::array<BinaryOperatorInfo, static_cast<std::size_t>(TokenType::Count)> operators {};
+            const auto add = [&](TokenType type, BinaryPrecedence precedence, BinaryOperatorKind op) {
+                operators[static_cast<std::size_t>(type)] = BinaryOperatorInfo(precedence, op);
+            };
+            add(TokenType::DoubleBar, BinaryPrecedence::LogicalOr, BinaryOperatorKind::LogicalOr);
+            add(TokenType::DoubleAmpersand, BinaryPrecedence::LogicalAnd, BinaryOperatorKind::LogicalAnd);
+            add(TokenType::ExclamationEquals, BinaryPrecedence::Comparison, BinaryOperatorKind::NotEqual);
+            add(TokenType::DoubleEquals, BinaryPrecedence::Comparison, BinaryOperatorKind::Equal);
+            add(TokenType::LessThan, BinaryPrecedence::Comparison, BinaryOperatorKind::LessThan);
+            add(TokenType::GreaterThan, BinaryPrecedence::Comparison, BinaryOperatorKind::GreaterThan);
+            add(TokenType::LessThanEquals, BinaryPrecedence::Comparison, BinaryOperatorKind::LessThanOrEqual);
+            add(TokenType::GreaterThanEquals, BinaryPrecedence::Comparison, BinaryOperatorKind::GreaterThanOrEqual);
+            // Ranges aren't binary operators, but they bind like one.
+            add(TokenType::DotDot, BinaryPrecedence::Range, BinaryOperatorKind::None);
+            add(TokenType::Bar, BinaryPrecedence::BitwiseOr, BinaryOperatorKind::BitwiseOr);
+            add(TokenType::Caret, BinaryPrecedence::BitwiseXor, BinaryOperatorKind::BitwiseXor);
+            add(TokenType::Ampersand, BinaryPrecedence::BitwiseAnd, BinaryOperatorKind::BitwiseAnd);
+            add(TokenType::DoubleLessThan, BinaryPrecedence::Shift, BinaryOperatorKind::LeftShift);
+            add(TokenType::DoubleGreaterThan, BinaryPrecedence::Shift, BinaryOperatorKind::RightShift);
+            add(TokenType::TripleLessThan, BinaryPrecedence::Shift, BinaryOperatorKind::LogicalLeftShift);
+            add(TokenType::TripleGreaterThan, BinaryPrecedence::Shift, BinaryOperatorKind::LogicalRightShift);
+            add(TokenType::QuadrupleLessThan, BinaryPrecedence::Shift, BinaryOperatorKind::LeftRotate);
+            add(TokenType::QuadrupleGreaterThan, BinaryPrecedence::Shift, BinaryOperatorKind::RightRotate);
+            add(TokenType::QuadrupleLessThanHash, BinaryPrecedence::Shift, BinaryOperatorKind::LeftRotateWithCarry);
+            add(TokenType::QuadrupleGreaterThanHash, BinaryPrecedence::Shift, BinaryOperatorKind::RightRotateWithCarry);
+            add(TokenType::Plus, BinaryPrecedence::Addition, BinaryOperatorKind::Addition);
+            add(TokenType::Minus, BinaryPrecedence::Addition, BinaryOperatorKind::Subtraction);
+            add(TokenType::PlusHash, BinaryPrecedence::Addition, BinaryOperatorKind::AdditionWithCarry);
+            add(TokenType::MinusHash, BinaryPrecedence::Addition, BinaryOperatorKind::SubtractionWithCarry);
+            add(TokenType::Asterisk, BinaryPrecedence::Multiplication, BinaryOperatorKind::Multiplication);
+            add(TokenType::Slash, BinaryPrecedence::Multiplication, BinaryOperatorKind::Division);
+            add(TokenType::Percent, BinaryPrecedence::Multiplication, BinaryOperatorKind::Modulo);
+            return operators;
+        }();
+
+        auto left = parseCast(options); // cast
+        // A range can't be the left side of another range, but can still be compared, and-ed or or-ed.
+        auto maximumPrecedence = BinaryPrecedence::Multiplication;
 
-        left = parseMultiplication(options); // multiplication
         while (report->alive()) {
-            BinaryOperatorKind op = BinaryOperatorKind::None;
-            switch (token.type) {
-                case TokenType::Plus: op = BinaryOperatorKind::Addition; break;
-                case TokenType::Minus: op = BinaryOperatorKind::Subtraction; break;
-                case TokenType::PlusHash: op = BinaryOperatorKind::AdditionWithCarry; break;
-                case TokenType::MinusHash: op = BinaryOperatorKind::SubtractionWithCarry; break;
-                default: op = BinaryOperatorKind::None; break;
-            }
-
-            if (op != BinaryOperatorKind::None) {
-                const auto location = scanner->getLocation();
-                nextToken(); // operator token
-                auto right = parseMultiplication(options); // multiplication
-                left = makeFwdUnique<const Expression>(Expression::BinaryOperator(
-                    op, std::move(left), std::move(right)), location, Optional<ExpressionInfo>());
-            } else {
+            const auto& info = operators[static_cast<std::size_t>(token.type)];
+            if (info.precedence == BinaryPrecedence::None
+            || info.precedence < minimumPrecedence
+            || info.precedence > maximumPrecedence) {
                 return left;
             }
-        }
-        return nullptr;
-    }
 
-    FwdUniquePtr<const Expression> Parser::parseMultiplication(ExpressionParseOptions options) {
-        // multiplication = cast (Multiply_op cast)*
-        FwdUniquePtr<const Expression> left;
+            const auto location = scanner->getLocation();
+            const auto nextPrecedence = static_cast<BinaryPrecedence>(static_cast<int>(info.precedence) + 1);
+            nextToken(); // operator token
+            auto right = parseBinaryOperators(options, nextPrecedence);
 
-        left = parseCast(options); // prefix
-        while (report->alive()) {
-            BinaryOperatorKind op = BinaryOperatorKind::None;
-            switch (token.type) {
-                case TokenType::Asterisk: op = BinaryOperatorKind::Multiplication; break;
-                case TokenType::Slash: op = BinaryOperatorKind::Division; break;
-                case TokenType::Percent: op = BinaryOperatorKind::Modulo; break;
-                default: op = BinaryOperatorKind::None; break;
-            }
+            if (info.precedence == BinaryPrecedence::Range) {
+                FwdUniquePtr<const Expression> step;
+                if (token.type == TokenType::Identifier && token.keyword == Keyword::By) {
+                    nextToken(); // IDENTIFIER (keyword `by`)
+                    step = parseBinaryOperators(options, nextPrecedence); // bitwise_or
+                }
 
-            if (op != BinaryOperatorKind::None) {
-                const auto location = scanner->getLocation();
-                nextToken(); // operator token
-                auto right = parseCast(options); // prefix
-                left = makeFwdUnique<const Expression>(Expression::BinaryOperator(
-                    op, std::move(left), std::move(right)), location, Optional<ExpressionInfo>());
+                left = makeFwdUnique<const Expression>(Expression::RangeLiteral(std::move(left), std::move(right), std::move(step)), location, Optional<ExpressionInfo>());
+                maximumPrecedence = BinaryPrecedence::Comparison;
             } else {
-                return left;
+                left = makeFwdUnique<const Expression>(Expression::BinaryOperator(
+                    info.op, std::move(left), std::move(right)), location, Optional<ExpressionInfo>());
             }
         }
         return nullptr;
@@ -1874,13 +1756,13 @@ namespace wiz {
 
                 if (token.type == TokenType::DoubleAmpersand) {
                     nextToken(); // `&&`
-                    auto comparison = parseComparison(options); // comparison
+                    auto comparison = parseBinaryOperators(options, BinaryPrecedence::Comparison); // comparison
                     auto left = makeFwdUnique<const Expression>(Expression::SideEffect(std::move(block), std::move(comparison)), location, Optional<ExpressionInfo>());
                     while (report->alive()) {
                         if (token.type == TokenType::DoubleAmpersand) {
                             const auto location = scanner->getLocation();
                             nextToken(); // operator token
-                            auto right = parseComparison(options); // comparison
+                            auto right = parseBinaryOperators(options, BinaryPrecedence::Comparison); // comparison
                             left = makeFwdUnique<const Expression>(Expression::BinaryOperator(
                                 BinaryOperatorKind::LogicalAnd, std::move(left), std::move(right)), location, Optional<ExpressionInfo>());
                         } else {
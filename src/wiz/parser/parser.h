@@ -37,6 +37,21 @@ namespace wiz {
     };
     WIZ_BITWISE_OVERLOADS(ExpressionParseOptions)
 
+    // Binding strength of the binary operators, from loosest to tightest.
+    enum class BinaryPrecedence {
+        None,
+        LogicalOr,
+        LogicalAnd,
+        Comparison,
+        Range,
+        BitwiseOr,
+        BitwiseXor,
+        BitwiseAnd,
+        Shift,
+        Addition,
+        Multiplication,
+    };
+
     class Parser {
         public:
             Parser(StringPool* stringPool, ImportManager* importManager, Report* report);
@@ -88,15 +103,7 @@ namespace wiz {
             FwdUniquePtr<const Expression> parseExpressionWithOptions(ExpressionParseOptions options);
             FwdUniquePtr<const Expression> parseAssignment(ExpressionParseOptions options);
             FwdUniquePtr<const Expression> parseLogicalOr(ExpressionParseOptions options);
-            FwdUniquePtr<const Expression> parseLogicalAnd(ExpressionParseOptions options);
-            FwdUniquePtr<const Expression> parseRange(ExpressionParseOptions options);
-            FwdUniquePtr<const Expression> parseComparison(ExpressionParseOptions options);
-            FwdUniquePtr<const Expression> parseBitwiseOr(ExpressionParseOptions options);
-            FwdUniquePtr<const Expression> parseBitwiseXor(ExpressionParseOptions options);
-            FwdUniquePtr<const Expression> parseBitwiseAnd(ExpressionParseOptions options);
-            FwdUniquePtr<const Expression> parseShift(ExpressionParseOptions options);
-            FwdUniquePtr<const Expression> parseAddition(ExpressionParseOptions options);
-            FwdUniquePtr<const Expression> parseMultiplication(ExpressionParseOptions options);
+            FwdUniquePtr<const Expression> parseBinaryOperators(ExpressionParseOptions options, BinaryPrecedence minimumPrecedence);
             FwdUniquePtr<const Expression> parseCast(ExpressionParseOptions options);
             FwdUniquePtr<const Expression> parsePrefix(ExpressionParseOptions options);
             FwdUniquePtr<const Expression> parsePostfix(ExpressionParseOptions options);
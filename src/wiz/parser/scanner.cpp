@@ -1,15 +1,65 @@
+#include <cstdint>
 #include <cstring>
 #include <utility>
 
 #include <wiz/utility/text.h>
+#include <wiz/utility/macros.h>
 #include <wiz/utility/report.h>
 #include <wiz/utility/reader.h>
+#include <wiz/utility/checksum.h>
 #include <wiz/parser/token.h>
 #include <wiz/parser/scanner.h>
 
 namespace wiz {
     namespace {
         const char* const ErrorText = "<error>";
+
+        enum CharacterClass : std::uint8_t {
+            Whitespace = 0x01,
+            IdentifierStart = 0x02,
+            IdentifierPart = 0x04,
+            DecimalDigit = 0x08,
+            HexadecimalDigit = 0x10,
+        };
+
+        struct CharacterClassTable {
+            std::uint8_t classes[256];
+        };
+
+        constexpr CharacterClassTable createCharacterClassTable() {
+            CharacterClassTable result {};
+            result.classes[static_cast<unsigned char>(' ')] = Whitespace;
+            result.classes[static_cast<unsigned char>('\t')] = Whitespace;
+            result.classes[static_cast<unsigned char>('\r')] = Whitespace;
+            result.classes[static_cast<unsigned char>('\n')] = Whitespace;
+            result.classes[static_cast<unsigned char>('_')] = IdentifierStart | IdentifierPart;
+            for (char c = 'a'; c <= 'z'; ++c) {
+                result.classes[static_cast<unsigned char>(c)] = IdentifierStart | IdentifierPart;
+            }
+            for (char c = 'A'; c <= 'Z'; ++c) {
+                result.classes[static_cast<unsigned char>(c)] = IdentifierStart | IdentifierPart;
+            }
+            for (char c = 'a'; c <= 'f'; ++c) {
+                result.classes[static_cast<unsigned char>(c)] |= HexadecimalDigit;
+            }
+            for (char c = 'A'; c <= 'F'; ++c) {
+                result.classes[static_cast<unsigned char>(c)] |= HexadecimalDigit;
+            }
+            for (char c = '0'; c <= '9'; ++c) {
+                result.classes[static_cast<unsigned char>(c)] = IdentifierPart | DecimalDigit | HexadecimalDigit;
+            }
+            return result;
+        }
+
+        constexpr auto characterClassTable = createCharacterClassTable();
+
+        WIZ_FORCE_INLINE bool hasCharacterClass(char c, std::uint8_t characterClass) {
+            return (characterClassTable.classes[static_cast<unsigned char>(c)] & characterClass) != 0;
+        }
+
+        WIZ_FORCE_INLINE std::uint8_t getHexadecimalDigitValue(char c) {
+            return static_cast<std::uint8_t>(c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10);
+        }
     }
 
     enum class Scanner::State {
@@ -72,7 +122,8 @@ namespace wiz {
     position(0),
     state(State::Start),
     baseTokenType(TokenType::None),
-    intermediateCharCode(0) {}
+    intermediateCharCode(0),
+    checksum(0) {}
 
     Scanner::~Scanner() {}
 
@@ -80,6 +131,10 @@ namespace wiz {
         return location;
     }
 
+    std::uint32_t Scanner::getChecksum() const {
+        return checksum;
+    }
+
     Token Scanner::next() {
         std::string text;
         while (true) {
@@ -87,6 +142,58 @@ namespace wiz {
                 char c = buffer[position];
                 switch (state) {
                     case State::Start:
+                        // Whitespace and identifiers are taken a whole run at a time.
+                        if (hasCharacterClass(c, Whitespace)) {
+                            do {
+                                position++;
+                            } while (position < buffer.length() && hasCharacterClass(buffer[position], Whitespace));
+                            continue;
+                        }
+                        if (hasCharacterClass(c, IdentifierStart)) {
+                            const auto start = position;
+                            do {
+                                position++;
+                            } while (position < buffer.length() && hasCharacterClass(buffer[position], IdentifierPart));
+
+                            // Usually the identifier can be interned straight from the line.
+                            // Every line but the last ends in a newline, so one that reaches the end of the buffer is at the end of the file.
+                            // Text is only left over here after an unterminated string, which the identifier is appended to.
+                            if (position == buffer.length() || text.length() != 0) {
+                                text.append(buffer, start, position - start);
+                                if (position == buffer.length()) {
+                                    state = State::Identifier;
+                                    continue;
+                                }
+
+                                state = State::Start;
+                                const auto internedText = stringPool->intern(text);
+                                return Token(TokenType::Identifier, findKeyword(internedText), internedText);
+                            }
+
+                            const auto internedText = stringPool->intern(StringView(buffer.data() + start, position - start));
+                            return Token(TokenType::Identifier, findKeyword(internedText), internedText);
+                        }
+
+                        // Plain decimal and hexadecimal numbers, the bulk of most data tables, are also taken whole, straight from the line.
+                        // Anything else (digit separators, suffixes, other radixes) goes through the states below.
+                        if (hasCharacterClass(c, DecimalDigit) && text.length() == 0) {
+                            const auto hexadecimal = c == '0' && position + 1 < buffer.length() && buffer[position + 1] == 'x';
+                            const auto digitClass = hexadecimal ? HexadecimalDigit : DecimalDigit;
+                            const auto start = position;
+                            auto end = position + (hexadecimal ? 2 : 1);
+                            while (end < buffer.length() && hasCharacterClass(buffer[end], digitClass)) {
+                                end++;
+                            }
+
+                            if (end < buffer.length()
+                            && !hasCharacterClass(buffer[end], IdentifierPart)
+                            && (!hexadecimal || end > start + 2)
+                            && (hexadecimal || c != '0' || end == start + 1)) {
+                                position = end;
+                                return Token(hexadecimal ? TokenType::Hexadecimal : TokenType::Integer, stringPool->intern(StringView(buffer.data() + start, end - start)));
+                            }
+                        }
+
                         switch (c) {
                             case '0':
                                 state = State::LeadingZero;
@@ -104,67 +211,10 @@ namespace wiz {
                                 state = State::IntegerDigits;
                                 text += c;
                                 break;
-                            case '_':
-                            case 'a':
-                            case 'b':
-                            case 'c':
-                            case 'd':
-                            case 'e':
-                            case 'f':
-                            case 'g':
-                            case 'h':
-                            case 'i':
-                            case 'j':
-                            case 'k':
-                            case 'l':
-                            case 'm':
-                            case 'n':
-                            case 'o':
-                            case 'p':
-                            case 'q':
-                            case 'r':
-                            case 's':
-                            case 't':
-                            case 'u':
-                            case 'v':
-                            case 'w':
-                            case 'x':
-                            case 'y':
-                            case 'z':
-                            case 'A':
-                            case 'B':
-                            case 'C':
-                            case 'D':
-                            case 'E':
-                            case 'F':
-                            case 'G':
-                            case 'H':
-                            case 'I':
-                            case 'J':
-                            case 'K':
-                            case 'L':
-                            case 'M':
-                            case 'N':
-                            case 'O':
-                            case 'P':
-                            case 'Q':
-                            case 'R':
-                            case 'S':
-                            case 'T':
-                            case 'U':
-                            case 'V':
-                            case 'W':
-                            case 'X':
-                            case 'Y':
-                            case 'Z':
-                                state = State::Identifier;
-                                text += c;
-                                break;
                             case '\'': case '\"':
                                 terminator = c;
                                 state = State::String;
                                 break;
-                            case ' ': case '\t': case '\r': case '\n': break;
                             case ':': position++; return Token(TokenType::Colon);
                             case ',': position++; return Token(TokenType::Comma);
                             case '.': state = State::Dot; break;
@@ -198,77 +248,12 @@ namespace wiz {
                         }
                         break;
                     case State::Identifier:
-                        switch (c) {
-                            case '_':
-                            case '0':
-                            case '1':
-                            case '2':
-                            case '3':
-                            case '4':
-                            case '5':
-                            case '6':
-                            case '7':
-                            case '8':
-                            case '9':
-                            case 'a':
-                            case 'b':
-                            case 'c':
-                            case 'd':
-                            case 'e':
-                            case 'f':
-                            case 'g':
-                            case 'h':
-                            case 'i':
-                            case 'j':
-                            case 'k':
-                            case 'l':
-                            case 'm':
-                            case 'n':
-                            case 'o':
-                            case 'p':
-                            case 'q':
-                            case 'r':
-                            case 's':
-                            case 't':
-                            case 'u':
-                            case 'v':
-                            case 'w':
-                            case 'x':
-                            case 'y':
-                            case 'z':
-                            case 'A':
-                            case 'B':
-                            case 'C':
-                            case 'D':
-                            case 'E':
-                            case 'F':
-                            case 'G':
-                            case 'H':
-                            case 'I':
-                            case 'J':
-                            case 'K':
-                            case 'L':
-                            case 'M':
-                            case 'N':
-                            case 'O':
-                            case 'P':
-                            case 'Q':
-                            case 'R':
-                            case 'S':
-                            case 'T':
-                            case 'U':
-                            case 'V':
-                            case 'W':
-                            case 'X':
-                            case 'Y':
-                            case 'Z':
-                                text += c;
-                                break;
-                            default: {
-                                state = State::Start;
-                                const auto internedText = stringPool->intern(text);
-                                return Token(TokenType::Identifier, findKeyword(internedText), internedText);
-                            }
+                        if (hasCharacterClass(c, IdentifierPart)) {
+                            text += c;
+                        } else {
+                            state = State::Start;
+                            const auto internedText = stringPool->intern(text);
+                            return Token(TokenType::Identifier, findKeyword(internedText), internedText);
                         }
                         break;
                     case State::String:
@@ -285,13 +270,16 @@ namespace wiz {
                                     }
                                 default: return Token(TokenType::String, stringPool->intern(text));
                             }
-                        } else switch (c) {
-                            case '\\':
-                                state = State::StringEscape;
-                                break;
-                            default:
-                                text += c;
-                                break;
+                        } else if (c == '\\') {
+                            state = State::StringEscape;
+                        } else {
+                            // Take everything up to the closing quote or the next escape at once.
+                            const auto start = position;
+                            do {
+                                position++;
+                            } while (position < buffer.length() && buffer[position] != terminator && buffer[position] != '\\');
+                            text.append(buffer, start, position - start);
+                            continue;
                         }
                         break;
                     case State::StringEscape:
@@ -317,77 +305,20 @@ namespace wiz {
                         break;
                     case State::HexEscapeFirstDigit: {
                         state = State::HexEscapeSecondDigit;
-                        switch (c) {
-                            case '0':
-                            case '1':
-                            case '2':
-                            case '3':
-                            case '4':
-                            case '5':
-                            case '6':
-                            case '7':
-                            case '8':
-                            case '9':
-                                intermediateCharCode = static_cast<std::uint8_t>(c - '0') << 4;
-                                break;
-                            case 'a':
-                            case 'b':
-                            case 'c':
-                            case 'd':
-                            case 'e':
-                            case 'f':
-                                intermediateCharCode = static_cast<std::uint8_t>(c - 'a' + 10) << 4;
-                                break;
-                            case 'A':
-                            case 'B':
-                            case 'C':
-                            case 'D':
-                            case 'E':
-                            case 'F':
-                                intermediateCharCode = static_cast<std::uint8_t>(c - 'A' + 10) << 4;
-                                break;
-                            default:
-                                state = State::String;
-                                report->error("hex escape `\\x` contains illegal character `" + std::string(1, c) + "`", location);
-                                break;
+                        if (hasCharacterClass(c, HexadecimalDigit)) {
+                            intermediateCharCode = static_cast<std::uint8_t>(getHexadecimalDigitValue(c) << 4);
+                        } else {
+                            state = State::String;
+                            report->error("hex escape `\\x` contains illegal character `" + std::string(1, c) + "`", location);
                         }
                         break;
                     }
                     case State::HexEscapeSecondDigit: {
                         state = State::String;
-                        switch (c) {
-                            case '0':
-                            case '1':
-                            case '2':
-                            case '3':
-                            case '4':
-                            case '5':
-                            case '6':
-                            case '7':
-                            case '8':
-                            case '9':
-                                text += static_cast<char>(intermediateCharCode | static_cast<std::uint8_t>(c - '0'));
-                                break;
-                            case 'a':
-                            case 'b':
-                            case 'c':
-                            case 'd':
-                            case 'e':
-                            case 'f':
-                                text += static_cast<char>(intermediateCharCode | static_cast<std::uint8_t>(c - 'a' + 10));
-                                break;
-                            case 'A':
-                            case 'B':
-                            case 'C':
-                            case 'D':
-                            case 'E':
-                            case 'F':
-                                text += static_cast<char>(intermediateCharCode | static_cast<std::uint8_t>(c - 'A' + 10));
-                                break;
-                            default:
-                                state = State::String;
-                                report->error("hex escape `\\x` contains illegal character `" + std::string(1, c) + "`", location);
-                                break;
+                        if (hasCharacterClass(c, HexadecimalDigit)) {
+                            text += static_cast<char>(intermediateCharCode | getHexadecimalDigitValue(c));
+                        } else {
+                            report->error("hex escape `\\x` contains illegal character `" + std::string(1, c) + "`", location);
                         }
                         break;
                     }
@@ -437,6 +368,9 @@ namespace wiz {
                             case '8':
                             case '9':
                                 text += c;
+                                while (position + 1 < buffer.length() && hasCharacterClass(buffer[position + 1], DecimalDigit)) {
+                                    text += buffer[++position];
+                                }
                                 break;
                             case 'u': case 'i':
                                 text += c;
@@ -449,33 +383,16 @@ namespace wiz {
                         }
                         break;
                     case State::HexadecimalDigits:
+                        if (hasCharacterClass(c, HexadecimalDigit)) {
+                            text += c;
+                            while (position + 1 < buffer.length() && hasCharacterClass(buffer[position + 1], HexadecimalDigit)) {
+                                text += buffer[++position];
+                            }
+                            break;
+                        }
                         switch (c) {
                             case '_':
                                 break;
-                            case '0':
-                            case '1':
-                            case '2':
-                            case '3':
-                            case '4':
-                            case '5':
-                            case '6':
-                            case '7':
-                            case '8':
-                            case '9':
-                            case 'a':
-                            case 'b':
-                            case 'c':
-                            case 'd':
-                            case 'e':
-                            case 'f':
-                            case 'A':
-                            case 'B':
-                            case 'C':
-                            case 'D':
-                            case 'E':
-                            case 'F':
-                                text += c;
-                                break;
                             case 'u': case 'i':
                                 text += c;
                                 baseTokenType = TokenType::Hexadecimal;
@@ -528,76 +445,11 @@ namespace wiz {
                         }
                         break;
                     case State::LiteralSuffix:
-                        switch (c) {
-                            case '_':
-                            case '0':
-                            case '1':
-                            case '2':
-                            case '3':
-                            case '4':
-                            case '5':
-                            case '6':
-                            case '7':
-                            case '8':
-                            case '9':
-                            case 'a':
-                            case 'b':
-                            case 'c':
-                            case 'd':
-                            case 'e':
-                            case 'f':
-                            case 'g':
-                            case 'h':
-                            case 'i':
-                            case 'j':
-                            case 'k':
-                            case 'l':
-                            case 'm':
-                            case 'n':
-                            case 'o':
-                            case 'p':
-                            case 'q':
-                            case 'r':
-                            case 's':
-                            case 't':
-                            case 'u':
-                            case 'v':
-                            case 'w':
-                            case 'x':
-                            case 'y':
-                            case 'z':
-                            case 'A':
-                            case 'B':
-                            case 'C':
-                            case 'D':
-                            case 'E':
-                            case 'F':
-                            case 'G':
-                            case 'H':
-                            case 'I':
-                            case 'J':
-                            case 'K':
-                            case 'L':
-                            case 'M':
-                            case 'N':
-                            case 'O':
-                            case 'P':
-                            case 'Q':
-                            case 'R':
-                            case 'S':
-                            case 'T':
-                            case 'U':
-                            case 'V':
-                            case 'W':
-                            case 'X':
-                            case 'Y':
-                            case 'Z':
-                                text += c;
-                                break;
-                            default: {
-                                state = State::Start;
-                                return Token(baseTokenType, Keyword::None, stringPool->intern(text));
-                            }
+                        if (hasCharacterClass(c, IdentifierPart)) {
+                            text += c;
+                        } else {
+                            state = State::Start;
+                            return Token(baseTokenType, Keyword::None, stringPool->intern(text));
                         }
                         break;
                     case State::Exclamation:
@@ -686,13 +538,21 @@ namespace wiz {
                                 return Token(TokenType::Slash);
                         }
                         break;
-                    case State::DoubleSlashComment: break;
-                    case State::SlashStarComment:
-                        switch (c) {
-                            case '*': state = State::SlashStarCommentStar;
-                            default: break;
-                        }
+                    case State::DoubleSlashComment:
+                        // The rest of the line is skipped.
+                        position = buffer.length();
+                        continue;
+                    case State::SlashStarComment: {
+                        // Comment bodies are skipped up to the next `*`.
+                        const auto star = buffer.find('*', position);
+                        if (star == std::string::npos) {
+                            position = buffer.length();
+                            continue;
+                        }
+                        position = star;
+                        state = State::SlashStarCommentStar;
                         break;
+                    }
                     case State::SlashStarCommentStar:
                         switch (c) {
                             case '/': state = State::Start; break;
@@ -853,6 +713,8 @@ namespace wiz {
             }
 
             if (reader && reader->isOpen() && reader->readLine(buffer)) {
+                checksum = checksum::crc32(checksum, reinterpret_cast<const std::uint8_t*>(buffer.data()), buffer.size());
+
                 // Special handling in states for end-of-line.
                 switch (state) {
                     case State::DoubleSlashComment:
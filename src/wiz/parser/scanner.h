@@ -22,6 +22,8 @@ namespace wiz {
             ~Scanner();
 
             SourceLocation getLocation() const;
+            // The CRC-32 of every line read so far, which covers the whole file once the scanner reaches the end.
+            std::uint32_t getChecksum() const;
             Token next();
 
         private:
@@ -37,6 +39,7 @@ namespace wiz {
             State state;
             TokenType baseTokenType;
             std::uint8_t intermediateCharCode;
+            std::uint32_t checksum;
 
             std::string buffer;
     };
@@ -1,12 +1,12 @@
+#include <cstddef>
 #include <cstring>
-#include <unordered_map>
 
 #include <wiz/parser/token.h>
 #include <wiz/utility/text.h>
 
 namespace wiz {
     namespace {
-        const char* const keywordNames[] = {
+        constexpr const char* keywordNames[] = {
             "(no keyword)",
             "alignof",
             "as",
@@ -59,6 +59,48 @@ namespace wiz {
 
         static_assert(sizeof(keywordNames) / sizeof(*keywordNames) == static_cast<std::size_t>(Keyword::Count), "`keywordNames` table must have an entry for every `Keyword`");
 
+        // Keywords are looked up for every identifier, so they're found with a perfect hash, checked when compiling.
+        // If a new keyword collides with another, search for new multipliers for `hashKeyword` that separate every keyword.
+        constexpr std::size_t KeywordHashTableSize = 128;
+
+        constexpr std::size_t hashKeyword(const char* text, std::size_t length) {
+            return (static_cast<std::size_t>(static_cast<unsigned char>(text[0])) * 15
+                + static_cast<std::size_t>(static_cast<unsigned char>(text[1])) * 56
+                + static_cast<std::size_t>(static_cast<unsigned char>(text[length - 1]))
+                + length * 16) % KeywordHashTableSize;
+        }
+
+        constexpr std::size_t getKeywordLength(const char* text) {
+            std::size_t length = 0;
+            while (text[length] != '\0') {
+                ++length;
+            }
+            return length;
+        }
+
+        struct KeywordHashTable {
+            Keyword keywords[KeywordHashTableSize];
+            bool perfect;
+        };
+
+        constexpr KeywordHashTable createKeywordHashTable() {
+            KeywordHashTable result {};
+            result.perfect = true;
+            for (std::size_t i = 1; i != sizeof(keywordNames) / sizeof(*keywordNames); ++i) {
+                const auto length = getKeywordLength(keywordNames[i]);
+                const auto index = hashKeyword(keywordNames[i], length);
+                if (length < 2 || result.keywords[index] != Keyword::None) {
+                    result.perfect = false;
+                }
+                result.keywords[index] = static_cast<Keyword>(i);
+            }
+            return result;
+        }
+
+        constexpr auto keywordHashTable = createKeywordHashTable();
+
+        static_assert(keywordHashTable.perfect, "`hashKeyword` must give every keyword a different slot in `keywordHashTable`");
+
         const char* const tokenNames[] = {
             "nothing",
             "end-of-file",
@@ -191,14 +233,14 @@ namespace wiz {
     }
 
     Keyword findKeyword(StringView text) {
-        static std::unordered_map<StringView, Keyword> keywords;
-        if (keywords.empty()) {
-            for (std::size_t i = 0; i != sizeof(keywordNames) / sizeof(*keywordNames); ++i) {
-                keywords[StringView(keywordNames[i])] = static_cast<Keyword>(i);
-            }
+        const auto length = text.getLength();
+        if (length < 2) {
+            return Keyword::None;
         }
 
-        const auto match = keywords.find(text);
-        return match != keywords.end() ? match->second : Keyword::None;
+        const auto keyword = keywordHashTable.keywords[hashKeyword(text.getData(), length)];
+        return keyword != Keyword::None && text == StringView(keywordNames[static_cast<std::size_t>(keyword)])
+            ? keyword
+            : Keyword::None;
     }
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include <cstddef>
 #include <unordered_map>
 #include <memory>
+#include <algorithm>
 
 #include <wiz/ast/expression.h>
 #include <wiz/ast/type_expression.h>
@@ -15,6 +16,7 @@
 #include <wiz/utility/report.h>
 #include <wiz/utility/misc.h>
 #include <wiz/platform/gb_platform.h>
+#include <wiz/platform/z80_platform.h>
 
 namespace wiz {
     GameBoyPlatform::GameBoyPlatform() {}
@@ -52,11 +54,11 @@ namespace wiz {
         const auto e = scope->createDefinition(nullptr, Definition::BuiltinRegister(u8Type), stringPool->intern("e"), decl);
         const auto h = scope->createDefinition(nullptr, Definition::BuiltinRegister(u8Type), stringPool->intern("h"), decl);
         const auto l = scope->createDefinition(nullptr, Definition::BuiltinRegister(u8Type), stringPool->intern("l"), decl);
-        const auto af = scope->createDefinition(nullptr, Definition::BuiltinRegister(u16Type), stringPool->intern("af"), decl);
+        af = scope->createDefinition(nullptr, Definition::BuiltinRegister(u16Type), stringPool->intern("af"), decl);
         const auto bc = scope->createDefinition(nullptr, Definition::BuiltinRegister(u16Type), stringPool->intern("bc"), decl);
         const auto de = scope->createDefinition(nullptr, Definition::BuiltinRegister(u16Type), stringPool->intern("de"), decl);
         const auto hl = scope->createDefinition(nullptr, Definition::BuiltinRegister(u16Type), stringPool->intern("hl"), decl);
-        const auto sp = scope->createDefinition(nullptr, Definition::BuiltinRegister(u16Type), stringPool->intern("sp"), decl);
+        sp = scope->createDefinition(nullptr, Definition::BuiltinRegister(u16Type), stringPool->intern("sp"), decl);
 
         builtins.addRegisterDecomposition(bc, {c, b});
         builtins.addRegisterDecomposition(de, {e, d});
@@ -81,8 +83,8 @@ namespace wiz {
         const auto patternInterrupt = builtins.createInstructionOperandPattern(InstructionOperandPattern::Register(scope->createDefinition(nullptr, Definition::BuiltinRegister(boolType), stringPool->intern("interrupt"), decl)));
 
         // Intrinsics.
-        const auto push = scope->createDefinition(nullptr, Definition::BuiltinVoidIntrinsic(), stringPool->intern("push"), decl);
-        const auto pop = scope->createDefinition(nullptr, Definition::BuiltinLoadIntrinsic(u16Type), stringPool->intern("pop"), decl);
+        push = scope->createDefinition(nullptr, Definition::BuiltinVoidIntrinsic(), stringPool->intern("push"), decl);
+        pop = scope->createDefinition(nullptr, Definition::BuiltinLoadIntrinsic(u16Type), stringPool->intern("pop"), decl);
         const auto nop = scope->createDefinition(nullptr, Definition::BuiltinVoidIntrinsic(), stringPool->intern("nop"), decl);
         const auto halt = scope->createDefinition(nullptr, Definition::BuiltinVoidIntrinsic(), stringPool->intern("halt"), decl);
         const auto stop = scope->createDefinition(nullptr, Definition::BuiltinVoidIntrinsic(), stringPool->intern("stop"), decl);
@@ -317,8 +319,8 @@ namespace wiz {
             builtins.createInstruction(InstructionSignature(InstructionType(BinaryOperatorKind::Assignment), 0, {destRegisterOperand, patternImmU8}), encodingU8Operand, InstructionOptions(opcode, {1}, {}));
         }
         // a = 0 (a = a ^ a)
-        // FIXME: xor clears the carry. sometimes, we don't want to clear the carry when loading 0 (eg. ld 0 followed by adc). need a way to disambiguate the instructions. for now disallow this optimization.
-        //builtins.createInstruction(InstructionSignature(InstructionType(BinaryOperatorKind::Assignment), 0, {patternA, pattern0}), encodingImplicit, InstructionOptions({0xAF}, {}, {}));
+        // xor clobbers the flags, so this is only used in place of ld a, 0 when the compiler can prove none of them are read afterwards (eg. ld 0 followed by adc keeps the ld).
+        builtins.createFlagClobberingInstruction(InstructionSignature(InstructionType(BinaryOperatorKind::Assignment), 0, {patternA, pattern0}), encodingImplicit, InstructionOptions({0xAF}, {}, {zero, carry}));
         // a = *(bc)
         // *(bc) = a
         builtins.createInstruction(InstructionSignature(InstructionType(BinaryOperatorKind::Assignment), 0, {patternA, patternIndirectBC}), encodingImplicit, InstructionOptions({0x0A}, {}, {}));
@@ -689,6 +691,24 @@ namespace wiz {
         return zero;
     }
 
+    bool GameBoyPlatform::isStackPointer(const Definition* definition) const {
+        return definition == sp;
+    }
+
+    int GameBoyPlatform::getStackEffect(const Definition* intrinsic) const {
+        if (intrinsic == push) {
+            return 2;
+        }
+        if (intrinsic == pop) {
+            return -2;
+        }
+        return 0;
+    }
+
+    PlatformFlagUsage GameBoyPlatform::getFlagUsage(const Instruction* instruction, const std::vector<InstructionOperandRoot>& operandRoots, const Definition* flag) const {
+        return getZ80FamilyFlagUsage(instruction, operandRoots, flag, a, af, carry, zero, cmp, bit);
+    }
+
     Int128 GameBoyPlatform::getPlaceholderValue() const {
         return Int128(UINT64_C(0xCCCCCCCCCCCCCCCC));
     }
@@ -14,6 +14,9 @@ namespace wiz {
             Definition* getFarPointerSizedType() const override;
             std::unique_ptr<PlatformTestAndBranch> getTestAndBranch(const Compiler& compiler, const Definition* type, BinaryOperatorKind op, const Expression* left, const Expression* right, std::size_t distanceHint) const override;
             Definition* getZeroFlag() const override;
+            PlatformFlagUsage getFlagUsage(const Instruction* instruction, const std::vector<InstructionOperandRoot>& operandRoots, const Definition* flag) const override;
+            bool isStackPointer(const Definition* definition) const override;
+            int getStackEffect(const Definition* intrinsic) const override;
             Int128 getPlaceholderValue() const override;
 
         private:
@@ -23,10 +26,15 @@ namespace wiz {
             Definition* farPointerSizedType = nullptr;
 
             Definition* a = nullptr;
+            Definition* af = nullptr;
             Definition* zero = nullptr;
             Definition* carry = nullptr;
             Definition* cmp = nullptr;
             Definition* bit = nullptr;
+
+            Definition* sp = nullptr;
+            Definition* push = nullptr;
+            Definition* pop = nullptr;
     };
 }
 
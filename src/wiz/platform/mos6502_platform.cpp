@@ -62,10 +62,11 @@ namespace wiz {
         a = scope->createDefinition(nullptr, Definition::BuiltinRegister(u8Type), stringPool->intern("a"), decl);
         x = scope->createDefinition(nullptr, Definition::BuiltinRegister(u8Type), stringPool->intern("x"), decl);
         y = scope->createDefinition(nullptr, Definition::BuiltinRegister(u8Type), stringPool->intern("y"), decl);
+        s = scope->createDefinition(nullptr, Definition::BuiltinRegister(u8Type), stringPool->intern("s"), decl);
         const auto patternA = builtins.createInstructionOperandPattern(InstructionOperandPattern::Register(a));
         const auto patternX = builtins.createInstructionOperandPattern(InstructionOperandPattern::Register(x));
         const auto patternY = builtins.createInstructionOperandPattern(InstructionOperandPattern::Register(y));
-        const auto patternS = builtins.createInstructionOperandPattern(InstructionOperandPattern::Register(scope->createDefinition(nullptr, Definition::BuiltinRegister(u8Type), stringPool->intern("s"), decl)));
+        const auto patternS = builtins.createInstructionOperandPattern(InstructionOperandPattern::Register(s));
         const auto patternP = builtins.createInstructionOperandPattern(InstructionOperandPattern::Register(scope->createDefinition(nullptr, Definition::BuiltinRegister(u8Type), stringPool->intern("p"), decl)));
         carry = scope->createDefinition(nullptr, Definition::BuiltinRegister(boolType), stringPool->intern("carry"), decl);
         zero = scope->createDefinition(nullptr, Definition::BuiltinRegister(boolType), stringPool->intern("zero"), decl);
@@ -83,8 +84,8 @@ namespace wiz {
         // Intrinsics.
         cmp = scope->createDefinition(nullptr, Definition::BuiltinVoidIntrinsic(), stringPool->intern("cmp"), decl);
         bit = scope->createDefinition(nullptr, Definition::BuiltinVoidIntrinsic(), stringPool->intern("bit"), decl);
-        const auto push = scope->createDefinition(nullptr, Definition::BuiltinVoidIntrinsic(), stringPool->intern("push"), decl);
-        const auto pop = scope->createDefinition(nullptr, Definition::BuiltinLoadIntrinsic(u8Type), stringPool->intern("pop"), decl);
+        push = scope->createDefinition(nullptr, Definition::BuiltinVoidIntrinsic(), stringPool->intern("push"), decl);
+        pop = scope->createDefinition(nullptr, Definition::BuiltinLoadIntrinsic(u8Type), stringPool->intern("pop"), decl);
         const auto irqcall = scope->createDefinition(nullptr, Definition::BuiltinVoidIntrinsic(), stringPool->intern("irqcall"), decl);
         const auto nop = scope->createDefinition(nullptr, Definition::BuiltinVoidIntrinsic(), stringPool->intern("nop"), decl);
         const auto debug_break = scope->createDefinition(nullptr, Definition::BuiltinVoidIntrinsic(), stringPool->intern("debug_break"), decl);
@@ -1073,6 +1074,20 @@ namespace wiz {
         return zero;
     }
 
+    bool Mos6502Platform::isStackPointer(const Definition* definition) const {
+        return definition == s;
+    }
+
+    int Mos6502Platform::getStackEffect(const Definition* intrinsic) const {
+        if (intrinsic == push) {
+            return 1;
+        }
+        if (intrinsic == pop) {
+            return -1;
+        }
+        return 0;
+    }
+
     Int128 Mos6502Platform::getPlaceholderValue() const {
         return Int128(UINT64_C(0xCCCCCCCCCCCCCCCC));
     }
@@ -22,6 +22,8 @@ namespace wiz {
             Definition* getFarPointerSizedType() const override;
             std::unique_ptr<PlatformTestAndBranch> getTestAndBranch(const Compiler& compiler, const Definition* type, BinaryOperatorKind op, const Expression* left, const Expression* right, std::size_t distanceHint) const override;
             Definition* getZeroFlag() const override;
+            bool isStackPointer(const Definition* definition) const override;
+            int getStackEffect(const Definition* intrinsic) const override;
             Int128 getPlaceholderValue() const override;
 
         private:
@@ -44,6 +46,10 @@ namespace wiz {
             Definition* bit = nullptr;
             Definition* tst = nullptr;
             Definition* tstbit = nullptr;
+
+            Definition* s = nullptr;
+            Definition* push = nullptr;
+            Definition* pop = nullptr;
     };
 }
 
@@ -7,6 +7,13 @@
 #include <wiz/platform/spc700_platform.h>
 
 namespace wiz {
+    PlatformFlagUsage Platform::getFlagUsage(const Instruction* instruction, const std::vector<InstructionOperandRoot>& operandRoots, const Definition* flag) const {
+        static_cast<void>(instruction);
+        static_cast<void>(operandRoots);
+        static_cast<void>(flag);
+        return PlatformFlagUsage::Unknown;
+    }
+
     PlatformCollection::PlatformCollection() {
         addPlatform("6502"_sv, std::make_unique<Mos6502Platform>(Mos6502Platform::Revision::Base6502));
         addPlatform("65c02"_sv, std::make_unique<Mos6502Platform>(Mos6502Platform::Revision::Base65C02));
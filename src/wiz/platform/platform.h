@@ -53,6 +53,17 @@ namespace wiz {
         std::vector<PlatformBranch> branches;
     };
 
+    enum class PlatformFlagUsage {
+        // The instruction leaves the flag alone.
+        None,
+        // The instruction reads the flag, or refers to it in some other way.
+        Read,
+        // The instruction overwrites the flag without reading it first.
+        Write,
+        // The platform doesn't know, so the flag must be assumed to be read.
+        Unknown,
+    };
+
     class Platform {
         public:
             virtual ~Platform() {}
@@ -62,6 +73,12 @@ namespace wiz {
             virtual Definition* getFarPointerSizedType() const = 0;
             virtual std::unique_ptr<PlatformTestAndBranch> getTestAndBranch(const Compiler& compiler, const Definition* type, BinaryOperatorKind op, const Expression* left, const Expression* right, std::size_t distanceHint) const = 0;
             virtual Definition* getZeroFlag() const = 0;
+            // How an instruction uses a flag. Platforms that don't describe their instructions leave every flag Unknown.
+            virtual PlatformFlagUsage getFlagUsage(const Instruction* instruction, const std::vector<InstructionOperandRoot>& operandRoots, const Definition* flag) const;
+            // Whether the register refers to the hardware stack pointer.
+            virtual bool isStackPointer(const Definition* definition) const = 0;
+            // The number of bytes an intrinsic pushes onto the stack, or negative if it pops them instead.
+            virtual int getStackEffect(const Definition* intrinsic) const = 0;
             virtual Int128 getPlaceholderValue() const = 0;
     };
 
@@ -76,8 +76,8 @@ namespace wiz {
         const auto patternNegative = builtins.createInstructionOperandPattern(InstructionOperandPattern::Register(negative));
 
         // Intrinsics.
-        const auto push = scope->createDefinition(nullptr, Definition::BuiltinVoidIntrinsic(), stringPool->intern("push"), decl);
-        const auto pop = scope->createDefinition(nullptr, Definition::BuiltinLoadIntrinsic(u16Type), stringPool->intern("pop"), decl);
+        push = scope->createDefinition(nullptr, Definition::BuiltinVoidIntrinsic(), stringPool->intern("push"), decl);
+        pop = scope->createDefinition(nullptr, Definition::BuiltinLoadIntrinsic(u16Type), stringPool->intern("pop"), decl);
         const auto nop = scope->createDefinition(nullptr, Definition::BuiltinVoidIntrinsic(), stringPool->intern("nop"), decl);
         const auto swap = scope->createDefinition(nullptr, Definition::BuiltinVoidIntrinsic(), stringPool->intern("swap"), decl);
         const auto swap_digits = scope->createDefinition(nullptr, Definition::BuiltinVoidIntrinsic(), stringPool->intern("swap_digits"), decl);
@@ -87,10 +87,10 @@ namespace wiz {
         const auto halt = scope->createDefinition(nullptr, Definition::BuiltinVoidIntrinsic(), stringPool->intern("halt"), decl);
         const auto stop = scope->createDefinition(nullptr, Definition::BuiltinVoidIntrinsic(), stringPool->intern("stop"), decl);
         const auto divmod = scope->createDefinition(nullptr, Definition::BuiltinVoidIntrinsic(), stringPool->intern("divmod"), decl);
-        const auto push_registers = scope->createDefinition(nullptr, Definition::BuiltinVoidIntrinsic(), stringPool->intern("push_registers"), decl);
-        const auto push_registers_ex = scope->createDefinition(nullptr, Definition::BuiltinVoidIntrinsic(), stringPool->intern("push_registers_ex"), decl);
-        const auto pop_registers = scope->createDefinition(nullptr, Definition::BuiltinVoidIntrinsic(), stringPool->intern("pop_registers"), decl);
-        const auto pop_registers_ex = scope->createDefinition(nullptr, Definition::BuiltinVoidIntrinsic(), stringPool->intern("pop_registers_ex"), decl);
+        push_registers = scope->createDefinition(nullptr, Definition::BuiltinVoidIntrinsic(), stringPool->intern("push_registers"), decl);
+        push_registers_ex = scope->createDefinition(nullptr, Definition::BuiltinVoidIntrinsic(), stringPool->intern("push_registers_ex"), decl);
+        pop_registers = scope->createDefinition(nullptr, Definition::BuiltinVoidIntrinsic(), stringPool->intern("pop_registers"), decl);
+        pop_registers_ex = scope->createDefinition(nullptr, Definition::BuiltinVoidIntrinsic(), stringPool->intern("pop_registers_ex"), decl);
         test = scope->createDefinition(nullptr, Definition::BuiltinVoidIntrinsic(), stringPool->intern("test"), decl);
         cmp = scope->createDefinition(nullptr, Definition::BuiltinVoidIntrinsic(), stringPool->intern("cmp"), decl);
 
@@ -778,6 +778,32 @@ namespace wiz {
         return zero;
     }
 
+    bool PokemonMiniPlatform::isStackPointer(const Definition* definition) const {
+        return definition == sp;
+    }
+
+    int PokemonMiniPlatform::getStackEffect(const Definition* intrinsic) const {
+        if (intrinsic == push) {
+            return 2;
+        }
+        if (intrinsic == pop) {
+            return -2;
+        }
+        if (intrinsic == push_registers) {
+            return 9;
+        }
+        if (intrinsic == pop_registers) {
+            return -9;
+        }
+        if (intrinsic == push_registers_ex) {
+            return 12;
+        }
+        if (intrinsic == pop_registers_ex) {
+            return -12;
+        }
+        return 0;
+    }
+
     Int128 PokemonMiniPlatform::getPlaceholderValue() const {
         return Int128(UINT64_C(0xCCCCCCCCCCCCCCCC));
     }
@@ -14,6 +14,8 @@ namespace wiz {
             Definition* getFarPointerSizedType() const override;
             std::unique_ptr<PlatformTestAndBranch> getTestAndBranch(const Compiler& compiler, const Definition* type, BinaryOperatorKind op, const Expression* left, const Expression* right, std::size_t distanceHint) const override;
             Definition* getZeroFlag() const override;
+            bool isStackPointer(const Definition* definition) const override;
+            int getStackEffect(const Definition* intrinsic) const override;
             Int128 getPlaceholderValue() const override;
 
         private:
@@ -32,6 +34,13 @@ namespace wiz {
             Definition* negative = nullptr;
             Definition* cmp = nullptr;
             Definition* test = nullptr;
+
+            Definition* push = nullptr;
+            Definition* pop = nullptr;
+            Definition* push_registers = nullptr;
+            Definition* pop_registers = nullptr;
+            Definition* push_registers_ex = nullptr;
+            Definition* pop_registers_ex = nullptr;
     };
 }
 
@@ -43,13 +43,14 @@ namespace wiz {
         x = scope->createDefinition(nullptr, Definition::BuiltinRegister(u8Type), stringPool->intern("x"), decl);
         y = scope->createDefinition(nullptr, Definition::BuiltinRegister(u8Type), stringPool->intern("y"), decl);
         ya = scope->createDefinition(nullptr, Definition::BuiltinRegister(u16Type), stringPool->intern("ya"), decl);
+        sp = scope->createDefinition(nullptr, Definition::BuiltinRegister(u8Type), stringPool->intern("sp"), decl);
 
         builtins.addRegisterDecomposition(ya, {a, y});
 
         const auto patternA = builtins.createInstructionOperandPattern(InstructionOperandPattern::Register(a));
         const auto patternX = builtins.createInstructionOperandPattern(InstructionOperandPattern::Register(x));
         const auto patternY = builtins.createInstructionOperandPattern(InstructionOperandPattern::Register(y));
-        const auto patternSP = builtins.createInstructionOperandPattern(InstructionOperandPattern::Register(scope->createDefinition(nullptr, Definition::BuiltinRegister(u8Type), stringPool->intern("sp"), decl)));
+        const auto patternSP = builtins.createInstructionOperandPattern(InstructionOperandPattern::Register(sp));
         const auto patternPSW = builtins.createInstructionOperandPattern(InstructionOperandPattern::Register(scope->createDefinition(nullptr, Definition::BuiltinRegister(u8Type), stringPool->intern("psw"), decl)));
         const auto patternYA = builtins.createInstructionOperandPattern(InstructionOperandPattern::Register(ya));
 
@@ -70,8 +71,8 @@ namespace wiz {
         const auto patternCarry = builtins.createInstructionOperandPattern(InstructionOperandPattern::Register(carry));
 
         // Intrinsics.
-        const auto push = scope->createDefinition(nullptr, Definition::BuiltinVoidIntrinsic(), stringPool->intern("push"), decl);
-        const auto pop = scope->createDefinition(nullptr, Definition::BuiltinLoadIntrinsic(u8Type), stringPool->intern("pop"), decl);
+        push = scope->createDefinition(nullptr, Definition::BuiltinVoidIntrinsic(), stringPool->intern("push"), decl);
+        pop = scope->createDefinition(nullptr, Definition::BuiltinLoadIntrinsic(u8Type), stringPool->intern("pop"), decl);
         const auto irqcall = scope->createDefinition(nullptr, Definition::BuiltinVoidIntrinsic(), stringPool->intern("irqcall"), decl);
         const auto nop = scope->createDefinition(nullptr, Definition::BuiltinVoidIntrinsic(), stringPool->intern("nop"), decl);
         const auto sleep = scope->createDefinition(nullptr, Definition::BuiltinVoidIntrinsic(), stringPool->intern("sleep"), decl);
@@ -877,6 +878,20 @@ namespace wiz {
         return zero;
     }
 
+    bool Spc700Platform::isStackPointer(const Definition* definition) const {
+        return definition == sp;
+    }
+
+    int Spc700Platform::getStackEffect(const Definition* intrinsic) const {
+        if (intrinsic == push) {
+            return 1;
+        }
+        if (intrinsic == pop) {
+            return -1;
+        }
+        return 0;
+    }
+
     Int128 Spc700Platform::getPlaceholderValue() const {
         return Int128(UINT64_C(0xCCCCCCCCCCCCCCCC));
     }
@@ -16,6 +16,8 @@ namespace wiz {
             Definition* getFarPointerSizedType() const override;
             std::unique_ptr<PlatformTestAndBranch> getTestAndBranch(const Compiler& compiler, const Definition* type, BinaryOperatorKind op, const Expression* left, const Expression* right, std::size_t distanceHint) const override;
             Definition* getZeroFlag() const override;
+            bool isStackPointer(const Definition* definition) const override;
+            int getStackEffect(const Definition* intrinsic) const override;
             Int128 getPlaceholderValue() const override;
 
         private:
@@ -37,6 +39,10 @@ namespace wiz {
 			Definition* cmp = nullptr;
 			Definition* cmp_branch_not_equal = nullptr;
 			Definition* dec_branch_not_zero = nullptr;
+
+			Definition* sp = nullptr;
+			Definition* push = nullptr;
+			Definition* pop = nullptr;
     };
 }
 
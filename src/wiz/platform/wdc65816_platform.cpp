@@ -48,10 +48,11 @@ namespace wiz {
         a = scope->createDefinition(nullptr, Definition::BuiltinRegister(u8Type), stringPool->intern("a"), decl);
         x = scope->createDefinition(nullptr, Definition::BuiltinRegister(u8Type), stringPool->intern("x"), decl);
         y = scope->createDefinition(nullptr, Definition::BuiltinRegister(u8Type), stringPool->intern("y"), decl);
+        s = scope->createDefinition(nullptr, Definition::BuiltinRegister(u8Type), stringPool->intern("s"), decl);
         const auto patternA = builtins.createInstructionOperandPattern(InstructionOperandPattern::Register(a));
         const auto patternX = builtins.createInstructionOperandPattern(InstructionOperandPattern::Register(x));
         const auto patternY = builtins.createInstructionOperandPattern(InstructionOperandPattern::Register(y));
-        const auto patternS = builtins.createInstructionOperandPattern(InstructionOperandPattern::Register(scope->createDefinition(nullptr, Definition::BuiltinRegister(u8Type), stringPool->intern("s"), decl)));
+        const auto patternS = builtins.createInstructionOperandPattern(InstructionOperandPattern::Register(s));
         const auto patternP = builtins.createInstructionOperandPattern(InstructionOperandPattern::Register(scope->createDefinition(nullptr, Definition::BuiltinRegister(u8Type), stringPool->intern("p"), decl)));
         const auto patternDirectPageRegister = builtins.createInstructionOperandPattern(InstructionOperandPattern::Register(scope->createDefinition(nullptr, Definition::BuiltinRegister(u16Type), stringPool->intern("direct_page"), decl)));
         const auto patternProgramBank = builtins.createInstructionOperandPattern(InstructionOperandPattern::Register(scope->createDefinition(nullptr, Definition::BuiltinRegister(u8Type), stringPool->intern("program_bank"), decl)));
@@ -60,10 +61,11 @@ namespace wiz {
         aa = scope->createDefinition(nullptr, Definition::BuiltinRegister(u16Type), stringPool->intern("aa"), decl);
         xx = scope->createDefinition(nullptr, Definition::BuiltinRegister(u16Type), stringPool->intern("xx"), decl);
         yy = scope->createDefinition(nullptr, Definition::BuiltinRegister(u16Type), stringPool->intern("yy"), decl);
+        ss = scope->createDefinition(nullptr, Definition::BuiltinRegister(u16Type), stringPool->intern("ss"), decl);
         const auto patternAA = builtins.createInstructionOperandPattern(InstructionOperandPattern::Register(aa));
         const auto patternXX = builtins.createInstructionOperandPattern(InstructionOperandPattern::Register(xx));
         const auto patternYY = builtins.createInstructionOperandPattern(InstructionOperandPattern::Register(yy));
-        const auto patternSS = builtins.createInstructionOperandPattern(InstructionOperandPattern::Register(scope->createDefinition(nullptr, Definition::BuiltinRegister(u16Type), stringPool->intern("ss"), decl)));
+        const auto patternSS = builtins.createInstructionOperandPattern(InstructionOperandPattern::Register(ss));
 
         carry = scope->createDefinition(nullptr, Definition::BuiltinRegister(boolType), stringPool->intern("carry"), decl);
         zero = scope->createDefinition(nullptr, Definition::BuiltinRegister(boolType), stringPool->intern("zero"), decl);
@@ -81,11 +83,11 @@ namespace wiz {
         // Intrinsics.
         cmp = scope->createDefinition(nullptr, Definition::BuiltinVoidIntrinsic(), stringPool->intern("cmp"), decl);
         bit = scope->createDefinition(nullptr, Definition::BuiltinVoidIntrinsic(), stringPool->intern("bit"), decl);
-        const auto push8 = scope->createDefinition(nullptr, Definition::BuiltinVoidIntrinsic(), stringPool->intern("push8"), decl);
-        const auto pop8 = scope->createDefinition(nullptr, Definition::BuiltinLoadIntrinsic(u8Type), stringPool->intern("pop8"), decl);
-        const auto push16 = scope->createDefinition(nullptr, Definition::BuiltinVoidIntrinsic(), stringPool->intern("push16"), decl);
-        const auto pop16 = scope->createDefinition(nullptr, Definition::BuiltinLoadIntrinsic(u16Type), stringPool->intern("pop16"), decl);
-        const auto push_rel16 = scope->createDefinition(nullptr, Definition::BuiltinVoidIntrinsic(), stringPool->intern("push_rel16"), decl);
+        push8 = scope->createDefinition(nullptr, Definition::BuiltinVoidIntrinsic(), stringPool->intern("push8"), decl);
+        pop8 = scope->createDefinition(nullptr, Definition::BuiltinLoadIntrinsic(u8Type), stringPool->intern("pop8"), decl);
+        push16 = scope->createDefinition(nullptr, Definition::BuiltinVoidIntrinsic(), stringPool->intern("push16"), decl);
+        pop16 = scope->createDefinition(nullptr, Definition::BuiltinLoadIntrinsic(u16Type), stringPool->intern("pop16"), decl);
+        push_rel16 = scope->createDefinition(nullptr, Definition::BuiltinVoidIntrinsic(), stringPool->intern("push_rel16"), decl);
         const auto irqcall = scope->createDefinition(nullptr, Definition::BuiltinVoidIntrinsic(), stringPool->intern("irqcall"), decl);
         const auto copcall = scope->createDefinition(nullptr, Definition::BuiltinVoidIntrinsic(), stringPool->intern("copcall"), decl);
         const auto nop = scope->createDefinition(nullptr, Definition::BuiltinVoidIntrinsic(), stringPool->intern("nop"), decl);
@@ -1375,6 +1377,29 @@ namespace wiz {
         return zero;
     }
 
+    bool Wdc65816Platform::isStackPointer(const Definition* definition) const {
+        return definition == s || definition == ss;
+    }
+
+    int Wdc65816Platform::getStackEffect(const Definition* intrinsic) const {
+        if (intrinsic == push8) {
+            return 1;
+        }
+        if (intrinsic == pop8) {
+            return -1;
+        }
+        if (intrinsic == push16) {
+            return 2;
+        }
+        if (intrinsic == pop16) {
+            return -2;
+        }
+        if (intrinsic == push_rel16) {
+            return 2;
+        }
+        return 0;
+    }
+
     Int128 Wdc65816Platform::getPlaceholderValue() const {
         return Int128(UINT64_C(0xCCCCCCCCCCCCCCCC));
     }
@@ -14,6 +14,8 @@ namespace wiz {
             Definition* getFarPointerSizedType() const override;
             std::unique_ptr<PlatformTestAndBranch> getTestAndBranch(const Compiler& compiler, const Definition* type, BinaryOperatorKind op, const Expression* left, const Expression* right, std::size_t distanceHint) const override;
             Definition* getZeroFlag() const override;
+            bool isStackPointer(const Definition* definition) const override;
+            int getStackEffect(const Definition* intrinsic) const override;
             Int128 getPlaceholderValue() const override;
 
         private:
@@ -42,6 +44,14 @@ namespace wiz {
 
             Definition* cmp = nullptr;
             Definition* bit = nullptr;
+
+            Definition* s = nullptr;
+            Definition* ss = nullptr;
+            Definition* push8 = nullptr;
+            Definition* pop8 = nullptr;
+            Definition* push16 = nullptr;
+            Definition* pop16 = nullptr;
+            Definition* push_rel16 = nullptr;
     };
 }
 
@@ -2,6 +2,7 @@
 #include <cstddef>
 #include <unordered_map>
 #include <memory>
+#include <algorithm>
 
 #include <wiz/ast/expression.h>
 #include <wiz/ast/type_expression.h>
@@ -57,11 +58,11 @@ namespace wiz {
         const auto ixl = scope->createDefinition(nullptr, Definition::BuiltinRegister(u8Type), stringPool->intern("ixl"), decl);
         const auto iyh = scope->createDefinition(nullptr, Definition::BuiltinRegister(u8Type), stringPool->intern("iyh"), decl);
         const auto iyl = scope->createDefinition(nullptr, Definition::BuiltinRegister(u8Type), stringPool->intern("iyl"), decl);
-        const auto af = scope->createDefinition(nullptr, Definition::BuiltinRegister(u16Type), stringPool->intern("af"), decl);
+        af = scope->createDefinition(nullptr, Definition::BuiltinRegister(u16Type), stringPool->intern("af"), decl);
         const auto bc = scope->createDefinition(nullptr, Definition::BuiltinRegister(u16Type), stringPool->intern("bc"), decl);
         const auto de = scope->createDefinition(nullptr, Definition::BuiltinRegister(u16Type), stringPool->intern("de"), decl);
         const auto hl = scope->createDefinition(nullptr, Definition::BuiltinRegister(u16Type), stringPool->intern("hl"), decl);
-        const auto sp = scope->createDefinition(nullptr, Definition::BuiltinRegister(u16Type), stringPool->intern("sp"), decl);
+        sp = scope->createDefinition(nullptr, Definition::BuiltinRegister(u16Type), stringPool->intern("sp"), decl);
         const auto ix = scope->createDefinition(nullptr, Definition::BuiltinRegister(u16Type), stringPool->intern("ix"), decl);
         const auto iy = scope->createDefinition(nullptr, Definition::BuiltinRegister(u16Type), stringPool->intern("iy"), decl);
 
@@ -95,7 +96,8 @@ namespace wiz {
         negative = scope->createDefinition(nullptr, Definition::BuiltinRegister(boolType), stringPool->intern("negative"), decl);
         const auto patternZero = builtins.createInstructionOperandPattern(InstructionOperandPattern::Register(zero));
         const auto patternCarry = builtins.createInstructionOperandPattern(InstructionOperandPattern::Register(carry));
-        const auto patternOverflow = builtins.createInstructionOperandPattern(InstructionOperandPattern::Register(scope->createDefinition(nullptr, Definition::BuiltinRegister(boolType), stringPool->intern("overflow"), decl)));
+        overflow = scope->createDefinition(nullptr, Definition::BuiltinRegister(boolType), stringPool->intern("overflow"), decl);
+        const auto patternOverflow = builtins.createInstructionOperandPattern(InstructionOperandPattern::Register(overflow));
         const auto patternNegative = builtins.createInstructionOperandPattern(InstructionOperandPattern::Register(negative));
         const auto patternInterrupt = builtins.createInstructionOperandPattern(InstructionOperandPattern::Register(scope->createDefinition(nullptr, Definition::BuiltinRegister(boolType), stringPool->intern("interrupt"), decl)));
         const auto patternInterruptMode = builtins.createInstructionOperandPattern(InstructionOperandPattern::Register(scope->createDefinition(nullptr, Definition::BuiltinRegister(u8Type), stringPool->intern("interrupt_mode"), decl)));
@@ -103,8 +105,8 @@ namespace wiz {
         const auto patternMemoryRefresh = builtins.createInstructionOperandPattern(InstructionOperandPattern::Register(scope->createDefinition(nullptr, Definition::BuiltinRegister(u8Type), stringPool->intern("memory_refresh"), decl)));
 
         // Intrinsics.
-        const auto push = scope->createDefinition(nullptr, Definition::BuiltinVoidIntrinsic(), stringPool->intern("push"), decl);
-        const auto pop = scope->createDefinition(nullptr, Definition::BuiltinLoadIntrinsic(u16Type), stringPool->intern("pop"), decl);
+        push = scope->createDefinition(nullptr, Definition::BuiltinVoidIntrinsic(), stringPool->intern("push"), decl);
+        pop = scope->createDefinition(nullptr, Definition::BuiltinLoadIntrinsic(u16Type), stringPool->intern("pop"), decl);
         const auto nop = scope->createDefinition(nullptr, Definition::BuiltinVoidIntrinsic(), stringPool->intern("nop"), decl);
         const auto halt = scope->createDefinition(nullptr, Definition::BuiltinVoidIntrinsic(), stringPool->intern("halt"), decl);
         const auto debug_break = scope->createDefinition(nullptr, Definition::BuiltinVoidIntrinsic(), stringPool->intern("debug_break"), decl);
@@ -482,8 +484,8 @@ namespace wiz {
             }
         }
         // a = 0 (a = a ^ a)
-        // FIXME: xor clears the carry. sometimes, we don't want to clear the carry when loading zero (eg. ld 0 followed by adc). need a way to disambiguate the instructions. for now disallow this optimization.
-        //builtins.emplaceInstruction(InstructionSignature(InstructionType(BinaryOperatorKind::Assignment), 0, {patternA, pattern0}), encodingImplicit, InstructionOptions({0xAF}, {}, {}));
+        // xor clobbers the flags, so this is only used in place of ld a, 0 when the compiler can prove none of them are read afterwards (eg. ld 0 followed by adc keeps the ld).
+        builtins.createFlagClobberingInstruction(InstructionSignature(InstructionType(BinaryOperatorKind::Assignment), 0, {patternA, pattern0}), encodingImplicit, InstructionOptions({0xAF}, {}, {zero, carry, negative, overflow}));
 
         // a = *(bc)
         // *(bc) = a
@@ -1126,6 +1128,123 @@ namespace wiz {
         return zero;
     }
 
+    bool Z80Platform::isStackPointer(const Definition* definition) const {
+        return definition == sp;
+    }
+
+    int Z80Platform::getStackEffect(const Definition* intrinsic) const {
+        if (intrinsic == push) {
+            return 2;
+        }
+        if (intrinsic == pop) {
+            return -2;
+        }
+        return 0;
+    }
+
+    PlatformFlagUsage getZ80FamilyFlagUsage(const Instruction* instruction, const std::vector<InstructionOperandRoot>& operandRoots, const Definition* flag,
+        const Definition* a, const Definition* af, const Definition* carry, const Definition* zero, const Definition* cmp, const Definition* bit) {
+        const auto isRegister = [&](std::size_t index, const Definition* reg) {
+            if (index < operandRoots.size()) {
+                if (const auto registerOperand = operandRoots[index].operand->tryGet<InstructionOperand::Register>()) {
+                    return registerOperand->definition == reg;
+                }
+            }
+            return false;
+        };
+        const auto& type = instruction->signature.type;
+
+        // carry = false
+        // carry = true
+        if (const auto binaryOperatorKind = type.tryGet<BinaryOperatorKind>()) {
+            if (*binaryOperatorKind == BinaryOperatorKind::Assignment && isRegister(0, flag) && operandRoots.size() == 2
+            && operandRoots[1].operand->kind == InstructionOperandKind::Boolean) {
+                return PlatformFlagUsage::Write;
+            }
+        }
+
+        // Anything else that mentions the flag or the af pair holding it (eg. conditional branches, carry = !carry, push(af)) might read it.
+        for (std::size_t i = 0; i != operandRoots.size(); ++i) {
+            if (isRegister(i, flag) || isRegister(i, af)) {
+                return PlatformFlagUsage::Read;
+            }
+        }
+
+        if (type.tryGet<BranchKind>() != nullptr) {
+            return PlatformFlagUsage::None;
+        }
+        if (const auto unaryOperatorKind = type.tryGet<UnaryOperatorKind>()) {
+            switch (*unaryOperatorKind) {
+                // inc r, dec r, inc rr, dec rr
+                case UnaryOperatorKind::PreIncrement:
+                case UnaryOperatorKind::PreDecrement: {
+                    const auto& affectedFlags = instruction->options.affectedFlags;
+                    return std::find(affectedFlags.begin(), affectedFlags.end(), flag) != affectedFlags.end() ? PlatformFlagUsage::Write : PlatformFlagUsage::None;
+                }
+                default:
+                    return PlatformFlagUsage::Unknown;
+            }
+        }
+        if (const auto binaryOperatorKind = type.tryGet<BinaryOperatorKind>()) {
+            switch (*binaryOperatorKind) {
+                // ld, and the bit set/reset instructions
+                case BinaryOperatorKind::Assignment:
+                    return PlatformFlagUsage::None;
+                // add, sub, and, xor, or
+                case BinaryOperatorKind::Addition:
+                case BinaryOperatorKind::Subtraction:
+                case BinaryOperatorKind::BitwiseAnd:
+                case BinaryOperatorKind::BitwiseXor:
+                case BinaryOperatorKind::BitwiseOr:
+                    if (isRegister(0, a)) {
+                        return PlatformFlagUsage::Write;
+                    }
+                    // 16-bit add only updates the carry.
+                    if (*binaryOperatorKind == BinaryOperatorKind::Addition) {
+                        return flag == carry ? PlatformFlagUsage::Write : PlatformFlagUsage::None;
+                    }
+                    return PlatformFlagUsage::Unknown;
+                // adc, sbc, rl, rr
+                case BinaryOperatorKind::AdditionWithCarry:
+                case BinaryOperatorKind::SubtractionWithCarry:
+                case BinaryOperatorKind::LeftRotateWithCarry:
+                case BinaryOperatorKind::RightRotateWithCarry:
+                    return flag == carry ? PlatformFlagUsage::Read : PlatformFlagUsage::Unknown;
+                // sla, sra, srl, rlc, rrc, add hl, hl
+                case BinaryOperatorKind::LeftShift:
+                case BinaryOperatorKind::LogicalLeftShift:
+                case BinaryOperatorKind::RightShift:
+                case BinaryOperatorKind::LogicalRightShift:
+                case BinaryOperatorKind::LeftRotate:
+                case BinaryOperatorKind::RightRotate:
+                    if (flag == carry && operandRoots.size() == 2) {
+                        // A shift by zero emits nothing, so it leaves the carry alone.
+                        if (const auto count = operandRoots[1].operand->tryGet<InstructionOperand::Integer>()) {
+                            return count->value > Int128(0) ? PlatformFlagUsage::Write : PlatformFlagUsage::None;
+                        }
+                    }
+                    return PlatformFlagUsage::Unknown;
+                default:
+                    return PlatformFlagUsage::Unknown;
+            }
+        }
+        if (const auto voidIntrinsic = type.tryGet<InstructionType::VoidIntrinsic>()) {
+            // cp
+            if (voidIntrinsic->definition == cmp && isRegister(0, a)) {
+                return PlatformFlagUsage::Write;
+            }
+            // bit
+            if (voidIntrinsic->definition == bit) {
+                return flag == carry ? PlatformFlagUsage::None : flag == zero ? PlatformFlagUsage::Write : PlatformFlagUsage::Unknown;
+            }
+        }
+        return PlatformFlagUsage::Unknown;
+    }
+
+    PlatformFlagUsage Z80Platform::getFlagUsage(const Instruction* instruction, const std::vector<InstructionOperandRoot>& operandRoots, const Definition* flag) const {
+        return getZ80FamilyFlagUsage(instruction, operandRoots, flag, a, af, carry, zero, cmp, bit);
+    }
+
     Int128 Z80Platform::getPlaceholderValue() const {
         return Int128(UINT64_C(0xCCCCCCCCCCCCCCCC));
     }
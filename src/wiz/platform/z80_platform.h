@@ -4,6 +4,11 @@
 #include <wiz/platform/platform.h>
 
 namespace wiz {
+    // The flag usage of the instruction forms that the Z80 and the Game Boy share.
+    // The definitions are the platform's own `a`, `af`, `carry` and `zero` registers, and its compare and bit test intrinsics.
+    PlatformFlagUsage getZ80FamilyFlagUsage(const Instruction* instruction, const std::vector<InstructionOperandRoot>& operandRoots, const Definition* flag,
+        const Definition* a, const Definition* af, const Definition* carry, const Definition* zero, const Definition* cmp, const Definition* bit);
+
     class Z80Platform : public Platform {
         public:
             Z80Platform();
@@ -14,6 +19,9 @@ namespace wiz {
             Definition* getFarPointerSizedType() const override;
             std::unique_ptr<PlatformTestAndBranch> getTestAndBranch(const Compiler& compiler, const Definition* type, BinaryOperatorKind op, const Expression* left, const Expression* right, std::size_t distanceHint) const override;
             Definition* getZeroFlag() const override;
+            PlatformFlagUsage getFlagUsage(const Instruction* instruction, const std::vector<InstructionOperandRoot>& operandRoots, const Definition* flag) const override;
+            bool isStackPointer(const Definition* definition) const override;
+            int getStackEffect(const Definition* intrinsic) const override;
             Int128 getPlaceholderValue() const override;
 
         private:
@@ -24,12 +32,18 @@ namespace wiz {
 
             Definition* a = nullptr;
             Definition* b = nullptr;
+            Definition* af = nullptr;
             Definition* zero = nullptr;
             Definition* carry = nullptr;
             Definition* negative = nullptr;
+            Definition* overflow = nullptr;
             Definition* cmp = nullptr;
             Definition* bit = nullptr;
             Definition* dec_branch_not_zero = nullptr;
+
+            Definition* sp = nullptr;
+            Definition* push = nullptr;
+            Definition* pop = nullptr;
     };
 }
 
@@ -0,0 +1,201 @@
+#include <cstring>
+
+#include <wiz/utility/checksum.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+
+    #define WIZ_CHECKSUM_SSE2
+#endif
+
+namespace wiz {
+    namespace checksum {
+        namespace {
+            std::uint64_t sumBytesScalar(const std::uint8_t* data, std::size_t length) {
+                const std::uint64_t evenLaneMask = UINT64_C(0x00FF00FF00FF00FF);
+                // Each 16-bit lane gains at most 2 * 255 per word, so it can take this many words before it needs folding.
+                const std::size_t maxWordsPerFold = 128;
+
+                std::uint64_t result = 0;
+                std::size_t i = 0;
+
+                // Sum 8 bytes at a time, by splitting each word into two sets of four 16-bit lanes.
+                while (length - i >= sizeof(std::uint64_t)) {
+                    std::uint64_t lanes = 0;
+                    for (std::size_t words = 0; words != maxWordsPerFold && length - i >= sizeof(std::uint64_t); ++words, i += sizeof(std::uint64_t)) {
+                        std::uint64_t word;
+                        std::memcpy(&word, data + i, sizeof(word));
+                        lanes += (word & evenLaneMask) + ((word >> 8) & evenLaneMask);
+                    }
+
+                    for (std::size_t lane = 0; lane != 4; ++lane) {
+                        result += (lanes >> (lane * 16)) & 0xFFFF;
+                    }
+                }
+
+                for (; i != length; ++i) {
+                    result += data[i];
+                }
+
+                return result;
+            }
+        }
+
+        std::uint64_t sumBytes(const std::uint8_t* data, std::size_t length) {
+#ifdef WIZ_CHECKSUM_SSE2
+            // psadbw against zero sums each group of 8 bytes into a 64-bit lane, so the accumulators never overflow.
+            const auto zero = _mm_setzero_si128();
+            auto lanes = _mm_setzero_si128();
+            std::size_t i = 0;
+
+            for (; length - i >= 16; i += 16) {
+                const auto block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+                lanes = _mm_add_epi64(lanes, _mm_sad_epu8(block, zero));
+            }
+
+            std::uint64_t laneSums[2];
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(laneSums), lanes);
+
+            return laneSums[0] + laneSums[1] + sumBytesScalar(data + i, length - i);
+#else
+            return sumBytesScalar(data, length);
+#endif
+        }
+
+        std::uint64_t sumBytes(ArrayView<std::uint8_t> data) {
+            return sumBytes(data.getData(), data.size());
+        }
+
+        std::uint32_t crc32(const std::uint8_t* data, std::size_t length) {
+            return crc32(0, data, length);
+        }
+
+        std::uint32_t crc32(std::uint32_t crc, const std::uint8_t* data, std::size_t length) {
+            // Slicing-by-8: entries[k][i] is the CRC of byte i followed by k zero bytes, so 8 bytes are folded in per step.
+            struct Table {
+                Table() {
+                    for (std::uint32_t i = 0; i != 256; ++i) {
+                        auto value = i;
+                        for (std::size_t bit = 0; bit != 8; ++bit) {
+                            value = (value & 1) != 0 ? (value >> 1) ^ UINT32_C(0xEDB88320) : value >> 1;
+                        }
+                        entries[0][i] = value;
+                    }
+                    for (std::uint32_t i = 0; i != 256; ++i) {
+                        for (std::size_t k = 1; k != 8; ++k) {
+                            entries[k][i] = entries[0][entries[k - 1][i] & 0xFF] ^ (entries[k - 1][i] >> 8);
+                        }
+                    }
+                }
+
+                std::uint32_t entries[8][256];
+            };
+            static const Table table;
+
+            std::uint32_t result = crc ^ UINT32_C(0xFFFFFFFF);
+            std::size_t i = 0;
+            for (; i + 8 <= length; i += 8) {
+                const auto low = result
+                    ^ (static_cast<std::uint32_t>(data[i])
+                    | (static_cast<std::uint32_t>(data[i + 1]) << 8)
+                    | (static_cast<std::uint32_t>(data[i + 2]) << 16)
+                    | (static_cast<std::uint32_t>(data[i + 3]) << 24));
+                result = table.entries[7][low & 0xFF]
+                    ^ table.entries[6][(low >> 8) & 0xFF]
+                    ^ table.entries[5][(low >> 16) & 0xFF]
+                    ^ table.entries[4][low >> 24]
+                    ^ table.entries[3][data[i + 4]]
+                    ^ table.entries[2][data[i + 5]]
+                    ^ table.entries[1][data[i + 6]]
+                    ^ table.entries[0][data[i + 7]];
+            }
+            for (; i != length; ++i) {
+                result = table.entries[0][(result ^ data[i]) & 0xFF] ^ (result >> 8);
+            }
+            return result ^ UINT32_C(0xFFFFFFFF);
+        }
+
+        std::string sha256(const std::uint8_t* data, std::size_t length) {
+            static const std::uint32_t roundConstants[64] = {
+                0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5, 0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+                0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3, 0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+                0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC, 0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+                0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7, 0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+                0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13, 0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+                0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3, 0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+                0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5, 0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+                0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208, 0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2,
+            };
+            std::uint32_t state[8] = {
+                0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A, 0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19,
+            };
+
+            const auto rotateRight = [](std::uint32_t value, unsigned int count) {
+                return (value >> count) | (value << (32 - count));
+            };
+
+            const auto processBlock = [&](const std::uint8_t* block) {
+                std::uint32_t words[64];
+                for (std::size_t i = 0; i != 16; ++i) {
+                    words[i] = (static_cast<std::uint32_t>(block[i * 4]) << 24)
+                        | (static_cast<std::uint32_t>(block[i * 4 + 1]) << 16)
+                        | (static_cast<std::uint32_t>(block[i * 4 + 2]) << 8)
+                        | static_cast<std::uint32_t>(block[i * 4 + 3]);
+                }
+                for (std::size_t i = 16; i != 64; ++i) {
+                    const auto s0 = rotateRight(words[i - 15], 7) ^ rotateRight(words[i - 15], 18) ^ (words[i - 15] >> 3);
+                    const auto s1 = rotateRight(words[i - 2], 17) ^ rotateRight(words[i - 2], 19) ^ (words[i - 2] >> 10);
+                    words[i] = words[i - 16] + s0 + words[i - 7] + s1;
+                }
+
+                std::uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4], f = state[5], g = state[6], h = state[7];
+                for (std::size_t i = 0; i != 64; ++i) {
+                    const auto t1 = h + (rotateRight(e, 6) ^ rotateRight(e, 11) ^ rotateRight(e, 25)) + ((e & f) ^ (~e & g)) + roundConstants[i] + words[i];
+                    const auto t2 = (rotateRight(a, 2) ^ rotateRight(a, 13) ^ rotateRight(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+                    h = g;
+                    g = f;
+                    f = e;
+                    e = d + t1;
+                    d = c;
+                    c = b;
+                    b = a;
+                    a = t1 + t2;
+                }
+
+                state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+                state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+            };
+
+            std::size_t i = 0;
+            for (; length - i >= 64; i += 64) {
+                processBlock(data + i);
+            }
+
+            // Pad the rest with a single 1 bit, zeroes, and the message length in bits, to a multiple of the block size.
+            std::uint8_t tail[128] = {0};
+            const auto remaining = length - i;
+            std::memcpy(tail, data + i, remaining);
+            tail[remaining] = 0x80;
+
+            const auto tailLength = remaining + 1 + 8 <= 64 ? std::size_t(64) : std::size_t(128);
+            const auto bitLength = static_cast<std::uint64_t>(length) * 8;
+            for (std::size_t j = 0; j != 8; ++j) {
+                tail[tailLength - 1 - j] = static_cast<std::uint8_t>(bitLength >> (j * 8));
+            }
+
+            for (std::size_t j = 0; j != tailLength; j += 64) {
+                processBlock(tail + j);
+            }
+
+            static const char hexDigits[] = "0123456789abcdef";
+            std::string result;
+            result.reserve(64);
+            for (const auto word : state) {
+                for (std::size_t shift = 32; shift != 0; shift -= 4) {
+                    result += hexDigits[(word >> (shift - 4)) & 0xF];
+                }
+            }
+            return result;
+        }
+    }
+}
@@ -0,0 +1,28 @@
+#ifndef WIZ_UTILITY_CHECKSUM_H
+#define WIZ_UTILITY_CHECKSUM_H
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+#include <wiz/utility/macros.h>
+#include <wiz/utility/array_view.h>
+
+namespace wiz {
+    namespace checksum {
+        // Returns the sum of every byte in the range.
+        // The result is wide enough to never overflow, so callers can truncate it to the width of their checksum.
+        std::uint64_t sumBytes(const std::uint8_t* data, std::size_t length);
+        std::uint64_t sumBytes(ArrayView<std::uint8_t> data);
+
+        // Returns the CRC-32 (the polynomial used by zip and png) of the range.
+        std::uint32_t crc32(const std::uint8_t* data, std::size_t length);
+        // Continues a CRC-32 returned by an earlier call, as if its range and this one had been checksummed together.
+        std::uint32_t crc32(std::uint32_t crc, const std::uint8_t* data, std::size_t length);
+
+        // Returns the SHA-256 digest of the range, as 64 lowercase hexadecimal digits.
+        std::string sha256(const std::uint8_t* data, std::size_t length);
+    }
+}
+
+#endif
@@ -30,6 +30,18 @@ namespace wiz {
         currentPath = value;
     }
 
+    const std::vector<StringView>& ImportManager::getImportedPaths() const {
+        return importedPaths;
+    }
+
+    const std::unordered_map<StringView, std::uint32_t>& ImportManager::getSourceChecksums() const {
+        return sourceChecksums;
+    }
+
+    void ImportManager::setSourceChecksum(StringView canonicalPath, std::uint32_t checksum) {
+        sourceChecksums[canonicalPath] = checksum;
+    }
+
     ImportResult ImportManager::attemptAbsoluteImport(StringView originalPath, StringView attemptedPath, ImportOptions importOptions, StringView& displayPath, StringView& canonicalPath, std::unique_ptr<Reader>& reader) {
         static_cast<void>(originalPath);
         const auto appendExtension = (importOptions & ImportOptions::AppendExtension) != ImportOptions::None;
@@ -60,6 +72,7 @@ namespace wiz {
             reader = resourceManager->openReader(canonicalPath, allowShellResources);
             if (reader != nullptr && reader->isOpen()) {
                 alreadyImportedPaths.insert(canonicalPath);
+                importedPaths.push_back(canonicalPath);
                 
                 return ImportResult::JustImported;
             } else {
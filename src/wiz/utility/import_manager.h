@@ -2,6 +2,9 @@
 #define WIZ_UTILITY_IMPORT_MANAGER_H
 
 #include <memory>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
 #include <unordered_set>
 
 #include <wiz/utility/array_view.h>
@@ -30,6 +33,13 @@ namespace wiz {
             StringView getCurrentPath() const;
             void setCurrentPath(StringView value);
 
+            // The canonical path of every file that was opened, in the order they were first imported.
+            const std::vector<StringView>& getImportedPaths() const;
+
+            // The CRC-32 of every source file that was parsed, keyed by canonical path.
+            const std::unordered_map<StringView, std::uint32_t>& getSourceChecksums() const;
+            void setSourceChecksum(StringView canonicalPath, std::uint32_t checksum);
+
             ImportResult attemptAbsoluteImport(StringView originalPath, StringView attemptedPath, ImportOptions importOptions, StringView& displayPath, StringView& canonicalPath, std::unique_ptr<Reader>& reader);
             ImportResult attemptRelativeImport(StringView originalPath, ImportOptions importOptions, StringView& displayPath, StringView& canonicalPath, std::unique_ptr<Reader>& reader);
             ImportResult importModule(StringView originalPath, ImportOptions importOptions, StringView& displayPath, StringView& canonicalPath, std::unique_ptr<Reader>& reader);
@@ -42,6 +52,8 @@ namespace wiz {
             StringView startPath;
             StringView currentPath;
             std::unordered_set<StringView> alreadyImportedPaths;
+            std::vector<StringView> importedPaths;
+            std::unordered_map<StringView, std::uint32_t> sourceChecksums;
     };
 }
 
@@ -14,8 +14,18 @@
 #include <iostream>
 #endif
 
+// Use the compiler's 128-bit integer type for the slow paths (multiplication, division), where available.
+#if defined(__SIZEOF_INT128__) && !defined(WIZ_UTILITY_INT128_NO_NATIVE)
+#define WIZ_UTILITY_INT128_NATIVE
+#endif
+
 namespace wiz {
     struct Int128 {
+#ifdef WIZ_UTILITY_INT128_NATIVE
+        __extension__ typedef unsigned __int128 NativeUnsigned;
+        __extension__ typedef __int128 NativeSigned;
+#endif
+
         static_assert(sizeof(int) <= sizeof(std::uint64_t), "wiz::Int128(int) constructor assumes sizeof(int) <= sizeof(std::uint64_t) currently.");
         static_assert(sizeof(long) <= sizeof(std::uint64_t), "wiz::Int128(long) constructor assumes sizeof(long) <= sizeof(std::uint64_t) currently.");
         static_assert(sizeof(long long) <= sizeof(std::uint64_t), "wiz::Int128(long long) constructor assumes sizeof(long long) <= sizeof(std::uint64_t) currently.");
@@ -167,6 +177,21 @@ namespace wiz {
             return (high & 0x8000000000000000) != 0;
         }
 
+        // Most values fit in 64 bits, and arithmetic on them can skip the general 128-bit paths.
+        bool isInt64() const {
+            return high == ((low & 0x8000000000000000) != 0 ? UINT64_MAX : 0);
+        }
+
+#ifdef WIZ_UTILITY_INT128_NATIVE
+        static Int128 fromNative(NativeUnsigned value) {
+            return Int128(static_cast<std::uint64_t>(value), static_cast<std::uint64_t>(value >> 64));
+        }
+
+        NativeUnsigned toNative() const {
+            return (static_cast<NativeUnsigned>(high) << 64) | low;
+        }
+#endif
+
         Int128 getAbsoluteValue() const {
             return isNegative() ? -*this : *this;
         }
@@ -254,7 +279,15 @@ namespace wiz {
                 return {zero(), *this};
             } else if (high == 0 && other.high == 0) {
                 return {Int128(low / other.low, 0), Int128(low % other.low, 0)};
-            } else {
+            }
+#ifdef WIZ_UTILITY_INT128_NATIVE
+            else if (!isNegative() && !other.isNegative()) {
+                const auto dividend = toNative();
+                const auto divisor = other.toNative();
+                return {fromNative(dividend / divisor), fromNative(dividend % divisor)};
+            }
+#endif
+            else {
                 auto quotient = zero();
                 auto remainder = zero();
                 for (std::size_t i = findMostSignificantBit() + 1; i-- > 0;) {
@@ -270,6 +303,23 @@ namespace wiz {
         }
 
         std::pair<Int128, Int128> divisionWithRemainder(Int128 other) const {
+            if (isInt64() && other.isInt64() && !other.isZero()) {
+                const auto dividend = static_cast<std::int64_t>(low);
+                const auto divisor = static_cast<std::int64_t>(other.low);
+                // INT64_MIN / -1 doesn't fit in 64 bits.
+                if (dividend != INT64_MIN || divisor != -1) {
+                    return {Int128(dividend / divisor), Int128(dividend % divisor)};
+                }
+            }
+
+#ifdef WIZ_UTILITY_INT128_NATIVE
+            if (!other.isZero() && (*this != minValue() || other != Int128(-1))) {
+                const auto dividend = static_cast<NativeSigned>(toNative());
+                const auto divisor = static_cast<NativeSigned>(other.toNative());
+                return {fromNative(static_cast<NativeUnsigned>(dividend / divisor)), fromNative(static_cast<NativeUnsigned>(dividend % divisor))};
+            }
+#endif
+
             if (isNegative()) {
                 const auto negativeThis = -*this;
                 if (other.isNegative()) {
@@ -359,6 +409,11 @@ namespace wiz {
         };
 
         std::pair<CheckedArithmeticResult, Int128> checkedAdd(Int128 other) const {
+            // The sum of two 64-bit values always fits.
+            if (isInt64() && other.isInt64()) {
+                return {CheckedArithmeticResult::Success, *this + other};
+            }
+
             if (isNegative()) {
                 if (other.isNegative() && *this < minValue() - other) {
                     return {CheckedArithmeticResult::OverflowError, zero()};
@@ -372,6 +427,10 @@ namespace wiz {
         }
 
         std::pair<CheckedArithmeticResult, Int128> checkedSubtract(Int128 other) const {
+            if (isInt64() && other.isInt64()) {
+                return {CheckedArithmeticResult::Success, *this - other};
+            }
+
             if (isNegative()) {
                 if (!other.isNegative() && *this < minValue() + other) {
                     return {CheckedArithmeticResult::OverflowError, zero()};
@@ -385,7 +444,18 @@ namespace wiz {
         }
 
         std::pair<CheckedArithmeticResult, Int128> checkedMultiply(Int128 other) const {
-            Int128 result;
+            // The product of two 64-bit values always fits, so there's no need for the division-based overflow checks below.
+            if (isInt64() && other.isInt64()) {
+                return {CheckedArithmeticResult::Success, *this * other};
+            }
+
+#if defined(WIZ_UTILITY_INT128_NATIVE) && defined(__GNUC__)
+            NativeSigned product;
+            if (__builtin_mul_overflow(static_cast<NativeSigned>(toNative()), static_cast<NativeSigned>(other.toNative()), &product)) {
+                return {CheckedArithmeticResult::OverflowError, Int128()};
+            }
+            return {CheckedArithmeticResult::Success, fromNative(static_cast<NativeUnsigned>(product))};
+#else
             if (isZero() || other.isZero()) {
                 return {CheckedArithmeticResult::Success, Int128()};
             }
@@ -414,6 +484,7 @@ namespace wiz {
             }
 
             return {CheckedArithmeticResult::Success, *this * other};
+#endif
         }
 
 
@@ -616,9 +687,13 @@ namespace wiz {
                 return *this;
             } else if (isZero() || other.isZero()) {
                 return Int128();
-            } else if (((high == 0 || high == UINT64_MAX) && low <= UINT32_MAX) && ((other.high == 0 || other.high == UINT64_MAX) && other.low <= UINT32_MAX)) {
-                return Int128(low * other.low, (high == UINT64_MAX) != (other.high == UINT64_MAX) ? UINT64_MAX : 0);
+            } else if (high == 0 && low <= UINT32_MAX && other.high == 0 && other.low <= UINT32_MAX) {
+                return Int128(low * other.low, 0);
             } else {
+#ifdef WIZ_UTILITY_INT128_NATIVE
+                // Wraps modulo 2^128, the same as the long multiplication below.
+                return fromNative(toNative() * other.toNative());
+#else
                 // First do a 64 x 64 -> 128-bit multiply.
                 //
                 // a * b
@@ -645,6 +720,7 @@ namespace wiz {
                 const auto z = ah * bl;
                 const auto w = ah * bh;
                 return Int128(x, 0) + Int128(y << 32, y >> 32) + Int128(z << 32, z >> 32) + Int128(0, w + low * other.high + high * other.low);
+#endif
             }
         }
 
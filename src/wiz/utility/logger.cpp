@@ -350,4 +350,42 @@ namespace wiz {
     : location(location), severity(severity), message(message) {}
 
     MemoryLogger::ErrorMessage::~ErrorMessage() {}
-}
\ No newline at end of file
+
+
+
+    BufferedLogger::BufferedLogger(LoggerColorSetting colorSetting)
+    : colorSetting(colorSetting) {}
+
+    BufferedLogger::~BufferedLogger() {}
+
+    void BufferedLogger::log(const std::string& message) {
+        messages.push_back(Message(MessageKind::Log, SourceLocation(), ReportErrorSeverity::Error, message));
+    }
+
+    void BufferedLogger::error(const SourceLocation& location, ReportErrorSeverity severity, const std::string& message) {
+        messages.push_back(Message(MessageKind::Error, location, severity, message));
+    }
+
+    void BufferedLogger::notice(const std::string& message) {
+        messages.push_back(Message(MessageKind::Notice, SourceLocation(), ReportErrorSeverity::Error, message));
+    }
+
+    LoggerColorSetting BufferedLogger::getColorSetting() const {
+        return colorSetting;
+    }
+
+    void BufferedLogger::setColorSetting(LoggerColorSetting value) {
+        colorSetting = value;
+    }
+
+    void BufferedLogger::replay(Logger* logger) {
+        for (const auto& message : messages) {
+            switch (message.kind) {
+                case MessageKind::Log: logger->log(message.text); break;
+                case MessageKind::Error: logger->error(message.location, message.severity, message.text); break;
+                case MessageKind::Notice: logger->notice(message.text); break;
+            }
+        }
+        messages.clear();
+    }
+}
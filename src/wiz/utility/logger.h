@@ -95,6 +95,51 @@ namespace wiz {
             std::vector<ErrorMessage> errors;
             std::vector<std::string> notices;
     };
+
+    // Holds messages in the order they were logged, until they are replayed to another logger.
+    // Lets work running on another thread report without interleaving its messages with everyone else's.
+    class BufferedLogger : public Logger {
+        public:
+            BufferedLogger(LoggerColorSetting colorSetting);
+            virtual ~BufferedLogger() override;
+
+            virtual void log(const std::string& message) override;
+            virtual void error(const SourceLocation& location, ReportErrorSeverity severity, const std::string& message) override;
+            virtual void notice(const std::string& message) override;
+
+            virtual LoggerColorSetting getColorSetting() const override;
+            virtual void setColorSetting(LoggerColorSetting value) override;
+
+            // Sends every buffered message to the logger, and empties the buffer.
+            void replay(Logger* logger);
+
+        private:
+            enum class MessageKind {
+                Log,
+                Error,
+                Notice,
+            };
+
+            struct Message {
+                Message(
+                    MessageKind kind,
+                    const SourceLocation& location,
+                    ReportErrorSeverity severity,
+                    const std::string& text)
+                : kind(kind),
+                location(location),
+                severity(severity),
+                text(text) {}
+
+                MessageKind kind;
+                SourceLocation location;
+                ReportErrorSeverity severity;
+                std::string text;
+            };
+
+            LoggerColorSetting colorSetting;
+            std::vector<Message> messages;
+    };
 }
 
 #endif
@@ -20,11 +20,13 @@ namespace wiz {
             char shortname,
             bool parameterized,
             const char* parameterName,
-            const char* description)
+            const char* description,
+            bool parameterOptional = false)
         : type(type),
         longname(longname),
         shortname(shortname),
         parameterized(parameterized),
+        parameterOptional(parameterOptional),
         parameterName(parameterName),
         description(description) {}
 
@@ -32,6 +34,8 @@ namespace wiz {
         StringView longname;
         char shortname;
         bool parameterized;
+        // If set, the parameter can only be given with `--name=value`, and the option can be used without one.
+        bool parameterOptional;
         StringView parameterName;
         StringView description;
     };
@@ -130,6 +134,9 @@ namespace wiz {
                                         if (hasValue) {
                                             options.emplace_back(definition->type, value);
                                             activeOption = 0;
+                                        } else if (definition->parameterOptional) {
+                                            options.emplace_back(definition->type, StringView());
+                                            activeOption = 0;
                                         }
                                     } else {
                                         if (hasValue) {
@@ -0,0 +1,48 @@
+#include <wiz/utility/parallel.h>
+
+#if !defined(__EMSCRIPTEN__) && !defined(WIZ_NO_THREADS)
+    #include <atomic>
+    #include <thread>
+    #include <vector>
+    #include <algorithm>
+
+    #define WIZ_PARALLEL_THREADS
+#endif
+
+namespace wiz {
+    namespace parallel {
+        void forEach(std::size_t count, const std::function<void(std::size_t)>& func) {
+#ifdef WIZ_PARALLEL_THREADS
+            const auto hardwareThreads = static_cast<std::size_t>(std::max(std::thread::hardware_concurrency(), 1U));
+            const auto workerCount = std::min(count, hardwareThreads);
+
+            if (workerCount > 1) {
+                std::atomic<std::size_t> nextIndex(0);
+                const auto work = [&]() {
+                    for (auto i = nextIndex++; i < count; i = nextIndex++) {
+                        func(i);
+                    }
+                };
+
+                // The calling thread takes a share of the work too, so only spawn the remaining workers.
+                std::vector<std::thread> workers;
+                workers.reserve(workerCount - 1);
+                for (std::size_t i = 1; i != workerCount; ++i) {
+                    workers.emplace_back(work);
+                }
+
+                work();
+
+                for (auto& worker : workers) {
+                    worker.join();
+                }
+                return;
+            }
+#endif
+
+            for (std::size_t i = 0; i != count; ++i) {
+                func(i);
+            }
+        }
+    }
+}
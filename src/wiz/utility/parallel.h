@@ -0,0 +1,16 @@
+#ifndef WIZ_UTILITY_PARALLEL_H
+#define WIZ_UTILITY_PARALLEL_H
+
+#include <cstddef>
+#include <functional>
+
+namespace wiz {
+    namespace parallel {
+        // Calls func(i) once for every i in [0, count), spreading the calls across worker threads when threads are available.
+        // Calls for different indices may run concurrently, so func must only write state owned by its index.
+        // Returns after every call has finished.
+        void forEach(std::size_t count, const std::function<void(std::size_t)>& func);
+    }
+}
+
+#endif
@@ -1,11 +1,22 @@
 #if defined(_WIN32)
     #include <direct.h>
+    #include <wiz/utility/win32.h>
     #define GETCWD _getcwd
 #elif !defined(__EMSCRIPTEN__)
     #include <unistd.h>
     #define GETCWD getcwd
 #endif
 
+#if !defined(_WIN32)
+    #include <sys/stat.h>
+#endif
+
+#if defined(__APPLE__)
+    #include <cstdint>
+    #include <mach-o/dyld.h>
+#endif
+
+#include <cerrno>
 #include <cstdlib>
 #include <numeric>
 #include <vector>
@@ -41,6 +52,38 @@ namespace wiz {
             return "";
         }
 
+        std::string getExecutablePath() {
+#if defined(_WIN32)
+            char buffer[MAX_PATH];
+            const auto length = GetModuleFileNameA(nullptr, buffer, MAX_PATH);
+            if (length != 0 && length < MAX_PATH) {
+                return std::string(buffer, length);
+            }
+#elif defined(__APPLE__)
+            std::uint32_t size = 0;
+            _NSGetExecutablePath(nullptr, &size);
+            std::string result(size, '\0');
+            if (size != 0 && _NSGetExecutablePath(&result[0], &size) == 0) {
+                return std::string(result.c_str());
+            }
+#elif defined(__linux__)
+            // Reading this link opens the executable itself, even if it was moved or deleted since it started.
+            return "/proc/self/exe";
+#endif
+
+            return "";
+        }
+
+        bool createDirectory(StringView path) {
+            const auto name = path.toString();
+#if defined(_WIN32)
+            const auto result = _mkdir(name.c_str());
+#else
+            const auto result = mkdir(name.c_str(), 0777);
+#endif
+            return result == 0 || errno == EEXIST;
+        }
+
         // Converts a path into an absolute path that has been normalized.
         // For absolute paths, it just normalizes them.
         // For relative paths, turns them into absolute paths relative to the current working directory, and then normalizes them.
@@ -7,6 +7,10 @@
 namespace wiz {
     namespace path {
         std::string getCurrentWorkingDirectory();
+        // Returns a path that the running executable can be read from, or an empty string if there is no way to find it.
+        std::string getExecutablePath();
+        // Creates a directory, unless it already exists. Its parent directory must exist.
+        bool createDirectory(StringView path);
         std::string toNormalizedAbsolute(StringView path);
         std::string toNormalized(StringView path);
         std::string toRelative(StringView path, StringView origin);
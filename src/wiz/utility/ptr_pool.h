@@ -1,6 +1,7 @@
 #ifndef WIZ_UTILITY_INSTANCE_POOL_H
 #define WIZ_UTILITY_INSTANCE_POOL_H
 
+#include <set>
 #include <vector>
 
 #include <wiz/utility/array_view.h>
@@ -26,10 +27,35 @@ namespace wiz {
                 instances_.erase(instances_.begin() + index);
             }
 
+            // Removes every instance at the given indices, shifting the remaining instances down in one pass.
+            void remove(const std::set<std::size_t>& indexes) {
+                if (indexes.size() == 0) {
+                    return;
+                }
+
+                auto next = indexes.begin();
+                auto dest = *next;
+                for (auto source = dest; source != instances_.size(); ++source) {
+                    if (next != indexes.end() && *next == source) {
+                        ++next;
+                    } else {
+                        instances_[dest] = std::move(instances_[source]);
+                        ++dest;
+                    }
+                }
+                instances_.erase(instances_.begin() + dest, instances_.end());
+            }
+
             WIZ_FORCE_INLINE void clear() {
                 instances_.clear();
             }
 
+            WIZ_FORCE_INLINE std::vector<Pointer> release() {
+                std::vector<Pointer> result;
+                result.swap(instances_);
+                return result;
+            }
+
             WIZ_FORCE_INLINE std::size_t size() const {
                 return instances_.size();
             }
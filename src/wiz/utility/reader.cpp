@@ -1,3 +1,4 @@
+#include <cstring>
 #include <algorithm>
 #include <iterator>
 
@@ -101,7 +102,13 @@ namespace wiz {
      
         bool eof = false;
         const auto old = offset;
-        offset = buffer.find_first_of("\r\n", offset);
+        // Lines almost always end in `\n`, so find that first, and then any `\r` before it.
+        const auto data = buffer.data();
+        const auto length = buffer.length();
+        const auto newline = static_cast<const char*>(std::memchr(data + offset, '\n', length - offset));
+        const auto end = newline != nullptr ? newline : data + length;
+        const auto carriageReturn = static_cast<const char*>(std::memchr(data + offset, '\r', static_cast<std::size_t>(end - (data + offset))));
+        offset = static_cast<std::size_t>((carriageReturn != nullptr ? carriageReturn : end) - data);
      
         if (offset >= buffer.length()) {
             offset = buffer.length() - 1;
@@ -115,7 +122,7 @@ namespace wiz {
         }
      
         offset++;
-        result = buffer.substr(old, offset - old);
+        result.assign(buffer, old, offset - old);
 
         return !eof || result.length() > 0;
     }
@@ -4,6 +4,41 @@
 #include <wiz/utility/tty.h>
 
 namespace wiz {
+    namespace {
+        // Writes everything to another writer, and also appends it to a buffer.
+        class TeeWriter : public Writer {
+            public:
+                TeeWriter(std::unique_ptr<Writer> writer, std::vector<std::uint8_t>& buffer)
+                : writer(std::move(writer)), copy(buffer) {}
+
+                ~TeeWriter() override {}
+
+                bool isOpen() const override {
+                    return writer->isOpen();
+                }
+
+                bool write(const std::vector<std::uint8_t>& data) override {
+                    return writer->write(data) && copy.write(data);
+                }
+
+                bool write(const std::vector<ArrayView<std::uint8_t>>& spans) override {
+                    return writer->write(spans) && copy.write(spans);
+                }
+
+                bool write(StringView data) override {
+                    return writer->write(data) && copy.write(data);
+                }
+
+                bool writeLine(StringView data) override {
+                    return writer->writeLine(data) && copy.writeLine(data);
+                }
+
+            private:
+                std::unique_ptr<Writer> writer;
+                MemoryWriter copy;
+        };
+    }
+
     FileResourceManager::FileResourceManager() {}
     FileResourceManager::~FileResourceManager() {}
 
@@ -39,7 +74,7 @@ namespace wiz {
     std::unique_ptr<Reader> MemoryResourceManager::openReader(StringView filename, bool allowShellResources) {
         static_cast<void>(allowShellResources);
         
-        const auto match = readBuffers.find(filename);
+        const auto match = readBuffers.find(filename.toString());
         if (match != readBuffers.end()) {
             return std::make_unique<MemoryReader>(match->second);
         }
@@ -47,16 +82,21 @@ namespace wiz {
     }
 
     std::unique_ptr<Writer> MemoryResourceManager::openWriter(StringView filename) {
-        writeBuffers[filename] = std::vector<std::uint8_t>();
-        return std::make_unique<MemoryWriter>(writeBuffers[filename]);
+        auto& buffer = writeBuffers[filename.toString()];
+        buffer.clear();
+        return std::make_unique<MemoryWriter>(buffer);
     }
 
     void MemoryResourceManager::registerReadBuffer(StringView filename, const std::string& buffer) {
-        readBuffers[filename] = buffer;
+        readBuffers[filename.toString()] = buffer;
+    }
+
+    void MemoryResourceManager::unregisterReadBuffer(StringView filename) {
+        readBuffers.erase(filename.toString());
     }
 
     bool MemoryResourceManager::getReadBuffer(StringView filename, std::string& buffer) {
-        const auto match = readBuffers.find(filename);
+        const auto match = readBuffers.find(filename.toString());
         if (match != readBuffers.end()) {
             buffer = match->second;
             return true;
@@ -66,7 +106,7 @@ namespace wiz {
     }
 
     bool MemoryResourceManager::getWriteBuffer(StringView filename, std::vector<std::uint8_t>& buffer) {
-        const auto match = writeBuffers.find(filename);
+        const auto match = writeBuffers.find(filename.toString());
         if (match != writeBuffers.end()) {
             buffer = match->second;
             return true;
@@ -74,4 +114,48 @@ namespace wiz {
             return false;
         }
     }
-}
\ No newline at end of file
+
+    const std::unordered_map<std::string, std::vector<std::uint8_t>>& MemoryResourceManager::getWriteBuffers() const {
+        return writeBuffers;
+    }
+
+    void MemoryResourceManager::clearWriteBuffers() {
+        writeBuffers.clear();
+    }
+
+
+
+    RecordingResourceManager::RecordingResourceManager(ResourceManager* resourceManager)
+    : resourceManager(resourceManager) {}
+
+    RecordingResourceManager::~RecordingResourceManager() {}
+
+    std::unique_ptr<Reader> RecordingResourceManager::openReader(StringView filename, bool allowShellResources) {
+        auto reader = resourceManager->openReader(filename, allowShellResources);
+        if (reader == nullptr || !reader->isOpen()) {
+            reads.emplace_back(filename.toString(), false, std::string());
+            return reader;
+        }
+
+        reads.emplace_back(filename.toString(), true, reader->readFully());
+        return std::make_unique<MemoryReader>(reads.back().contents);
+    }
+
+    std::unique_ptr<Writer> RecordingResourceManager::openWriter(StringView filename) {
+        auto writer = resourceManager->openWriter(filename);
+        if (writer == nullptr) {
+            return nullptr;
+        }
+
+        writes.emplace_back(filename.toString());
+        return std::make_unique<TeeWriter>(std::move(writer), writes.back().contents);
+    }
+
+    const std::vector<RecordingResourceManager::ReadRecord>& RecordingResourceManager::getReads() const {
+        return reads;
+    }
+
+    const std::deque<RecordingResourceManager::WriteRecord>& RecordingResourceManager::getWrites() const {
+        return writes;
+    }
+}
@@ -4,6 +4,7 @@
 #include <cstdint>
 #include <string>
 #include <vector>
+#include <deque>
 #include <memory>
 #include <unordered_map>
 #include <wiz/utility/string_view.h>
@@ -36,12 +37,60 @@ namespace wiz {
             virtual std::unique_ptr<Writer> openWriter(StringView filename) override;
 
             void registerReadBuffer(StringView filename, const std::string& buffer);
+            void unregisterReadBuffer(StringView filename);
             bool getReadBuffer(StringView filename, std::string& result);
             bool getWriteBuffer(StringView filename, std::vector<std::uint8_t>& result);
+            const std::unordered_map<std::string, std::vector<std::uint8_t>>& getWriteBuffers() const;
+            void clearWriteBuffers();
 
         private:
-            std::unordered_map<StringView, std::string> readBuffers;
-            std::unordered_map<StringView, std::vector<std::uint8_t>> writeBuffers;
+            // Keys are owned by the manager, since it can outlive the string pool of the compile that wrote each buffer.
+            std::unordered_map<std::string, std::string> readBuffers;
+            std::unordered_map<std::string, std::vector<std::uint8_t>> writeBuffers;
+    };
+
+    // Passes everything through to another resource manager, and keeps a copy of every file that was read or written.
+    // Lets a compile's inputs and outputs be saved afterward, without changing how the compile opens them.
+    class RecordingResourceManager : public ResourceManager {
+        public:
+            struct ReadRecord {
+                ReadRecord(
+                    std::string filename,
+                    bool found,
+                    std::string contents)
+                : filename(std::move(filename)),
+                found(found),
+                contents(std::move(contents)) {}
+
+                std::string filename;
+                // Files that couldn't be opened are kept too, since whether they exist can change the result.
+                bool found;
+                std::string contents;
+            };
+
+            struct WriteRecord {
+                WriteRecord(
+                    std::string filename)
+                : filename(std::move(filename)) {}
+
+                std::string filename;
+                std::vector<std::uint8_t> contents;
+            };
+
+            RecordingResourceManager(ResourceManager* resourceManager);
+            virtual ~RecordingResourceManager() override;
+
+            virtual std::unique_ptr<Reader> openReader(StringView filename, bool allowShellResources) override;
+            virtual std::unique_ptr<Writer> openWriter(StringView filename) override;
+
+            const std::vector<ReadRecord>& getReads() const;
+            const std::deque<WriteRecord>& getWrites() const;
+
+        private:
+            ResourceManager* resourceManager;
+            std::vector<ReadRecord> reads;
+            // A deque, so that writers can keep pointing at their record while more files are opened.
+            std::deque<WriteRecord> writes;
     };
 }
 
@@ -2,10 +2,11 @@
 #define WIZ_UTILITY_STRING_POOL_H
 
 #include <cstddef>
+#include <cstring>
 #include <string>
 #include <vector>
-#include <unordered_set>
 #include <memory>
+#include <functional>
 
 #include <wiz/utility/macros.h>
 #include <wiz/utility/string_view.h>
@@ -13,6 +14,10 @@
 namespace wiz {
     class StringPool {
         public:
+            StringPool()
+            : blockOffset(BlockSize),
+            count(0) {}
+
             WIZ_FORCE_INLINE StringView intern(const char* source) {
                 return intern(StringView(source));
             }
@@ -21,23 +26,100 @@ namespace wiz {
                 return intern(StringView(source));
             }
 
-            StringView intern(StringView source) {
-                const auto match = views.find(source);
+            // Every identifier and literal the scanner reads is interned, so this avoids an allocation per string.
+            // Strings are copied into shared blocks, and found again through an open-addressed table.
+            WIZ_FORCE_INLINE StringView intern(StringView source) {
+                if ((count + 1) * 4 > slots.size() * 3) {
+                    grow();
+                }
+
+                const auto hash = std::hash<StringView>()(source);
+                const auto mask = slots.size() - 1;
+                auto index = hash & mask;
+                while (slots[index].data != nullptr) {
+                    const auto& slot = slots[index];
+                    if (slot.hash == hash
+                    && slot.length == source.getLength()
+                    && std::memcmp(slot.data, source.getData(), slot.length) == 0) {
+                        return StringView(slot.data, slot.length);
+                    }
+                    index = (index + 1) & mask;
+                }
+
+                const auto data = store(source);
+                slots[index] = Slot(data, source.getLength(), hash);
+                ++count;
+                return StringView(data, source.getLength());
+            }
+
+        private:
+            struct Slot {
+                Slot()
+                : data(nullptr), length(0), hash(0) {}
+
+                Slot(
+                    const char* data,
+                    std::size_t length,
+                    std::size_t hash)
+                : data(data),
+                length(length),
+                hash(hash) {}
 
-                if (match != views.end()) {
-                    return *match;
+                const char* data;
+                std::size_t length;
+                std::size_t hash;
+            };
+
+            static const std::size_t BlockSize = 16384;
+            static const std::size_t MinimumSlotCount = 256;
+
+            // Copies the string with a null terminator, since interned strings are sometimes passed on as C strings.
+            const char* store(StringView source) {
+                const auto size = source.getLength() + 1;
+                char* data = nullptr;
+
+                if (size > BlockSize / 4) {
+                    // Long strings get a block of their own, so that the current block isn't wasted.
+                    blocks.push_back(std::make_unique<char[]>(size));
+                    data = blocks.back().get();
+                    if (blocks.size() >= 2) {
+                        std::swap(blocks[blocks.size() - 1], blocks[blocks.size() - 2]);
+                    }
                 } else {
-                    strings.push_back(std::make_unique<std::string>(source.getData(), source.getLength()));
+                    if (blockOffset + size > BlockSize) {
+                        blocks.push_back(std::make_unique<char[]>(BlockSize));
+                        blockOffset = 0;
+                    }
+                    data = blocks.back().get() + blockOffset;
+                    blockOffset += size;
+                }
 
-                    const auto view = StringView(*strings.back());
-                    views.insert(view);
-                    return view;
+                std::memcpy(data, source.getData(), source.getLength());
+                data[source.getLength()] = '\0';
+                return data;
+            }
+
+            void grow() {
+                std::vector<Slot> oldSlots(slots.size() != 0 ? slots.size() * 2 : MinimumSlotCount);
+                std::swap(slots, oldSlots);
+
+                const auto mask = slots.size() - 1;
+                for (const auto& slot : oldSlots) {
+                    if (slot.data != nullptr) {
+                        auto index = slot.hash & mask;
+                        while (slots[index].data != nullptr) {
+                            index = (index + 1) & mask;
+                        }
+                        slots[index] = slot;
+                    }
                 }
             }
 
-        private:
-            std::vector<std::unique_ptr<std::string>> strings;
-            std::unordered_set<StringView> views;
+            // The last block is the one still being filled.
+            std::vector<std::unique_ptr<char[]>> blocks;
+            std::size_t blockOffset;
+            std::vector<Slot> slots;
+            std::size_t count;
     };
 }
 
@@ -1,3 +1,4 @@
+#include <cctype>
 #include <cstdint>
 #include <wiz/utility/text.h>
 
@@ -85,6 +86,18 @@ namespace wiz {
             return result;
         }
 
+        StringView trim(StringView text) {
+            std::size_t start = 0;
+            std::size_t end = text.getLength();
+            while (start != end && std::isspace(static_cast<unsigned char>(text[start]))) {
+                ++start;
+            }
+            while (end != start && std::isspace(static_cast<unsigned char>(text[end - 1]))) {
+                --end;
+            }
+            return text.sub(start, end - start);
+        }
+
         std::string replaceAll(const std::string& text, const std::string& search, const std::string& replace) {
             auto result = text;
             auto pos = result.find(search, 0);
@@ -55,6 +55,7 @@ namespace wiz {
         std::string escape(StringView text, char quote);
         std::string truncate(StringView text, std::size_t length);
         std::vector<StringView> split(StringView text, StringView delimiters, std::size_t offset = 0);
+        StringView trim(StringView text);
         std::string replaceAll(const std::string& text, const std::string& search, const std::string& replace);
         std::string padLeft(const std::string& text, char padding, std::size_t length);
         std::string padRight(const std::string& text, char padding, std::size_t length);
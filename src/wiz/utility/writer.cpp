@@ -1,6 +1,16 @@
 #include <wiz/utility/text.h>
 #include <wiz/utility/writer.h>
 
+#if (defined(__APPLE__) || defined(__unix__)) && !defined(__EMSCRIPTEN__) && defined(_POSIX_SOURCE)
+    #include <algorithm>
+    #include <cerrno>
+    #include <climits>
+    #include <unistd.h>
+    #include <sys/uio.h>
+
+    #define WIZ_WRITER_WRITEV
+#endif
+
 namespace wiz {
     FileWriter::FileWriter(
         StringView filename)
@@ -27,6 +37,68 @@ namespace wiz {
         return std::fwrite(&data[0], data.size(), 1, file.get()) == 1;
     }
 
+    bool FileWriter::write(const std::vector<ArrayView<std::uint8_t>>& spans) {
+        if (!isOpen()) {
+            return false;
+        }
+
+#ifdef WIZ_WRITER_WRITEV
+        // Hand the spans to the OS directly, instead of copying them through the stdio buffer.
+        if (std::fflush(file.get()) != 0) {
+            return false;
+        }
+
+        const auto fd = fileno(file.get());
+        std::vector<struct iovec> vectors;
+        vectors.reserve(spans.size());
+
+        for (const auto& span : spans) {
+            if (span.size() != 0) {
+                struct iovec vector;
+                // This is the one place const is cast away, because POSIX shares iovec between readv and writev, so iov_base isn't a pointer to const.
+                // writev only ever reads through it, so the spans stay const everywhere else.
+                vector.iov_base = const_cast<std::uint8_t*>(span.getData());
+                vector.iov_len = span.size();
+                vectors.push_back(vector);
+            }
+        }
+
+        std::size_t index = 0;
+        while (index != vectors.size()) {
+            const auto count = static_cast<int>(std::min(vectors.size() - index, static_cast<std::size_t>(IOV_MAX)));
+            const auto result = writev(fd, &vectors[index], count);
+            if (result < 0) {
+                // A signal arrived before anything was written, so the same spans can be tried again.
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+
+            // Skip past whatever the OS accepted, which may end partway through a span.
+            auto written = static_cast<std::size_t>(result);
+            while (index != vectors.size() && written >= vectors[index].iov_len) {
+                written -= vectors[index].iov_len;
+                ++index;
+            }
+            if (written != 0) {
+                vectors[index].iov_base = static_cast<std::uint8_t*>(vectors[index].iov_base) + written;
+                vectors[index].iov_len -= written;
+            }
+        }
+
+        return true;
+#else
+        for (const auto& span : spans) {
+            if (span.size() != 0 && std::fwrite(span.getData(), span.size(), 1, file.get()) != 1) {
+                return false;
+            }
+        }
+
+        return true;
+#endif
+    }
+
     bool FileWriter::write(StringView data) {
         if (!isOpen()) {
             return false;
@@ -60,6 +132,13 @@ namespace wiz {
         return true;
     }
 
+    bool MemoryWriter::write(const std::vector<ArrayView<std::uint8_t>>& spans) {
+        for (const auto& span : spans) {
+            buffer.insert(buffer.end(), span.begin(), span.end());
+        }
+        return true;
+    }
+
     bool MemoryWriter::write(StringView data) {
         buffer.insert(buffer.end(), data.begin(), data.end());
         return true;
@@ -7,6 +7,7 @@
 #include <cstdio>
 #include <cstdint>
 #include <wiz/utility/string_view.h>
+#include <wiz/utility/array_view.h>
 
 namespace wiz {
     enum class WriterMode {
@@ -19,6 +20,8 @@ namespace wiz {
             virtual ~Writer() {}
             virtual bool isOpen() const = 0;
             virtual bool write(const std::vector<std::uint8_t>& data) = 0;
+            // Writes several spans of memory in order, as if they were one buffer.
+            virtual bool write(const std::vector<ArrayView<std::uint8_t>>& spans) = 0;
             virtual bool write(StringView data) = 0;
             virtual bool writeLine(StringView data) = 0;
     };
@@ -30,6 +33,7 @@ namespace wiz {
 
             bool isOpen() const override;
             bool write(const std::vector<std::uint8_t>& data) override;
+            bool write(const std::vector<ArrayView<std::uint8_t>>& spans) override;
             bool write(StringView data) override;
             bool writeLine(StringView data) override;
 
@@ -48,6 +52,7 @@ namespace wiz {
             
             bool isOpen() const override;
             bool write(const std::vector<std::uint8_t>& data) override;
+            bool write(const std::vector<ArrayView<std::uint8_t>>& spans) override;
             bool write(StringView data) override;
             bool writeLine(StringView data) override;
 
@@ -1,5 +1,6 @@
 #include <memory>
 #include <utility>
+#include <unordered_set>
 #include <clocale>
 
 #include <wiz/ast/statement.h>
@@ -9,17 +10,23 @@
 #include <wiz/compiler/config.h>
 #include <wiz/compiler/version.h>
 #include <wiz/compiler/compiler.h>
+#include <wiz/compiler/profile.h>
+#include <wiz/compiler/size_report.h>
+#include <wiz/compiler/result_cache.h>
 #include <wiz/compiler/definition.h>
 #include <wiz/compiler/symbol_table.h>
 #include <wiz/format/output/output_format.h>
 #include <wiz/platform/platform.h>
 #include <wiz/utility/tty.h>
 #include <wiz/utility/path.h>
+#include <wiz/utility/text.h>
 #include <wiz/utility/logger.h>
+#include <wiz/utility/checksum.h>
 #include <wiz/utility/reader.h>
 #include <wiz/utility/report.h>
 #include <wiz/utility/writer.h>
 #include <wiz/utility/optional.h>
+#include <wiz/utility/parallel.h>
 #include <wiz/utility/array_view.h>
 #include <wiz/utility/string_view.h>
 #include <wiz/utility/string_pool.h>
@@ -29,37 +36,435 @@
 #include <wiz/format/debug/debug_format.h>
 
 namespace wiz {
+    // The formats keep no state between compiles. The platforms keep the builtin definitions of the compile in progress,
+    // which every compile replaces when it starts. A toolchain can serve runs one after another, but not at the same time.
+    // This is why each variant build has its own platforms.
+    struct Toolchain {
+        PlatformCollection platformCollection;
+        OutputFormatCollection outputFormatCollection;
+        DebugFormatCollection debugFormatCollection;
+    };
+
+    namespace {
+        // Settings for the files written alongside each compiled program.
+        struct OutputOptions {
+            std::vector<StringView> symbolFormatNames;
+            std::vector<DebugFormat*> symbolFormats;
+            Optional<StringView> sizeReportFormat;
+            StringView baselineName;
+            // Set by `--depfile`. An empty name means the file is named after the output file.
+            Optional<StringView> dependencyFileName;
+        };
+
+        // Another program to build from the same parsed input, given by `--variant`.
+        struct VariantOption {
+            StringView outputName;
+            StringView systemName;
+            Optional<std::size_t> optimizationLevel;
+            std::vector<std::pair<StringView, StringView>> defines;
+        };
+
+        // Only `0` and `1` do anything different today, but higher levels are accepted so that build scripts can ask for them.
+        const std::size_t MaxOptimizationLevel = 9;
+
+        bool parseOptimizationLevel(StringView text, std::size_t& result) {
+            const auto value = text.toString();
+            if (value.size() == 0 || value.find_first_not_of("0123456789") != std::string::npos) {
+                return false;
+            }
+
+            result = 0;
+            for (const auto c : value) {
+                result = result * 10 + static_cast<std::size_t>(c - '0');
+                if (result > MaxOptimizationLevel) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // A define given on the command line becomes an untyped literal, which is typed the same way as a literal in the program.
+        // No value or `true` gives a boolean, a decimal or `0x` hexadecimal number gives an integer, and anything else gives a string.
+        FwdUniquePtr<const Expression> createDefineExpression(StringView value) {
+            const auto location = SourceLocation("<command line>"_sv);
+
+            if (value.getLength() == 0 || value == "true"_sv || value == "false"_sv) {
+                return makeFwdUnique<const Expression>(Expression::BooleanLiteral(value != "false"_sv), location, Optional<ExpressionInfo>());
+            }
+
+            const bool negative = value[0] == '-';
+            auto digits = negative ? value.sub(1) : value;
+            if (digits.getLength() == 0 || digits[0] < '0' || digits[0] > '9') {
+                return makeFwdUnique<const Expression>(Expression::StringLiteral(value), location, Optional<ExpressionInfo>());
+            }
+
+            std::size_t base = 10;
+            auto digitSet = "0123456789"_sv;
+            if (digits.startsWith("0x"_sv)) {
+                base = 16;
+                digits = digits.sub(2);
+                digitSet = "0123456789ABCDEFabcdef"_sv;
+            }
+
+            if (digits.getLength() == 0) {
+                return nullptr;
+            }
+            for (const auto c : digits) {
+                if (!digitSet.contains(StringView(&c, 1))) {
+                    return nullptr;
+                }
+            }
+
+            const auto result = Int128::parse(digits.begin(), digits.end(), base, negative);
+            if (result.first != Int128::ParseResult::Success) {
+                return nullptr;
+            }
+            return makeFwdUnique<const Expression>(Expression::IntegerLiteral(result.second), location, Optional<ExpressionInfo>());
+        }
+
+        // Reads `name` or `name=value`. Names starting with `__` are kept for the compiler's own defines.
+        bool parseDefineOption(StringView text, std::pair<StringView, StringView>& result) {
+            const auto separator = text.find("="_sv);
+            const auto name = separator != SIZE_MAX ? text.sub(0, separator) : text;
+            const auto value = separator != SIZE_MAX ? text.sub(separator + 1) : StringView();
+
+            if (name.getLength() == 0 || name.startsWith("__"_sv) || (name[0] >= '0' && name[0] <= '9')) {
+                return false;
+            }
+            for (const auto c : name) {
+                if (!(c >= 'a' && c <= 'z') && !(c >= 'A' && c <= 'Z') && !(c >= '0' && c <= '9') && c != '_') {
+                    return false;
+                }
+            }
+            if (!createDefineExpression(value)) {
+                return false;
+            }
+
+            result = std::make_pair(name, value);
+            return true;
+        }
+
+        // The compiler takes ownership of its defines, so every compile needs a fresh copy. Later values replace earlier ones.
+        std::unordered_map<StringView, FwdUniquePtr<const Expression>> createDefines(const std::vector<std::pair<StringView, StringView>>& defineOptions) {
+            std::unordered_map<StringView, FwdUniquePtr<const Expression>> defines;
+            for (const auto& define : defineOptions) {
+                defines[define.first] = createDefineExpression(define.second);
+            }
+            return defines;
+        }
+
+        Platform* findVariantPlatform(const PlatformCollection& platformCollection, const VariantOption& variant) {
+            return variant.systemName.getLength() != 0
+                ? platformCollection.findByName(variant.systemName)
+                : platformCollection.findByFileExtension(path::getExtension(variant.outputName));
+        }
+
+        // Returns a hash of the running compiler, so that cached outputs of a different build of it are never restored.
+        Optional<std::string> hashExecutable(ResourceManager* resourceManager) {
+            const auto executablePath = path::getExecutablePath();
+            if (executablePath.length() == 0) {
+                return Optional<std::string>();
+            }
+
+            auto reader = resourceManager->openReader(StringView(executablePath), false);
+            if (!reader || !reader->isOpen()) {
+                return Optional<std::string>();
+            }
+
+            const auto contents = reader->readFully();
+            if (contents.length() == 0) {
+                return Optional<std::string>();
+            }
+
+            return checksum::sha256(reinterpret_cast<const std::uint8_t*>(contents.data()), contents.size());
+        }
+
+        bool writeOutputs(Report* report, ResourceManager* resourceManager, StringPool* stringPool, const OutputFormatCollection& outputFormatCollection, const OutputOptions& outputOptions, const Compiler& compiler, Config* config, StringView outputName, const std::unordered_map<StringView, std::uint32_t>& sourceChecksums) {
+            const auto& symbolFormatNames = outputOptions.symbolFormatNames;
+            const auto& symbolFormats = outputOptions.symbolFormats;
+            const auto& sizeReportFormat = outputOptions.sizeReportFormat;
+            const auto baselineName = outputOptions.baselineName;
+
+            StringView outputFormatName;
+            OutputFormat* outputFormat = nullptr;
+
+            if (const auto formatValue = config->checkString(report, "format"_sv, false)) {
+                outputFormatName = formatValue->second;
+                outputFormat = outputFormatCollection.find(outputFormatName);
+                if (outputFormat == nullptr) {
+                    report->error("`format` of `" + formatValue->second.toString() + "` is not supported.", formatValue->first->location, ReportErrorFlags::Fatal);
+                    return false;
+                }
+            }
+
+            if (outputFormat == nullptr) {
+                outputFormatName = path::getExtension(outputName);
+                outputFormat = outputFormatCollection.find(outputFormatName);
+
+                if (outputFormat == nullptr) {
+                    outputFormatName = "bin"_sv;
+                    outputFormat = outputFormatCollection.find(outputFormatName);
+                }
+            }
+
+            report->log(">> Writing ROM...");
+
+            auto banks = compiler.getRegisteredBanks();
+            OutputFormatContext outputContext(report, stringPool, config, outputFormatName, outputName, banks);
+
+            if (!outputFormat->generate(outputContext) || !report->validate()) {
+                return false;
+            }
+
+            {
+                auto writer = resourceManager->openWriter(outputName);
+                if (writer && writer->write(outputContext.data.getSpans())) {
+                    report->log(">> Wrote to \"" + outputName.toString() + "\".");
+                } else {
+                    report->error("Output file \"" + outputName.toString() + "\" could not be written.", SourceLocation(), ReportErrorFlags::Fatal);
+                    return false;
+                }
+            }
+
+            if (symbolFormats.size() != 0) {
+                // Every format reads the same symbol table, and writes into its own buffer, so they can be generated concurrently.
+                // The files are written afterward, in the order the formats were given.
+                const auto symbols = collectDebugSymbols(compiler.getRegisteredDefinitions());
+                std::vector<std::vector<std::uint8_t>> symbolBuffers(symbolFormats.size());
+
+                parallel::forEach(symbolFormats.size(), [&](std::size_t i) {
+                    DebugFormatContext debugContext(resourceManager, report, stringPool, config, symbolFormatNames[i], outputName, &outputContext, &symbols, &compiler.getSourceMap(), &sourceChecksums);
+                    MemoryWriter writer(symbolBuffers[i]);
+                    symbolFormats[i]->generate(debugContext, &writer);
+                });
+
+                for (std::size_t i = 0; i != symbolFormats.size(); ++i) {
+                    const auto debugName = stringPool->intern(path::stripExtension(outputName).toString() + "." + symbolFormats[i]->getExtension().toString());
+                    auto writer = resourceManager->openWriter(debugName);
+                    if (!writer || !writer->write(symbolBuffers[i])) {
+                        report->error("Symbol file \"" + debugName.toString() + "\" could not be written.", SourceLocation(), ReportErrorFlags::Fatal);
+                        return false;
+                    }
+                }
+            }
+
+            if (sizeReportFormat.hasValue() || baselineName.getLength() != 0) {
+                SizeReport sizeReport;
+                sizeReport.collect(banks, compiler.getRegisteredDefinitions());
+
+                if (sizeReportFormat.hasValue() && sizeReportFormat.get() == "json"_sv) {
+                    const auto sizeReportName = stringPool->intern(path::stripExtension(outputName).toString() + ".size.json");
+                    auto writer = resourceManager->openWriter(sizeReportName);
+                    if (writer && writer->write(StringView(sizeReport.toJson()))) {
+                        report->log(">> Wrote size report to \"" + sizeReportName.toString() + "\".");
+                    } else {
+                        report->error("Size report \"" + sizeReportName.toString() + "\" could not be written.", SourceLocation(), ReportErrorFlags::Fatal);
+                        return false;
+                    }
+                } else if (sizeReportFormat.hasValue()) {
+                    sizeReport.log(report);
+                }
+
+                if (baselineName.getLength() != 0) {
+                    auto reader = resourceManager->openReader(baselineName, false);
+                    if (!reader) {
+                        report->error("Baseline \"" + baselineName.toString() + "\" could not be read.", SourceLocation(), ReportErrorFlags::Fatal);
+                        return false;
+                    }
+
+                    SizeReport baseline;
+                    if (!baseline.parseJson(report, baselineName, reader->readFully()) || !report->validate()) {
+                        return false;
+                    }
+                    sizeReport.logChanges(report, baseline);
+                }
+            }
+
 #if 0
-    void dumpAddress(const Definition* definition, OutputFormatContext& outputFormatContext) {
-        Optional<Address> address = definition->getAddress();
+            const auto definitions = compiler.getRegisteredDefinitions();
+
+            for (const auto& definition : definitions) {
+                dumpAddress(definition, outputFormatContext);
+            }
+#endif
+            return true;
+        }
+
+        // An output file, and every source file and embedded file that was read to build it.
+        struct DependencyRule {
+            StringView target;
+            std::vector<StringView> dependencies;
+        };
+
+        // Make splits paths on spaces, starts a comment at `#`, and expands variables at `$`.
+        std::string escapeMakePath(StringView path) {
+            std::string result;
+            for (const auto c : path) {
+                switch (c) {
+                    case ' ': case '#': result += '\\'; result += c; break;
+                    case '$': result += "$$"; break;
+                    default: result += c; break;
+                }
+            }
+            return result;
+        }
+
+        // Dependencies are made relative to the working directory when they can be, like the paths a Makefile would name them by.
+        std::string formatDependencyRules(const std::vector<DependencyRule>& rules) {
+            const auto workingDirectory = path::getCurrentWorkingDirectory();
+            const auto origin = workingDirectory.size() != 0 ? path::toNormalized(StringView(workingDirectory)) + "/" : std::string();
+            const auto originDepth = static_cast<std::size_t>(std::count(origin.begin(), origin.end(), '/')) - (origin.size() != 0 ? 1 : 0);
+
+            std::string result;
+            for (const auto& rule : rules) {
+                std::unordered_set<StringView> written;
+                result += escapeMakePath(rule.target) + ":";
+
+                for (const auto& dependency : rule.dependencies) {
+                    // Skip `<stdin>`, and files that were reached by more than one path.
+                    if (dependency.startsWith("<"_sv) || !written.insert(dependency).second) {
+                        continue;
+                    }
+
+                    auto relativePath = origin.size() != 0 ? path::toRelative(dependency, StringView(origin)) : std::string();
+
+                    // A path that climbs all the way back to the root is clearer written as an absolute path.
+                    std::size_t levelsAbove = 0;
+                    while (StringView(relativePath).sub(levelsAbove * 3).startsWith("../"_sv)) {
+                        ++levelsAbove;
+                    }
+                    if (levelsAbove != 0 && levelsAbove >= originDepth) {
+                        relativePath.clear();
+                    }
+
+                    result += " \\\n  " + escapeMakePath(relativePath.size() != 0 ? StringView(relativePath) : dependency);
+                }
+                result += "\n";
+            }
+            return result;
+        }
 
-        if (address.hasValue()) {
-            if (address->relativePosition.hasValue() && address->absolutePosition.hasValue()) {
-                const auto offset = address->relativePosition.get() + output.bankOffsets[address->bank];
+        // Writes every rule to the named file, or each rule to a `.d` file named after its target.
+        bool writeDependencyFiles(Report* report, ResourceManager* resourceManager, StringPool* stringPool, StringView dependencyFileName, const std::vector<DependencyRule>& rules) {
+            std::vector<std::pair<StringView, std::vector<DependencyRule>>> files;
+            if (dependencyFileName.getLength() != 0) {
+                files.emplace_back(dependencyFileName, rules);
+            } else {
+                for (const auto& rule : rules) {
+                    files.emplace_back(stringPool->intern(path::stripExtension(rule.target).toString() + ".d"), std::vector<DependencyRule> {rule});
+                }
+            }
 
-                outputFormatContext->report->log("var " + definition->name.toString()
-                    + " @ " + Int128(address->absolutePosition.get()).toString(16)
-                    + (address->bank != nullptr
-                        ? " (in bank " + address->bank->getName().toString() + ")"
-                        : "")
-                    + " -> offset = " + Int128(offset).toString(16));
+            for (const auto& file : files) {
+                auto writer = resourceManager->openWriter(file.first);
+                if (writer && writer->write(StringView(formatDependencyRules(file.second)))) {
+                    report->log(">> Wrote dependencies to \"" + file.first.toString() + "\".");
+                } else {
+                    report->error("Dependency file \"" + file.first.toString() + "\" could not be written.", SourceLocation(), ReportErrorFlags::Fatal);
+                    return false;
+                }
             }
+            return true;
+        }
+
+        // Everything that a compile writes to, so that variants can be compiled concurrently.
+        // Platforms remember the definitions they reserved for the current compile, so each variant needs its own.
+        // Messages are held until every variant has finished, and then reported in the order the variants were given.
+        struct VariantBuild {
+            VariantBuild(ResourceManager* resourceManager, ArrayView<StringView> importDirs, LoggerColorSetting colorSetting)
+            : importManager(&stringPool, resourceManager, importDirs),
+            report(std::make_unique<BufferedLogger>(colorSetting)) {}
+
+            void replay(Logger* logger) {
+                static_cast<BufferedLogger*>(report.getLogger())->replay(logger);
+            }
+
+            PlatformCollection platformCollection;
+            StringPool stringPool;
+            Config config;
+            ImportManager importManager;
+            Report report;
+            std::unique_ptr<Compiler> compiler;
+            bool compiled = false;
+        };
+
+        // Compiles one parsed program once per variant. The backends run concurrently, and share nothing but the program.
+        // Files are written afterward, one variant at a time.
+        int compileVariants(Report* report, ResourceManager* resourceManager, const Toolchain& toolchain, StringPool* stringPool, const ImportManager& sourceImportManager, const Statement* program, ArrayView<StringView> importDirs, const std::vector<VariantOption>& variants, const OutputOptions& outputOptions) {
+            const auto colorSetting = report->getLogger()->getColorSetting();
+            std::vector<std::unique_ptr<VariantBuild>> builds;
+            for (std::size_t i = 0; i != variants.size(); ++i) {
+                builds.push_back(std::make_unique<VariantBuild>(resourceManager, importDirs, colorSetting));
+            }
+
+            report->log(">> Compiling " + std::to_string(variants.size()) + " variants...");
+
+            parallel::forEach(variants.size(), [&](std::size_t i) {
+                const auto& variant = variants[i];
+                auto& build = *builds[i];
+
+                build.report.log(">> Compiling \"" + variant.outputName.toString() + "\"...");
+                build.compiler = std::make_unique<Compiler>(program, findVariantPlatform(build.platformCollection, variant), &build.stringPool, &build.config, &build.importManager, &build.report,
+                    variant.optimizationLevel.get(), nullptr, createDefines(variant.defines));
+                build.compiled = build.compiler->compile();
+            });
+
+            bool success = true;
+            for (std::size_t i = 0; i != variants.size(); ++i) {
+                auto& build = *builds[i];
+
+                if (!build.compiled
+                || !writeOutputs(&build.report, resourceManager, &build.stringPool, toolchain.outputFormatCollection, outputOptions, *build.compiler, &build.config, variants[i].outputName, sourceImportManager.getSourceChecksums())) {
+                    success = false;
+                }
+                build.replay(report->getLogger());
+            }
+
+            if (!success) {
+                return 1;
+            }
+
+            if (outputOptions.dependencyFileName.hasValue()) {
+                // Every variant reads the same source files, and then whatever its own embeds picked.
+                std::vector<DependencyRule> rules;
+                for (std::size_t i = 0; i != variants.size(); ++i) {
+                    rules.push_back(DependencyRule {variants[i].outputName, sourceImportManager.getImportedPaths()});
+
+                    const auto& embeddedPaths = builds[i]->importManager.getImportedPaths();
+                    rules.back().dependencies.insert(rules.back().dependencies.end(), embeddedPaths.begin(), embeddedPaths.end());
+                }
+
+                if (!writeDependencyFiles(report, resourceManager, stringPool, outputOptions.dependencyFileName.get(), rules)) {
+                    return 1;
+                }
+            }
+
+            report->notice("Done.");
+            return 0;
         }
     }
-#endif
 
-    int run(Report* report, ResourceManager* resourceManager, ArrayView<const char*> arguments) {
+    int run(Report* report, ResourceManager* resourceManager, const Toolchain& toolchain, ArrayView<const char*> arguments) {
         StringPool stringPool;
-        PlatformCollection platformCollection;
-        OutputFormatCollection outputFormatCollection;
-        DebugFormatCollection debugFormatCollection;
+        const auto& platformCollection = toolchain.platformCollection;
+        const auto& outputFormatCollection = toolchain.outputFormatCollection;
+        const auto& debugFormatCollection = toolchain.debugFormatCollection;
         StringView inputName;
         StringView outputName;
-        StringView debugFormatName;
+        std::vector<StringView> profileNames;
+        StringView baselineName;
+        StringView cacheDirectory;
+        Optional<StringView> sizeReportFormat;
+        Optional<StringView> dependencyFileName;
+        std::vector<StringView> symbolFormatNames;
+        std::vector<DebugFormat*> symbolFormats;
         std::vector<StringView> importDirs;
-        std::unordered_map<StringView, FwdUniquePtr<const Expression>> defines;
+        std::vector<std::pair<StringView, StringView>> defineOptions;
+        std::vector<VariantOption> variants;
+        StringView systemName;
         Platform* platform = nullptr;
         Config config;
+        std::size_t optimizationLevel = 0;
 
         if (isTTY(stdout)) {
             std::setvbuf(stdout, 0, _IONBF, 0);
@@ -71,10 +476,18 @@ namespace wiz {
             Output,
             System,
             ImportDir,
+            Define,
             Color,
             Version,
             FromStdin,
             SymbolFormat,
+            Optimize,
+            Profile,
+            SizeReport,
+            Baseline,
+            Variant,
+            DependencyFile,
+            CacheDirectory,
             Help,
         };
 
@@ -96,7 +509,8 @@ namespace wiz {
         const auto debugFormatOptionHelp = stringPool.intern(
             std::string() +
             "    specifies a symbol table format to export alongside this program.\n"
-            "    If set, symbol files will be written to the same folder as the output file.\n\n" +
+            "    If set, symbol files will be written to the same folder as the output file.\n"
+            "    Several formats can be given as a comma-separated list (eg. `mlb,wla`).\n\n" +
             "    possible options:" + debugFormatNames);
 
         auto optionParser = OptionParser<OptionType>{         
@@ -106,6 +520,10 @@ namespace wiz {
                 systemOptionHelp.getData()},
             {OptionType::ImportDir, "import-dir", 'I', true, "path",
                 "    adds the directory to the import search path. (for `import`, `embed`, etc.)"},
+            {OptionType::Define, "define", 'D', true, "name[=value]",
+                "    defines a value that the program can read with `__has` and `__get`.\n"
+                "    a decimal or `0x` hexadecimal value is an integer, `true`, `false` or no value is a boolean,\n"
+                "    and anything else is a string."},
             {OptionType::Color, "color", 0, true, "setting",
                 "    changes the color settings for the terminal output.\n\n"
                 "    possible options:\n"
@@ -118,11 +536,62 @@ namespace wiz {
                 "    if used as an input path, wiz will read from stdin."}, 
             {OptionType::SymbolFormat, "symbol-format", 's', true, "type",
                 debugFormatOptionHelp.getData()},
+            {OptionType::Optimize, "optimize", 'O', true, "level",
+                "    sets the optimization level. (can also be set by an `optimize` config directive.)\n\n"
+                "    possible options:\n"
+                "    `0` - no extra optimization (default)\n"
+                "    `1` - automatically inline small functions, and functions with a single call site."},
+            {OptionType::Profile, "profile", 0, true, "filename",
+                "    reads per-address execution counts or cycle totals (`address,count` rows, with hexadecimal addresses)\n"
+                "    exported from an emulator, and uses them to guide optimization.\n"
+                "    the counts must come from a build of the same program made without `--profile`.\n"
+                "    can be given several times, for counts recorded from builds that were made with a profile:\n"
+                "    each profile must come from a build made with all the profiles listed before it, and the last one guides optimization."},
+            {OptionType::SizeReport, "size-report", 0, true, "format",
+                "    reports the bytes used by every function, constant and variable, and the free space in each bank.\n\n"
+                "    possible options:\n"
+                "    `text` - print the report. (default)\n"
+                "    `json` - write the report to a `.size.json` file alongside the output file.", true},
+            {OptionType::Baseline, "baseline", 0, true, "filename",
+                "    reads a report written by `--size-report=json` for an earlier build,\n"
+                "    and prints how the size of each bank, function, constant and variable changed since then."},
+            {OptionType::Variant, "variant", 0, true, "output[,field...]",
+                "    also compiles the program to another output file, reusing the parsed program.\n"
+                "    can be given several times, and the variants are compiled concurrently.\n"
+                "    each field is `system=type`, `optimize=level`, or a `name[=value]` define.\n"
+                "    fields replace the `--system` and `--optimize` settings, and add to the `--define` values.\n"
+                "    (eg. `--variant=game-pal.nes,PAL` or `--variant=game-c02.prg,system=65c02`)"},
+            {OptionType::DependencyFile, "depfile", 0, true, "filename",
+                "    writes a Makefile rule listing every source file and embedded file that the output was built from.\n"
+                "    if no filename is given, the rule is written to a `.d` file alongside the output file.\n"
+                "    `-MD` and `-MF filename` are accepted too, as in gcc.", true},
+            {OptionType::CacheDirectory, "cache-dir", 0, true, "path",
+                "    saves the files written by each compile in this directory, and restores them instead of compiling\n"
+                "    when the same arguments are given and every source file and embedded file is unchanged.\n"
+                "    (the directory can be shared between builds, and deleted at any time to clear the cache.)"},
             {OptionType::Help, "help", 0, false, "",
                 "    displays this help message."},
         };
 
-        if (!optionParser.parse(arguments)) {
+        // Accept gcc's spellings of `--depfile`, so that wiz fits into build rules written for C compilers.
+        std::vector<const char*> translatedArguments;
+        for (std::size_t i = 0, argumentCount = arguments.getLength(); i != argumentCount; ++i) {
+            const auto argument = StringView(arguments[i]);
+            if (argument == "--"_sv) {
+                translatedArguments.insert(translatedArguments.end(), arguments.begin() + i, arguments.end());
+                break;
+            } else if (argument == "-MD"_sv) {
+                translatedArguments.push_back("--depfile");
+            } else if (argument == "-MF"_sv && i + 1 != argumentCount) {
+                translatedArguments.push_back(stringPool.intern("--depfile=" + std::string(arguments[++i])).getData());
+            } else if (argument.startsWith("-MF"_sv) && argument.getLength() > 3) {
+                translatedArguments.push_back(stringPool.intern("--depfile=" + argument.sub(3).toString()).getData());
+            } else {
+                translatedArguments.push_back(arguments[i]);
+            }
+        }
+
+        if (!optionParser.parse(ArrayView<const char*>(translatedArguments))) {
             report->notice(optionParser.getError().toString());
             return 1;
         }
@@ -167,6 +636,7 @@ namespace wiz {
                     break;
                 }
                 case OptionType::System: {
+                    systemName = option.value;
                     platform = platformCollection.findByName(option.value);
                     if (!platform) {
                         report->notice("unrecognized system `" + option.value.toString() + "` provided to `--system` argument.");
@@ -180,6 +650,16 @@ namespace wiz {
                     }
                     break;
                 }
+                case OptionType::Define: {
+                    std::pair<StringView, StringView> define;
+                    if (parseDefineOption(option.value, define)) {
+                        defineOptions.push_back(define);
+                    } else {
+                        report->notice("invalid define `" + option.value.toString() + "` provided to `--define` argument.");
+                        invalidOptions = true;
+                    }
+                    break;
+                }
                 case OptionType::Color: {
                     LoggerColorSetting setting = LoggerColorSetting::None;
                     if (option.value == "none"_sv) { setting = LoggerColorSetting::None; } 
@@ -206,14 +686,118 @@ namespace wiz {
                     break;
                 }
                 case OptionType::SymbolFormat: {
-                    if (debugFormatName.getLength() == 0) {
-                        debugFormatName = option.value;
+                    for (const auto& name : text::split(option.value, ","_sv)) {
+                        const auto debugFormat = debugFormatCollection.find(name);
+                        if (debugFormat == nullptr) {
+                            report->notice("unrecognized symbol format `" + name.toString() + "` provided to `--symbol-format` argument.\n"
+                                "    use `--help` to see usage of this command-line option.");
+                            invalidOptions = true;
+                            continue;
+                        }
+                        if (std::find(symbolFormats.begin(), symbolFormats.end(), debugFormat) != symbolFormats.end()) {
+                            continue;
+                        }
+
+                        // Formats that share an extension would overwrite each other's symbol file.
+                        bool conflict = false;
+                        for (std::size_t i = 0; i != symbolFormats.size(); ++i) {
+                            if (symbolFormats[i]->getExtension() == debugFormat->getExtension()) {
+                                report->notice("symbol formats `" + symbolFormatNames[i].toString() + "` and `" + name.toString() + "` both write `."
+                                    + debugFormat->getExtension().toString() + "` files, so only one of them can be specified.");
+                                invalidOptions = true;
+                                conflict = true;
+                                break;
+                            }
+                        }
+                        if (!conflict) {
+                            symbolFormatNames.push_back(name);
+                            symbolFormats.push_back(debugFormat);
+                        }
+                    }
+                    break;
+                }
+                case OptionType::Optimize: {
+                    if (!parseOptimizationLevel(option.value, optimizationLevel)) {
+                        report->notice("unrecognized option `" + option.value.toString() + "` provided to `--optimize` argument. (expected a level from 0 to " + std::to_string(MaxOptimizationLevel) + ")");
+                        invalidOptions = true;
+                    }
+                    break;
+                }
+                case OptionType::Profile: {
+                    profileNames.push_back(option.value);
+                    break;
+                }
+                case OptionType::SizeReport: {
+                    if (option.value.getLength() == 0 || option.value == "text"_sv || option.value == "json"_sv) {
+                        sizeReportFormat = option.value.getLength() != 0 ? option.value : "text"_sv;
+                    } else {
+                        report->notice("unrecognized option `" + option.value.toString() + "` provided to `--size-report` argument.");
+                        invalidOptions = true;
+                    }
+                    break;
+                }
+                case OptionType::Baseline: {
+                    if (baselineName.getLength() == 0) {
+                        baselineName = option.value;
                     } else {
-                        report->notice("only one symbol format can be specified. (previously specified as `" + debugFormatName.toString() + "`)");
+                        report->notice("only one baseline can be specified. (previously specified as `" + baselineName.toString() + "`)");
                         invalidOptions = true;
                     }
                     break;
                 }
+                case OptionType::Variant: {
+                    const auto fields = text::split(option.value, ","_sv);
+                    VariantOption variant;
+
+                    if (fields.size() == 0 || fields[0].getLength() == 0) {
+                        report->notice("no output filename provided to `--variant` argument.");
+                        invalidOptions = true;
+                        break;
+                    }
+                    // The fields aren't null-terminated, and the output filename is opened as a file.
+                    variant.outputName = stringPool.intern(fields[0].toString());
+
+                    for (std::size_t i = 1; i != fields.size(); ++i) {
+                        const auto field = fields[i];
+                        if (field.startsWith("system="_sv)) {
+                            variant.systemName = field.sub(7);
+                            if (!platformCollection.findByName(variant.systemName)) {
+                                report->notice("unrecognized system `" + variant.systemName.toString() + "` provided to `--variant` argument.");
+                                invalidOptions = true;
+                            }
+                        } else if (field.startsWith("optimize="_sv)) {
+                            std::size_t level = 0;
+                            if (parseOptimizationLevel(field.sub(9), level)) {
+                                variant.optimizationLevel = level;
+                            } else {
+                                report->notice("unrecognized optimization level `" + field.sub(9).toString() + "` provided to `--variant` argument. (expected a level from 0 to " + std::to_string(MaxOptimizationLevel) + ")");
+                                invalidOptions = true;
+                            }
+                        } else {
+                            std::pair<StringView, StringView> define;
+                            if (parseDefineOption(field, define)) {
+                                variant.defines.push_back(define);
+                            } else {
+                                report->notice("invalid define `" + field.toString() + "` provided to `--variant` argument.");
+                                invalidOptions = true;
+                            }
+                        }
+                    }
+
+                    variants.push_back(std::move(variant));
+                    break;
+                }
+                case OptionType::DependencyFile: {
+                    // A name given by `-MF` is kept, even if `-MD` comes after it.
+                    if (!dependencyFileName.hasValue() || option.value.getLength() != 0) {
+                        dependencyFileName = option.value;
+                    }
+                    break;
+                }
+                case OptionType::CacheDirectory: {
+                    cacheDirectory = option.value;
+                    break;
+                }
                 case OptionType::Help: {
                     report->log("usage: wiz [options] <input>");
                     report->log("");
@@ -241,7 +825,9 @@ namespace wiz {
                                 "  --"
                                 + definition.longname.toString()
                                 + (definition.parameterName.getLength() != 0
-                                    ? "=" + definition.parameterName.toString()
+                                    ? definition.parameterOptional
+                                        ? "[=" + definition.parameterName.toString() + "]"
+                                        : "=" + definition.parameterName.toString()
                                     : ""));
                         }
                         if (definition.description.getLength() != 0) {
@@ -258,7 +844,7 @@ namespace wiz {
 
         importDirs.push_back("."_sv);
 
-        if (outputName.getLength() == 0) {
+        if (outputName.getLength() == 0 && variants.size() == 0) {
             report->notice("no target/output file given, please provide an output `-o` parameter.\n  type `wiz --help` to see program usage.");
             return 1;
         }
@@ -285,92 +871,195 @@ namespace wiz {
             return 1;
         }
 
-        if (platform == nullptr) {
-            platform = platformCollection.findByFileExtension(path::getExtension(outputName));
+        const OutputOptions outputOptions {symbolFormatNames, symbolFormats, sizeReportFormat, baselineName, dependencyFileName};
 
-            if (platform == nullptr) {
-                report->notice("failed to auto-detect target system.\n  please provide a manual `--system` option.\n  type `wiz --help` to see program usage.");
+        if (variants.size() != 0) {
+            if (profileNames.size() != 0 || baselineName.getLength() != 0) {
+                report->notice("`--profile` and `--baseline` cannot be used with `--variant`, because every variant has its own layout.");
                 return 1;
             }
-        }
 
-        report->log(">> Parsing...");
-        ImportManager importManager(&stringPool, resourceManager, ArrayView<StringView>(importDirs));
-        Parser parser(&stringPool, &importManager, report);
+            // The `-o` output, if one was given, is compiled as the first variant.
+            if (outputName.getLength() != 0) {
+                VariantOption variant;
+                variant.outputName = outputName;
+                variants.insert(variants.begin(), std::move(variant));
+            }
 
-        if (auto program = parser.parse(inputName)) {
-            report->log(">> Compiling...");
-            Compiler compiler(std::move(program), platform, &stringPool, &config, &importManager, report, std::move(defines));
+            for (std::size_t i = 0; i != variants.size(); ++i) {
+                auto& variant = variants[i];
+                if (variant.systemName.getLength() == 0) {
+                    variant.systemName = systemName;
+                }
+                if (!variant.optimizationLevel.hasValue()) {
+                    variant.optimizationLevel = optimizationLevel;
+                }
+                variant.defines.insert(variant.defines.begin(), defineOptions.begin(), defineOptions.end());
 
-            if (compiler.compile()) {
-                StringView outputFormatName;
-                OutputFormat* outputFormat = nullptr;
+                if (findVariantPlatform(platformCollection, variant) == nullptr) {
+                    report->notice("failed to auto-detect target system for \"" + variant.outputName.toString() + "\".\n  please provide a `system=` field or a manual `--system` option.\n  type `wiz --help` to see program usage.");
+                    return 1;
+                }
 
-                if (const auto formatValue = config.checkString(report, "format"_sv, false)) {
-                    outputFormatName = formatValue->second;
-                    outputFormat = outputFormatCollection.find(outputFormatName);
-                    if (outputFormat == nullptr) {
-                        report->error("`format` of `" + formatValue->second.toString() + "` is not supported.", formatValue->first->location, ReportErrorFlags::Fatal);
+                // Symbol files and size reports are named after the output file, so variants must not share a name, even with different extensions.
+                for (std::size_t j = 0; j != i; ++j) {
+                    if (path::stripExtension(variants[j].outputName) == path::stripExtension(variant.outputName)) {
+                        report->notice("variants \"" + variants[j].outputName.toString() + "\" and \"" + variant.outputName.toString() + "\" would write files with the same name.");
                         return 1;
                     }
                 }
+            }
+        } else if (platform == nullptr) {
+            platform = platformCollection.findByFileExtension(path::getExtension(outputName));
 
-                if (outputFormat == nullptr) {
-                    outputFormatName = path::getExtension(outputName);
-                    outputFormat = outputFormatCollection.find(outputFormatName);
+            if (platform == nullptr) {
+                report->notice("failed to auto-detect target system.\n  please provide a manual `--system` option.\n  type `wiz --help` to see program usage.");
+                return 1;
+            }
+        }
 
-                    if (outputFormat == nullptr) {
-                        outputFormatName = "bin"_sv;
-                        outputFormat = outputFormatCollection.find(outputFormatName);
+        std::unique_ptr<ResultCache> resultCache;
+        std::unique_ptr<RecordingResourceManager> recordingResourceManager;
+        if (cacheDirectory.getLength() != 0) {
+            const auto cacheable = variants.size() == 0
+                && inputName != "<stdin>"_sv
+                && baselineName.getLength() == 0
+                && !(sizeReportFormat.hasValue() && sizeReportFormat.get() == "text"_sv);
+            const auto buildHash = cacheable ? hashExecutable(resourceManager) : Optional<std::string>();
+
+            if (!cacheable) {
+                report->notice("`--cache-dir` is ignored with `--variant`, `--baseline`, `--size-report=text` or stdin input, so the output won't be cached.");
+            } else if (!buildHash) {
+                report->notice("`--cache-dir` is ignored because the compiler executable could not be read, so the output won't be cached.");
+            } else {
+                // Everything that decides the output besides the files read while compiling.
+                // The compiler can change without a version bump, so the key includes a hash of the executable too.
+                // The cache directory itself doesn't, so the same cache can be found under different spellings of it.
+                std::string key = std::string("wiz ") + version::Text;
+                key.push_back('\0');
+                key += buildHash.get();
+                key.push_back('\0');
+                key += path::getCurrentWorkingDirectory();
+
+                bool positional = false;
+                for (std::size_t i = 0; i != translatedArguments.size(); ++i) {
+                    const auto argument = StringView(translatedArguments[i]);
+                    if (!positional) {
+                        if (argument == "--"_sv) {
+                            positional = true;
+                        } else if (argument == "--cache-dir"_sv) {
+                            // The directory is the next argument.
+                            if (i + 1 != translatedArguments.size()) {
+                                ++i;
+                            }
+                            continue;
+                        } else if (argument.startsWith("--cache-dir="_sv)) {
+                            continue;
+                        }
                     }
-                }
-
-                report->log(">> Writing ROM...");
-
-                auto banks = compiler.getRegisteredBanks();
-                OutputFormatContext outputContext(report, &stringPool, &config, outputFormatName, outputName, banks);
 
-                if (!outputFormat->generate(outputContext) || !report->validate()) {
-                    return 1;
+                    key.push_back('\0');
+                    key += argument.toString();
                 }
 
-                {
-                    auto writer = resourceManager->openWriter(outputName);
-                    if (writer && writer->write(outputContext.data)) {
-                        report->log(">> Wrote to \"" + outputName.toString() + "\".");
-                    } else {
-                        report->error("Output file \"" + outputName.toString() + "\" could not be written.", SourceLocation(), ReportErrorFlags::Fatal);
-                        return 1;
+                resultCache = std::make_unique<ResultCache>(cacheDirectory, StringView(key));
+
+                std::vector<ResultCache::File> files;
+                if (resultCache->lookup(resourceManager, files)) {
+                    report->log(">> Restoring cached output...");
+                    for (const auto& file : files) {
+                        auto writer = resourceManager->openWriter(StringView(file.filename));
+                        if (writer && writer->write(file.contents)) {
+                            report->log(">> Wrote to \"" + file.filename + "\".");
+                        } else {
+                            report->error("Output file \"" + file.filename + "\" could not be written.", SourceLocation(), ReportErrorFlags::Fatal);
+                            return 1;
+                        }
                     }
+
+                    report->notice("Done.");
+                    return 0;
                 }
 
-                if (debugFormatName.getLength() != 0) {
-                    DebugFormatContext debugContext(resourceManager, report, &stringPool, &config, debugFormatName, outputName, &outputContext, compiler.getRegisteredDefinitions());
+                // Everything from here on reads and writes through the recording, so the compile can be stored afterward.
+                recordingResourceManager = std::make_unique<RecordingResourceManager>(resourceManager);
+                resourceManager = recordingResourceManager.get();
+            }
+        }
 
-                    // FIXME: hardcoded.
-                    const auto debugFormat = debugFormatCollection.find(debugFormatName);
-                    if (debugFormat != nullptr) {
-                        debugFormat->generate(debugContext);
-                    } else {
-                        report->error(
-                            "`--symbol-format` argument of `" + debugFormatName.toString() + "` is not supported.\n"
-                            "    use `--help` to see usage of this command-line option.", SourceLocation(), ReportErrorFlags::Fatal);
-                    }
-                }
+        report->log(">> Parsing...");
+        ImportManager importManager(&stringPool, resourceManager, ArrayView<StringView>(importDirs));
+        Parser parser(&stringPool, &importManager, report);
 
-#if 0
-                const auto definitions = compiler.getRegisteredDefinitions();
+        auto program = parser.parse(inputName);
+        if (!program) {
+            return 1;
+        }
 
-                for (const auto& definition : definitions) {
-                    dumpAddress(definition, outputFormatContext);
-                }
-#endif
-                report->notice("Done.");
-                return 0;
+        // Each profile was recorded from a build made with the profiles listed before it.
+        // The last one guides this build, and the earlier ones only rebuild the layout that the next one was recorded against.
+        std::vector<std::unique_ptr<Profile>> profiles;
+        for (const auto& profileName : profileNames) {
+            auto reader = resourceManager->openReader(profileName, false);
+            if (!reader || !reader->isOpen()) {
+                report->error("Profile \"" + profileName.toString() + "\" could not be read.", SourceLocation(), ReportErrorFlags::Fatal);
+                return 1;
+            }
+
+            auto profile = std::make_unique<Profile>();
+            if (!profile->parse(report, profileName, reader->readFully())) {
+                return 1;
+            }
+
+            // Lay out the parsed program again with the previous profile, to recover the addresses that the counts were recorded against.
+            // Only the addresses are needed, so this stops before any code is generated.
+            report->log(">> Mapping profile \"" + profileName.toString() + "\"...");
+            Config profileConfig;
+            ImportManager profileImportManager(&stringPool, resourceManager, ArrayView<StringView>(importDirs));
+            Compiler profileCompiler(program.get(), platform, &stringPool, &profileConfig, &profileImportManager, report, optimizationLevel, profiles.size() != 0 ? profiles.back().get() : nullptr, createDefines(defineOptions));
+            if (!profileCompiler.compileLayout()) {
+                return 1;
+            }
+
+            profile->attribute(profileCompiler.getRegisteredDefinitions());
+            profile->attributeVariableAccesses(profileCompiler.getVariableAccesses());
+
+            report->log("profile has " + std::to_string(profile->getSampleCount()) + " address(es), with a total weight of " + std::to_string(profile->getTotalWeight()) + " in functions");
+            for (const auto& function : profile->getHottestFunctions(5)) {
+                report->log("  `" + function.first + "`: " + std::to_string(function.second * 100 / profile->getTotalWeight()) + "%");
             }
+
+            profiles.push_back(std::move(profile));
         }
 
-        return 1;
+        if (variants.size() != 0) {
+            return compileVariants(report, resourceManager, toolchain, &stringPool, importManager, program.get(), ArrayView<StringView>(importDirs), variants, outputOptions);
+        }
+
+        report->log(">> Compiling...");
+        Compiler compiler(std::move(program), platform, &stringPool, &config, &importManager, report, optimizationLevel, profiles.size() != 0 ? profiles.back().get() : nullptr, createDefines(defineOptions));
+
+        if (!compiler.compile()
+        || !writeOutputs(report, resourceManager, &stringPool, outputFormatCollection, outputOptions, compiler, &config, outputName, importManager.getSourceChecksums())) {
+            return 1;
+        }
+
+        if (outputOptions.dependencyFileName.hasValue()
+        && !writeDependencyFiles(report, resourceManager, &stringPool, outputOptions.dependencyFileName.get(), {DependencyRule {outputName, importManager.getImportedPaths()}})) {
+            return 1;
+        }
+
+        if (resultCache && !resultCache->store(*recordingResourceManager)) {
+            report->notice("the output could not be saved to the cache directory \"" + cacheDirectory.toString() + "\".");
+        }
+
+        report->notice("Done.");
+        return 0;
+    }
+
+    int run(Report* report, ResourceManager* resourceManager, ArrayView<const char*> arguments) {
+        Toolchain toolchain;
+        return run(report, resourceManager, toolchain, arguments);
     }
 }
 
@@ -435,8 +1124,60 @@ emscripten::val compile(emscripten::val sources, emscripten::val arguments, emsc
     return emscripten::val::null();
 }
 
+// Keeps the source files and the toolchain alive between compiles, so that an editor can recompile on every change,
+// only sending the files that changed.
+class Session {
+    public:
+        Session() {}
+
+        void setFile(const std::string& filename, const std::string& content) {
+            resourceManager.registerReadBuffer(wiz::StringView(filename), content);
+        }
+
+        void removeFile(const std::string& filename) {
+            resourceManager.unregisterReadBuffer(wiz::StringView(filename));
+        }
+
+        // Returns `{success, files}`, where `files` maps the name of every file written by the compile to a `Uint8Array`.
+        // Each array is a copy owned by JavaScript. A view into the module's memory would detach as soon as the heap grows.
+        emscripten::val compile(emscripten::val arguments, emscripten::val logger) {
+            wiz::Report report(std::make_unique<EmLogger>(logger));
+            std::vector<const char*> internedArguments;
+
+            const auto argumentsLength = arguments["length"].as<unsigned>();
+            for (unsigned i = 0; i != argumentsLength; ++i) {
+                internedArguments.push_back(pool.intern(arguments[i].as<std::string>()).getData());
+            }
+
+            resourceManager.clearWriteBuffers();
+            const auto result = wiz::run(&report, &resourceManager, toolchain, wiz::ArrayView<const char*>(internedArguments));
+
+            auto files = emscripten::val::object();
+            for (const auto& item : resourceManager.getWriteBuffers()) {
+                const auto view = emscripten::val(emscripten::typed_memory_view(item.second.size(), item.second.data()));
+                files.set(item.first, emscripten::val::global("Uint8Array").new_(view));
+            }
+
+            auto output = emscripten::val::object();
+            output.set("success", result == 0);
+            output.set("files", files);
+            return output;
+        }
+
+    private:
+        wiz::StringPool pool;
+        wiz::MemoryResourceManager resourceManager;
+        wiz::Toolchain toolchain;
+};
+
 EMSCRIPTEN_BINDINGS(wiz_module) {
     emscripten::function("compile", compile);
+
+    emscripten::class_<Session>("Session")
+        .constructor<>()
+        .function("setFile", &Session::setFile)
+        .function("removeFile", &Session::removeFile)
+        .function("compile", &Session::compile);
 }
 
 #else
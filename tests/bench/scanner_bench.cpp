@@ -0,0 +1,125 @@
+// Measures the throughput of the scanner, in tokens per second.
+//
+// Build with `make scanner-bench`, then run:
+//
+//      bin/scanner-bench [file.wiz]...
+//
+// Three generated inputs are always measured: a table of hexadecimal literals,
+// declarations with unique names and comments, and statements with a mix of
+// keywords and operators. Each file given on the command line is measured too.
+// Inputs are scanned from memory, so file reading is not counted.
+
+#include <chrono>
+#include <cstdio>
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+#include <utility>
+
+#include <wiz/parser/token.h>
+#include <wiz/parser/scanner.h>
+#include <wiz/utility/report.h>
+#include <wiz/utility/reader.h>
+#include <wiz/utility/logger.h>
+#include <wiz/utility/string_pool.h>
+
+namespace wiz {
+    namespace {
+        const std::size_t TargetSize = 16 * 1024 * 1024;
+        const int Runs = 5;
+
+        std::string generateLiteralTable() {
+            const char* const digits = "0123456789abcdef";
+            std::string result = "const table : [u8] = [\n";
+            unsigned int value = 0;
+            while (result.size() < TargetSize) {
+                result += "   ";
+                for (int i = 0; i != 16; ++i) {
+                    value = value * 1103515245 + 12345;
+                    result += " 0x";
+                    result += digits[(value >> 20) & 0xF];
+                    result += digits[(value >> 16) & 0xF];
+                    result += ',';
+                }
+                result += '\n';
+            }
+            result += "];\n";
+            return result;
+        }
+
+        std::string generateDeclarations() {
+            std::string result;
+            for (std::size_t i = 0; result.size() < TargetSize; ++i) {
+                const auto index = std::to_string(i);
+                result += "var sprite_" + index + "_position : u16; // position of sprite " + index + " on screen\n";
+                result += "/* flags */ var sprite_" + index + "_flags : u8;\n";
+            }
+            return result;
+        }
+
+        std::string generateStatements() {
+            std::string result = "func main {\n";
+            while (result.size() < TargetSize) {
+                result +=
+                    "    if a == 10 && !carry { x = a; a = *(&table as *u8 + x); } else { a += 1; }\n"
+                    "    while x != 0 { --x; buffer[x] = a <<< 1; }\n"
+                    "    return if zero;\n";
+            }
+            result += "}\n";
+            return result;
+        }
+
+        void measure(const std::string& name, const std::string& source) {
+            double best = 0.0;
+            std::size_t tokens = 0;
+
+            for (int run = 0; run != Runs; ++run) {
+                StringPool stringPool;
+                Report report(std::make_unique<MemoryLogger>());
+                Scanner scanner(std::make_unique<MemoryReader>(source), StringView(name), StringView(name), &stringPool, &report);
+
+                const auto start = std::chrono::steady_clock::now();
+                tokens = 0;
+                while (scanner.next().type != TokenType::EndOfFile) {
+                    ++tokens;
+                }
+                const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                best = std::max(best, static_cast<double>(tokens) / seconds);
+            }
+
+            std::printf("%-32s %10zu tokens %8.2f M tokens/s\n", name.c_str(), tokens, best / 1e6);
+        }
+
+        bool measureFile(const char* path) {
+            FileReader reader {StringView(path)};
+            if (!reader.isOpen()) {
+                std::fprintf(stderr, "scanner-bench: could not open `%s`\n", path);
+                return false;
+            }
+
+            // Small files are repeated until they are big enough to time.
+            const auto contents = reader.readFully() + "\n";
+            std::string source;
+            while (source.size() < TargetSize) {
+                source += contents;
+            }
+            measure(path, source);
+            return true;
+        }
+    }
+}
+
+int main(int argc, const char** argv) {
+    wiz::measure("literal table", wiz::generateLiteralTable());
+    wiz::measure("unique names and comments", wiz::generateDeclarations());
+    wiz::measure("statements", wiz::generateStatements());
+
+    for (int i = 1; i < argc; ++i) {
+        if (!wiz::measureFile(argv[i])) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,2720 @@
+#!/usr/bin/env python3
+
+# A small cycle-counting CPU simulator used by wiztests.py to execute compiled
+# code and check its results.
+#
+# Simulated CPUs:
+#  - NMOS 6502 (official opcodes, binary arithmetic). Cycle counts include the
+#    page-crossing and branch-taken penalties.
+#  - Z80 (documented opcodes, plus the `ixh`/`ixl`/`iyh`/`iyl` forms). Cycle
+#    counts are in T-states. I/O ports read as 0xff and ignore writes.
+#  - SM83 (Game Boy). Cycle counts are in T-states (4 per machine cycle).
+#  - SPC700 (all opcodes). Cycle counts include the branch-taken penalties.
+#  - WDC 65816 in native mode, bank 0 only, binary arithmetic. Cycle counts
+#    include the 16-bit register, direct page alignment, index and
+#    branch-taken penalties.
+#
+# The Z80 and SM83 cores don't model the undocumented flag bits, interrupts or
+# memory-mapped hardware.
+#
+# The 6502, SPC700 and 65816 cores decode each opcode through a table. The Z80
+# and SM83 cores decode the fields of the opcode bits instead, the way their
+# encodings are laid out.
+
+from collections import namedtuple
+
+
+class SimulationError(Exception):
+    pass
+
+
+# Where the output binary of each simulated system is loaded in the address space.
+# The block tests map the `prg` bank at 0x8000 (see `_6502_memmap.wiz`).
+# The Z80 and Game Boy block tests map the `prg` bank at 0x0000 (see `_z80_memmap.wiz` and `_gb_memmap.wiz`).
+# The SPC700 block tests declare their own banks, starting at 0x0000.
+# The 65816 block tests use `_6502_memmap.wiz`.
+LOAD_ADDRESSES = {
+    '6502': 0x8000,
+    'z80': 0x0000,
+    'gb': 0x0000,
+    'spc700': 0x0000,
+    'wdc65816': 0x8000,
+}
+
+SYSTEMS = set(LOAD_ADDRESSES.keys())
+
+# Address returned to by the final `rts` or `ret`, used to detect the end of the simulation.
+RETURN_ADDRESS = 0xFFFF
+
+# Initial stack pointer of the Z80 and SM83, at the end of the `stack` bank of the block tests.
+STACK_ADDRESS = 0xE000
+
+MAX_STEPS = 1000000
+
+
+FLAG_C = 0x01
+FLAG_Z = 0x02
+FLAG_I = 0x04
+FLAG_D = 0x08
+FLAG_B = 0x10
+FLAG_U = 0x20
+FLAG_V = 0x40
+FLAG_N = 0x80
+
+FLAG_NAMES = {
+    'c': FLAG_C,
+    'z': FLAG_Z,
+    'i': FLAG_I,
+    'd': FLAG_D,
+    'v': FLAG_V,
+    'n': FLAG_N,
+}
+
+
+# opcode: (mnemonic, addressing mode, cycles, extra cycle on page crossing)
+OPCODES_6502 = {
+    0x69: ('adc', 'imm', 2, False), 0x65: ('adc', 'zp', 3, False), 0x75: ('adc', 'zpx', 4, False), 0x6D: ('adc', 'abs', 4, False),
+    0x7D: ('adc', 'absx', 4, True), 0x79: ('adc', 'absy', 4, True), 0x61: ('adc', 'indx', 6, False), 0x71: ('adc', 'indy', 5, True),
+
+    0x29: ('and', 'imm', 2, False), 0x25: ('and', 'zp', 3, False), 0x35: ('and', 'zpx', 4, False), 0x2D: ('and', 'abs', 4, False),
+    0x3D: ('and', 'absx', 4, True), 0x39: ('and', 'absy', 4, True), 0x21: ('and', 'indx', 6, False), 0x31: ('and', 'indy', 5, True),
+
+    0x0A: ('asl', 'acc', 2, False), 0x06: ('asl', 'zp', 5, False), 0x16: ('asl', 'zpx', 6, False), 0x0E: ('asl', 'abs', 6, False),
+    0x1E: ('asl', 'absx', 7, False),
+
+    0x90: ('bcc', 'rel', 2, False), 0xB0: ('bcs', 'rel', 2, False), 0xF0: ('beq', 'rel', 2, False), 0x30: ('bmi', 'rel', 2, False),
+    0xD0: ('bne', 'rel', 2, False), 0x10: ('bpl', 'rel', 2, False), 0x50: ('bvc', 'rel', 2, False), 0x70: ('bvs', 'rel', 2, False),
+
+    0x24: ('bit', 'zp', 3, False), 0x2C: ('bit', 'abs', 4, False),
+
+    0x00: ('brk', 'imp', 7, False),
+
+    0x18: ('clc', 'imp', 2, False), 0xD8: ('cld', 'imp', 2, False), 0x58: ('cli', 'imp', 2, False), 0xB8: ('clv', 'imp', 2, False),
+    0x38: ('sec', 'imp', 2, False), 0xF8: ('sed', 'imp', 2, False), 0x78: ('sei', 'imp', 2, False),
+
+    0xC9: ('cmp', 'imm', 2, False), 0xC5: ('cmp', 'zp', 3, False), 0xD5: ('cmp', 'zpx', 4, False), 0xCD: ('cmp', 'abs', 4, False),
+    0xDD: ('cmp', 'absx', 4, True), 0xD9: ('cmp', 'absy', 4, True), 0xC1: ('cmp', 'indx', 6, False), 0xD1: ('cmp', 'indy', 5, True),
+
+    0xE0: ('cpx', 'imm', 2, False), 0xE4: ('cpx', 'zp', 3, False), 0xEC: ('cpx', 'abs', 4, False),
+    0xC0: ('cpy', 'imm', 2, False), 0xC4: ('cpy', 'zp', 3, False), 0xCC: ('cpy', 'abs', 4, False),
+
+    0xC6: ('dec', 'zp', 5, False), 0xD6: ('dec', 'zpx', 6, False), 0xCE: ('dec', 'abs', 6, False), 0xDE: ('dec', 'absx', 7, False),
+    0xCA: ('dex', 'imp', 2, False), 0x88: ('dey', 'imp', 2, False),
+
+    0x49: ('eor', 'imm', 2, False), 0x45: ('eor', 'zp', 3, False), 0x55: ('eor', 'zpx', 4, False), 0x4D: ('eor', 'abs', 4, False),
+    0x5D: ('eor', 'absx', 4, True), 0x59: ('eor', 'absy', 4, True), 0x41: ('eor', 'indx', 6, False), 0x51: ('eor', 'indy', 5, True),
+
+    0xE6: ('inc', 'zp', 5, False), 0xF6: ('inc', 'zpx', 6, False), 0xEE: ('inc', 'abs', 6, False), 0xFE: ('inc', 'absx', 7, False),
+    0xE8: ('inx', 'imp', 2, False), 0xC8: ('iny', 'imp', 2, False),
+
+    0x4C: ('jmp', 'abs', 3, False), 0x6C: ('jmp', 'ind', 5, False),
+    0x20: ('jsr', 'abs', 6, False),
+
+    0xA9: ('lda', 'imm', 2, False), 0xA5: ('lda', 'zp', 3, False), 0xB5: ('lda', 'zpx', 4, False), 0xAD: ('lda', 'abs', 4, False),
+    0xBD: ('lda', 'absx', 4, True), 0xB9: ('lda', 'absy', 4, True), 0xA1: ('lda', 'indx', 6, False), 0xB1: ('lda', 'indy', 5, True),
+
+    0xA2: ('ldx', 'imm', 2, False), 0xA6: ('ldx', 'zp', 3, False), 0xB6: ('ldx', 'zpy', 4, False), 0xAE: ('ldx', 'abs', 4, False),
+    0xBE: ('ldx', 'absy', 4, True),
+
+    0xA0: ('ldy', 'imm', 2, False), 0xA4: ('ldy', 'zp', 3, False), 0xB4: ('ldy', 'zpx', 4, False), 0xAC: ('ldy', 'abs', 4, False),
+    0xBC: ('ldy', 'absx', 4, True),
+
+    0x4A: ('lsr', 'acc', 2, False), 0x46: ('lsr', 'zp', 5, False), 0x56: ('lsr', 'zpx', 6, False), 0x4E: ('lsr', 'abs', 6, False),
+    0x5E: ('lsr', 'absx', 7, False),
+
+    0xEA: ('nop', 'imp', 2, False),
+
+    0x09: ('ora', 'imm', 2, False), 0x05: ('ora', 'zp', 3, False), 0x15: ('ora', 'zpx', 4, False), 0x0D: ('ora', 'abs', 4, False),
+    0x1D: ('ora', 'absx', 4, True), 0x19: ('ora', 'absy', 4, True), 0x01: ('ora', 'indx', 6, False), 0x11: ('ora', 'indy', 5, True),
+
+    0x48: ('pha', 'imp', 3, False), 0x08: ('php', 'imp', 3, False), 0x68: ('pla', 'imp', 4, False), 0x28: ('plp', 'imp', 4, False),
+
+    0x2A: ('rol', 'acc', 2, False), 0x26: ('rol', 'zp', 5, False), 0x36: ('rol', 'zpx', 6, False), 0x2E: ('rol', 'abs', 6, False),
+    0x3E: ('rol', 'absx', 7, False),
+
+    0x6A: ('ror', 'acc', 2, False), 0x66: ('ror', 'zp', 5, False), 0x76: ('ror', 'zpx', 6, False), 0x6E: ('ror', 'abs', 6, False),
+    0x7E: ('ror', 'absx', 7, False),
+
+    0x40: ('rti', 'imp', 6, False), 0x60: ('rts', 'imp', 6, False),
+
+    0xE9: ('sbc', 'imm', 2, False), 0xE5: ('sbc', 'zp', 3, False), 0xF5: ('sbc', 'zpx', 4, False), 0xED: ('sbc', 'abs', 4, False),
+    0xFD: ('sbc', 'absx', 4, True), 0xF9: ('sbc', 'absy', 4, True), 0xE1: ('sbc', 'indx', 6, False), 0xF1: ('sbc', 'indy', 5, True),
+
+    0x85: ('sta', 'zp', 3, False), 0x95: ('sta', 'zpx', 4, False), 0x8D: ('sta', 'abs', 4, False), 0x9D: ('sta', 'absx', 5, False),
+    0x99: ('sta', 'absy', 5, False), 0x81: ('sta', 'indx', 6, False), 0x91: ('sta', 'indy', 6, False),
+
+    0x86: ('stx', 'zp', 3, False), 0x96: ('stx', 'zpy', 4, False), 0x8E: ('stx', 'abs', 4, False),
+    0x84: ('sty', 'zp', 3, False), 0x94: ('sty', 'zpx', 4, False), 0x8C: ('sty', 'abs', 4, False),
+
+    0xAA: ('tax', 'imp', 2, False), 0xA8: ('tay', 'imp', 2, False), 0xBA: ('tsx', 'imp', 2, False),
+    0x8A: ('txa', 'imp', 2, False), 0x9A: ('txs', 'imp', 2, False), 0x98: ('tya', 'imp', 2, False),
+}
+
+BRANCH_CONDITIONS = {
+    'bcc': (FLAG_C, False), 'bcs': (FLAG_C, True),
+    'bne': (FLAG_Z, False), 'beq': (FLAG_Z, True),
+    'bpl': (FLAG_N, False), 'bmi': (FLAG_N, True),
+    'bvc': (FLAG_V, False), 'bvs': (FLAG_V, True),
+}
+
+
+
+class Cpu6502:
+    REGISTERS = ('a', 'x', 'y', 's')
+    FLAG_NAMES = FLAG_NAMES
+
+    def __init__(self, memory):
+        self.memory = memory
+        self.a = 0
+        self.x = 0
+        self.y = 0
+        self.s = 0xFF
+        self.p = FLAG_U | FLAG_I
+        self.pc = 0
+        self.cycles = 0
+
+    def read(self, address):
+        return self.memory[address & 0xFFFF]
+
+    def write(self, address, value):
+        self.memory[address & 0xFFFF] = value & 0xFF
+
+    def read_word(self, address):
+        return self.read(address) | (self.read(address + 1) << 8)
+
+    def read_word_zp(self, address):
+        return self.read(address & 0xFF) | (self.read((address + 1) & 0xFF) << 8)
+
+    def push(self, value):
+        self.write(0x100 | self.s, value)
+        self.s = (self.s - 1) & 0xFF
+
+    def pull(self):
+        self.s = (self.s + 1) & 0xFF
+        return self.read(0x100 | self.s)
+
+    def get_flag(self, flag):
+        return (self.p & flag) != 0
+
+    def get_register(self, name):
+        if name in self.REGISTERS:
+            return getattr(self, name)
+        elif name in FLAG_NAMES:
+            return 1 if self.get_flag(FLAG_NAMES[name]) else 0
+        else:
+            raise SimulationError(f"unknown register {name}")
+
+    def initialize(self, name, value):
+        if name in ('a', 'x', 'y'):
+            setattr(self, name, value & 0xFF)
+        elif name in FLAG_NAMES:
+            self.set_flag(FLAG_NAMES[name], value)
+        else:
+            raise SimulationError(f"cannot initialize register {name}")
+
+    def call(self, entry, return_address):
+        ret = (return_address - 1) & 0xFFFF
+        self.push(ret >> 8)
+        self.push(ret & 0xFF)
+        self.pc = entry
+
+    def set_flag(self, flag, value):
+        if value:
+            self.p |= flag
+        else:
+            self.p &= ~flag
+
+    def set_nz(self, value):
+        self.set_flag(FLAG_Z, (value & 0xFF) == 0)
+        self.set_flag(FLAG_N, (value & 0x80) != 0)
+        return value & 0xFF
+
+    def fetch(self):
+        value = self.read(self.pc)
+        self.pc = (self.pc + 1) & 0xFFFF
+        return value
+
+    def fetch_word(self):
+        lo = self.fetch()
+        return lo | (self.fetch() << 8)
+
+    # Returns (effective address, page crossed)
+    def effective_address(self, mode):
+        if mode == 'zp':
+            return self.fetch(), False
+        elif mode == 'zpx':
+            return (self.fetch() + self.x) & 0xFF, False
+        elif mode == 'zpy':
+            return (self.fetch() + self.y) & 0xFF, False
+        elif mode == 'abs':
+            return self.fetch_word(), False
+        elif mode == 'absx' or mode == 'absy':
+            base = self.fetch_word()
+            address = (base + (self.x if mode == 'absx' else self.y)) & 0xFFFF
+            return address, (base & 0xFF00) != (address & 0xFF00)
+        elif mode == 'ind':
+            pointer = self.fetch_word()
+            # NMOS 6502 does not carry into the high byte of the pointer
+            return self.read(pointer) | (self.read((pointer & 0xFF00) | ((pointer + 1) & 0xFF)) << 8), False
+        elif mode == 'indx':
+            return self.read_word_zp(self.fetch() + self.x), False
+        elif mode == 'indy':
+            base = self.read_word_zp(self.fetch())
+            address = (base + self.y) & 0xFFFF
+            return address, (base & 0xFF00) != (address & 0xFF00)
+        else:
+            raise SimulationError(f"unsupported addressing mode {mode}")
+
+    def add(self, value):
+        if self.get_flag(FLAG_D):
+            raise SimulationError(f"decimal mode arithmetic is not supported (at 0x{self.pc:04x})")
+
+        result = self.a + value + (1 if self.get_flag(FLAG_C) else 0)
+        self.set_flag(FLAG_C, result > 0xFF)
+        self.set_flag(FLAG_V, (~(self.a ^ value) & (self.a ^ result) & 0x80) != 0)
+        self.a = self.set_nz(result)
+
+    def compare(self, register, value):
+        result = register - value
+        self.set_flag(FLAG_C, result >= 0)
+        self.set_nz(result)
+
+    def step(self):
+        opcode_address = self.pc
+        opcode = self.fetch()
+
+        if opcode not in OPCODES_6502:
+            raise SimulationError(f"unsupported opcode 0x{opcode:02x} at 0x{opcode_address:04x}")
+
+        mnemonic, mode, cycles, page_penalty = OPCODES_6502[opcode]
+        self.cycles += cycles
+
+        if mode == 'rel':
+            offset = self.fetch()
+            if offset & 0x80:
+                offset -= 0x100
+            flag, expected = BRANCH_CONDITIONS[mnemonic]
+            if self.get_flag(flag) == expected:
+                target = (self.pc + offset) & 0xFFFF
+                self.cycles += 1
+                if (target & 0xFF00) != (self.pc & 0xFF00):
+                    self.cycles += 1
+                self.pc = target
+            return
+
+        address = None
+        if mode == 'imm':
+            operand = self.fetch()
+        elif mode == 'acc':
+            operand = self.a
+        elif mode == 'imp':
+            operand = None
+        else:
+            address, page_crossed = self.effective_address(mode)
+            if page_penalty and page_crossed:
+                self.cycles += 1
+            operand = None
+
+        def load():
+            return operand if address is None else self.read(address)
+
+        def store_shifted(value):
+            if mode == 'acc':
+                self.a = self.set_nz(value)
+            else:
+                self.write(address, self.set_nz(value))
+
+        if mnemonic == 'lda':
+            self.a = self.set_nz(load())
+        elif mnemonic == 'ldx':
+            self.x = self.set_nz(load())
+        elif mnemonic == 'ldy':
+            self.y = self.set_nz(load())
+        elif mnemonic == 'sta':
+            self.write(address, self.a)
+        elif mnemonic == 'stx':
+            self.write(address, self.x)
+        elif mnemonic == 'sty':
+            self.write(address, self.y)
+
+        elif mnemonic == 'adc':
+            self.add(load())
+        elif mnemonic == 'sbc':
+            self.add(load() ^ 0xFF)
+        elif mnemonic == 'and':
+            self.a = self.set_nz(self.a & load())
+        elif mnemonic == 'ora':
+            self.a = self.set_nz(self.a | load())
+        elif mnemonic == 'eor':
+            self.a = self.set_nz(self.a ^ load())
+        elif mnemonic == 'cmp':
+            self.compare(self.a, load())
+        elif mnemonic == 'cpx':
+            self.compare(self.x, load())
+        elif mnemonic == 'cpy':
+            self.compare(self.y, load())
+        elif mnemonic == 'bit':
+            value = load()
+            self.set_flag(FLAG_Z, (self.a & value) == 0)
+            self.set_flag(FLAG_N, (value & 0x80) != 0)
+            self.set_flag(FLAG_V, (value & 0x40) != 0)
+
+        elif mnemonic == 'asl':
+            value = load()
+            self.set_flag(FLAG_C, (value & 0x80) != 0)
+            store_shifted(value << 1)
+        elif mnemonic == 'lsr':
+            value = load()
+            self.set_flag(FLAG_C, (value & 0x01) != 0)
+            store_shifted(value >> 1)
+        elif mnemonic == 'rol':
+            value = load()
+            carry = 1 if self.get_flag(FLAG_C) else 0
+            self.set_flag(FLAG_C, (value & 0x80) != 0)
+            store_shifted((value << 1) | carry)
+        elif mnemonic == 'ror':
+            value = load()
+            carry = 0x80 if self.get_flag(FLAG_C) else 0
+            self.set_flag(FLAG_C, (value & 0x01) != 0)
+            store_shifted((value >> 1) | carry)
+
+        elif mnemonic == 'inc':
+            self.write(address, self.set_nz(load() + 1))
+        elif mnemonic == 'dec':
+            self.write(address, self.set_nz(load() - 1))
+        elif mnemonic == 'inx':
+            self.x = self.set_nz(self.x + 1)
+        elif mnemonic == 'iny':
+            self.y = self.set_nz(self.y + 1)
+        elif mnemonic == 'dex':
+            self.x = self.set_nz(self.x - 1)
+        elif mnemonic == 'dey':
+            self.y = self.set_nz(self.y - 1)
+
+        elif mnemonic == 'tax':
+            self.x = self.set_nz(self.a)
+        elif mnemonic == 'tay':
+            self.y = self.set_nz(self.a)
+        elif mnemonic == 'txa':
+            self.a = self.set_nz(self.x)
+        elif mnemonic == 'tya':
+            self.a = self.set_nz(self.y)
+        elif mnemonic == 'tsx':
+            self.x = self.set_nz(self.s)
+        elif mnemonic == 'txs':
+            self.s = self.x
+
+        elif mnemonic == 'pha':
+            self.push(self.a)
+        elif mnemonic == 'php':
+            self.push(self.p | FLAG_B | FLAG_U)
+        elif mnemonic == 'pla':
+            self.a = self.set_nz(self.pull())
+        elif mnemonic == 'plp':
+            self.p = (self.pull() & ~FLAG_B) | FLAG_U
+
+        elif mnemonic == 'clc':
+            self.set_flag(FLAG_C, False)
+        elif mnemonic == 'sec':
+            self.set_flag(FLAG_C, True)
+        elif mnemonic == 'cld':
+            self.set_flag(FLAG_D, False)
+        elif mnemonic == 'sed':
+            self.set_flag(FLAG_D, True)
+        elif mnemonic == 'cli':
+            self.set_flag(FLAG_I, False)
+        elif mnemonic == 'sei':
+            self.set_flag(FLAG_I, True)
+        elif mnemonic == 'clv':
+            self.set_flag(FLAG_V, False)
+
+        elif mnemonic == 'jmp':
+            self.pc = address
+        elif mnemonic == 'jsr':
+            ret = (self.pc - 1) & 0xFFFF
+            self.push(ret >> 8)
+            self.push(ret & 0xFF)
+            self.pc = address
+        elif mnemonic == 'rts':
+            lo = self.pull()
+            self.pc = ((lo | (self.pull() << 8)) + 1) & 0xFFFF
+        elif mnemonic == 'rti':
+            self.p = (self.pull() & ~FLAG_B) | FLAG_U
+            lo = self.pull()
+            self.pc = lo | (self.pull() << 8)
+
+        elif mnemonic == 'nop':
+            pass
+        elif mnemonic == 'brk':
+            raise SimulationError(f"brk executed at 0x{opcode_address:04x}")
+
+        else:
+            raise SimulationError(f"unimplemented instruction {mnemonic} at 0x{opcode_address:04x}")
+
+
+
+def _parity(value):
+    return bin(value & 0xFF).count('1') % 2 == 0
+
+
+class CpuZ80Family:
+    """Registers, memory access and arithmetic shared by the Z80 and the SM83 (Game Boy) cores.
+
+    Flags are set by name, and each core maps the names it has onto bits of `f`.
+    Flags that a core does not have are ignored, as are the undocumented bits 3 and 5 of the Z80.
+    """
+
+    # flag name: bit in f
+    FLAG_BITS = {}
+
+    # wiz name (used in `// SIMULATE` tags): flag name
+    FLAG_NAMES = {}
+
+    REGISTERS = ('a', 'b', 'c', 'd', 'e', 'h', 'l', 'bc', 'de', 'hl', 'sp')
+
+    def __init__(self, memory):
+        self.memory = memory
+        self.a = 0
+        self.f = 0
+        self.b = 0
+        self.c = 0
+        self.d = 0
+        self.e = 0
+        self.h = 0
+        self.l = 0
+        self.sp = STACK_ADDRESS
+        self.pc = 0
+        self.cycles = 0
+
+    def read(self, address):
+        return self.memory[address & 0xFFFF]
+
+    def write(self, address, value):
+        self.memory[address & 0xFFFF] = value & 0xFF
+
+    def read_word(self, address):
+        return self.read(address) | (self.read(address + 1) << 8)
+
+    def write_word(self, address, value):
+        self.write(address, value)
+        self.write(address + 1, value >> 8)
+
+    def fetch(self):
+        value = self.read(self.pc)
+        self.pc = (self.pc + 1) & 0xFFFF
+        return value
+
+    def fetch_word(self):
+        lo = self.fetch()
+        return lo | (self.fetch() << 8)
+
+    def fetch_displacement(self):
+        offset = self.fetch()
+        return offset - 0x100 if offset & 0x80 else offset
+
+    def push(self, value):
+        self.sp = (self.sp - 2) & 0xFFFF
+        self.write_word(self.sp, value)
+
+    def pull(self):
+        value = self.read_word(self.sp)
+        self.sp = (self.sp + 2) & 0xFFFF
+        return value
+
+    def get_pair(self, name):
+        if name in ('sp', 'pc', 'ix', 'iy'):
+            return getattr(self, name)
+        return (getattr(self, name[0]) << 8) | getattr(self, name[1])
+
+    def set_pair(self, name, value):
+        value &= 0xFFFF
+        if name in ('sp', 'pc', 'ix', 'iy'):
+            setattr(self, name, value)
+        elif name == 'af':
+            self.a = value >> 8
+            self.f = value & self.FLAG_MASK
+        else:
+            setattr(self, name[0], value >> 8)
+            setattr(self, name[1], value & 0xFF)
+
+    def get_flag(self, name):
+        return (self.f & self.FLAG_BITS[name]) != 0
+
+    def set_flag(self, name, value):
+        bit = self.FLAG_BITS.get(name)
+        if bit is not None:
+            if value:
+                self.f |= bit
+            else:
+                self.f &= ~bit
+
+    def set_flags(self, **flags):
+        for name, value in flags.items():
+            self.set_flag(name, value)
+
+    def get_register(self, name):
+        if name in self.FLAG_NAMES:
+            return 1 if self.get_flag(self.FLAG_NAMES[name]) else 0
+        elif name in self.REGISTERS:
+            return self.get_pair(name) if len(name) == 2 else getattr(self, name)
+        else:
+            raise SimulationError(f"unknown register {name}")
+
+    def initialize(self, name, value):
+        if name in self.FLAG_NAMES:
+            self.set_flag(self.FLAG_NAMES[name], value)
+        elif name in self.REGISTERS and name != 'sp':
+            if len(name) == 2:
+                self.set_pair(name, value)
+            else:
+                setattr(self, name, value & 0xFF)
+        else:
+            raise SimulationError(f"cannot initialize register {name}")
+
+    def call(self, entry, return_address):
+        self.push(return_address)
+        self.pc = entry
+
+    # 8-bit arithmetic
+
+    def alu(self, op, value):
+        a = self.a
+        carry = 1 if self.get_flag('carry') else 0
+        if op == 0 or op == 1:
+            carry_in = carry if op == 1 else 0
+            result = a + value + carry_in
+            self.set_flags(
+                half=((a & 0xF) + (value & 0xF) + carry_in) > 0xF,
+                parity=(~(a ^ value) & (a ^ result) & 0x80) != 0,
+                subtract=False, carry=result > 0xFF)
+            self.a = self.set_sz(result)
+        elif op == 2 or op == 3 or op == 7:
+            carry_in = carry if op == 3 else 0
+            result = a - value - carry_in
+            self.set_flags(
+                half=((a & 0xF) - (value & 0xF) - carry_in) < 0,
+                parity=((a ^ value) & (a ^ result) & 0x80) != 0,
+                subtract=True, carry=result < 0)
+            if op == 7:
+                self.set_sz(result)
+            else:
+                self.a = self.set_sz(result)
+        else:
+            if op == 4:
+                result = a & value
+            elif op == 5:
+                result = a ^ value
+            else:
+                result = a | value
+            self.set_flags(half=(op == 4), parity=_parity(result), subtract=False, carry=False)
+            self.a = self.set_sz(result)
+
+    def set_sz(self, value):
+        value &= 0xFF
+        self.set_flags(sign=(value & 0x80) != 0, zero=value == 0)
+        return value
+
+    def increment(self, value):
+        self.set_flags(half=(value & 0xF) == 0xF, parity=value == 0x7F, subtract=False)
+        return self.set_sz(value + 1)
+
+    def decrement(self, value):
+        self.set_flags(half=(value & 0xF) == 0, parity=value == 0x80, subtract=True)
+        return self.set_sz(value - 1)
+
+    def add_pair(self, left, right):
+        result = left + right
+        self.set_flags(half=((left & 0xFFF) + (right & 0xFFF)) > 0xFFF, subtract=False, carry=result > 0xFFFF)
+        return result & 0xFFFF
+
+    # Rotates and shifts from the CB page. Operation 6 is `sll` on the Z80 and `swap` on the SM83.
+    def rotate(self, op, value):
+        carry = 1 if self.get_flag('carry') else 0
+        if op == 0:
+            out, result = value >> 7, (value << 1) | (value >> 7)
+        elif op == 1:
+            out, result = value & 1, (value >> 1) | ((value & 1) << 7)
+        elif op == 2:
+            out, result = value >> 7, (value << 1) | carry
+        elif op == 3:
+            out, result = value & 1, (value >> 1) | (carry << 7)
+        elif op == 4:
+            out, result = value >> 7, value << 1
+        elif op == 5:
+            out, result = value & 1, (value >> 1) | (value & 0x80)
+        elif op == 6:
+            out, result = self.rotate_sll(value)
+        else:
+            out, result = value & 1, value >> 1
+        self.set_flags(half=False, subtract=False, parity=_parity(result), carry=out != 0)
+        return self.set_sz(result)
+
+    def rotate_sll(self, value):
+        return value >> 7, (value << 1) | 1
+
+    # `rlca`, `rrca`, `rla` and `rra` only change the carry (and on the SM83, clear zero).
+    def rotate_a(self, op):
+        sign, zero, parity = self.f & self.FLAG_BITS.get('sign', 0), self.f & self.FLAG_BITS['zero'], self.f & self.FLAG_BITS.get('parity', 0)
+        self.a = self.rotate(op, self.a)
+        self.set_flags(sign=sign != 0, zero=zero != 0 and self.ROTATE_A_KEEPS_ZERO, parity=parity != 0)
+
+    def test_bit(self, bit, value):
+        zero = (value & (1 << bit)) == 0
+        self.set_flags(zero=zero, half=True, subtract=False, sign=bit == 7 and not zero, parity=zero)
+
+    def condition(self, index):
+        return self.get_flag(('zero', 'carry', 'parity', 'sign')[index >> 1]) == ((index & 1) != 0)
+
+    def jump_relative(self, condition, taken_cycles, not_taken_cycles):
+        offset = self.fetch_displacement()
+        if condition:
+            self.pc = (self.pc + offset) & 0xFFFF
+            self.cycles += taken_cycles
+        else:
+            self.cycles += not_taken_cycles
+
+
+
+class CpuZ80(CpuZ80Family):
+    FLAG_BITS = {
+        'carry': 0x01,
+        'subtract': 0x02,
+        'parity': 0x04,
+        'half': 0x10,
+        'zero': 0x40,
+        'sign': 0x80,
+    }
+    FLAG_MASK = 0xFF
+
+    FLAG_NAMES = {
+        'carry': 'carry',
+        'zero': 'zero',
+        'negative': 'sign',
+        'overflow': 'parity',
+    }
+
+    REGISTERS = CpuZ80Family.REGISTERS + ('ix', 'iy', 'ixh', 'ixl', 'iyh', 'iyl')
+
+    ROTATE_A_KEEPS_ZERO = True
+
+    PAIRS = ('bc', 'de', 'hl', 'sp')
+    PAIRS_AF = ('bc', 'de', 'hl', 'af')
+
+    def __init__(self, memory):
+        super().__init__(memory)
+        self.ix = 0
+        self.iy = 0
+        self.shadow = {'af': 0, 'bc': 0, 'de': 0, 'hl': 0}
+        self.interrupt = False
+        # The index register (`ix` or `iy`) that replaces `hl` in the current instruction, if any.
+        self.index = None
+
+    def get_register(self, name):
+        if name in ('ixh', 'ixl', 'iyh', 'iyl'):
+            value = getattr(self, name[:2])
+            return value >> 8 if name[2] == 'h' else value & 0xFF
+        return super().get_register(name)
+
+    def initialize(self, name, value):
+        if name in ('ixh', 'ixl', 'iyh', 'iyl'):
+            pair = getattr(self, name[:2])
+            pair = ((value & 0xFF) << 8) | (pair & 0xFF) if name[2] == 'h' else (pair & 0xFF00) | (value & 0xFF)
+            setattr(self, name[:2], pair)
+        else:
+            super().initialize(name, value)
+
+    def get_pair(self, name):
+        if name == 'hl' and self.index is not None:
+            return getattr(self, self.index)
+        return super().get_pair(name)
+
+    def set_pair(self, name, value):
+        if name == 'hl' and self.index is not None:
+            setattr(self, self.index, value & 0xFFFF)
+        else:
+            super().set_pair(name, value)
+
+    # Returns the address of the `(hl)` operand, which is `(ix+d)` after an index prefix.
+    def memory_operand(self):
+        if self.index is not None:
+            return (getattr(self, self.index) + self.fetch_displacement()) & 0xFFFF
+        return self.get_pair('hl')
+
+    # 8-bit registers by their encoding. `h` and `l` refer to the index register halves after a prefix,
+    # unless the same instruction also uses `(ix+d)`.
+    def get_r(self, index, address=None, use_index=True):
+        if index == 6:
+            return self.read(address)
+        if index in (4, 5) and self.index is not None and use_index:
+            value = getattr(self, self.index)
+            return value >> 8 if index == 4 else value & 0xFF
+        return getattr(self, 'bcdehla'[index if index < 6 else 6])
+
+    def set_r(self, index, value, address=None, use_index=True):
+        value &= 0xFF
+        if index == 6:
+            self.write(address, value)
+        elif index in (4, 5) and self.index is not None and use_index:
+            pair = getattr(self, self.index)
+            setattr(self, self.index, (value << 8) | (pair & 0xFF) if index == 4 else (pair & 0xFF00) | value)
+        else:
+            setattr(self, 'bcdehla'[index if index < 6 else 6], value)
+
+    def decimal_adjust(self):
+        a = self.a
+        correction = 0
+        carry = self.get_flag('carry')
+        if self.get_flag('half') or (a & 0xF) > 9:
+            correction |= 0x06
+        if carry or a > 0x99:
+            correction |= 0x60
+            carry = True
+        if self.get_flag('subtract'):
+            half = self.get_flag('half') and (a & 0xF) < 6
+            result = a - correction
+        else:
+            half = (a & 0xF) > 9
+            result = a + correction
+        self.set_flags(half=half, carry=carry, parity=_parity(result))
+        self.a = self.set_sz(result)
+
+    def step(self):
+        opcode_address = self.pc
+        self.index = None
+        opcode = self.fetch()
+        self.cycles += 4
+
+        while opcode in (0xDD, 0xFD):
+            self.index = 'ix' if opcode == 0xDD else 'iy'
+            opcode = self.fetch()
+            self.cycles += 4
+
+        if opcode == 0xCB:
+            self.step_cb(opcode_address)
+        elif opcode == 0xED:
+            self.index = None
+            self.step_ed(opcode_address)
+        else:
+            self.step_main(opcode, opcode_address)
+
+        self.index = None
+
+    def step_main(self, opcode, opcode_address):
+        x, y, z = opcode >> 6, (opcode >> 3) & 7, opcode & 7
+        p, q = y >> 1, y & 1
+
+        if x == 0:
+            if z == 0:
+                if y == 0:
+                    pass
+                elif y == 1:
+                    af = self.get_pair('af')
+                    self.set_pair('af', self.shadow['af'])
+                    self.shadow['af'] = af
+                elif y == 2:
+                    self.b = (self.b - 1) & 0xFF
+                    self.cycles += 1
+                    self.jump_relative(self.b != 0, 8, 3)
+                elif y == 3:
+                    self.jump_relative(True, 8, 8)
+                else:
+                    self.jump_relative(self.condition(y - 4), 8, 3)
+            elif z == 1:
+                if q == 0:
+                    self.set_pair(self.PAIRS[p], self.fetch_word())
+                    self.cycles += 6
+                else:
+                    self.set_pair('hl', self.add_pair(self.get_pair('hl'), self.get_pair(self.PAIRS[p])))
+                    self.cycles += 7
+            elif z == 2:
+                if p == 0 or p == 1:
+                    address = self.get_pair(('bc', 'de')[p])
+                    if q == 0:
+                        self.write(address, self.a)
+                    else:
+                        self.a = self.read(address)
+                    self.cycles += 3
+                elif p == 2:
+                    address = self.fetch_word()
+                    if q == 0:
+                        self.write_word(address, self.get_pair('hl'))
+                    else:
+                        self.set_pair('hl', self.read_word(address))
+                    self.cycles += 12
+                else:
+                    address = self.fetch_word()
+                    if q == 0:
+                        self.write(address, self.a)
+                    else:
+                        self.a = self.read(address)
+                    self.cycles += 9
+            elif z == 3:
+                self.set_pair(self.PAIRS[p], self.get_pair(self.PAIRS[p]) + (1 if q == 0 else -1))
+                self.cycles += 2
+            elif z == 4 or z == 5:
+                address = self.memory_operand() if y == 6 else None
+                value = self.get_r(y, address)
+                self.set_r(y, self.increment(value) if z == 4 else self.decrement(value), address)
+                self.cycles += (15 if self.index is not None else 7) if y == 6 else 0
+            elif z == 6:
+                address = self.memory_operand() if y == 6 else None
+                self.set_r(y, self.fetch(), address)
+                self.cycles += (11 if self.index is not None else 6) if y == 6 else 3
+            else:
+                if y < 4:
+                    self.rotate_a(y)
+                elif y == 4:
+                    self.decimal_adjust()
+                elif y == 5:
+                    self.a ^= 0xFF
+                    self.set_flags(half=True, subtract=True)
+                elif y == 6:
+                    self.set_flags(half=False, subtract=False, carry=True)
+                else:
+                    self.set_flags(half=self.get_flag('carry'), subtract=False, carry=not self.get_flag('carry'))
+
+        elif x == 1:
+            if y == 6 and z == 6:
+                raise SimulationError(f"halt executed at 0x{opcode_address:04x}")
+            memory = y == 6 or z == 6
+            address = self.memory_operand() if memory else None
+            self.set_r(y, self.get_r(z, address, not memory), address, not memory)
+            if memory:
+                self.cycles += 11 if self.index is not None else 3
+
+        elif x == 2:
+            address = self.memory_operand() if z == 6 else None
+            self.alu(y, self.get_r(z, address))
+            if z == 6:
+                self.cycles += 11 if self.index is not None else 3
+
+        else:
+            if z == 0:
+                self.cycles += 1
+                if self.condition(y):
+                    self.pc = self.pull()
+                    self.cycles += 6
+            elif z == 1:
+                if q == 0:
+                    self.set_pair(self.PAIRS_AF[p], self.pull())
+                    self.cycles += 6
+                elif p == 0:
+                    self.pc = self.pull()
+                    self.cycles += 6
+                elif p == 1:
+                    for name in ('bc', 'de', 'hl'):
+                        value = self.get_pair(name)
+                        self.set_pair(name, self.shadow[name])
+                        self.shadow[name] = value
+                elif p == 2:
+                    self.pc = self.get_pair('hl')
+                else:
+                    self.sp = self.get_pair('hl')
+                    self.cycles += 2
+            elif z == 2:
+                address = self.fetch_word()
+                if self.condition(y):
+                    self.pc = address
+                self.cycles += 6
+            elif z == 3:
+                if y == 0:
+                    self.pc = self.fetch_word()
+                    self.cycles += 6
+                elif y == 2:
+                    self.fetch()
+                    self.cycles += 7
+                elif y == 3:
+                    self.fetch()
+                    self.a = 0xFF
+                    self.cycles += 7
+                elif y == 4:
+                    value = self.read_word(self.sp)
+                    self.write_word(self.sp, self.get_pair('hl'))
+                    self.set_pair('hl', value)
+                    self.cycles += 15
+                elif y == 5:
+                    # `ex de, hl` is not affected by an index prefix.
+                    self.index = None
+                    de = self.get_pair('de')
+                    self.set_pair('de', self.get_pair('hl'))
+                    self.set_pair('hl', de)
+                else:
+                    self.interrupt = y == 7
+            elif z == 4:
+                address = self.fetch_word()
+                self.cycles += 6
+                if self.condition(y):
+                    self.push(self.pc)
+                    self.pc = address
+                    self.cycles += 7
+            elif z == 5:
+                if q == 0:
+                    self.push(self.get_pair(self.PAIRS_AF[p]))
+                    self.cycles += 7
+                else:
+                    address = self.fetch_word()
+                    self.push(self.pc)
+                    self.pc = address
+                    self.cycles += 13
+            elif z == 6:
+                self.alu(y, self.fetch())
+                self.cycles += 3
+            else:
+                self.push(self.pc)
+                self.pc = y * 8
+                self.cycles += 7
+
+    def step_cb(self, opcode_address):
+        if self.index is not None:
+            address = self.memory_operand()
+            opcode = self.fetch()
+            self.cycles += 4 + (8 if (opcode >> 6) == 1 else 11)
+            register = opcode & 7
+        else:
+            opcode = self.fetch()
+            register = opcode & 7
+            address = self.get_pair('hl') if register == 6 else None
+            self.cycles += 4
+            if register == 6:
+                self.cycles += 4 if (opcode >> 6) == 1 else 7
+
+        x, y = opcode >> 6, (opcode >> 3) & 7
+        value = self.read(address) if address is not None else self.get_r(register, use_index=False)
+
+        if x == 1:
+            self.test_bit(y, value)
+            return
+        elif x == 0:
+            result = self.rotate(y, value)
+        elif x == 2:
+            result = value & ~(1 << y)
+        else:
+            result = value | (1 << y)
+
+        if address is not None:
+            self.write(address, result)
+            # The undocumented `(ix+d)` forms also copy the result into a register.
+            if self.index is not None and register != 6:
+                self.set_r(register, result, use_index=False)
+        else:
+            self.set_r(register, result, use_index=False)
+
+    def step_ed(self, opcode_address):
+        opcode = self.fetch()
+        self.cycles += 4
+        x, y, z = opcode >> 6, (opcode >> 3) & 7, opcode & 7
+        p, q = y >> 1, y & 1
+
+        if x == 1:
+            if z == 0:
+                value = 0xFF
+                if y != 6:
+                    self.set_r(y, value)
+                self.set_sz(value)
+                self.set_flags(half=False, subtract=False, parity=_parity(value))
+                self.cycles += 4
+            elif z == 1:
+                self.cycles += 4
+            elif z == 2:
+                hl = self.get_pair('hl')
+                value = self.get_pair(self.PAIRS[p])
+                carry = 1 if self.get_flag('carry') else 0
+                if q == 0:
+                    result = hl - value - carry
+                    self.set_flags(
+                        half=((hl & 0xFFF) - (value & 0xFFF) - carry) < 0,
+                        parity=((hl ^ value) & (hl ^ result) & 0x8000) != 0,
+                        subtract=True, carry=result < 0)
+                else:
+                    result = hl + value + carry
+                    self.set_flags(
+                        half=((hl & 0xFFF) + (value & 0xFFF) + carry) > 0xFFF,
+                        parity=(~(hl ^ value) & (hl ^ result) & 0x8000) != 0,
+                        subtract=False, carry=result > 0xFFFF)
+                result &= 0xFFFF
+                self.set_flags(sign=(result & 0x8000) != 0, zero=result == 0)
+                self.set_pair('hl', result)
+                self.cycles += 7
+            elif z == 3:
+                address = self.fetch_word()
+                if q == 0:
+                    self.write_word(address, self.get_pair(self.PAIRS[p]))
+                else:
+                    self.set_pair(self.PAIRS[p], self.read_word(address))
+                self.cycles += 12
+            elif z == 4:
+                value = self.a
+                self.a = 0
+                self.alu(2, value)
+            elif z == 5:
+                self.pc = self.pull()
+                self.cycles += 6
+            elif z == 6:
+                pass
+            else:
+                if y == 4 or y == 5:
+                    address = self.get_pair('hl')
+                    value = self.read(address)
+                    if y == 4:
+                        self.write(address, (value >> 4) | ((self.a & 0x0F) << 4))
+                        self.a = (self.a & 0xF0) | (value & 0x0F)
+                    else:
+                        self.write(address, ((value << 4) | (self.a & 0x0F)) & 0xFF)
+                        self.a = (self.a & 0xF0) | (value >> 4)
+                    self.set_sz(self.a)
+                    self.set_flags(half=False, subtract=False, parity=_parity(self.a))
+                    self.cycles += 10
+                elif y < 4:
+                    if y == 2 or y == 3:
+                        self.a = 0
+                        self.set_sz(self.a)
+                        self.set_flags(half=False, subtract=False, parity=self.interrupt)
+                    self.cycles += 1
+        elif x == 2 and z <= 1 and y >= 4:
+            step = 1 if (y & 1) == 0 else -1
+            repeat = y >= 6
+            hl = self.get_pair('hl')
+            bc = (self.get_pair('bc') - 1) & 0xFFFF
+            value = self.read(hl)
+            if z == 0:
+                self.write(self.get_pair('de'), value)
+                self.set_pair('de', self.get_pair('de') + step)
+                self.set_flags(half=False, subtract=False, parity=bc != 0)
+                done = bc == 0
+            else:
+                carry = self.get_flag('carry')
+                result = self.a - value
+                self.set_sz(result)
+                self.set_flags(half=((self.a & 0xF) - (value & 0xF)) < 0, subtract=True, parity=bc != 0, carry=carry)
+                done = bc == 0 or (result & 0xFF) == 0
+            self.set_pair('hl', hl + step)
+            self.set_pair('bc', bc)
+            self.cycles += 8
+            if repeat and not done:
+                self.pc = (self.pc - 2) & 0xFFFF
+                self.cycles += 5
+        else:
+            raise SimulationError(f"unsupported opcode 0xed 0x{opcode:02x} at 0x{opcode_address:04x}")
+
+
+
+class CpuSm83(CpuZ80Family):
+    FLAG_BITS = {
+        'carry': 0x10,
+        'half': 0x20,
+        'subtract': 0x40,
+        'zero': 0x80,
+    }
+    FLAG_MASK = 0xF0
+
+    FLAG_NAMES = {
+        'carry': 'carry',
+        'zero': 'zero',
+    }
+
+    ROTATE_A_KEEPS_ZERO = False
+
+    PAIRS = ('bc', 'de', 'hl', 'sp')
+    PAIRS_AF = ('bc', 'de', 'hl', 'af')
+
+    def __init__(self, memory):
+        super().__init__(memory)
+        self.interrupt = False
+
+    def get_r(self, index, address=None):
+        if index == 6:
+            return self.read(address)
+        return getattr(self, 'bcdehla'[index if index < 6 else 6])
+
+    def set_r(self, index, value, address=None):
+        if index == 6:
+            self.write(address, value)
+        else:
+            setattr(self, 'bcdehla'[index if index < 6 else 6], value & 0xFF)
+
+    def rotate_sll(self, value):
+        # `swap` takes the place of `sll`, and always clears the carry.
+        return 0, ((value << 4) | (value >> 4)) & 0xFF
+
+    def condition(self, index):
+        return self.get_flag(('zero', 'carry')[index >> 1]) == ((index & 1) != 0)
+
+    def decimal_adjust(self):
+        a = self.a
+        carry = self.get_flag('carry')
+        if self.get_flag('subtract'):
+            if carry:
+                a -= 0x60
+            if self.get_flag('half'):
+                a -= 0x06
+        else:
+            if carry or a > 0x99:
+                a += 0x60
+                carry = True
+            if self.get_flag('half') or (a & 0x0F) > 0x09:
+                a += 0x06
+        self.set_flags(half=False, carry=carry)
+        self.a = self.set_sz(a)
+
+    def add_sp_offset(self):
+        offset = self.fetch()
+        sp = self.sp
+        self.set_flags(zero=False, subtract=False,
+            half=((sp & 0xF) + (offset & 0xF)) > 0xF,
+            carry=((sp & 0xFF) + offset) > 0xFF)
+        return (sp + (offset - 0x100 if offset & 0x80 else offset)) & 0xFFFF
+
+    def step(self):
+        opcode_address = self.pc
+        opcode = self.fetch()
+        self.cycles += 4
+
+        x, y, z = opcode >> 6, (opcode >> 3) & 7, opcode & 7
+        p, q = y >> 1, y & 1
+
+        if opcode == 0xCB:
+            self.step_cb()
+        elif x == 0:
+            if z == 0:
+                if y == 0:
+                    pass
+                elif y == 1:
+                    self.write_word(self.fetch_word(), self.sp)
+                    self.cycles += 16
+                elif y == 2:
+                    raise SimulationError(f"stop executed at 0x{opcode_address:04x}")
+                elif y == 3:
+                    self.jump_relative(True, 8, 8)
+                else:
+                    self.jump_relative(self.condition(y - 4), 8, 4)
+            elif z == 1:
+                if q == 0:
+                    self.set_pair(self.PAIRS[p], self.fetch_word())
+                    self.cycles += 8
+                else:
+                    self.set_pair('hl', self.add_pair(self.get_pair('hl'), self.get_pair(self.PAIRS[p])))
+                    self.cycles += 4
+            elif z == 2:
+                if p < 2:
+                    address = self.get_pair(('bc', 'de')[p])
+                else:
+                    address = self.get_pair('hl')
+                    self.set_pair('hl', address + (1 if p == 2 else -1))
+                if q == 0:
+                    self.write(address, self.a)
+                else:
+                    self.a = self.read(address)
+                self.cycles += 4
+            elif z == 3:
+                self.set_pair(self.PAIRS[p], self.get_pair(self.PAIRS[p]) + (1 if q == 0 else -1))
+                self.cycles += 4
+            elif z == 4 or z == 5:
+                address = self.get_pair('hl') if y == 6 else None
+                value = self.get_r(y, address)
+                self.set_r(y, self.increment(value) if z == 4 else self.decrement(value), address)
+                self.cycles += 8 if y == 6 else 0
+            elif z == 6:
+                address = self.get_pair('hl') if y == 6 else None
+                self.set_r(y, self.fetch(), address)
+                self.cycles += 8 if y == 6 else 4
+            else:
+                if y < 4:
+                    self.rotate_a(y)
+                elif y == 4:
+                    self.decimal_adjust()
+                elif y == 5:
+                    self.a ^= 0xFF
+                    self.set_flags(half=True, subtract=True)
+                elif y == 6:
+                    self.set_flags(half=False, subtract=False, carry=True)
+                else:
+                    self.set_flags(half=False, subtract=False, carry=not self.get_flag('carry'))
+
+        elif x == 1:
+            if y == 6 and z == 6:
+                raise SimulationError(f"halt executed at 0x{opcode_address:04x}")
+            address = self.get_pair('hl') if y == 6 or z == 6 else None
+            self.set_r(y, self.get_r(z, address), address)
+            if address is not None:
+                self.cycles += 4
+
+        elif x == 2:
+            address = self.get_pair('hl') if z == 6 else None
+            self.alu(y, self.get_r(z, address))
+            if z == 6:
+                self.cycles += 4
+
+        else:
+            if z == 0:
+                if y < 4:
+                    self.cycles += 4
+                    if self.condition(y):
+                        self.pc = self.pull()
+                        self.cycles += 12
+                elif y == 4 or y == 6:
+                    address = 0xFF00 | self.fetch()
+                    if y == 4:
+                        self.write(address, self.a)
+                    else:
+                        self.a = self.read(address)
+                    self.cycles += 8
+                elif y == 5:
+                    self.sp = self.add_sp_offset()
+                    self.cycles += 12
+                else:
+                    self.set_pair('hl', self.add_sp_offset())
+                    self.cycles += 8
+            elif z == 1:
+                if q == 0:
+                    self.set_pair(self.PAIRS_AF[p], self.pull())
+                    self.cycles += 8
+                elif p == 0 or p == 1:
+                    self.pc = self.pull()
+                    self.interrupt = self.interrupt or p == 1
+                    self.cycles += 12
+                elif p == 2:
+                    self.pc = self.get_pair('hl')
+                else:
+                    self.sp = self.get_pair('hl')
+                    self.cycles += 4
+            elif z == 2:
+                if y < 4:
+                    address = self.fetch_word()
+                    self.cycles += 8
+                    if self.condition(y):
+                        self.pc = address
+                        self.cycles += 4
+                else:
+                    if y == 4 or y == 6:
+                        address = 0xFF00 | self.c
+                        self.cycles += 4
+                    else:
+                        address = self.fetch_word()
+                        self.cycles += 12
+                    if y == 4 or y == 5:
+                        self.write(address, self.a)
+                    else:
+                        self.a = self.read(address)
+            elif z == 3 and y == 0:
+                self.pc = self.fetch_word()
+                self.cycles += 12
+            elif z == 3 and (y == 6 or y == 7):
+                self.interrupt = y == 7
+            elif z == 4 and y < 4:
+                address = self.fetch_word()
+                self.cycles += 8
+                if self.condition(y):
+                    self.push(self.pc)
+                    self.pc = address
+                    self.cycles += 12
+            elif z == 5 and q == 0:
+                self.push(self.get_pair(self.PAIRS_AF[p]))
+                self.cycles += 12
+            elif z == 5 and p == 0:
+                address = self.fetch_word()
+                self.push(self.pc)
+                self.pc = address
+                self.cycles += 20
+            elif z == 6:
+                self.alu(y, self.fetch())
+                self.cycles += 4
+            elif z == 7:
+                self.push(self.pc)
+                self.pc = y * 8
+                self.cycles += 12
+            else:
+                raise SimulationError(f"unsupported opcode 0x{opcode:02x} at 0x{opcode_address:04x}")
+
+    def step_cb(self):
+        opcode = self.fetch()
+        self.cycles += 4
+        x, y, z = opcode >> 6, (opcode >> 3) & 7, opcode & 7
+        address = self.get_pair('hl') if z == 6 else None
+        value = self.get_r(z, address)
+
+        if x == 1:
+            self.test_bit(y, value)
+            self.cycles += 4 if z == 6 else 0
+            return
+        elif x == 0:
+            result = self.rotate(y, value)
+        elif x == 2:
+            result = value & ~(1 << y)
+        else:
+            result = value | (1 << y)
+
+        self.set_r(z, result, address)
+        self.cycles += 8 if z == 6 else 0
+
+
+
+SPC700_FLAG_C = 0x01
+SPC700_FLAG_Z = 0x02
+SPC700_FLAG_I = 0x04
+SPC700_FLAG_H = 0x08
+SPC700_FLAG_B = 0x10
+SPC700_FLAG_P = 0x20
+SPC700_FLAG_V = 0x40
+SPC700_FLAG_N = 0x80
+
+
+# An immediate operand.
+Immediate = namedtuple('Immediate', ('value',))
+
+# A `mem.bit` operand of the SPC700 one-bit instructions, `inverted` for the `/mem.bit` form.
+MemoryBit = namedtuple('MemoryBit', ('address', 'bit', 'inverted'))
+
+
+# opcode: (mnemonic, destination, source, cycles)
+#
+# The operands are resolved source first, which is the order of their bytes in the instruction
+# (`mov dp, dp` and `mov dp, #imm` encode the source before the destination).
+# Branches, `cbne` and `dbnz` fetch their relative target after the other operands.
+# The bit number of `set1`, `clr1`, `bbs` and `bbc`, and the vector of `tcall`, take the place of the source.
+OPCODES_SPC700 = {
+    0x08: ('or', 'a', '#', 2), 0x04: ('or', 'a', 'dp', 3), 0x14: ('or', 'a', 'dp+x', 4), 0x05: ('or', 'a', 'abs', 4),
+    0x15: ('or', 'a', 'abs+x', 5), 0x16: ('or', 'a', 'abs+y', 5), 0x06: ('or', 'a', '(x)', 3), 0x07: ('or', 'a', '[dp+x]', 6),
+    0x17: ('or', 'a', '[dp]+y', 6), 0x09: ('or', 'dp', 'dp', 6), 0x18: ('or', 'dp', '#', 5), 0x19: ('or', '(x)', '(y)', 5),
+
+    0x28: ('and', 'a', '#', 2), 0x24: ('and', 'a', 'dp', 3), 0x34: ('and', 'a', 'dp+x', 4), 0x25: ('and', 'a', 'abs', 4),
+    0x35: ('and', 'a', 'abs+x', 5), 0x36: ('and', 'a', 'abs+y', 5), 0x26: ('and', 'a', '(x)', 3), 0x27: ('and', 'a', '[dp+x]', 6),
+    0x37: ('and', 'a', '[dp]+y', 6), 0x29: ('and', 'dp', 'dp', 6), 0x38: ('and', 'dp', '#', 5), 0x39: ('and', '(x)', '(y)', 5),
+
+    0x48: ('eor', 'a', '#', 2), 0x44: ('eor', 'a', 'dp', 3), 0x54: ('eor', 'a', 'dp+x', 4), 0x45: ('eor', 'a', 'abs', 4),
+    0x55: ('eor', 'a', 'abs+x', 5), 0x56: ('eor', 'a', 'abs+y', 5), 0x46: ('eor', 'a', '(x)', 3), 0x47: ('eor', 'a', '[dp+x]', 6),
+    0x57: ('eor', 'a', '[dp]+y', 6), 0x49: ('eor', 'dp', 'dp', 6), 0x58: ('eor', 'dp', '#', 5), 0x59: ('eor', '(x)', '(y)', 5),
+
+    0x68: ('cmp', 'a', '#', 2), 0x64: ('cmp', 'a', 'dp', 3), 0x74: ('cmp', 'a', 'dp+x', 4), 0x65: ('cmp', 'a', 'abs', 4),
+    0x75: ('cmp', 'a', 'abs+x', 5), 0x76: ('cmp', 'a', 'abs+y', 5), 0x66: ('cmp', 'a', '(x)', 3), 0x67: ('cmp', 'a', '[dp+x]', 6),
+    0x77: ('cmp', 'a', '[dp]+y', 6), 0x69: ('cmp', 'dp', 'dp', 6), 0x78: ('cmp', 'dp', '#', 5), 0x79: ('cmp', '(x)', '(y)', 5),
+    0xC8: ('cmp', 'x', '#', 2), 0x3E: ('cmp', 'x', 'dp', 3), 0x1E: ('cmp', 'x', 'abs', 4),
+    0xAD: ('cmp', 'y', '#', 2), 0x7E: ('cmp', 'y', 'dp', 3), 0x5E: ('cmp', 'y', 'abs', 4),
+
+    0x88: ('adc', 'a', '#', 2), 0x84: ('adc', 'a', 'dp', 3), 0x94: ('adc', 'a', 'dp+x', 4), 0x85: ('adc', 'a', 'abs', 4),
+    0x95: ('adc', 'a', 'abs+x', 5), 0x96: ('adc', 'a', 'abs+y', 5), 0x86: ('adc', 'a', '(x)', 3), 0x87: ('adc', 'a', '[dp+x]', 6),
+    0x97: ('adc', 'a', '[dp]+y', 6), 0x89: ('adc', 'dp', 'dp', 6), 0x98: ('adc', 'dp', '#', 5), 0x99: ('adc', '(x)', '(y)', 5),
+
+    0xA8: ('sbc', 'a', '#', 2), 0xA4: ('sbc', 'a', 'dp', 3), 0xB4: ('sbc', 'a', 'dp+x', 4), 0xA5: ('sbc', 'a', 'abs', 4),
+    0xB5: ('sbc', 'a', 'abs+x', 5), 0xB6: ('sbc', 'a', 'abs+y', 5), 0xA6: ('sbc', 'a', '(x)', 3), 0xA7: ('sbc', 'a', '[dp+x]', 6),
+    0xB7: ('sbc', 'a', '[dp]+y', 6), 0xA9: ('sbc', 'dp', 'dp', 6), 0xB8: ('sbc', 'dp', '#', 5), 0xB9: ('sbc', '(x)', '(y)', 5),
+
+    0xE8: ('mov', 'a', '#', 2), 0xE4: ('mov', 'a', 'dp', 3), 0xF4: ('mov', 'a', 'dp+x', 4), 0xE5: ('mov', 'a', 'abs', 4),
+    0xF5: ('mov', 'a', 'abs+x', 5), 0xF6: ('mov', 'a', 'abs+y', 5), 0xE6: ('mov', 'a', '(x)', 3), 0xBF: ('mov', 'a', '(x)+', 4),
+    0xE7: ('mov', 'a', '[dp+x]', 6), 0xF7: ('mov', 'a', '[dp]+y', 6),
+    0xCD: ('mov', 'x', '#', 2), 0xF8: ('mov', 'x', 'dp', 3), 0xF9: ('mov', 'x', 'dp+y', 4), 0xE9: ('mov', 'x', 'abs', 4),
+    0x8D: ('mov', 'y', '#', 2), 0xEB: ('mov', 'y', 'dp', 3), 0xFB: ('mov', 'y', 'dp+x', 4), 0xEC: ('mov', 'y', 'abs', 4),
+
+    0xC4: ('mov', 'dp', 'a', 4), 0xD4: ('mov', 'dp+x', 'a', 5), 0xC5: ('mov', 'abs', 'a', 5), 0xD5: ('mov', 'abs+x', 'a', 6),
+    0xD6: ('mov', 'abs+y', 'a', 6), 0xC6: ('mov', '(x)', 'a', 4), 0xAF: ('mov', '(x)+', 'a', 4), 0xC7: ('mov', '[dp+x]', 'a', 7),
+    0xD7: ('mov', '[dp]+y', 'a', 7),
+    0xD8: ('mov', 'dp', 'x', 4), 0xD9: ('mov', 'dp+y', 'x', 5), 0xC9: ('mov', 'abs', 'x', 5),
+    0xCB: ('mov', 'dp', 'y', 4), 0xDB: ('mov', 'dp+x', 'y', 5), 0xCC: ('mov', 'abs', 'y', 5),
+
+    0x7D: ('mov', 'a', 'x', 2), 0xDD: ('mov', 'a', 'y', 2), 0x5D: ('mov', 'x', 'a', 2), 0xFD: ('mov', 'y', 'a', 2),
+    0x9D: ('mov', 'x', 'sp', 2), 0xBD: ('mov', 'sp', 'x', 2),
+    0xFA: ('mov', 'dp', 'dp', 5), 0x8F: ('mov', 'dp', '#', 5),
+
+    0xBA: ('movw', 'ya', 'dp', 5), 0xDA: ('movw', 'dp', 'ya', 5),
+    0x3A: ('incw', 'dp', None, 6), 0x1A: ('decw', 'dp', None, 6),
+    0x7A: ('addw', 'ya', 'dp', 5), 0x9A: ('subw', 'ya', 'dp', 5), 0x5A: ('cmpw', 'ya', 'dp', 4),
+    0xCF: ('mul', 'ya', None, 9), 0x9E: ('div', 'ya', 'x', 12),
+    0xDF: ('daa', 'a', None, 3), 0xBE: ('das', 'a', None, 3), 0x9F: ('xcn', 'a', None, 5),
+
+    0x1C: ('asl', 'a', None, 2), 0x0B: ('asl', 'dp', None, 4), 0x1B: ('asl', 'dp+x', None, 5), 0x0C: ('asl', 'abs', None, 5),
+    0x3C: ('rol', 'a', None, 2), 0x2B: ('rol', 'dp', None, 4), 0x3B: ('rol', 'dp+x', None, 5), 0x2C: ('rol', 'abs', None, 5),
+    0x5C: ('lsr', 'a', None, 2), 0x4B: ('lsr', 'dp', None, 4), 0x5B: ('lsr', 'dp+x', None, 5), 0x4C: ('lsr', 'abs', None, 5),
+    0x7C: ('ror', 'a', None, 2), 0x6B: ('ror', 'dp', None, 4), 0x7B: ('ror', 'dp+x', None, 5), 0x6C: ('ror', 'abs', None, 5),
+
+    0xBC: ('inc', 'a', None, 2), 0x3D: ('inc', 'x', None, 2), 0xFC: ('inc', 'y', None, 2),
+    0xAB: ('inc', 'dp', None, 4), 0xBB: ('inc', 'dp+x', None, 5), 0xAC: ('inc', 'abs', None, 5),
+    0x9C: ('dec', 'a', None, 2), 0x1D: ('dec', 'x', None, 2), 0xDC: ('dec', 'y', None, 2),
+    0x8B: ('dec', 'dp', None, 4), 0x9B: ('dec', 'dp+x', None, 5), 0x8C: ('dec', 'abs', None, 5),
+
+    0x2D: ('push', None, 'a', 4), 0x4D: ('push', None, 'x', 4), 0x6D: ('push', None, 'y', 4), 0x0D: ('push', None, 'psw', 4),
+    0xAE: ('pop', 'a', None, 4), 0xCE: ('pop', 'x', None, 4), 0xEE: ('pop', 'y', None, 4), 0x8E: ('pop', 'psw', None, 4),
+
+    0x2F: ('bra', None, None, 2),
+    0x10: ('bpl', None, None, 2), 0x30: ('bmi', None, None, 2), 0x50: ('bvc', None, None, 2), 0x70: ('bvs', None, None, 2),
+    0x90: ('bcc', None, None, 2), 0xB0: ('bcs', None, None, 2), 0xD0: ('bne', None, None, 2), 0xF0: ('beq', None, None, 2),
+    0x2E: ('cbne', 'dp', None, 5), 0xDE: ('cbne', 'dp+x', None, 6),
+    0x6E: ('dbnz', 'dp', None, 5), 0xFE: ('dbnz', 'y', None, 4),
+
+    0x5F: ('jmp', None, 'abs', 3), 0x1F: ('jmp', None, '[abs+x]', 6),
+    0x3F: ('call', None, 'abs', 8), 0x4F: ('pcall', None, '#', 6),
+    0x6F: ('ret', None, None, 5), 0x7F: ('reti', None, None, 6),
+
+    0x0E: ('tset1', 'abs', None, 6), 0x4E: ('tclr1', 'abs', None, 6),
+    0x0A: ('or1', 'c', 'mem.bit', 5), 0x2A: ('or1', 'c', '/mem.bit', 5),
+    0x4A: ('and1', 'c', 'mem.bit', 4), 0x6A: ('and1', 'c', '/mem.bit', 4),
+    0x8A: ('eor1', 'c', 'mem.bit', 5), 0xAA: ('mov1', 'c', 'mem.bit', 4),
+    0xCA: ('mov1', 'mem.bit', 'c', 6), 0xEA: ('not1', 'mem.bit', None, 5),
+
+    0x60: ('clrc', None, None, 2), 0x80: ('setc', None, None, 2), 0xED: ('notc', None, None, 3), 0xE0: ('clrv', None, None, 2),
+    0x20: ('clrp', None, None, 2), 0x40: ('setp', None, None, 2), 0xA0: ('ei', None, None, 3), 0xC0: ('di', None, None, 3),
+
+    0x00: ('nop', None, None, 2), 0x0F: ('brk', None, None, 8), 0xEF: ('sleep', None, None, 3), 0xFF: ('stop', None, None, 3),
+}
+
+for _bit in range(8):
+    OPCODES_SPC700[0x02 | (_bit << 5)] = ('set1', 'dp', _bit, 4)
+    OPCODES_SPC700[0x12 | (_bit << 5)] = ('clr1', 'dp', _bit, 4)
+    OPCODES_SPC700[0x03 | (_bit << 5)] = ('bbs', 'dp', _bit, 5)
+    OPCODES_SPC700[0x13 | (_bit << 5)] = ('bbc', 'dp', _bit, 5)
+
+for _vector in range(16):
+    OPCODES_SPC700[0x01 | (_vector << 4)] = ('tcall', None, _vector, 8)
+
+# mnemonic: (flag, value taking the branch), or None for `bra`
+SPC700_BRANCH_CONDITIONS = {
+    'bra': None,
+    'bcc': (SPC700_FLAG_C, False), 'bcs': (SPC700_FLAG_C, True),
+    'bne': (SPC700_FLAG_Z, False), 'beq': (SPC700_FLAG_Z, True),
+    'bpl': (SPC700_FLAG_N, False), 'bmi': (SPC700_FLAG_N, True),
+    'bvc': (SPC700_FLAG_V, False), 'bvs': (SPC700_FLAG_V, True),
+}
+
+
+
+class CpuSpc700:
+    """Sony SPC700. Instructions are decoded with `OPCODES_SPC700`, and each mnemonic is executed by its `op_` method."""
+
+    REGISTERS = ('a', 'x', 'y', 'sp', 'psw', 'ya')
+
+    # wiz name (used in `// SIMULATE` tags): bit in psw
+    FLAG_NAMES = {
+        'carry': SPC700_FLAG_C,
+        'zero': SPC700_FLAG_Z,
+        'interrupt': SPC700_FLAG_I,
+        'half_carry': SPC700_FLAG_H,
+        'break_flag': SPC700_FLAG_B,
+        'direct_page': SPC700_FLAG_P,
+        'overflow': SPC700_FLAG_V,
+        'negative': SPC700_FLAG_N,
+    }
+
+    def __init__(self, memory):
+        self.memory = memory
+        self.a = 0
+        self.x = 0
+        self.y = 0
+        self.sp = 0xFF
+        self.psw = 0
+        self.pc = 0
+        self.cycles = 0
+        self.opcode_address = 0
+
+    def read(self, address):
+        return self.memory[address & 0xFFFF]
+
+    def write(self, address, value):
+        self.memory[address & 0xFFFF] = value & 0xFF
+
+    def read_word(self, address):
+        return self.read(address) | (self.read(address + 1) << 8)
+
+    # Word accesses to the direct page wrap around within the page.
+    def read_word_direct(self, address):
+        return self.read(address) | (self.read((address & 0xFF00) | ((address + 1) & 0xFF)) << 8)
+
+    def write_word_direct(self, address, value):
+        self.write(address, value)
+        self.write((address & 0xFF00) | ((address + 1) & 0xFF), value >> 8)
+
+    def direct(self, offset):
+        return (0x100 if self.get_flag(SPC700_FLAG_P) else 0) | (offset & 0xFF)
+
+    def push(self, value):
+        self.write(0x100 | self.sp, value)
+        self.sp = (self.sp - 1) & 0xFF
+
+    def pull(self):
+        self.sp = (self.sp + 1) & 0xFF
+        return self.read(0x100 | self.sp)
+
+    def get_flag(self, flag):
+        return (self.psw & flag) != 0
+
+    def set_flag(self, flag, value):
+        if value:
+            self.psw |= flag
+        else:
+            self.psw &= ~flag
+
+    def get_ya(self):
+        return (self.y << 8) | self.a
+
+    def set_ya(self, value):
+        self.y = (value >> 8) & 0xFF
+        self.a = value & 0xFF
+
+    def get_register(self, name):
+        if name == 'ya':
+            return self.get_ya()
+        elif name in self.REGISTERS:
+            return getattr(self, name)
+        elif name in self.FLAG_NAMES:
+            return 1 if self.get_flag(self.FLAG_NAMES[name]) else 0
+        else:
+            raise SimulationError(f"unknown register {name}")
+
+    def initialize(self, name, value):
+        if name in ('a', 'x', 'y'):
+            setattr(self, name, value & 0xFF)
+        elif name == 'ya':
+            self.set_ya(value)
+        elif name in self.FLAG_NAMES:
+            self.set_flag(self.FLAG_NAMES[name], value)
+        else:
+            raise SimulationError(f"cannot initialize register {name}")
+
+    def call(self, entry, return_address):
+        self.push(return_address >> 8)
+        self.push(return_address & 0xFF)
+        self.pc = entry
+
+    def set_nz(self, value):
+        self.set_flag(SPC700_FLAG_Z, (value & 0xFF) == 0)
+        self.set_flag(SPC700_FLAG_N, (value & 0x80) != 0)
+        return value & 0xFF
+
+    def set_nz16(self, value):
+        self.set_flag(SPC700_FLAG_Z, (value & 0xFFFF) == 0)
+        self.set_flag(SPC700_FLAG_N, (value & 0x8000) != 0)
+        return value & 0xFFFF
+
+    def fetch(self):
+        value = self.read(self.pc)
+        self.pc = (self.pc + 1) & 0xFFFF
+        return value
+
+    def fetch_word(self):
+        lo = self.fetch()
+        return lo | (self.fetch() << 8)
+
+    def resolve(self, operand):
+        """Returns the location of an operand: a register name, a memory address, an `Immediate` or a `MemoryBit`."""
+
+        if operand is None or isinstance(operand, int) or operand in ('a', 'x', 'y', 'sp', 'psw', 'ya', 'c'):
+            return operand
+        elif operand == '#':
+            return Immediate(self.fetch())
+        elif operand == 'dp':
+            return self.direct(self.fetch())
+        elif operand == 'dp+x':
+            return self.direct(self.fetch() + self.x)
+        elif operand == 'dp+y':
+            return self.direct(self.fetch() + self.y)
+        elif operand == 'abs':
+            return self.fetch_word()
+        elif operand == 'abs+x':
+            return (self.fetch_word() + self.x) & 0xFFFF
+        elif operand == 'abs+y':
+            return (self.fetch_word() + self.y) & 0xFFFF
+        elif operand == '(x)':
+            return self.direct(self.x)
+        elif operand == '(y)':
+            return self.direct(self.y)
+        elif operand == '(x)+':
+            address = self.direct(self.x)
+            self.x = (self.x + 1) & 0xFF
+            return address
+        elif operand == '[dp+x]':
+            return self.read_word_direct(self.direct(self.fetch() + self.x))
+        elif operand == '[dp]+y':
+            return (self.read_word_direct(self.direct(self.fetch())) + self.y) & 0xFFFF
+        elif operand == '[abs+x]':
+            return self.read_word((self.fetch_word() + self.x) & 0xFFFF)
+        elif operand in ('mem.bit', '/mem.bit'):
+            value = self.fetch_word()
+            return MemoryBit(value & 0x1FFF, value >> 13, operand.startswith('/'))
+        else:
+            raise SimulationError(f"unsupported operand {operand}")
+
+    def load(self, location):
+        if isinstance(location, str):
+            return getattr(self, location)
+        elif isinstance(location, Immediate):
+            return location.value
+        else:
+            return self.read(location)
+
+    def store(self, location, value):
+        if isinstance(location, str):
+            setattr(self, location, value & 0xFF)
+        else:
+            self.write(location, value)
+
+    def load_bit(self, location):
+        return ((self.read(location.address) >> location.bit) & 1) != location.inverted
+
+    def store_bit(self, location, value):
+        mask = 1 << location.bit
+        self.write(location.address, (self.read(location.address) & ~mask) | (mask if value else 0))
+
+    def branch(self, taken):
+        offset = self.fetch()
+        if offset & 0x80:
+            offset -= 0x100
+        if taken:
+            self.pc = (self.pc + offset) & 0xFFFF
+            self.cycles += 2
+
+    def add(self, left, right):
+        carry = 1 if self.get_flag(SPC700_FLAG_C) else 0
+        result = left + right + carry
+        self.set_flag(SPC700_FLAG_C, result > 0xFF)
+        self.set_flag(SPC700_FLAG_V, (~(left ^ right) & (left ^ result) & 0x80) != 0)
+        self.set_flag(SPC700_FLAG_H, (left & 0x0F) + (right & 0x0F) + carry > 0x0F)
+        return self.set_nz(result)
+
+    def step(self):
+        self.opcode_address = self.pc
+        mnemonic, destination, source, cycles = OPCODES_SPC700[self.fetch()]
+        self.cycles += cycles
+
+        source = self.resolve(source)
+        destination = self.resolve(destination)
+
+        if mnemonic in SPC700_BRANCH_CONDITIONS:
+            condition = SPC700_BRANCH_CONDITIONS[mnemonic]
+            self.branch(condition is None or self.get_flag(condition[0]) == condition[1])
+        else:
+            getattr(self, 'op_' + mnemonic)(destination, source)
+
+    def op_mov(self, destination, source):
+        value = self.load(source)
+        self.store(destination, value)
+        # Only the loads into a, x and y set the flags (`mov sp, x` doesn't).
+        if destination in ('a', 'x', 'y'):
+            self.set_nz(value)
+
+    def op_or(self, destination, source):
+        self.store(destination, self.set_nz(self.load(destination) | self.load(source)))
+
+    def op_and(self, destination, source):
+        self.store(destination, self.set_nz(self.load(destination) & self.load(source)))
+
+    def op_eor(self, destination, source):
+        self.store(destination, self.set_nz(self.load(destination) ^ self.load(source)))
+
+    def op_adc(self, destination, source):
+        self.store(destination, self.add(self.load(destination), self.load(source)))
+
+    def op_sbc(self, destination, source):
+        self.store(destination, self.add(self.load(destination), self.load(source) ^ 0xFF))
+
+    def op_cmp(self, destination, source):
+        result = self.load(destination) - self.load(source)
+        self.set_flag(SPC700_FLAG_C, result >= 0)
+        self.set_nz(result)
+
+    def op_asl(self, destination, source):
+        value = self.load(destination)
+        self.set_flag(SPC700_FLAG_C, (value & 0x80) != 0)
+        self.store(destination, self.set_nz(value << 1))
+
+    def op_rol(self, destination, source):
+        value = self.load(destination)
+        carry = 1 if self.get_flag(SPC700_FLAG_C) else 0
+        self.set_flag(SPC700_FLAG_C, (value & 0x80) != 0)
+        self.store(destination, self.set_nz((value << 1) | carry))
+
+    def op_lsr(self, destination, source):
+        value = self.load(destination)
+        self.set_flag(SPC700_FLAG_C, (value & 0x01) != 0)
+        self.store(destination, self.set_nz(value >> 1))
+
+    def op_ror(self, destination, source):
+        value = self.load(destination)
+        carry = 0x80 if self.get_flag(SPC700_FLAG_C) else 0
+        self.set_flag(SPC700_FLAG_C, (value & 0x01) != 0)
+        self.store(destination, self.set_nz((value >> 1) | carry))
+
+    def op_inc(self, destination, source):
+        self.store(destination, self.set_nz(self.load(destination) + 1))
+
+    def op_dec(self, destination, source):
+        self.store(destination, self.set_nz(self.load(destination) - 1))
+
+    def op_xcn(self, destination, source):
+        self.a = self.set_nz((self.a >> 4) | (self.a << 4))
+
+    def op_movw(self, destination, source):
+        if destination == 'ya':
+            self.set_ya(self.set_nz16(self.read_word_direct(source)))
+        else:
+            self.write_word_direct(destination, self.get_ya())
+
+    def op_incw(self, destination, source):
+        self.write_word_direct(destination, self.set_nz16(self.read_word_direct(destination) + 1))
+
+    def op_decw(self, destination, source):
+        self.write_word_direct(destination, self.set_nz16(self.read_word_direct(destination) - 1))
+
+    def op_addw(self, destination, source):
+        left = self.get_ya()
+        right = self.read_word_direct(source)
+        result = left + right
+        self.set_flag(SPC700_FLAG_C, result > 0xFFFF)
+        self.set_flag(SPC700_FLAG_V, (~(left ^ right) & (left ^ result) & 0x8000) != 0)
+        self.set_flag(SPC700_FLAG_H, (left & 0xFFF) + (right & 0xFFF) > 0xFFF)
+        self.set_ya(self.set_nz16(result))
+
+    def op_subw(self, destination, source):
+        left = self.get_ya()
+        right = self.read_word_direct(source)
+        result = left - right
+        self.set_flag(SPC700_FLAG_C, result >= 0)
+        self.set_flag(SPC700_FLAG_V, ((left ^ right) & (left ^ result) & 0x8000) != 0)
+        self.set_flag(SPC700_FLAG_H, (left & 0xFFF) >= (right & 0xFFF))
+        self.set_ya(self.set_nz16(result))
+
+    def op_cmpw(self, destination, source):
+        result = self.get_ya() - self.read_word_direct(source)
+        self.set_flag(SPC700_FLAG_C, result >= 0)
+        self.set_nz16(result)
+
+    def op_mul(self, destination, source):
+        self.set_ya(self.y * self.a)
+        self.set_nz(self.y)
+
+    def op_div(self, destination, source):
+        # Matches the hardware, including the results when the quotient doesn't fit in 8 bits.
+        dividend = self.get_ya()
+        self.set_flag(SPC700_FLAG_V, self.y >= self.x)
+        self.set_flag(SPC700_FLAG_H, (self.y & 0x0F) >= (self.x & 0x0F))
+        if self.y < (self.x << 1):
+            quotient, remainder = dividend // self.x, dividend % self.x
+        else:
+            quotient = 255 - (dividend - (self.x << 9)) // (256 - self.x)
+            remainder = self.x + (dividend - (self.x << 9)) % (256 - self.x)
+        self.y = remainder & 0xFF
+        self.a = self.set_nz(quotient)
+
+    def op_daa(self, destination, source):
+        if self.get_flag(SPC700_FLAG_C) or self.a > 0x99:
+            self.a = (self.a + 0x60) & 0xFF
+            self.set_flag(SPC700_FLAG_C, True)
+        if self.get_flag(SPC700_FLAG_H) or (self.a & 0x0F) > 0x09:
+            self.a = (self.a + 0x06) & 0xFF
+        self.set_nz(self.a)
+
+    def op_das(self, destination, source):
+        if not self.get_flag(SPC700_FLAG_C) or self.a > 0x99:
+            self.a = (self.a - 0x60) & 0xFF
+            self.set_flag(SPC700_FLAG_C, False)
+        if not self.get_flag(SPC700_FLAG_H) or (self.a & 0x0F) > 0x09:
+            self.a = (self.a - 0x06) & 0xFF
+        self.set_nz(self.a)
+
+    def op_push(self, destination, source):
+        self.push(self.load(source))
+
+    def op_pop(self, destination, source):
+        self.store(destination, self.pull())
+
+    def op_cbne(self, destination, source):
+        self.branch(self.a != self.load(destination))
+
+    def op_dbnz(self, destination, source):
+        value = (self.load(destination) - 1) & 0xFF
+        self.store(destination, value)
+        self.branch(value != 0)
+
+    def op_bbs(self, destination, source):
+        self.branch((self.read(destination) & (1 << source)) != 0)
+
+    def op_bbc(self, destination, source):
+        self.branch((self.read(destination) & (1 << source)) == 0)
+
+    def op_jmp(self, destination, source):
+        self.pc = source
+
+    def op_call(self, destination, source):
+        self.push(self.pc >> 8)
+        self.push(self.pc & 0xFF)
+        self.pc = source
+
+    def op_pcall(self, destination, source):
+        self.op_call(None, 0xFF00 | source.value)
+
+    def op_tcall(self, destination, source):
+        self.op_call(None, self.read_word(0xFFDE - source * 2))
+
+    def op_ret(self, destination, source):
+        lo = self.pull()
+        self.pc = lo | (self.pull() << 8)
+
+    def op_reti(self, destination, source):
+        self.psw = self.pull()
+        self.op_ret(None, None)
+
+    def op_set1(self, destination, source):
+        self.write(destination, self.read(destination) | (1 << source))
+
+    def op_clr1(self, destination, source):
+        self.write(destination, self.read(destination) & ~(1 << source))
+
+    def op_tset1(self, destination, source):
+        value = self.read(destination)
+        self.set_nz(self.a - value)
+        self.write(destination, value | self.a)
+
+    def op_tclr1(self, destination, source):
+        value = self.read(destination)
+        self.set_nz(self.a - value)
+        self.write(destination, value & ~self.a)
+
+    def op_or1(self, destination, source):
+        self.set_flag(SPC700_FLAG_C, self.get_flag(SPC700_FLAG_C) or self.load_bit(source))
+
+    def op_and1(self, destination, source):
+        self.set_flag(SPC700_FLAG_C, self.get_flag(SPC700_FLAG_C) and self.load_bit(source))
+
+    def op_eor1(self, destination, source):
+        self.set_flag(SPC700_FLAG_C, self.get_flag(SPC700_FLAG_C) != self.load_bit(source))
+
+    def op_mov1(self, destination, source):
+        if destination == 'c':
+            self.set_flag(SPC700_FLAG_C, self.load_bit(source))
+        else:
+            self.store_bit(destination, self.get_flag(SPC700_FLAG_C))
+
+    def op_not1(self, destination, source):
+        self.store_bit(destination, not self.load_bit(destination))
+
+    def op_clrc(self, destination, source):
+        self.set_flag(SPC700_FLAG_C, False)
+
+    def op_setc(self, destination, source):
+        self.set_flag(SPC700_FLAG_C, True)
+
+    def op_notc(self, destination, source):
+        self.set_flag(SPC700_FLAG_C, not self.get_flag(SPC700_FLAG_C))
+
+    def op_clrv(self, destination, source):
+        self.set_flag(SPC700_FLAG_V, False)
+        self.set_flag(SPC700_FLAG_H, False)
+
+    def op_clrp(self, destination, source):
+        self.set_flag(SPC700_FLAG_P, False)
+
+    def op_setp(self, destination, source):
+        self.set_flag(SPC700_FLAG_P, True)
+
+    def op_ei(self, destination, source):
+        self.set_flag(SPC700_FLAG_I, True)
+
+    def op_di(self, destination, source):
+        self.set_flag(SPC700_FLAG_I, False)
+
+    def op_nop(self, destination, source):
+        pass
+
+    def op_brk(self, destination, source):
+        raise SimulationError(f"brk executed at 0x{self.opcode_address:04x}")
+
+    def op_sleep(self, destination, source):
+        raise SimulationError(f"sleep executed at 0x{self.opcode_address:04x}")
+
+    def op_stop(self, destination, source):
+        raise SimulationError(f"stop executed at 0x{self.opcode_address:04x}")
+
+
+
+FLAG_X_65816 = 0x10
+FLAG_M_65816 = 0x20
+
+
+# opcode: (mnemonic, addressing mode, cycles, extra cycle on page crossing or with 16-bit index registers)
+#
+# The cycles are those of native mode with 8-bit registers and a page-aligned direct page.
+# Accessing an extra operand byte (16-bit registers) and a misaligned direct page each add a cycle.
+OPCODES_65816 = {
+    0x69: ('adc', 'imm', 2, False), 0x65: ('adc', 'dp', 3, False), 0x75: ('adc', 'dpx', 4, False), 0x72: ('adc', '(dp)', 5, False),
+    0x61: ('adc', '(dp,x)', 6, False), 0x71: ('adc', '(dp),y', 5, True), 0x67: ('adc', '[dp]', 6, False), 0x77: ('adc', '[dp],y', 6, False),
+    0x6D: ('adc', 'abs', 4, False), 0x7D: ('adc', 'absx', 4, True), 0x79: ('adc', 'absy', 4, True), 0x6F: ('adc', 'long', 5, False),
+    0x7F: ('adc', 'longx', 5, False), 0x63: ('adc', 'sr', 4, False), 0x73: ('adc', '(sr),y', 7, False),
+
+    0x29: ('and', 'imm', 2, False), 0x25: ('and', 'dp', 3, False), 0x35: ('and', 'dpx', 4, False), 0x32: ('and', '(dp)', 5, False),
+    0x21: ('and', '(dp,x)', 6, False), 0x31: ('and', '(dp),y', 5, True), 0x27: ('and', '[dp]', 6, False), 0x37: ('and', '[dp],y', 6, False),
+    0x2D: ('and', 'abs', 4, False), 0x3D: ('and', 'absx', 4, True), 0x39: ('and', 'absy', 4, True), 0x2F: ('and', 'long', 5, False),
+    0x3F: ('and', 'longx', 5, False), 0x23: ('and', 'sr', 4, False), 0x33: ('and', '(sr),y', 7, False),
+
+    0xC9: ('cmp', 'imm', 2, False), 0xC5: ('cmp', 'dp', 3, False), 0xD5: ('cmp', 'dpx', 4, False), 0xD2: ('cmp', '(dp)', 5, False),
+    0xC1: ('cmp', '(dp,x)', 6, False), 0xD1: ('cmp', '(dp),y', 5, True), 0xC7: ('cmp', '[dp]', 6, False), 0xD7: ('cmp', '[dp],y', 6, False),
+    0xCD: ('cmp', 'abs', 4, False), 0xDD: ('cmp', 'absx', 4, True), 0xD9: ('cmp', 'absy', 4, True), 0xCF: ('cmp', 'long', 5, False),
+    0xDF: ('cmp', 'longx', 5, False), 0xC3: ('cmp', 'sr', 4, False), 0xD3: ('cmp', '(sr),y', 7, False),
+
+    0x49: ('eor', 'imm', 2, False), 0x45: ('eor', 'dp', 3, False), 0x55: ('eor', 'dpx', 4, False), 0x52: ('eor', '(dp)', 5, False),
+    0x41: ('eor', '(dp,x)', 6, False), 0x51: ('eor', '(dp),y', 5, True), 0x47: ('eor', '[dp]', 6, False), 0x57: ('eor', '[dp],y', 6, False),
+    0x4D: ('eor', 'abs', 4, False), 0x5D: ('eor', 'absx', 4, True), 0x59: ('eor', 'absy', 4, True), 0x4F: ('eor', 'long', 5, False),
+    0x5F: ('eor', 'longx', 5, False), 0x43: ('eor', 'sr', 4, False), 0x53: ('eor', '(sr),y', 7, False),
+
+    0xA9: ('lda', 'imm', 2, False), 0xA5: ('lda', 'dp', 3, False), 0xB5: ('lda', 'dpx', 4, False), 0xB2: ('lda', '(dp)', 5, False),
+    0xA1: ('lda', '(dp,x)', 6, False), 0xB1: ('lda', '(dp),y', 5, True), 0xA7: ('lda', '[dp]', 6, False), 0xB7: ('lda', '[dp],y', 6, False),
+    0xAD: ('lda', 'abs', 4, False), 0xBD: ('lda', 'absx', 4, True), 0xB9: ('lda', 'absy', 4, True), 0xAF: ('lda', 'long', 5, False),
+    0xBF: ('lda', 'longx', 5, False), 0xA3: ('lda', 'sr', 4, False), 0xB3: ('lda', '(sr),y', 7, False),
+
+    0x09: ('ora', 'imm', 2, False), 0x05: ('ora', 'dp', 3, False), 0x15: ('ora', 'dpx', 4, False), 0x12: ('ora', '(dp)', 5, False),
+    0x01: ('ora', '(dp,x)', 6, False), 0x11: ('ora', '(dp),y', 5, True), 0x07: ('ora', '[dp]', 6, False), 0x17: ('ora', '[dp],y', 6, False),
+    0x0D: ('ora', 'abs', 4, False), 0x1D: ('ora', 'absx', 4, True), 0x19: ('ora', 'absy', 4, True), 0x0F: ('ora', 'long', 5, False),
+    0x1F: ('ora', 'longx', 5, False), 0x03: ('ora', 'sr', 4, False), 0x13: ('ora', '(sr),y', 7, False),
+
+    0xE9: ('sbc', 'imm', 2, False), 0xE5: ('sbc', 'dp', 3, False), 0xF5: ('sbc', 'dpx', 4, False), 0xF2: ('sbc', '(dp)', 5, False),
+    0xE1: ('sbc', '(dp,x)', 6, False), 0xF1: ('sbc', '(dp),y', 5, True), 0xE7: ('sbc', '[dp]', 6, False), 0xF7: ('sbc', '[dp],y', 6, False),
+    0xED: ('sbc', 'abs', 4, False), 0xFD: ('sbc', 'absx', 4, True), 0xF9: ('sbc', 'absy', 4, True), 0xEF: ('sbc', 'long', 5, False),
+    0xFF: ('sbc', 'longx', 5, False), 0xE3: ('sbc', 'sr', 4, False), 0xF3: ('sbc', '(sr),y', 7, False),
+
+    0x85: ('sta', 'dp', 3, False), 0x95: ('sta', 'dpx', 4, False), 0x92: ('sta', '(dp)', 5, False),
+    0x81: ('sta', '(dp,x)', 6, False), 0x91: ('sta', '(dp),y', 6, False), 0x87: ('sta', '[dp]', 6, False), 0x97: ('sta', '[dp],y', 6, False),
+    0x8D: ('sta', 'abs', 4, False), 0x9D: ('sta', 'absx', 5, False), 0x99: ('sta', 'absy', 5, False), 0x8F: ('sta', 'long', 5, False),
+    0x9F: ('sta', 'longx', 5, False), 0x83: ('sta', 'sr', 4, False), 0x93: ('sta', '(sr),y', 7, False),
+
+    0x89: ('bit', 'imm', 2, False), 0x24: ('bit', 'dp', 3, False), 0x34: ('bit', 'dpx', 4, False), 0x2C: ('bit', 'abs', 4, False),
+    0x3C: ('bit', 'absx', 4, True),
+
+    0x64: ('stz', 'dp', 3, False), 0x74: ('stz', 'dpx', 4, False), 0x9C: ('stz', 'abs', 4, False), 0x9E: ('stz', 'absx', 5, False),
+
+    0x0A: ('asl', 'acc', 2, False), 0x06: ('asl', 'dp', 5, False), 0x16: ('asl', 'dpx', 6, False), 0x0E: ('asl', 'abs', 6, False),
+    0x1E: ('asl', 'absx', 7, False),
+    0x2A: ('rol', 'acc', 2, False), 0x26: ('rol', 'dp', 5, False), 0x36: ('rol', 'dpx', 6, False), 0x2E: ('rol', 'abs', 6, False),
+    0x3E: ('rol', 'absx', 7, False),
+    0x4A: ('lsr', 'acc', 2, False), 0x46: ('lsr', 'dp', 5, False), 0x56: ('lsr', 'dpx', 6, False), 0x4E: ('lsr', 'abs', 6, False),
+    0x5E: ('lsr', 'absx', 7, False),
+    0x6A: ('ror', 'acc', 2, False), 0x66: ('ror', 'dp', 5, False), 0x76: ('ror', 'dpx', 6, False), 0x6E: ('ror', 'abs', 6, False),
+    0x7E: ('ror', 'absx', 7, False),
+
+    0x1A: ('inc', 'acc', 2, False), 0xE6: ('inc', 'dp', 5, False), 0xF6: ('inc', 'dpx', 6, False), 0xEE: ('inc', 'abs', 6, False),
+    0xFE: ('inc', 'absx', 7, False),
+    0x3A: ('dec', 'acc', 2, False), 0xC6: ('dec', 'dp', 5, False), 0xD6: ('dec', 'dpx', 6, False), 0xCE: ('dec', 'abs', 6, False),
+    0xDE: ('dec', 'absx', 7, False),
+    0xE8: ('inx', 'imp', 2, False), 0xC8: ('iny', 'imp', 2, False), 0xCA: ('dex', 'imp', 2, False), 0x88: ('dey', 'imp', 2, False),
+
+    0x04: ('tsb', 'dp', 5, False), 0x0C: ('tsb', 'abs', 6, False), 0x14: ('trb', 'dp', 5, False), 0x1C: ('trb', 'abs', 6, False),
+
+    0xA2: ('ldx', 'imm', 2, False), 0xA6: ('ldx', 'dp', 3, False), 0xB6: ('ldx', 'dpy', 4, False), 0xAE: ('ldx', 'abs', 4, False),
+    0xBE: ('ldx', 'absy', 4, True),
+    0xA0: ('ldy', 'imm', 2, False), 0xA4: ('ldy', 'dp', 3, False), 0xB4: ('ldy', 'dpx', 4, False), 0xAC: ('ldy', 'abs', 4, False),
+    0xBC: ('ldy', 'absx', 4, True),
+    0x86: ('stx', 'dp', 3, False), 0x96: ('stx', 'dpy', 4, False), 0x8E: ('stx', 'abs', 4, False),
+    0x84: ('sty', 'dp', 3, False), 0x94: ('sty', 'dpx', 4, False), 0x8C: ('sty', 'abs', 4, False),
+    0xE0: ('cpx', 'imm', 2, False), 0xE4: ('cpx', 'dp', 3, False), 0xEC: ('cpx', 'abs', 4, False),
+    0xC0: ('cpy', 'imm', 2, False), 0xC4: ('cpy', 'dp', 3, False), 0xCC: ('cpy', 'abs', 4, False),
+
+    0x80: ('bra', 'rel', 2, False), 0x82: ('brl', 'rel16', 4, False),
+    0x90: ('bcc', 'rel', 2, False), 0xB0: ('bcs', 'rel', 2, False), 0xF0: ('beq', 'rel', 2, False), 0x30: ('bmi', 'rel', 2, False),
+    0xD0: ('bne', 'rel', 2, False), 0x10: ('bpl', 'rel', 2, False), 0x50: ('bvc', 'rel', 2, False), 0x70: ('bvs', 'rel', 2, False),
+
+    0x4C: ('jmp', 'addr', 3, False), 0x6C: ('jmp', '(addr)', 5, False), 0x7C: ('jmp', '(addr,x)', 6, False),
+    0x5C: ('jml', 'far', 4, False), 0xDC: ('jml', '[addr]', 6, False),
+    0x20: ('jsr', 'addr', 6, False), 0xFC: ('jsr', '(addr,x)', 8, False), 0x22: ('jsl', 'far', 8, False),
+    0x60: ('rts', 'imp', 6, False), 0x6B: ('rtl', 'imp', 6, False), 0x40: ('rti', 'imp', 7, False),
+
+    0x48: ('pha', 'imp', 3, False), 0xDA: ('phx', 'imp', 3, False), 0x5A: ('phy', 'imp', 3, False), 0x08: ('php', 'imp', 3, False),
+    0x8B: ('phb', 'imp', 3, False), 0x0B: ('phd', 'imp', 4, False), 0x4B: ('phk', 'imp', 3, False),
+    0x68: ('pla', 'imp', 4, False), 0xFA: ('plx', 'imp', 4, False), 0x7A: ('ply', 'imp', 4, False), 0x28: ('plp', 'imp', 4, False),
+    0xAB: ('plb', 'imp', 4, False), 0x2B: ('pld', 'imp', 5, False),
+    0xF4: ('pea', 'imm16', 5, False), 0xD4: ('pei', 'dp', 6, False), 0x62: ('per', 'rel16', 6, False),
+
+    0x18: ('clc', 'imp', 2, False), 0x38: ('sec', 'imp', 2, False), 0xD8: ('cld', 'imp', 2, False), 0xF8: ('sed', 'imp', 2, False),
+    0x58: ('cli', 'imp', 2, False), 0x78: ('sei', 'imp', 2, False), 0xB8: ('clv', 'imp', 2, False),
+    0xC2: ('rep', 'imm8', 3, False), 0xE2: ('sep', 'imm8', 3, False),
+
+    0xAA: ('tax', 'imp', 2, False), 0xA8: ('tay', 'imp', 2, False), 0x8A: ('txa', 'imp', 2, False), 0x98: ('tya', 'imp', 2, False),
+    0xBA: ('tsx', 'imp', 2, False), 0x9A: ('txs', 'imp', 2, False), 0x9B: ('txy', 'imp', 2, False), 0xBB: ('tyx', 'imp', 2, False),
+    0x5B: ('tcd', 'imp', 2, False), 0x7B: ('tdc', 'imp', 2, False), 0x1B: ('tcs', 'imp', 2, False), 0x3B: ('tsc', 'imp', 2, False),
+    0xEB: ('xba', 'imp', 3, False), 0xFB: ('xce', 'imp', 2, False),
+
+    0x54: ('mvn', 'banks', 7, False), 0x44: ('mvp', 'banks', 7, False),
+
+    0xEA: ('nop', 'imp', 2, False), 0x42: ('wdm', 'imm8', 2, False),
+    0x00: ('brk', 'imm8', 8, False), 0x02: ('cop', 'imm8', 8, False), 0xCB: ('wai', 'imp', 3, False), 0xDB: ('stp', 'imp', 3, False),
+}
+
+# Addressing modes that access data memory, resolved before the instruction is executed.
+DATA_MODES_65816 = {
+    'dp', 'dpx', 'dpy', '(dp)', '(dp,x)', '(dp),y', '[dp]', '[dp],y',
+    'abs', 'absx', 'absy', 'long', 'longx', 'sr', '(sr),y',
+}
+
+
+
+class Cpu65816:
+    """WDC 65816 in native mode. Instructions are decoded with `OPCODES_65816`, and each mnemonic is executed by its `op_` method.
+
+    Only bank 0 is simulated, and decimal mode arithmetic and emulation mode are not supported.
+    The simulated subroutine must return with `rts`.
+    """
+
+    REGISTERS = ('a', 'x', 'y', 's', 'aa', 'xx', 'yy', 'ss', 'p', 'direct_page', 'data_bank', 'program_bank')
+
+    # wiz name (used in `// SIMULATE` tags): bit in p
+    FLAG_NAMES = {
+        'carry': FLAG_C,
+        'zero': FLAG_Z,
+        'nointerrupt': FLAG_I,
+        'decimal': FLAG_D,
+        'overflow': FLAG_V,
+        'negative': FLAG_N,
+    }
+
+    def __init__(self, memory):
+        self.memory = memory
+        # The 16-bit accumulator, `aa` in wiz.
+        self.c = 0
+        self.x = 0
+        self.y = 0
+        self.s = 0x01FF
+        self.d = 0
+        self.dbr = 0
+        self.pbr = 0
+        self.p = FLAG_M_65816 | FLAG_X_65816 | FLAG_I
+        self.pc = 0
+        self.cycles = 0
+        self.opcode_address = 0
+        self.address = None
+
+    def read(self, address):
+        if address > 0xFFFF:
+            raise SimulationError(f"access to bank 0x{address >> 16:02x} at 0x{self.opcode_address:04x}: only bank 0 is simulated")
+        return self.memory[address]
+
+    def write(self, address, value):
+        if address > 0xFFFF:
+            raise SimulationError(f"access to bank 0x{address >> 16:02x} at 0x{self.opcode_address:04x}: only bank 0 is simulated")
+        self.memory[address] = value & 0xFF
+
+    def read_word(self, address):
+        return self.read(address) | (self.read((address + 1) & 0xFFFFFF) << 8)
+
+    def read_long(self, address):
+        return self.read_word(address) | (self.read((address + 2) & 0xFFFFFF) << 16)
+
+    def push(self, value):
+        self.write(self.s, value)
+        self.s = (self.s - 1) & 0xFFFF
+
+    def pull(self):
+        self.s = (self.s + 1) & 0xFFFF
+        return self.read(self.s)
+
+    def push_word(self, value):
+        self.push(value >> 8)
+        self.push(value & 0xFF)
+
+    def pull_word(self):
+        lo = self.pull()
+        return lo | (self.pull() << 8)
+
+    def get_flag(self, flag):
+        return (self.p & flag) != 0
+
+    def set_flag(self, flag, value):
+        if value:
+            self.p |= flag
+        else:
+            self.p &= ~flag
+
+    def set_p(self, value):
+        self.p = value & 0xFF
+        # 8-bit index registers clear the high bytes of x and y.
+        if self.get_flag(FLAG_X_65816):
+            self.x &= 0xFF
+            self.y &= 0xFF
+
+    def memory_width(self):
+        return 1 if self.get_flag(FLAG_M_65816) else 2
+
+    def index_width(self):
+        return 1 if self.get_flag(FLAG_X_65816) else 2
+
+    def get_register(self, name):
+        if name in ('a', 'x', 'y', 's'):
+            return getattr(self, 'c' if name == 'a' else name) & 0xFF
+        elif name in ('aa', 'xx', 'yy', 'ss'):
+            return getattr(self, 'c' if name == 'aa' else name[0])
+        elif name in ('p', 'direct_page', 'data_bank', 'program_bank'):
+            return getattr(self, {'direct_page': 'd', 'data_bank': 'dbr', 'program_bank': 'pbr'}.get(name, name))
+        elif name in self.FLAG_NAMES:
+            return 1 if self.get_flag(self.FLAG_NAMES[name]) else 0
+        else:
+            raise SimulationError(f"unknown register {name}")
+
+    def initialize(self, name, value):
+        if name == 'a':
+            self.c = (self.c & 0xFF00) | (value & 0xFF)
+        elif name == 'aa':
+            self.c = value & 0xFFFF
+        elif name in ('x', 'y'):
+            setattr(self, name, value & 0xFF)
+        elif name in ('xx', 'yy'):
+            setattr(self, name[0], value & (0xFF if self.get_flag(FLAG_X_65816) else 0xFFFF))
+        elif name == 'p':
+            self.set_p(value)
+        elif name == 'direct_page':
+            self.d = value & 0xFFFF
+        elif name == 'data_bank':
+            self.dbr = value & 0xFF
+        elif name in self.FLAG_NAMES:
+            self.set_flag(self.FLAG_NAMES[name], value)
+        else:
+            raise SimulationError(f"cannot initialize register {name}")
+
+    def call(self, entry, return_address):
+        self.push_word((return_address - 1) & 0xFFFF)
+        self.pc = entry
+
+    def set_nz(self, value, width):
+        mask = 0xFF if width == 1 else 0xFFFF
+        self.set_flag(FLAG_Z, (value & mask) == 0)
+        self.set_flag(FLAG_N, (value & (mask ^ (mask >> 1))) != 0)
+        return value & mask
+
+    def fetch(self):
+        value = self.read((self.pbr << 16) | self.pc)
+        self.pc = (self.pc + 1) & 0xFFFF
+        return value
+
+    def fetch_word(self):
+        lo = self.fetch()
+        return lo | (self.fetch() << 8)
+
+    def fetch_long(self):
+        lo = self.fetch_word()
+        return lo | (self.fetch() << 16)
+
+    def direct(self, offset):
+        if self.d & 0xFF:
+            self.cycles += 1
+        return (self.d + offset) & 0xFFFF
+
+    # Returns (effective address, page crossed)
+    def effective_address(self, mode):
+        bank = self.dbr << 16
+        if mode == 'dp':
+            return self.direct(self.fetch()), False
+        elif mode == 'dpx':
+            return self.direct(self.fetch() + self.x), False
+        elif mode == 'dpy':
+            return self.direct(self.fetch() + self.y), False
+        elif mode == '(dp)':
+            return bank | self.read_word(self.direct(self.fetch())), False
+        elif mode == '(dp,x)':
+            return bank | self.read_word(self.direct(self.fetch() + self.x)), False
+        elif mode == '(dp),y':
+            base = bank | self.read_word(self.direct(self.fetch()))
+            address = (base + self.y) & 0xFFFFFF
+            return address, (base & 0xFFFF00) != (address & 0xFFFF00)
+        elif mode == '[dp]':
+            return self.read_long(self.direct(self.fetch())), False
+        elif mode == '[dp],y':
+            return (self.read_long(self.direct(self.fetch())) + self.y) & 0xFFFFFF, False
+        elif mode == 'abs':
+            return bank | self.fetch_word(), False
+        elif mode == 'absx' or mode == 'absy':
+            base = bank | self.fetch_word()
+            address = (base + (self.x if mode == 'absx' else self.y)) & 0xFFFFFF
+            return address, (base & 0xFFFF00) != (address & 0xFFFF00)
+        elif mode == 'long':
+            return self.fetch_long(), False
+        elif mode == 'longx':
+            return (self.fetch_long() + self.x) & 0xFFFFFF, False
+        elif mode == 'sr':
+            return (self.s + self.fetch()) & 0xFFFF, False
+        elif mode == '(sr),y':
+            return ((bank | self.read_word((self.s + self.fetch()) & 0xFFFF)) + self.y) & 0xFFFFFF, False
+        else:
+            raise SimulationError(f"unsupported addressing mode {mode}")
+
+    def load(self, mode, width):
+        """Reads the operand of the current instruction, adding a cycle for its second byte."""
+
+        if mode == 'acc':
+            return self.c & (0xFF if width == 1 else 0xFFFF)
+        self.cycles += width - 1
+        if mode == 'imm':
+            return self.fetch() if width == 1 else self.fetch_word()
+        return self.read(self.address) if width == 1 else self.read_word(self.address)
+
+    def store(self, mode, value, width):
+        if mode == 'acc':
+            self.set_accumulator(value, width)
+            return
+        self.cycles += width - 1
+        self.write(self.address, value)
+        if width == 2:
+            self.write((self.address + 1) & 0xFFFFFF, value >> 8)
+
+    def set_accumulator(self, value, width):
+        if width == 1:
+            self.c = (self.c & 0xFF00) | (value & 0xFF)
+        else:
+            self.c = value & 0xFFFF
+
+    def set_index(self, name, value):
+        setattr(self, name, value & (0xFF if self.index_width() == 1 else 0xFFFF))
+
+    def branch(self, taken, offset):
+        if taken:
+            self.pc = (self.pc + offset) & 0xFFFF
+            self.cycles += 1
+
+    def step(self):
+        self.opcode_address = self.pc
+        opcode = self.fetch()
+        mnemonic, mode, cycles, index_penalty = OPCODES_65816[opcode]
+        self.cycles += cycles
+
+        self.address = None
+        if mode in DATA_MODES_65816:
+            self.address, page_crossed = self.effective_address(mode)
+            if index_penalty and (page_crossed or self.index_width() == 2):
+                self.cycles += 1
+
+        if mnemonic in BRANCH_CONDITIONS:
+            offset = self.fetch()
+            flag, expected = BRANCH_CONDITIONS[mnemonic]
+            self.branch(self.get_flag(flag) == expected, offset - 0x100 if offset & 0x80 else offset)
+        else:
+            getattr(self, 'op_' + mnemonic)(mode)
+
+    def add(self, value, width):
+        if self.get_flag(FLAG_D):
+            raise SimulationError(f"decimal mode arithmetic is not supported (at 0x{self.opcode_address:04x})")
+
+        mask = 0xFF if width == 1 else 0xFFFF
+        sign = mask ^ (mask >> 1)
+        accumulator = self.c & mask
+        result = accumulator + value + (1 if self.get_flag(FLAG_C) else 0)
+        self.set_flag(FLAG_C, result > mask)
+        self.set_flag(FLAG_V, (~(accumulator ^ value) & (accumulator ^ result) & sign) != 0)
+        self.set_accumulator(self.set_nz(result, width), width)
+
+    def compare(self, register, value, width):
+        result = (register & (0xFF if width == 1 else 0xFFFF)) - value
+        self.set_flag(FLAG_C, result >= 0)
+        self.set_nz(result, width)
+
+    def op_lda(self, mode):
+        width = self.memory_width()
+        self.set_accumulator(self.set_nz(self.load(mode, width), width), width)
+
+    def op_ldx(self, mode):
+        width = self.index_width()
+        self.x = self.set_nz(self.load(mode, width), width)
+
+    def op_ldy(self, mode):
+        width = self.index_width()
+        self.y = self.set_nz(self.load(mode, width), width)
+
+    def op_sta(self, mode):
+        self.store(mode, self.c, self.memory_width())
+
+    def op_stx(self, mode):
+        self.store(mode, self.x, self.index_width())
+
+    def op_sty(self, mode):
+        self.store(mode, self.y, self.index_width())
+
+    def op_stz(self, mode):
+        self.store(mode, 0, self.memory_width())
+
+    def op_adc(self, mode):
+        width = self.memory_width()
+        self.add(self.load(mode, width), width)
+
+    def op_sbc(self, mode):
+        width = self.memory_width()
+        self.add(self.load(mode, width) ^ (0xFF if width == 1 else 0xFFFF), width)
+
+    def op_and(self, mode):
+        width = self.memory_width()
+        self.set_accumulator(self.set_nz(self.c & self.load(mode, width), width), width)
+
+    def op_ora(self, mode):
+        width = self.memory_width()
+        self.set_accumulator(self.set_nz(self.c | self.load(mode, width), width), width)
+
+    def op_eor(self, mode):
+        width = self.memory_width()
+        self.set_accumulator(self.set_nz(self.c ^ self.load(mode, width), width), width)
+
+    def op_cmp(self, mode):
+        width = self.memory_width()
+        self.compare(self.c, self.load(mode, width), width)
+
+    def op_cpx(self, mode):
+        width = self.index_width()
+        self.compare(self.x, self.load(mode, width), width)
+
+    def op_cpy(self, mode):
+        width = self.index_width()
+        self.compare(self.y, self.load(mode, width), width)
+
+    def op_bit(self, mode):
+        width = self.memory_width()
+        value = self.load(mode, width)
+        self.set_flag(FLAG_Z, (self.c & value & (0xFF if width == 1 else 0xFFFF)) == 0)
+        # The immediate form only affects the zero flag.
+        if mode != 'imm':
+            sign = 0x80 if width == 1 else 0x8000
+            self.set_flag(FLAG_N, (value & sign) != 0)
+            self.set_flag(FLAG_V, (value & (sign >> 1)) != 0)
+
+    def op_asl(self, mode):
+        width = self.memory_width()
+        value = self.load(mode, width)
+        self.set_flag(FLAG_C, (value & (0x80 if width == 1 else 0x8000)) != 0)
+        self.store(mode, self.set_nz(value << 1, width), width)
+
+    def op_lsr(self, mode):
+        width = self.memory_width()
+        value = self.load(mode, width)
+        self.set_flag(FLAG_C, (value & 0x01) != 0)
+        self.store(mode, self.set_nz(value >> 1, width), width)
+
+    def op_rol(self, mode):
+        width = self.memory_width()
+        value = self.load(mode, width)
+        carry = 1 if self.get_flag(FLAG_C) else 0
+        self.set_flag(FLAG_C, (value & (0x80 if width == 1 else 0x8000)) != 0)
+        self.store(mode, self.set_nz((value << 1) | carry, width), width)
+
+    def op_ror(self, mode):
+        width = self.memory_width()
+        value = self.load(mode, width)
+        carry = (0x80 if width == 1 else 0x8000) if self.get_flag(FLAG_C) else 0
+        self.set_flag(FLAG_C, (value & 0x01) != 0)
+        self.store(mode, self.set_nz((value >> 1) | carry, width), width)
+
+    def op_inc(self, mode):
+        width = self.memory_width()
+        self.store(mode, self.set_nz(self.load(mode, width) + 1, width), width)
+
+    def op_dec(self, mode):
+        width = self.memory_width()
+        self.store(mode, self.set_nz(self.load(mode, width) - 1, width), width)
+
+    def op_tsb(self, mode):
+        width = self.memory_width()
+        value = self.load(mode, width)
+        self.set_flag(FLAG_Z, (self.c & value & (0xFF if width == 1 else 0xFFFF)) == 0)
+        self.store(mode, value | self.c, width)
+
+    def op_trb(self, mode):
+        width = self.memory_width()
+        value = self.load(mode, width)
+        self.set_flag(FLAG_Z, (self.c & value & (0xFF if width == 1 else 0xFFFF)) == 0)
+        self.store(mode, value & ~self.c, width)
+
+    def op_inx(self, mode):
+        self.x = self.set_nz(self.x + 1, self.index_width())
+
+    def op_iny(self, mode):
+        self.y = self.set_nz(self.y + 1, self.index_width())
+
+    def op_dex(self, mode):
+        self.x = self.set_nz(self.x - 1, self.index_width())
+
+    def op_dey(self, mode):
+        self.y = self.set_nz(self.y - 1, self.index_width())
+
+    def op_tax(self, mode):
+        self.x = self.set_nz(self.c, self.index_width())
+
+    def op_tay(self, mode):
+        self.y = self.set_nz(self.c, self.index_width())
+
+    def op_txa(self, mode):
+        width = self.memory_width()
+        self.set_accumulator(self.set_nz(self.x, width), width)
+
+    def op_tya(self, mode):
+        width = self.memory_width()
+        self.set_accumulator(self.set_nz(self.y, width), width)
+
+    def op_txy(self, mode):
+        self.y = self.set_nz(self.x, self.index_width())
+
+    def op_tyx(self, mode):
+        self.x = self.set_nz(self.y, self.index_width())
+
+    def op_tsx(self, mode):
+        self.x = self.set_nz(self.s, self.index_width())
+
+    def op_txs(self, mode):
+        self.s = self.x
+
+    def op_tcd(self, mode):
+        self.d = self.set_nz(self.c, 2)
+
+    def op_tdc(self, mode):
+        self.c = self.set_nz(self.d, 2)
+
+    def op_tcs(self, mode):
+        self.s = self.c
+
+    def op_tsc(self, mode):
+        self.c = self.set_nz(self.s, 2)
+
+    def op_xba(self, mode):
+        self.c = ((self.c >> 8) | (self.c << 8)) & 0xFFFF
+        self.set_nz(self.c, 1)
+
+    def op_xce(self, mode):
+        if self.get_flag(FLAG_C):
+            raise SimulationError(f"emulation mode is not supported (at 0x{self.opcode_address:04x})")
+
+    def op_pha(self, mode):
+        if self.memory_width() == 2:
+            self.push(self.c >> 8)
+            self.cycles += 1
+        self.push(self.c & 0xFF)
+
+    def op_phx(self, mode):
+        if self.index_width() == 2:
+            self.push(self.x >> 8)
+            self.cycles += 1
+        self.push(self.x & 0xFF)
+
+    def op_phy(self, mode):
+        if self.index_width() == 2:
+            self.push(self.y >> 8)
+            self.cycles += 1
+        self.push(self.y & 0xFF)
+
+    def op_pla(self, mode):
+        width = self.memory_width()
+        value = self.pull()
+        if width == 2:
+            value |= self.pull() << 8
+            self.cycles += 1
+        self.set_accumulator(self.set_nz(value, width), width)
+
+    def op_plx(self, mode):
+        width = self.index_width()
+        value = self.pull()
+        if width == 2:
+            value |= self.pull() << 8
+            self.cycles += 1
+        self.x = self.set_nz(value, width)
+
+    def op_ply(self, mode):
+        width = self.index_width()
+        value = self.pull()
+        if width == 2:
+            value |= self.pull() << 8
+            self.cycles += 1
+        self.y = self.set_nz(value, width)
+
+    def op_php(self, mode):
+        self.push(self.p)
+
+    def op_plp(self, mode):
+        self.set_p(self.pull())
+
+    def op_phb(self, mode):
+        self.push(self.dbr)
+
+    def op_plb(self, mode):
+        self.dbr = self.set_nz(self.pull(), 1)
+
+    def op_phd(self, mode):
+        self.push_word(self.d)
+
+    def op_pld(self, mode):
+        self.d = self.set_nz(self.pull_word(), 2)
+
+    def op_phk(self, mode):
+        self.push(self.pbr)
+
+    def op_pea(self, mode):
+        self.push_word(self.fetch_word())
+
+    def op_pei(self, mode):
+        self.push_word(self.read_word(self.address))
+
+    def op_per(self, mode):
+        offset = self.fetch_word()
+        self.push_word((self.pc + offset) & 0xFFFF)
+
+    def op_clc(self, mode):
+        self.set_flag(FLAG_C, False)
+
+    def op_sec(self, mode):
+        self.set_flag(FLAG_C, True)
+
+    def op_cld(self, mode):
+        self.set_flag(FLAG_D, False)
+
+    def op_sed(self, mode):
+        self.set_flag(FLAG_D, True)
+
+    def op_cli(self, mode):
+        self.set_flag(FLAG_I, False)
+
+    def op_sei(self, mode):
+        self.set_flag(FLAG_I, True)
+
+    def op_clv(self, mode):
+        self.set_flag(FLAG_V, False)
+
+    def op_rep(self, mode):
+        self.set_p(self.p & ~self.fetch())
+
+    def op_sep(self, mode):
+        self.set_p(self.p | self.fetch())
+
+    def op_bra(self, mode):
+        offset = self.fetch()
+        self.branch(True, offset - 0x100 if offset & 0x80 else offset)
+
+    def op_brl(self, mode):
+        offset = self.fetch_word()
+        self.pc = (self.pc + offset) & 0xFFFF
+
+    def op_jmp(self, mode):
+        address = self.fetch_word()
+        if mode == '(addr)':
+            address = self.read_word(address)
+        elif mode == '(addr,x)':
+            address = self.read_word((self.pbr << 16) | ((address + self.x) & 0xFFFF))
+        self.pc = address
+
+    def op_jml(self, mode):
+        if mode == '[addr]':
+            address = self.read_long(self.fetch_word())
+        else:
+            address = self.fetch_long()
+        self.pbr = address >> 16
+        self.pc = address & 0xFFFF
+
+    def op_jsr(self, mode):
+        address = self.fetch_word()
+        self.push_word((self.pc - 1) & 0xFFFF)
+        if mode == '(addr,x)':
+            address = self.read_word((self.pbr << 16) | ((address + self.x) & 0xFFFF))
+        self.pc = address
+
+    def op_jsl(self, mode):
+        address = self.fetch_long()
+        self.push(self.pbr)
+        self.push_word((self.pc - 1) & 0xFFFF)
+        self.pbr = address >> 16
+        self.pc = address & 0xFFFF
+
+    def op_rts(self, mode):
+        self.pc = (self.pull_word() + 1) & 0xFFFF
+
+    def op_rtl(self, mode):
+        self.pc = (self.pull_word() + 1) & 0xFFFF
+        self.pbr = self.pull()
+
+    def op_rti(self, mode):
+        self.set_p(self.pull())
+        self.pc = self.pull_word()
+        self.pbr = self.pull()
+
+    def op_mvn(self, mode):
+        self.block_move(1)
+
+    def op_mvp(self, mode):
+        self.block_move(-1)
+
+    def block_move(self, step):
+        destination_bank = self.fetch()
+        source_bank = self.fetch()
+        self.dbr = destination_bank
+        self.write((destination_bank << 16) | self.y, self.read((source_bank << 16) | self.x))
+        self.set_index('x', self.x + step)
+        self.set_index('y', self.y + step)
+        self.c = (self.c - 1) & 0xFFFF
+        # The instruction repeats itself until the count in `aa` underflows.
+        if self.c != 0xFFFF:
+            self.pc = self.opcode_address
+
+    def op_nop(self, mode):
+        pass
+
+    def op_wdm(self, mode):
+        self.fetch()
+
+    def op_brk(self, mode):
+        raise SimulationError(f"brk executed at 0x{self.opcode_address:04x}")
+
+    def op_cop(self, mode):
+        raise SimulationError(f"cop executed at 0x{self.opcode_address:04x}")
+
+    def op_wai(self, mode):
+        raise SimulationError(f"wai executed at 0x{self.opcode_address:04x}")
+
+    def op_stp(self, mode):
+        raise SimulationError(f"stp executed at 0x{self.opcode_address:04x}")
+
+
+
+CORES = {
+    '6502': Cpu6502,
+    'z80': CpuZ80,
+    'gb': CpuSm83,
+    'spc700': CpuSpc700,
+    'wdc65816': Cpu65816,
+}
+
+
+def is_register_name(name):
+    """Returns whether `name` is a register or flag of any simulated CPU."""
+
+    return any(name in core.REGISTERS or name in core.FLAG_NAMES for core in CORES.values())
+
+
+
+class SimulationResult:
+    def __init__(self, cpu):
+        self.cpu = cpu
+        self.cycles = cpu.cycles
+
+    def get_register(self, name):
+        return self.cpu.get_register(name)
+
+    def read(self, address):
+        return self.cpu.read(address)
+
+
+
+def simulate(system, binary, entry, registers, memory):
+    """Calls the subroutine at `entry` and runs it until it returns.
+
+    `registers` maps register and flag names to their initial values,
+    `memory` maps addresses to initial byte values.
+
+    The returned cycle count includes the final return instruction, but not
+    the call that would have called the subroutine.
+    """
+
+    if system not in LOAD_ADDRESSES:
+        raise SimulationError(f"system {system} cannot be simulated")
+
+    load_address = LOAD_ADDRESSES[system]
+    if load_address + len(binary) > 0x10000:
+        raise SimulationError(f"output binary does not fit in the address space")
+
+    ram = bytearray(0x10000)
+    ram[load_address:load_address + len(binary)] = binary
+
+    for address, value in memory.items():
+        ram[address & 0xFFFF] = value & 0xFF
+
+    cpu = CORES[system](ram)
+    for name, value in registers.items():
+        cpu.initialize(name, value)
+
+    cpu.call(entry, RETURN_ADDRESS)
+
+    for _ in range(MAX_STEPS):
+        if cpu.pc == RETURN_ADDRESS:
+            return SimulationResult(cpu)
+        cpu.step()
+
+    raise SimulationError(f"subroutine at 0x{entry:04x} did not return within {MAX_STEPS} instructions")
@@ -9,10 +9,55 @@ import shlex
 
 from collections import namedtuple
 
+import wizsim
+
 ALL_SYSTEMS = ['6502', '65c02', 'rockwell65c02', 'wdc65c02', 'huc6280', 'wdc65816', 'spc700', 'z80', 'gb' ]
 
-TestFile = namedtuple('TestFile', ('filename', 'systems', 'blocks', 'errors', 'references'))
+TestFile = namedtuple('TestFile', ('filename', 'systems', 'blocks', 'errors', 'error_messages', 'references', 'simulations'))
 BlockData = namedtuple('BlockData', ('address', 'data'))
+Simulation = namedtuple('Simulation', ('lineno', 'entry', 'registers', 'memory', 'expected_registers', 'expected_memory', 'cycles'))
+
+def read_simulate_tag(filename, lineno, line):
+    # // SIMULATE aaaa [name=bb]* [[aaaa]=bb]* => [name=bb]* [[aaaa]=bb]* [cycles=n]
+    #  where aaaa = address of the subroutine/memory in hex
+    #          bb = register/flag/memory value in hex
+    #           n = expected number of cycles in decimal
+    _simulate_regex = re.compile(r'// SIMULATE\s+(?:0x)?([0-9A-Fa-f]{4})((?:\s+[^\s=]+=\S+)*)\s+=>((?:\s+[^\s=]+=\S+)*)\s*$')
+    _memory_regex = re.compile(r'\[(?:0x)?([0-9A-Fa-f]{1,4})\]')
+
+    m = _simulate_regex.search(line)
+    if not m:
+        raise ValueError(f"{filename}:{lineno}: Invalid `// SIMULATE` tag")
+
+    def parse_assignments(text, allow_cycles):
+        registers = dict()
+        memory = dict()
+        cycles = None
+
+        for assignment in text.split():
+            name, value = assignment.split('=', 1)
+            name = name.lower()
+
+            if allow_cycles and name == 'cycles':
+                cycles = int(value, 10)
+                continue
+
+            value = int(value, 16)
+            mem = _memory_regex.fullmatch(name)
+            if mem:
+                memory[int(mem.group(1), 16)] = value
+            elif wizsim.is_register_name(name):
+                registers[name] = value
+            else:
+                raise ValueError(f"{filename}:{lineno}: Unknown register `{name}` in `// SIMULATE` tag")
+
+        return registers, memory, cycles
+
+    registers, memory, _ = parse_assignments(m.group(2), False)
+    expected_registers, expected_memory, cycles = parse_assignments(m.group(3), True)
+
+    return Simulation(lineno, int(m.group(1), 16), registers, memory, expected_registers, expected_memory, cycles)
+
 
 def read_test_file(filename):
     _system_regex = re.compile(r'// SYSTEM\s+(.+)$')
@@ -21,10 +66,16 @@ def read_test_file(filename):
     #          bb = space separated bytes in hex
     _block_regex =  re.compile(r'// BLOCK(?:\s+(?:0x)?([0-9A-Fa-f]{4,8}))?\s*((?:\s[0-9A-Fa-f]{2})*)(?:\s{2}|$)')
 
+    # // ERROR ["text"]
+    #  where text = part of a message that must be reported on that line (optional)
+    _error_regex = re.compile(r'// ERROR\s+"([^"]+)"')
+
     systems = list()
     blocks = list()
     errors = set()
+    error_messages = list()
     references = set()
+    simulations = list()
 
     previous_block = None
 
@@ -51,6 +102,13 @@ def read_test_file(filename):
             if '// ERROR' in line:
                 errors.add(lineno)
 
+                m = _error_regex.search(line)
+                if m:
+                    error_messages.append((lineno, m.group(1)))
+
+            if '// SIMULATE' in line:
+                simulations.append(read_simulate_tag(filename, lineno, line))
+
             if '// BLOCK' in line:
                 m = _block_regex.search(line)
                 if not m:
@@ -87,10 +145,16 @@ def read_test_file(filename):
     if blocks and references:
         raise ValueError(f"{filename}: Cannot have a `// BLOCK` and a `// REFERENCE` tags in the same test")
 
-    if not blocks and not errors:
-        raise ValueError(f"{filename}: Expected at least one `// BLOCK` or `// ERROR` tag")
+    if simulations and errors:
+        raise ValueError(f"{filename}: Cannot have a `// SIMULATE` and a `// ERROR` tags in the same test")
 
-    return TestFile(filename, systems, blocks, errors, references)
+    if simulations and not any(s in wizsim.SYSTEMS for s in systems):
+        raise ValueError(f"{filename}: `// SIMULATE` tags require a simulated system ({', '.join(sorted(wizsim.SYSTEMS))})")
+
+    if not blocks and not errors and not simulations:
+        raise ValueError(f"{filename}: Expected at least one `// BLOCK`, `// ERROR` or `// SIMULATE` tag")
+
+    return TestFile(filename, systems, blocks, errors, error_messages, references, simulations)
 
 
 
@@ -115,7 +179,7 @@ def block_test(test, bin_fn, returncode, pout, perr):
         with open(bin_fn, 'br') as fp:
             output_binary = fp.read()
 
-        last_byte = max([b.address + len(b.data) for b in test.blocks])
+        last_byte = max([b.address + len(b.data) for b in test.blocks], default=0)
 
         if len(output_binary) < last_byte:
             errors.append(f"{bin_fn}: expected at least {last_byte} bytes in output file")
@@ -137,6 +201,36 @@ def block_test(test, bin_fn, returncode, pout, perr):
 
 
 
+def simulate_test(test, system, bin_fn):
+    errors = list()
+
+    with open(bin_fn, 'br') as fp:
+        output_binary = fp.read()
+
+    for sim in test.simulations:
+        try:
+            result = wizsim.simulate(system, output_binary, sim.entry, sim.registers, sim.memory)
+        except wizsim.SimulationError as e:
+            errors.append(f"{test.filename}:{sim.lineno}: simulation failed: {e}")
+            continue
+
+        for name, expected in sim.expected_registers.items():
+            got = result.get_register(name)
+            if got != expected:
+                errors.append(f"{test.filename}:{sim.lineno}: expected {name}=0x{expected:02x} got 0x{got:02x}")
+
+        for address, expected in sim.expected_memory.items():
+            got = result.read(address)
+            if got != expected:
+                errors.append(f"{test.filename}:{sim.lineno}: expected [0x{address:04x}]=0x{expected:02x} got 0x{got:02x}")
+
+        if sim.cycles is not None and result.cycles != sim.cycles:
+            errors.append(f"{test.filename}:{sim.lineno}: expected {sim.cycles} cycles got {result.cycles}")
+
+    return errors
+
+
+
 def lines_set_to_string(s : set):
     lines = list(s)
     lines.sort()
@@ -172,6 +266,11 @@ def error_test(test, returncode, pout, perr):
         test_perr("error", 'error', test.errors)
         test_perr("reference", 'note', test.references)
 
+        for lineno, text in test.error_messages:
+            regex = re.compile(r"^\s*" + re.escape(test.filename) + ":" + str(lineno) + r": \w+: .*" + re.escape(text), re.MULTILINE)
+            if not regex.search(perr):
+                errors.append(f"Missing message \"{text}\" on line {lineno}")
+
     else:
         errors.append(f"wiz returned EXIT_SUCCESS in an error test")
 
@@ -203,8 +302,10 @@ def do_test(test):
         pout, perr = process.communicate()
 
 
-        if test.blocks:
+        if test.blocks or test.simulations:
             errors = block_test(test, bin_fn, process.returncode, pout, perr)
+            if not errors and test.simulations and system in wizsim.SYSTEMS:
+                errors = simulate_test(test, system, bin_fn)
         else:
             errors = error_test(test, process.returncode, pout, perr)
 
@@ -1,2 +1,3 @@
 copy ..\bin\wiz.js wiz.js
+if exist ..\bin\wiz.wasm copy ..\bin\wiz.wasm wiz.wasm
 pause
\ No newline at end of file